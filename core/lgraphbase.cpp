@@ -2,6 +2,7 @@
 
 #include "lgraphbase.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <set>
 
@@ -204,6 +205,27 @@ Index_id Lgraph_Base::create_node_space(const Index_id last_idx, const Port_ID d
   return idx2;
 }
 
+uint64_t Lgraph_Base::get_node_table_hash() const {
+  static_assert(sizeof(Node_internal) % sizeof(uint64_t) == 0);
+
+  uint64_t h = node_internal.size();
+  if (node_internal.empty())
+    return h;
+
+  node_internal.ref_lock();
+  const auto *bytes = reinterpret_cast<const char *>(node_internal.cbegin());
+  const auto  n     = node_internal.size() * sizeof(Node_internal) / sizeof(uint64_t);
+  for (size_t i = 0; i < n; ++i) {
+    uint64_t word;
+    memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+    h = (h ^ word) * 0x100000001b3ULL;  // FNV style, one multiply per word
+    h ^= h >> 29;
+  }
+  node_internal.ref_unlock();
+
+  return h;
+}
+
 void Lgraph_Base::print_stats() const {
   double bytes = 0;
 
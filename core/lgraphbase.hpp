@@ -127,6 +127,10 @@ public:
   static size_t max_size() { return (((size_t)1) << Index_bits) - 1; }
   size_t        size() const { return node_internal.size(); }
 
+  // hash of the raw node table (types, bits and edges). It is a linear scan
+  // without decoding the edges, to cheaply detect an lgraph edited in place.
+  uint64_t get_node_table_hash() const;
+
   class _init {
   public:
     _init();
@@ -46,6 +46,163 @@ static bool tuple_sort(const std::pair<mmap_lib::str, Node_pin> &lhs, const std:
   return v;
 }
 
+void Lgtuple::unshare() const {
+  if (data.use_count() > 1) {
+    data = std::make_shared<Key_map_data>(*data);
+  }
+}
+
+void Lgtuple::sort_key_map() const {
+  if (data->sorted)
+    return;  // no copy for a shared block that is already sorted
+
+  unshare();
+  std::stable_sort(data->key_map.begin(), data->key_map.end(), tuple_sort);  // mutable (no semantic check. Just faster to process)
+  data->first_level.clear();
+  data->indexed = false;
+  data->sorted  = true;
+}
+
+void Lgtuple::append(const mmap_lib::str &key, const Node_pin &dpin) {
+  unshare();
+  data->key_map.emplace_back(key, dpin);
+  data->sorted = false;
+  if (data->indexed)
+    index_entry(data->key_map.size() - 1);
+}
+
+void Lgtuple::set_key(size_t pos, const mmap_lib::str &key) {
+  unshare();
+  I(pos < data->key_map.size());
+  data->key_map[pos].first = key;
+  data->sorted             = false;
+  if (data->indexed)
+    index_entry(pos);  // old ids stay (superset of candidates is fine)
+}
+
+void Lgtuple::first_level_ids(const mmap_lib::str &key, mmap_lib::str &pos_id, mmap_lib::str &name_id) {
+  pos_id  = mmap_lib::str();
+  name_id = mmap_lib::str();
+
+  if (key.empty())
+    return;
+
+  auto dot_pos = key.find('.');
+  if (key.front() == ':') {  // :3:foo.bar
+    auto n = key.find(':', 1);
+    if (n == std::string::npos) {
+      pos_id = key.substr(1, dot_pos == std::string::npos ? std::string::npos : dot_pos - 1);
+      return;
+    }
+    pos_id = key.substr(1, n - 1);
+    if (dot_pos == std::string::npos || dot_pos < n)
+      name_id = key.substr(n + 1);
+    else
+      name_id = key.substr(n + 1, dot_pos - n - 1);
+    return;
+  }
+
+  auto first = dot_pos == std::string::npos ? key : key.substr(0, dot_pos);
+  if (std::isdigit(first.front()))
+    pos_id = first;
+  else
+    name_id = first;
+}
+
+void Lgtuple::index_entry(size_t pos) const {
+  mmap_lib::str pos_id;
+  mmap_lib::str name_id;
+  first_level_ids(data->key_map[pos].first, pos_id, name_id);
+
+  auto insert = [this, pos](const mmap_lib::str &id) {
+    auto &v = data->first_level[id];
+    if (v.empty() || v.back() < pos) {
+      v.emplace_back(pos);
+      return;
+    }
+    auto it = std::lower_bound(v.begin(), v.end(), pos);
+    if (it == v.end() || *it != pos)
+      v.insert(it, pos);
+  };
+
+  if (!pos_id.empty())
+    insert(pos_id);
+  if (!name_id.empty())
+    insert(name_id);
+  if (pos_id.empty() && name_id.empty())
+    insert(mmap_lib::str());
+}
+
+void Lgtuple::build_index() const {
+  data->first_level.clear();
+  for (auto i = 0u; i < data->key_map.size(); ++i) {
+    index_entry(i);
+  }
+  data->indexed = true;
+}
+
+template <typename Func>
+void Lgtuple::for_each_candidate(const mmap_lib::str &key, bool learn, Func fn) const {
+  const auto n_entries = data->key_map.size();
+  if (n_entries < index_threshold) {
+    for (auto i = 0u; i < n_entries; ++i) {
+      if (!fn(i))
+        return;
+    }
+    return;
+  }
+
+  if (!data->indexed)
+    build_index();
+
+  mmap_lib::str pos_id;
+  mmap_lib::str name_id;
+  first_level_ids(key, pos_id, name_id);
+  if (key.empty())
+    pos_id = mmap_lib::str("0");  // "" matches 0 and :0:xxx
+
+  std::vector<mmap_lib::str> pending{mmap_lib::str()};  // "" entries (if any) are always checked
+  if (!pos_id.empty())
+    pending.emplace_back(pos_id);
+  if (!name_id.empty())
+    pending.emplace_back(name_id);
+
+  std::vector<mmap_lib::str> visited;
+  std::vector<uint32_t>      cand;
+  while (!pending.empty()) {
+    auto id = pending.back();
+    pending.pop_back();
+    if (std::find(visited.begin(), visited.end(), id) != visited.end())
+      continue;
+    visited.emplace_back(id);
+
+    auto it = data->first_level.find(id);
+    if (it == data->first_level.end())
+      continue;
+
+    for (auto pos : it->second) {
+      cand.emplace_back(pos);
+      if (!learn)
+        continue;
+      mmap_lib::str e_pos_id;
+      mmap_lib::str e_name_id;
+      first_level_ids(data->key_map[pos].first, e_pos_id, e_name_id);
+      if (!e_pos_id.empty())
+        pending.emplace_back(e_pos_id);
+      if (!e_name_id.empty())
+        pending.emplace_back(e_name_id);
+    }
+  }
+
+  std::sort(cand.begin(), cand.end());
+  cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+
+  for (auto pos : cand) {
+    if (!fn(pos))
+      return;
+  }
+}
+
 std::tuple<bool, size_t, size_t> Lgtuple::match_int_advance(const mmap_lib::str &a, const mmap_lib::str &b, size_t a_pos, size_t b_pos) {
   I(a[a_pos] == ':');
   I(b[b_pos] != ':');
@@ -358,21 +515,21 @@ void Lgtuple::add_int(const mmap_lib::str &key, const std::shared_ptr<Lgtuple co
   I(!key.empty());
   if (tup->is_scalar()) {
     I(!has_dpin(key));  // It was deleted before
-    key_map.emplace_back(key, tup->get_dpin());
+    append(key, tup->get_dpin());
     return;
   }
 
   bool root = is_root_attribute(key);
-  for (auto &ent : tup->key_map) {
+  for (auto &ent : tup->get_map()) {
     if (root) {
-      key_map.emplace_back(mmap_lib::str::concat(ent.first, ".", key), ent.second);
+      append(mmap_lib::str::concat(ent.first, ".", key), ent.second);
     } else {
-      key_map.emplace_back(mmap_lib::str::concat(key, ".", ent.first), ent.second);
+      append(mmap_lib::str::concat(key, ".", ent.first), ent.second);
     }
   }
 }
 
-void Lgtuple::reconnect_flop_if_needed(Node &flop, const mmap_lib::str &flop_name, Node_pin &dpin) {
+void Lgtuple::reconnect_flop_if_needed(Node &flop, const mmap_lib::str &flop_name, const Node_pin &dpin) {
   flop.setup_driver_pin().reset_name(mmap_lib::str(flop_name));
 
   auto s_din = flop.setup_sink_pin("din");
@@ -501,23 +658,37 @@ mmap_lib::str Lgtuple::get_all_but_first_level(const mmap_lib::str &key) {
 mmap_lib::str Lgtuple::learn_fix(const mmap_lib::str &a) {
   mmap_lib::str key{a};
 
-  for (auto &e : key_map) {
-    std::tie(key, e.first) = learn_fix_int(key, e.first);
-  }
+  for_each_candidate(a, true, [this, &key](size_t pos) {
+    const auto &entry = data->key_map[pos].first;
+
+    auto [new_key, new_entry] = learn_fix_int(key, entry);
+    key                       = new_key;
+    if (new_entry != entry)
+      set_key(pos, new_entry);
+    return true;
+  });
 
   return key;
 }
 
 const Node_pin &Lgtuple::get_dpin(const mmap_lib::str &key) const {
-  for (auto &e : key_map) {
-    if (match(e.first, key))
-      return e.second;
-  }
+  int found = -1;
+  for_each_candidate(key, false, [this, &key, &found](size_t pos) {
+    if (!match(data->key_map[pos].first, key))
+      return true;
+    found = static_cast<int>(pos);
+    return false;
+  });
+
+  if (found < 0)
+    return invalid_dpin;
 
-  return invalid_dpin;
+  return data->key_map[found].second;
 }
 
 const Node_pin &Lgtuple::get_dpin() const {
+  const auto &key_map = get_map();
+
   int pos = -1;
   for (auto i = 0u; i < key_map.size(); ++i) {
     if (is_attribute(key_map[i].first))
@@ -533,11 +704,12 @@ const Node_pin &Lgtuple::get_dpin() const {
 }
 
 bool Lgtuple::has_dpin(const mmap_lib::str &key) const {
-  for (auto &e : key_map) {
-    if (match(e.first, key))
-      return true;
-  }
-  return false;
+  bool found = false;
+  for_each_candidate(key, false, [this, &key, &found](size_t pos) {
+    found = match(data->key_map[pos].first, key);
+    return !found;
+  });
+  return found;
 }
 
 std::shared_ptr<Lgtuple> Lgtuple::get_sub_tuple(const mmap_lib::str &key) const {
@@ -549,11 +721,12 @@ std::shared_ptr<Lgtuple> Lgtuple::get_sub_tuple(const mmap_lib::str &key) const
 
   std::shared_ptr<Lgtuple> tup;
 
-  for (auto &e : key_map) {
+  for_each_candidate(key, false, [this, &key, &tup](size_t pos) {
+    const auto          &e = data->key_map[pos];
     const mmap_lib::str &entry(e.first);
     auto             e_pos = match_first_partial(key, entry);
     if (e_pos == 0)
-      continue;
+      return true;
     GI(e_pos<entry.size(), entry[e_pos] != '.');  // . not included
 
     if (!tup) {
@@ -564,17 +737,18 @@ std::shared_ptr<Lgtuple> Lgtuple::get_sub_tuple(const mmap_lib::str &key) const
     }
 
     if (e_pos >= entry.size()) {
-      tup->key_map.emplace_back("0", e.second);
+      tup->append("0"_str, e.second);
     } else {
       auto key2 = entry.substr(e_pos);
       I(!key2.empty());
       if (is_root_attribute(key2)) {
-        tup->key_map.emplace_back(mmap_lib::str::concat("0."_str, key2), e.second);
+        tup->append(mmap_lib::str::concat("0."_str, key2), e.second);
       } else {
-        tup->key_map.emplace_back(key2, e.second);
+        tup->append(key2, e.second);
       }
     }
-  }
+    return true;
+  });
 
   if (!is_correct())
     tup->set_issue();
@@ -587,7 +761,7 @@ std::shared_ptr<Lgtuple> Lgtuple::get_sub_tuple(const std::shared_ptr<Lgtuple co
   std::shared_ptr<Lgtuple> ret_tup;
 
   int pos = 0;
-  for (const auto &e : tup->key_map) {
+  for (const auto &e : tup->get_map()) {
     mmap_lib::str e_name{e.first};
     (void)e_name;
     auto e_node = e.second.get_node();
@@ -610,7 +784,7 @@ std::shared_ptr<Lgtuple> Lgtuple::get_sub_tuple(const std::shared_ptr<Lgtuple co
     if (!ret_tup) {
       ret_tup = std::make_shared<Lgtuple>(get_name());
     }
-    ret_tup->key_map.emplace_back(std::to_string(pos), dpin);
+    ret_tup->append(mmap_lib::str(pos), dpin);
     ++pos;
   }
 
@@ -621,7 +795,8 @@ std::shared_ptr<Lgtuple> Lgtuple::get_sub_tuple(const std::shared_ptr<Lgtuple co
 
 void Lgtuple::del(const mmap_lib::str &key) {
   if (key.empty()) {
-    key_map.clear();
+    if (!data->key_map.empty())
+      data = std::make_shared<Key_map_data>();
     return;
   }
 
@@ -631,37 +806,73 @@ void Lgtuple::del(const mmap_lib::str &key) {
   }
 #endif
 
-  Key_map_type new_map;
+  std::vector<uint32_t> del_pos;
 
   bool is_attr_key = is_root_attribute(key);
 
-  for (auto &e : key_map) {
-    mmap_lib::str entry{e.first};
+  // Only the candidates can be deleted ("" entries are always candidates)
+  for_each_candidate(key, false, [this, &key, &del_pos, is_attr_key](size_t pos) {
+    const mmap_lib::str &entry = data->key_map[pos].first;
     if (entry.empty()) {
-      if (is_attr_key) {
-        new_map.emplace_back(std::move(e));
+      if (!is_attr_key) {
+        del_pos.emplace_back(pos);  // "" keys must be gone by now
       }
-      continue;  // "" keys must be gone by now
+      return true;
     }
 
     auto e_pos = match_first_partial(key, entry);
     if (e_pos == 0) {
-      new_map.emplace_back(std::move(e));
-      continue;
+      return true;
+    }
+    if (e_pos >= entry.size()) {
+      del_pos.emplace_back(pos);  // full match?
+      return true;
     }
-    if (e_pos >= entry.size())
-      continue;  // full match?
 
     I(entry[e_pos] != '.');  // not . included
 
     auto sub_name = entry.substr(e_pos);
     if (sub_name.substr(0, 2) == "__" && sub_name[3] != '_') {
-      new_map.emplace_back(std::move(e));
-      continue;  // Keep the attributes
+      return true;  // Keep the attributes
     }
+    del_pos.emplace_back(pos);
+    return true;
+  });
+
+  if (del_pos.empty())
+    return;
+
+  unshare();
+
+  Key_map_type new_map;
+  new_map.reserve(data->key_map.size() - del_pos.size());
+
+  auto del_it = del_pos.begin();
+  for (auto i = 0u; i < data->key_map.size(); ++i) {
+    if (del_it != del_pos.end() && *del_it == i) {
+      ++del_it;
+      continue;
+    }
+    new_map.emplace_back(std::move(data->key_map[i]));
   }
 
-  key_map.swap(new_map);
+  data->key_map.swap(new_map);
+
+  if (!data->indexed)
+    return;
+
+  // Shift the index instead of rebuilding it (no need to parse the keys again)
+  for (auto &it : data->first_level) {
+    auto &v     = it.second;
+    auto  v_end = 0u;
+    for (auto pos : v) {
+      auto d = std::lower_bound(del_pos.begin(), del_pos.end(), pos);
+      if (d != del_pos.end() && *d == pos)
+        continue;
+      v[v_end++] = pos - static_cast<uint32_t>(d - del_pos.begin());
+    }
+    v.resize(v_end);
+  }
 }
 
 void Lgtuple::add(const mmap_lib::str &key, const std::shared_ptr<Lgtuple const>& tup) {
@@ -675,7 +886,7 @@ void Lgtuple::add(const mmap_lib::str &key, const std::shared_ptr<Lgtuple const>
 
   bool tup_scalar = tup->is_scalar();
 
-  for (const auto &e : tup->key_map) {
+  for (const auto &e : tup->get_map()) {
     mmap_lib::str key2;
     // Remove 0. from tup if tup is scalar
     if (tup_scalar && e.first.front() == '0' && (e.first.size() == 1 || e.first[1] == '.')) {
@@ -734,7 +945,10 @@ void Lgtuple::add(const mmap_lib::str &key, const Node_pin &dpin) {
     if (is_attribute(fixed_key)) {
       key_part = get_all_but_last_level(fixed_key);
     }
-    for (auto &e : key_map) {
+    // Only entries with the same first level can be a prefix of key_part
+    bool done = false;
+    for_each_candidate(key_part, false, [this, &key_part, &fixed_key, &dpin, &done](size_t pos) {
+      const auto   &e = data->key_map[pos];
       mmap_lib::str fpart{e.first};
       mmap_lib::str lpart;
       if (is_attribute(e.first)) {
@@ -743,28 +957,32 @@ void Lgtuple::add(const mmap_lib::str &key, const Node_pin &dpin) {
       }
 
       if (fpart.size() >= key_part.size())
-        continue;
+        return true;
 
       // NOTE: full match foo.bar == foo not foo.bar == foo match
       if (key_part[fpart.size()] == '.' && fpart == key_part.substr(0, fpart.size())) {
         if (lpart.empty())
-          e.first = mmap_lib::str::concat(fpart, ".0"sv);
+          set_key(pos, mmap_lib::str::concat(fpart, ".0"sv));
         else
-          e.first = mmap_lib::str::concat(fpart, ".0.", lpart);
-        if (e.first == fixed_key) {
-          e.second = dpin;
-          return;
+          set_key(pos, mmap_lib::str::concat(fpart, ".0.", lpart));
+        if (data->key_map[pos].first == fixed_key) {
+          data->key_map[pos].second = dpin;
+          done = true;
+          return false;
         }
       }
-    }
+      return true;
+    });
+    if (done)
+      return;
   }
 
   I(!has_dpin(fixed_key));
   I(!fixed_key.empty());
-  key_map.emplace_back(fixed_key, dpin);
+  append(fixed_key, dpin);
 
 #ifdef DEBUG_SLOW
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     auto lower = get_all_but_last_level(e.first);
     if (is_attribute(e.first)) {
       lower = get_all_but_last_level(lower);
@@ -788,7 +1006,7 @@ bool Lgtuple::concat(const std::shared_ptr<Lgtuple const>& tup) {
 
   std::vector<std::pair<mmap_lib::str, Node_pin>> delayed_numbers;
 
-  for (auto &it : tup->key_map) {
+  for (auto &it : tup->get_map()) {
     if (has_dpin(it.first)) {
       if (std::isdigit(it.first.front()) && is_single_level(it.first)) {
         delayed_numbers.emplace_back(it.first, it.second);
@@ -802,12 +1020,12 @@ bool Lgtuple::concat(const std::shared_ptr<Lgtuple const>& tup) {
     }
     auto fixed_key = learn_fix(it.first);
     I(!fixed_key.empty());
-    key_map.emplace_back(fixed_key, it.second);
+    append(fixed_key, it.second);
   }
 
   if (delayed_numbers.size()) {
     auto max_pos = 0;
-    for (const auto &e : key_map) {
+    for (const auto &e : get_map()) {
       int x = 0;
       if (e.first.is_i()) {
         x = e.first.to_i();
@@ -825,7 +1043,7 @@ bool Lgtuple::concat(const std::shared_ptr<Lgtuple const>& tup) {
       auto x = e.first.to_i();
       mmap_lib::str new_key(std::to_string(x + max_pos + 1));
 
-      key_map.emplace_back(new_key, e.second);
+      append(new_key, e.second);
     }
   }
 
@@ -923,9 +1141,9 @@ Node_pin Lgtuple::flatten() const {
   Node_pin a_dpin;
   bool     all_const = true;
 
-  std::stable_sort(key_map.begin(), key_map.end(), tuple_sort);  // mutable (no semantic check. Just faster to process)
+  sort_key_map();
 
-  for (auto &e : key_map) {
+  for (auto &e : get_map()) {
     if (is_attribute(e.first))
       continue;
 
@@ -943,7 +1161,7 @@ Node_pin Lgtuple::flatten() const {
 
   if (all_const) {
     Lconst result;
-    for (auto &e : key_map) {
+    for (auto &e : get_map()) {
       if (is_attribute(e.first))
         continue;
       auto v = e.second.get_type_const();
@@ -960,7 +1178,7 @@ Node_pin Lgtuple::flatten() const {
   Node_pin sbits_dpin;
   Node_pin ubits_dpin;
 
-  for (auto &e : key_map) {
+  for (auto &e : get_map()) {
     if (is_attribute(e.first)) {
       auto attr_txt = get_last_level(e.first);
       if (attr_txt == "__sbits")
@@ -1030,7 +1248,8 @@ bool Lgtuple::add_pending(Node &node, std::vector<std::pair<mmap_lib::str, Node_
 std::shared_ptr<Lgtuple> Lgtuple::create_assign(const Node_pin &rhs_dpin) const {
   I(is_correct());
 
-  std::stable_sort(key_map.begin(), key_map.end(), tuple_sort);
+  sort_key_map();
+  const auto &key_map = get_map();
 
   auto tup = std::make_shared<Lgtuple>(get_name());
 
@@ -1054,7 +1273,7 @@ std::shared_ptr<Lgtuple> Lgtuple::create_assign(const Node_pin &rhs_dpin) const
           ubits_dpin = e.second;
 
         I(!e.first.empty());
-        tup->key_map.emplace_back(e.first, e.second);  // Keep all the attributes
+        tup->append(e.first, e.second);  // Keep all the attributes
 
         auto txt = get_all_but_last_level(e.first);
 
@@ -1138,7 +1357,7 @@ std::shared_ptr<Lgtuple> Lgtuple::create_assign(const Node_pin &rhs_dpin) const
     sext_node.setup_sink_pin("b").connect_driver(e.second);
 
     I(!e.first.empty());
-    tup->key_map.emplace_back(e.first, sext_node.setup_driver_pin());
+    tup->append(e.first, sext_node.setup_driver_pin());
 
     if ((i + 1) < pending_entries.size()) {  // no need for last
       auto sra_node = rhs_node.create(Ntype_op::SRA);
@@ -1149,19 +1368,19 @@ std::shared_ptr<Lgtuple> Lgtuple::create_assign(const Node_pin &rhs_dpin) const
     }
   }
 
-  std::stable_sort(tup->key_map.begin(), tup->key_map.end(), tuple_sort);
+  tup->sort_key_map();
 
   return tup;
 }
 
 const Lgtuple::Key_map_type &Lgtuple::get_sort_map() const {
-  std::stable_sort(key_map.begin(), key_map.end(), tuple_sort);  // mutable (no semantic check. Just faster to process)
-  return key_map;
+  sort_key_map();
+  return data->key_map;
 }
 
 bool Lgtuple::concat(const Node_pin &dpin) {
   auto max_pos = 0;
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     int x = 0;
     if (e.first.is_i()) {
       x = e.first.to_i();
@@ -1178,7 +1397,7 @@ bool Lgtuple::concat(const Node_pin &dpin) {
 
   mmap_lib::str new_key(std::to_string(max_pos + 1));
 
-  key_map.emplace_back(new_key, dpin);
+  append(new_key, dpin);
 
   return true;
 }
@@ -1225,32 +1444,37 @@ std::tuple<std::shared_ptr<Lgtuple>, bool> Lgtuple::get_mux_tup(const std::vecto
     bool        found = false;
     mmap_lib::str key{it.first};
 
-    for (auto &e : fixing_tup->key_map) {
-      std::tie(key, e.first) = learn_fix_int(key, e.first);
-      if (key == e.first) {
-        e.first = key;                // Put new expanded name
-        if (is_attribute(e.first)) {  // Attributes merge if invalid from others
-          if (e.second.is_invalid()) {
-            e.second = it.second;
-          } else if (it.second.is_invalid()) {
-            // keep e.second
-          } else if (it.second != e.second) {  // bocanth valid but different
-            e.second.invalidate();
-          }
-        } else if (e.second != it.second) {  // Non-attributes invalidate
+    fixing_tup->for_each_candidate(it.first, true, [&fixing_tup, &it, &key, &found](size_t pos) {
+      auto [new_key, new_entry] = learn_fix_int(key, fixing_tup->data->key_map[pos].first);
+      key                       = new_key;
+      if (new_entry != fixing_tup->data->key_map[pos].first)
+        fixing_tup->set_key(pos, new_entry);
+      if (key != new_entry)
+        return true;
+
+      auto &e = fixing_tup->data->key_map[pos];
+      if (is_attribute(e.first)) {  // Attributes merge if invalid from others
+        if (e.second.is_invalid()) {
+          e.second = it.second;
+        } else if (it.second.is_invalid()) {
+          // keep e.second
+        } else if (it.second != e.second) {  // bocanth valid but different
           e.second.invalidate();
         }
-        found = true;
-        break;
+      } else if (e.second != it.second) {  // Non-attributes invalidate
+        e.second.invalidate();
       }
-    }
+      found = true;
+      return false;
+    });
     if (!found) {
       I(!key.empty());
-      fixing_tup->key_map.emplace_back(key, it.second);
+      fixing_tup->append(key, it.second);
     }
   }
 
-  if (fixing_tup->key_map.empty() || (fixing_tup->key_map.size() == 1 && fixing_tup->key_map[0].first == "0")) {
+  const auto &fixing_map = fixing_tup->get_map();
+  if (fixing_map.empty() || (fixing_map.size() == 1 && fixing_map[0].first == "0")) {
     // Either nothing or key == ""
     return std::tuple(nullptr, false);
   }
@@ -1310,8 +1534,10 @@ std::vector<Node::Compact> Lgtuple::make_mux(Node &mux_node, Node_pin &sel_dpin,
 
   std::vector<Node::Compact> mux_list;
 
+  unshare();  // e.second is updated with the new mux
+
   bool mux_node_reused = false;
-  for (auto &e : key_map) {
+  for (auto &e : data->key_map) {
     if (!e.second.is_invalid()) {  // No need to create mux
       continue;
     }
@@ -1407,7 +1633,7 @@ std::tuple<std::shared_ptr<Lgtuple>, bool> Lgtuple::get_flop_tup(Node &flop) con
 
   auto *lg = flop.get_class_lgraph();
 
-  for (auto &e : key_map) {
+  for (auto &e : get_map()) {
     if (e.second.is_invalid()) {
       pending_iterations = true;
     }
@@ -1435,7 +1661,7 @@ std::tuple<std::shared_ptr<Lgtuple>, bool> Lgtuple::get_flop_tup(Node &flop) con
     }
 
     I(!e.first.empty());
-    ret_tup->key_map.emplace_back(e.first, dpin);
+    ret_tup->append(e.first, dpin);
   }
 
   return std::tuple(ret_tup, pending_iterations);
@@ -1462,14 +1688,14 @@ std::shared_ptr<Lgtuple> Lgtuple::make_flop(Node &flop) const {
 
   std::shared_ptr<Lgtuple> ret_tup;
 
-  std::stable_sort(key_map.begin(), key_map.end(), tuple_sort);  // mutable (no semantic check. Just faster to process)
+  sort_key_map();
 
   auto *lg = flop.get_class_lgraph();
 
   std::vector<Node>                             all_flops;
   std::vector<std::pair<mmap_lib::str, Node_pin>> multi_flop_attrs;
 
-  for (auto &e : key_map) {
+  for (auto &e : get_map()) {
     auto [attr, new_flop_name] = get_flop_attr_name(flop_root_name, e.first);
 
     auto flop_dpin = Node_pin::find_driver_pin(lg, new_flop_name);
@@ -1487,7 +1713,7 @@ std::shared_ptr<Lgtuple> Lgtuple::make_flop(Node &flop) const {
         ret_tup = std::make_shared<Lgtuple>(flop_root_name);
       }
       I(!e.first.empty());
-      ret_tup->key_map.emplace_back(e.first, flop_dpin);
+      ret_tup->append(e.first, flop_dpin);
       continue;
     }
     // ATTR PATH
@@ -1581,7 +1807,7 @@ std::vector<std::pair<mmap_lib::str, Node_pin>> Lgtuple::get_level_attributes(co
   std::vector<std::pair<mmap_lib::str, Node_pin>> v;
 
   if (key.empty() || is_scalar()) {
-    for (const auto &e : key_map) {
+    for (const auto &e : get_map()) {
       if (!is_attribute(e.first))
         continue;
       v.emplace_back(e.first, e.second);
@@ -1590,26 +1816,28 @@ std::vector<std::pair<mmap_lib::str, Node_pin>> Lgtuple::get_level_attributes(co
     return v;
   }
 
-  for (const auto &e : key_map) {
+  for_each_candidate(key, false, [this, &key, &v](size_t pos) {
+    const auto   &e = data->key_map[pos];
     mmap_lib::str entry{e.first};
     auto             e_pos = match_first_partial(key, entry);
     if (e_pos == 0 || e_pos >= entry.size())
-      continue;
+      return true;
 
     I(entry[e_pos] != '.');  // . not included
 
     if (!is_root_attribute(entry.substr(e_pos)))
-      continue;
+      return true;
 
     v.emplace_back(entry.substr(e_pos), e.second);
-  }
+    return true;
+  });
 
   return v;
 }
 
 bool Lgtuple::is_scalar() const {
   auto conta = 0;
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     if (is_attribute(e.first))
       continue;
     if (conta > 0)
@@ -1620,7 +1848,7 @@ bool Lgtuple::is_scalar() const {
 }
 
 bool Lgtuple::is_ordered() const {
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     if (is_root_attribute(e.first))
       continue;
 
@@ -1634,7 +1862,7 @@ bool Lgtuple::is_ordered() const {
 mmap_lib::str Lgtuple::get_scalar_name() const {
   mmap_lib::str sname;
 
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     mmap_lib::str s;
     if (is_attribute(e.first)) {
       s = get_all_but_last_level(e.first);
@@ -1652,7 +1880,7 @@ mmap_lib::str Lgtuple::get_scalar_name() const {
 bool Lgtuple::is_trivial_scalar() const {
   auto conta = 0;
 
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     mmap_lib::str field{e.first};
 
     if (is_attribute(field)) {
@@ -1672,7 +1900,7 @@ bool Lgtuple::is_trivial_scalar() const {
 }
 
 bool Lgtuple::has_just_attributes() const {
-  for (const auto &e : key_map) {
+  for (const auto &e : get_map()) {
     if (is_attribute(e.first)) {
       continue;
     }
@@ -1684,7 +1912,7 @@ bool Lgtuple::has_just_attributes() const {
 
 void Lgtuple::dump() const {
   fmt::print("tuple_name:{} {}\n", name, correct ? "" : " ISSUES");
-  for (const auto &it : key_map) {
+  for (const auto &it : get_map()) {
     fmt::print("  key:{} dpin:{}\n", it.first, it.second.debug_name());
   }
 }
@@ -8,11 +8,13 @@
 
 #include <strings.h>  // strcasecmp
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "lconst.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
@@ -29,9 +31,34 @@ protected:
   mutable bool           correct;
   static inline Node_pin invalid_dpin;
 
-  mutable Key_map_type key_map;
-
-  void sort_key_map();
+  // Tuples copied from each other (cprop copies a lot) share the fields until
+  // one of them is updated (copy-on-write). Big tuples also index the entries
+  // by first level (field name and/or position) so that lookups only match the
+  // entries that can match, instead of scanning the whole key_map.
+  struct Key_map_data {
+    Key_map_type                                              key_map;
+    absl::flat_hash_map<mmap_lib::str, std::vector<uint32_t>> first_level;  // sorted entry positions
+    bool                                                      indexed = false;
+    bool                                                      sorted  = false;  // key_map in tuple_sort order
+  };
+  static constexpr size_t index_threshold = 16;  // smaller tuples just scan
+
+  mutable std::shared_ptr<Key_map_data> data;
+
+  void unshare() const;
+  void sort_key_map() const;
+  void append(const mmap_lib::str &key, const Node_pin &dpin);
+  void set_key(size_t pos, const mmap_lib::str &key);
+
+  static void first_level_ids(const mmap_lib::str &key, mmap_lib::str &pos_id, mmap_lib::str &name_id);
+  void        index_entry(size_t pos) const;
+  void        build_index() const;
+
+  // Call fn(pos) for every entry that may match key (fn returns false to stop).
+  // With learn, it also visits the entries that learn_fix_int can reach
+  // through a learned name/position alias (:3:foo matching 3 and foo).
+  template <typename Func>
+  void for_each_candidate(const mmap_lib::str &key, bool learn, Func fn) const;
 
   static std::tuple<bool, size_t, size_t> match_int_advance(const mmap_lib::str &a, const mmap_lib::str &b, size_t a_pos, size_t b_pos);
   static std::tuple<bool, bool, size_t>   match_int(const mmap_lib::str &a, const mmap_lib::str &b);
@@ -44,7 +71,7 @@ protected:
   static bool   match_either_partial(const mmap_lib::str &a, const mmap_lib::str &b);
 
   void        add_int(const mmap_lib::str &key, const std::shared_ptr<Lgtuple const>& tup);
-  static void reconnect_flop_if_needed(Node &flop, const mmap_lib::str &flop_name, Node_pin &dpin);
+  static void reconnect_flop_if_needed(Node &flop, const mmap_lib::str &flop_name, const Node_pin &dpin);
 
   std::tuple<mmap_lib::str, bool> get_flop_name(const Node &flop) const;
 
@@ -54,7 +81,7 @@ protected:
                                                  Node_pin &ubits_dpin);
 
 public:
-  Lgtuple(const mmap_lib::str &_name) : name(_name), correct(true) {}
+  Lgtuple(const mmap_lib::str &_name) : name(_name), correct(true), data(std::make_shared<Key_map_data>()) {}
 
   static mmap_lib::str get_last_level(const mmap_lib::str &key);
   static mmap_lib::str get_all_but_last_level(const mmap_lib::str &key);
@@ -155,12 +182,12 @@ public:
   /// Get all the attributes (__bits) in the same tuple level
   std::vector<std::pair<mmap_lib::str, Node_pin>> get_level_attributes(const mmap_lib::str &key) const;
 
-  const Key_map_type &get_map() const { return key_map; }
+  const Key_map_type &get_map() const { return data->key_map; }
   const Key_map_type &get_sort_map() const;
 
   mmap_lib::str get_scalar_name() const;  // empty if not scalar
 
-  bool is_empty() const { return (key_map.empty()); }
+  bool is_empty() const { return (data->key_map.empty()); }
 
   bool is_scalar() const;
   bool is_ordered() const;
@@ -214,7 +214,9 @@ public:
       return *this;
     }
 
-    constexpr bool is_invalid() const { return idx == 0; }
+    constexpr bool     is_invalid() const { return idx == 0; }
+    constexpr Index_id get_idx() const { return idx; }
+    constexpr bool     is_sink() const { return sink; }
 
     constexpr bool operator==(const Compact_class &other) const { return idx == other.idx && sink == other.sink; }
     constexpr bool operator!=(const Compact_class &other) const { return !(*this == other); }
@@ -253,7 +255,8 @@ public:
       return *this;
     }
 
-    constexpr bool is_invalid() const { return idx == 0; }
+    constexpr bool     is_invalid() const { return idx == 0; }
+    constexpr Index_id get_idx() const { return idx; }
 
     constexpr bool operator==(const Compact_class_driver &other) const { return idx == other.idx; }
     constexpr bool operator!=(const Compact_class_driver &other) const { return !(*this == other); }
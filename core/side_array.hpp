@@ -0,0 +1,202 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "iassert.hpp"
+#include "lgraph.hpp"
+#include "node.hpp"
+#include "node_pin.hpp"
+
+// Dense per-lgraph side table. Node/pin compact classes are dense Index_id
+// values, so a flat vector indexed by them (plus a valid bitmap) is faster
+// and smaller than a flat_hash_map for per-pass annotations.
+//
+// The interface follows the subset of absl::flat_hash_map used by the passes
+// (find/end/contains/insert/insert_or_assign/emplace/erase/operator[]).
+// Iteration is in Index_id order (deterministic). Any insert may resize, so
+// iterators/references are invalidated by inserts (like flat_hash_map).
+
+namespace side_array {
+inline size_t get_pos(const Node::Compact_class &c) { return c.get_nid().value; }
+inline size_t get_pos(const Node_pin::Compact_class &c) { return (static_cast<size_t>(c.get_idx().value) << 1) | (c.is_sink() ? 1 : 0); }
+inline size_t get_pos(const Node_pin::Compact_class_driver &c) { return c.get_idx().value; }
+
+inline size_t get_size(const Node::Compact_class *, const Lgraph *lg) { return lg->size(); }
+inline size_t get_size(const Node_pin::Compact_class *, const Lgraph *lg) { return lg->size() << 1; }
+inline size_t get_size(const Node_pin::Compact_class_driver *, const Lgraph *lg) { return lg->size(); }
+}  // namespace side_array
+
+template <typename Key, typename T>
+class Side_array {
+public:
+  using value_type = std::pair<Key, T>;
+
+protected:
+  std::vector<value_type> data;
+  std::vector<bool>       valid;
+  size_t                  n_valid = 0;
+
+  void grow(size_t pos) {
+    if (likely(pos < data.size()))
+      return;
+
+    auto sz = std::max(pos + 1, data.size() + (data.size() >> 1));
+    data.resize(sz);
+    valid.resize(sz, false);
+  }
+
+  template <typename V>
+  class Iter {
+  protected:
+    V     *array;
+    size_t pos;
+
+    friend class Side_array;
+
+  public:
+    Iter(V *a, size_t p) : array(a), pos(p) {}
+
+    auto &operator*() const { return array->data[pos]; }
+    auto *operator->() const { return &array->data[pos]; }
+
+    Iter &operator++() {
+      ++pos;
+      while (pos < array->data.size() && !array->valid[pos]) ++pos;
+      return *this;
+    }
+
+    bool operator==(const Iter &other) const { return array == other.array && pos == other.pos; }
+    bool operator!=(const Iter &other) const { return !(*this == other); }
+  };
+
+  size_t get_end_pos() const { return data.size(); }
+
+public:
+  using iterator       = Iter<Side_array>;
+  using const_iterator = Iter<const Side_array>;
+
+  Side_array() = default;
+  explicit Side_array(const Lgraph *lg) { setup(lg); }
+
+  // Preallocate for all the nodes/pins in the lgraph (entries still invalid)
+  void setup(const Lgraph *lg) {
+    auto sz = side_array::get_size(static_cast<const Key *>(nullptr), lg);
+    if (sz > data.size()) {
+      data.resize(sz);
+      valid.resize(sz, false);
+    }
+  }
+
+  size_t size() const { return n_valid; }
+  bool   empty() const { return n_valid == 0; }
+
+  void clear() {
+    data.clear();
+    valid.clear();
+    n_valid = 0;
+  }
+
+  iterator begin() {
+    iterator it(this, 0);
+    if (!data.empty() && !valid[0])
+      ++it;
+    return it;
+  }
+  iterator end() { return iterator(this, get_end_pos()); }
+
+  const_iterator begin() const {
+    const_iterator it(this, 0);
+    if (!data.empty() && !valid[0])
+      ++it;
+    return it;
+  }
+  const_iterator end() const { return const_iterator(this, get_end_pos()); }
+
+  bool contains(const Key &key) const {
+    auto pos = side_array::get_pos(key);
+    return pos < data.size() && valid[pos];
+  }
+
+  iterator find(const Key &key) {
+    auto pos = side_array::get_pos(key);
+    if (pos < data.size() && valid[pos])
+      return iterator(this, pos);
+    return end();
+  }
+
+  const_iterator find(const Key &key) const {
+    auto pos = side_array::get_pos(key);
+    if (pos < data.size() && valid[pos])
+      return const_iterator(this, pos);
+    return end();
+  }
+
+  std::pair<iterator, bool> insert(const value_type &v) {
+    auto pos = side_array::get_pos(v.first);
+    grow(pos);
+    if (valid[pos])
+      return {iterator(this, pos), false};
+
+    data[pos]  = v;
+    valid[pos] = true;
+    ++n_valid;
+    return {iterator(this, pos), true};
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(const Key &key, Args &&...args) {
+    return insert(value_type(key, T(std::forward<Args>(args)...)));
+  }
+
+  std::pair<iterator, bool> insert_or_assign(const Key &key, const T &val) {
+    auto pos = side_array::get_pos(key);
+    grow(pos);
+
+    data[pos].first  = key;
+    data[pos].second = val;
+    if (valid[pos])
+      return {iterator(this, pos), false};
+
+    valid[pos] = true;
+    ++n_valid;
+    return {iterator(this, pos), true};
+  }
+
+  T &operator[](const Key &key) {
+    auto pos = side_array::get_pos(key);
+    grow(pos);
+    if (!valid[pos]) {
+      data[pos]  = value_type(key, T());
+      valid[pos] = true;
+      ++n_valid;
+    }
+    return data[pos].second;
+  }
+
+  size_t erase(const Key &key) {
+    auto pos = side_array::get_pos(key);
+    if (pos >= data.size() || !valid[pos])
+      return 0;
+
+    data[pos].second = T();  // release resources (shared_ptr, str...)
+    valid[pos]       = false;
+    --n_valid;
+    return 1;
+  }
+
+  void erase(iterator it) {
+    I(it.array == this);
+    erase(it->first);
+  }
+};
+
+template <typename T>
+using Node_side_array = Side_array<Node::Compact_class, T>;
+
+template <typename T>
+using Pin_side_array = Side_array<Node_pin::Compact_class, T>;
+
+template <typename T>
+using Pin_driver_side_array = Side_array<Node_pin::Compact_class_driver, T>;
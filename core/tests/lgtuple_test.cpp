@@ -285,4 +285,85 @@ TEST_F(Lgtuple_test, sort) {
   for (size_t i = 0; i < sorted_map.size(); ++i) {
     EXPECT_EQ(sorted_map[i].first, names[i]);
   }
-}
\ No newline at end of file
+}
+
+TEST_F(Lgtuple_test, sort_shared) {
+  auto top = std::make_shared<Lgtuple>("top");
+
+  const std::vector<mmap_lib::str> names = {"4", ":2:c", ":0:a", "3", ":1:b"};
+  for (const auto &name : names) {
+    top->add(name, dpin[1]);
+  }
+
+  // Sorting a copy does not reorder the original
+  auto copy = std::make_shared<Lgtuple>(*top);
+
+  const auto &sorted_map = copy->get_sort_map();
+  EXPECT_EQ(sorted_map[0].first, ":0:a");
+  EXPECT_EQ(top->get_map()[0].first, "4");
+
+  // A sorted block is not copied again (by the same or a new sharing tuple)
+  EXPECT_EQ(&copy->get_sort_map(), &sorted_map);
+
+  auto copy2 = std::make_shared<Lgtuple>(*copy);
+  EXPECT_EQ(&copy2->get_sort_map(), &sorted_map);
+
+  copy2->add("5", dpin[2]);  // unshares, the sorted copy stays the same
+  EXPECT_NE(&copy2->get_map(), &sorted_map);
+  EXPECT_EQ(copy->get_sort_map().size(), names.size());
+  EXPECT_EQ(copy2->get_sort_map().size(), names.size() + 1);
+}
+
+TEST_F(Lgtuple_test, big_nested) {
+  auto top = std::make_shared<Lgtuple>("top");
+
+  std::vector<mmap_lib::str> names;
+  {
+    Lbench b("lgtuple_test.BIG_NESTED_ADD");
+
+    // 1000 fields: 10 bundles (with position) of 10 sub-bundles of 10 fields
+    for (int i = 0; i < 10; ++i) {
+      for (int j = 0; j < 10; ++j) {
+        for (int k = 0; k < 10; ++k) {
+          auto name = mmap_lib::str::concat(":", i, ":b", i, ".s", j, ".f", k);
+          names.emplace_back(name);
+          top->add(name, dpin[names.size() % dpin.size()]);
+        }
+      }
+    }
+  }
+  EXPECT_EQ(top->get_map().size(), names.size());
+
+  {
+    Lbench b("lgtuple_test.BIG_NESTED_GET");
+
+    for (auto n = 0u; n < names.size(); ++n) {
+      EXPECT_TRUE(top->has_dpin(names[n]));
+      EXPECT_EQ(top->get_dpin(names[n]), dpin[(n + 1) % dpin.size()]);
+    }
+  }
+
+  // Fields can be found by name or position
+  EXPECT_EQ(top->get_dpin("b3.s4.f5"), dpin[346 % dpin.size()]);
+  EXPECT_EQ(top->get_dpin("3.s4.f5"), dpin[346 % dpin.size()]);
+  EXPECT_FALSE(top->has_dpin("b3.s4.f10"));
+  EXPECT_FALSE(top->has_dpin("b10"));
+
+  auto sub = top->get_sub_tuple("b7.s2");
+  ASSERT_NE(sub, nullptr);
+  EXPECT_EQ(sub->get_map().size(), 10u);
+  EXPECT_EQ(sub->get_dpin("f9"), dpin[730 % dpin.size()]);
+
+  // Copies share the fields until one of them changes
+  auto copy = std::make_shared<Lgtuple>(*top);
+  copy->add("b0.s0.f0", dpin[0]);
+  copy->del("b9");
+
+  EXPECT_EQ(copy->get_dpin("b0.s0.f0"), dpin[0]);
+  EXPECT_EQ(top->get_dpin("b0.s0.f0"), dpin[1]);
+  EXPECT_FALSE(copy->has_dpin("b9.s0.f0"));
+  EXPECT_TRUE(top->has_dpin("b9.s0.f0"));
+  EXPECT_EQ(copy->get_map().size(), names.size() - 100);
+  EXPECT_EQ(top->get_map().size(), names.size());
+  EXPECT_EQ(copy->get_dpin("b8.s9.f9"), dpin[900 % dpin.size()]);
+}
@@ -0,0 +1,76 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "side_array.hpp"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+class Side_array_test : public ::testing::Test {
+protected:
+  Lgraph *lg = nullptr;
+
+  void SetUp() override {
+    lg = Lgraph::create("lgdb_side_array", "side_array", "-");
+
+    Lrand<int> rng;
+
+    std::vector<Node> nodes;
+    for (int i = 0; i < 200000; ++i) {
+      auto node = lg->create_node(Ntype_op::Sum);
+      nodes.emplace_back(node);
+      if (nodes.size() > 2) {
+        auto src = nodes[rng.max(nodes.size() - 1)];
+        src.setup_driver_pin().connect_sink(node.setup_sink_pin("A"));
+      }
+    }
+  }
+
+  void TearDown() override { lg->sync(); }
+};
+
+TEST_F(Side_array_test, map_semantics) {
+  Pin_side_array<int> a(lg);
+
+  EXPECT_TRUE(a.empty());
+
+  std::vector<Node_pin::Compact_class> dpins;
+  for (auto node : lg->fast()) {
+    dpins.emplace_back(node.get_driver_pin().get_compact_class());
+  }
+
+  for (auto i = 0u; i < dpins.size(); ++i) {
+    auto [it, inserted] = a.insert({dpins[i], static_cast<int>(i)});
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(it->second, static_cast<int>(i));
+  }
+  EXPECT_EQ(a.size(), dpins.size());
+
+  auto [it2, inserted2] = a.insert({dpins[0], -1});
+  EXPECT_FALSE(inserted2);
+  EXPECT_EQ(it2->second, 0);
+
+  a.insert_or_assign(dpins[0], 33);
+  EXPECT_EQ(a.find(dpins[0])->second, 33);
+
+  EXPECT_EQ(a.erase(dpins[1]), 1);
+  EXPECT_EQ(a.erase(dpins[1]), 0);
+  EXPECT_FALSE(a.contains(dpins[1]));
+  EXPECT_TRUE(a.find(dpins[1]) == a.end());
+  EXPECT_EQ(a.size(), dpins.size() - 1);
+
+  size_t n = 0;
+  for (const auto &it : a) {
+    EXPECT_TRUE(a.contains(it.first));
+    ++n;
+  }
+  EXPECT_EQ(n, a.size());
+
+  // New nodes after setup grow the array
+  auto node = lg->create_node(Ntype_op::Sum);
+  a[node.setup_driver_pin().get_compact_class()] = 7;
+  EXPECT_EQ(a.find(node.get_driver_pin().get_compact_class())->second, 7);
+}
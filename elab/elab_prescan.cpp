@@ -0,0 +1,207 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "elab_prescan.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+//------------------------------------------------------------------ scalar
+
+static inline bool is_alnum_char(unsigned char c) {
+  return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_';
+}
+static inline bool is_blank_char(char c) { return c == ' ' || c == '\t'; }
+static inline bool is_newline_char(char c) { return c == '\n' || c == '\r' || c == '\f'; }
+static inline bool is_comment_stop_char(char c) { return is_newline_char(c) || c == '*' || c == '/'; }
+
+static size_t scalar_skip_alnum(const char *mem, size_t pos, size_t end) {
+  while (pos < end && is_alnum_char(mem[pos])) ++pos;
+  return pos;
+}
+
+static size_t scalar_skip_blank(const char *mem, size_t pos, size_t end) {
+  while (pos < end && is_blank_char(mem[pos])) ++pos;
+  return pos;
+}
+
+static size_t scalar_skip_to_newline(const char *mem, size_t pos, size_t end) {
+  while (pos < end && !is_newline_char(mem[pos])) ++pos;
+  return pos;
+}
+
+static size_t scalar_skip_comment_body(const char *mem, size_t pos, size_t end) {
+  while (pos < end && !is_comment_stop_char(mem[pos])) ++pos;
+  return pos;
+}
+
+#if defined(__x86_64__)
+//------------------------------------------------------------------ SSE4.2
+// pcmpestri with explicit lengths (no issue with '\0' in the file)
+
+__attribute__((target("sse4.2"))) static size_t sse42_skip_alnum(const char *mem, size_t pos, size_t end) {
+  const __m128i ranges = _mm_setr_epi8('0', '9', 'A', 'Z', 'a', 'z', '_', '_', 0, 0, 0, 0, 0, 0, 0, 0);
+  while (pos + 16 <= end) {
+    auto blk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mem + pos));
+    int  idx = _mm_cmpestri(ranges, 8, blk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY);
+    if (idx < 16)
+      return pos + idx;
+    pos += 16;
+  }
+  return scalar_skip_alnum(mem, pos, end);
+}
+
+__attribute__((target("sse4.2"))) static size_t sse42_skip_blank(const char *mem, size_t pos, size_t end) {
+  const __m128i set = _mm_setr_epi8(' ', '\t', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  while (pos + 16 <= end) {
+    auto blk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mem + pos));
+    int  idx = _mm_cmpestri(set, 2, blk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+    if (idx < 16)
+      return pos + idx;
+    pos += 16;
+  }
+  return scalar_skip_blank(mem, pos, end);
+}
+
+__attribute__((target("sse4.2"))) static size_t sse42_skip_to_newline(const char *mem, size_t pos, size_t end) {
+  const __m128i set = _mm_setr_epi8('\n', '\r', '\f', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  while (pos + 16 <= end) {
+    auto blk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mem + pos));
+    int  idx = _mm_cmpestri(set, 3, blk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+    if (idx < 16)
+      return pos + idx;
+    pos += 16;
+  }
+  return scalar_skip_to_newline(mem, pos, end);
+}
+
+__attribute__((target("sse4.2"))) static size_t sse42_skip_comment_body(const char *mem, size_t pos, size_t end) {
+  const __m128i set = _mm_setr_epi8('\n', '\r', '\f', '*', '/', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  while (pos + 16 <= end) {
+    auto blk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mem + pos));
+    int  idx = _mm_cmpestri(set, 5, blk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+    if (idx < 16)
+      return pos + idx;
+    pos += 16;
+  }
+  return scalar_skip_comment_body(mem, pos, end);
+}
+
+//------------------------------------------------------------------ AVX2
+// 32 byte blocks, the class mask is found with compares and movemask
+
+__attribute__((target("avx2"))) static inline __m256i avx2_in_range(__m256i blk, char lo, char hi) {
+  // (c - lo) <= (hi - lo) as unsigned
+  auto d = _mm256_sub_epi8(blk, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(static_cast<char>(hi - lo))), d);
+}
+
+__attribute__((target("avx2"))) static size_t avx2_skip_alnum(const char *mem, size_t pos, size_t end) {
+  while (pos + 32 <= end) {
+    auto blk   = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mem + pos));
+    auto lower = _mm256_or_si256(blk, _mm256_set1_epi8(0x20));
+    auto m     = _mm256_or_si256(avx2_in_range(blk, '0', '9'), avx2_in_range(lower, 'a', 'z'));
+    m          = _mm256_or_si256(m, _mm256_cmpeq_epi8(blk, _mm256_set1_epi8('_')));
+
+    uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(m));
+    if (stop)
+      return pos + __builtin_ctz(stop);
+    pos += 32;
+  }
+  return sse42_skip_alnum(mem, pos, end);
+}
+
+__attribute__((target("avx2"))) static size_t avx2_skip_blank(const char *mem, size_t pos, size_t end) {
+  while (pos + 32 <= end) {
+    auto blk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mem + pos));
+    auto m   = _mm256_or_si256(_mm256_cmpeq_epi8(blk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(blk, _mm256_set1_epi8('\t')));
+
+    uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(m));
+    if (stop)
+      return pos + __builtin_ctz(stop);
+    pos += 32;
+  }
+  return sse42_skip_blank(mem, pos, end);
+}
+
+__attribute__((target("avx2"))) static inline __m256i avx2_newline_mask(__m256i blk) {
+  auto m = _mm256_or_si256(_mm256_cmpeq_epi8(blk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(blk, _mm256_set1_epi8('\r')));
+  return _mm256_or_si256(m, _mm256_cmpeq_epi8(blk, _mm256_set1_epi8('\f')));
+}
+
+__attribute__((target("avx2"))) static size_t avx2_skip_to_newline(const char *mem, size_t pos, size_t end) {
+  while (pos + 32 <= end) {
+    auto blk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mem + pos));
+
+    uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(avx2_newline_mask(blk)));
+    if (stop)
+      return pos + __builtin_ctz(stop);
+    pos += 32;
+  }
+  return sse42_skip_to_newline(mem, pos, end);
+}
+
+__attribute__((target("avx2"))) static size_t avx2_skip_comment_body(const char *mem, size_t pos, size_t end) {
+  while (pos + 32 <= end) {
+    auto blk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mem + pos));
+    auto m   = _mm256_or_si256(_mm256_cmpeq_epi8(blk, _mm256_set1_epi8('*')), _mm256_cmpeq_epi8(blk, _mm256_set1_epi8('/')));
+    m        = _mm256_or_si256(m, avx2_newline_mask(blk));
+
+    uint32_t stop = static_cast<uint32_t>(_mm256_movemask_epi8(m));
+    if (stop)
+      return pos + __builtin_ctz(stop);
+    pos += 32;
+  }
+  return sse42_skip_comment_body(mem, pos, end);
+}
+#endif
+
+//------------------------------------------------------------------ dispatch
+
+Elab_prescan::Fns Elab_prescan::fns = Elab_prescan::select_best();
+
+Elab_prescan::Fns Elab_prescan::select_best() {
+  Fns best{Impl::Scalar, scalar_skip_alnum, scalar_skip_blank, scalar_skip_to_newline, scalar_skip_comment_body};
+
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2")) {
+    best = Fns{Impl::AVX2, avx2_skip_alnum, avx2_skip_blank, avx2_skip_to_newline, avx2_skip_comment_body};
+  } else if (__builtin_cpu_supports("sse4.2")) {
+    best = Fns{Impl::SSE42, sse42_skip_alnum, sse42_skip_blank, sse42_skip_to_newline, sse42_skip_comment_body};
+  }
+#endif
+
+  return best;
+}
+
+bool Elab_prescan::set_impl(Impl impl) {
+  if (impl == Impl::Scalar) {
+    fns = Fns{Impl::Scalar, scalar_skip_alnum, scalar_skip_blank, scalar_skip_to_newline, scalar_skip_comment_body};
+    return true;
+  }
+
+  auto best = select_best();
+  if (impl == Impl::AVX2 && best.impl != Impl::AVX2)
+    return false;
+  if (impl == Impl::SSE42 && best.impl == Impl::Scalar)
+    return false;
+
+#if defined(__x86_64__)
+  if (impl == Impl::SSE42) {
+    fns = Fns{Impl::SSE42, sse42_skip_alnum, sse42_skip_blank, sse42_skip_to_newline, sse42_skip_comment_body};
+    return true;
+  }
+#endif
+
+  fns = best;
+  return true;
+}
+
+std::string_view Elab_prescan::get_impl_name() {
+  switch (fns.impl) {
+    case Impl::AVX2: return "avx2";
+    case Impl::SSE42: return "sse4.2";
+    default: return "scalar";
+  }
+}
@@ -0,0 +1,43 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Block (16/32 bytes) character class search used by Elab_scanner to skip
+// runs (identifiers, blanks, comment bodies) instead of walking them one
+// char at a time. AVX2 or SSE4.2 is selected at runtime, with a scalar
+// fallback. All the methods return the first position in [pos,end) that is
+// NOT in the run (end if the run reaches end).
+class Elab_prescan {
+public:
+  enum class Impl { Scalar, SSE42, AVX2 };
+
+  // [0-9A-Za-z_]
+  static size_t skip_alnum(const char *mem, size_t pos, size_t end) { return fns.skip_alnum(mem, pos, end); }
+  // ' ' or '\t'
+  static size_t skip_blank(const char *mem, size_t pos, size_t end) { return fns.skip_blank(mem, pos, end); }
+  // Stops at '\n', '\r', '\f'
+  static size_t skip_to_newline(const char *mem, size_t pos, size_t end) { return fns.skip_to_newline(mem, pos, end); }
+  // Stops at newline, '*', '/' (multi-line comment body)
+  static size_t skip_comment_body(const char *mem, size_t pos, size_t end) { return fns.skip_comment_body(mem, pos, end); }
+
+  static Impl             get_impl() { return fns.impl; }
+  static std::string_view get_impl_name();
+
+  // Force a given implementation (tests/bench). Returns false if not supported by the CPU.
+  static bool set_impl(Impl impl);
+
+private:
+  using Skip_fn = size_t (*)(const char *, size_t, size_t);
+  struct Fns {
+    Impl    impl;
+    Skip_fn skip_alnum;
+    Skip_fn skip_blank;
+    Skip_fn skip_to_newline;
+    Skip_fn skip_comment_body;
+  };
+
+  static Fns fns;
+  static Fns select_best();
+};
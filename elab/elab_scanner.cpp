@@ -12,6 +12,7 @@
 #include <limits>
 #include <string>
 
+#include "elab_prescan.hpp"
 #include "err_tracker.hpp"
 #include "iassert.hpp"
 #include "likely.hpp"
@@ -325,17 +326,14 @@ void Elab_scanner::parse_step() {
       starting_comment  = false;
       finishing_comment = false;
 
+      // Skip the comment body up to the char before the next stop (or memblock_size-3)
       if (in_singleline_comment) {
-        if (!is_newline(memblock[pos]) && (pos + 1) < memblock_size) {
-          // TODO: Convert this to a word base (not byte based) skip
-          while (!is_newline(memblock[pos + 1]) && (pos + 3) < memblock_size) pos++;
+        if (!is_newline(memblock[pos]) && (pos + 3) < memblock_size) {
+          pos = Elab_prescan::skip_to_newline(memblock, pos + 1, memblock_size - 2) - 1;
         }
       } else {
         if (!is_newline(memblock[pos]) && memblock[pos] != '*' && memblock[pos] != '/' && (pos + 3) < memblock_size) {
-          // TODO: Convert this to a word base (not byte based) skip
-          while (!is_newline(memblock[pos + 1]) && memblock[pos + 1] != '*' && memblock[pos + 1] != '/'
-                 && (pos + 3) < memblock_size)
-            pos++;
+          pos = Elab_prescan::skip_comment_body(memblock, pos + 1, memblock_size - 2) - 1;
         }
       }
 
@@ -360,6 +358,22 @@ void Elab_scanner::parse_step() {
       add_token(t);
       t.reset(nt, pos, nlines);
       trying_merge = translate[c].try_merge;
+
+      // Runs of the same class are handled as a block (same tokens as char by char)
+      if (nt == Token_id_alnum) {
+        auto end = Elab_prescan::skip_alnum(memblock, pos + 1, memblock_size);
+        if (end > pos + 1) {
+          t.adjust_token_size(pos + 1);
+          add_token(t);  // first char may fuse (#foo, $foo, %foo...)
+          t.reset(Token_id_alnum, pos + 1, nlines);
+          trying_merge = true;  // rest of the run is appended to the fused token
+          pos          = end - 1;
+          c            = memblock[pos];
+        }
+      } else if (c == ' ' || c == '\t') {
+        pos = Elab_prescan::skip_blank(memblock, pos + 1, memblock_size) - 1;
+        c   = memblock[pos];
+      }
     }
 
     last_c = c;
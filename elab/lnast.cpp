@@ -2,11 +2,14 @@
 
 #include "lnast.hpp"
 
+#include <atomic>
+#include <exception>
 #include <string>
 
 #include "elab_scanner.hpp"
 #include "lbench.hpp"
 #include "mmap_vector.hpp"
+#include "thread_pool.hpp"
 
 void Lnast_node::dump() const {
   fmt::print("{}, {}, {}\n", type.debug_name(), token.get_text(), subs);  // TODO: cleaner API to also dump token
@@ -16,7 +19,19 @@ Lnast::~Lnast() {
 }
 
 void Lnast::do_ssa_trans(const Lnast_nid &top_nid) {
-  Lbench    b("pass.lnast_ssa");
+  Lbench b("pass.lnast_ssa");
+
+  // func_def scopes nest through analyze_selc_lrhs. The depth must unwind
+  // when a step throws, or the next ssa_trans would only queue its scopes.
+  struct Depth_guard {
+    Lnast &ln;
+    explicit Depth_guard(Lnast &_ln) : ln(_ln) { ++ln.ssa_trans_depth; }
+    ~Depth_guard() {
+      if (--ln.ssa_trans_depth == 0)
+        ln.ssa_rhs_scopes.clear();
+    }
+  } depth_guard(*this);
+
   Lnast_nid top_sts_nid;
   if (get_type(top_nid).is_func_def()) {
     /* fmt::print("Step-0: Handle Inline Function Definition\n"); */
@@ -44,12 +59,21 @@ void Lnast::do_ssa_trans(const Lnast_nid &top_nid) {
   /* fmt::print("Step-3: LHS SSA\n"); Insert DP-Assign Parent_nid\n");*/
   resolve_ssa_lhs_subs(top_sts_nid);
 
+  // Step-4 and Step-5 do not change the tree structure and func_def scopes do
+  // not look at each other, so they run once from the outermost call for all
+  // the scopes.
+  ssa_rhs_scopes.emplace_back(top_sts_nid);
+  if (ssa_trans_depth > 1)
+    return;
+
   // see Note I
   /* fmt::print("Step-4: RHS SSA\n"); */
-  resolve_ssa_rhs_subs(top_sts_nid);
+  resolve_ssa_rhs_subs_regions();
 
   /* fmt::print("Step-5: Operator LHS Merge\n"); */
-  opr_lhs_merge(top_sts_nid);
+  for (const auto &sts_nid : ssa_rhs_scopes) {
+    opr_lhs_merge(sts_nid);
+  }
 
   /* fmt::print("LNAST SSA Transformation Finished!\n"); */
   // dump();
@@ -707,45 +731,152 @@ void Lnast::resolve_ssa_lhs_subs(const Lnast_nid &psts_nid) {
   }
 }
 
-void Lnast::resolve_ssa_rhs_subs(const Lnast_nid &psts_nid) {
-  Cnt_rtable top_ssa_rhs_cnt_table;
-  ssa_rhs_cnt_tables[psts_nid] = top_ssa_rhs_cnt_table;
-  for (const auto &opr_nid : children(psts_nid)) {
+// The RHS SSA of a statement only depends on the lhs subs (already set by the
+// LHS SSA) of the statements before it in the same scope, and on the parent
+// scopes up to the func_def/top. The scope statements are split in regions,
+// each region starts from the lhs defined before it (seed) and runs as its
+// own thread_pool job with private tables. The tables are merged afterwards.
+void Lnast::resolve_ssa_rhs_subs_regions() {
+  std::vector<Ssa_rhs_region> regions;
+
+  for (const auto &psts_nid : ssa_rhs_scopes) {
+    Cnt_rtable defs;
+    size_t     n = 0;
+    for (const auto &opr_nid : children(psts_nid)) {
+      if (n == 0) {
+        auto &region    = regions.emplace_back();
+        region.psts_nid = psts_nid;
+        region.first    = opr_nid;
+        region.seed     = defs;
+      }
+      regions.back().last = opr_nid;
+
+      collect_ssa_rhs_defs(opr_nid, defs);
+      if (++n == ssa_rhs_region_size)
+        n = 0;
+    }
+  }
+
+  if (regions.size() <= 1 || ssa_rhs_region_size == 0) {
+    for (auto &region : regions) {
+      resolve_ssa_rhs_subs(region);
+    }
+  } else {
+    std::atomic<int>                pending = 0;
+    std::vector<std::exception_ptr> errors(regions.size());
+    for (auto i = 0u; i < regions.size(); ++i) {
+      ++pending;
+      thread_pool.add([this, &regions, &errors, &pending, i]() -> void {
+        try {
+          resolve_ssa_rhs_subs(regions[i]);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+        --pending;
+      });
+    }
+    thread_pool.wait_until_done(pending);
+
+    for (const auto &e : errors) {
+      if (e)
+        std::rethrow_exception(e);
+    }
+  }
+
+  // join: later regions see more statements, so they win on the scope table
+  for (auto &region : regions) {
+    for (auto &[sts_nid, table] : region.tables) {
+      auto &dst = ssa_rhs_cnt_tables[sts_nid];
+      for (const auto &[name, subs] : table) {
+        dst.insert_or_assign(name, subs);
+      }
+    }
+  }
+}
+
+// Same lhs updates that ssa_rhs_handle_a_statement/ssa_rhs_if_subtree do on
+// the scope table, without touching the operands.
+void Lnast::collect_ssa_rhs_defs(const Lnast_nid &opr_nid, Cnt_rtable &defs) const {
+  const auto type = get_type(opr_nid);
+  if (type.is_invalid() || type.is_func_def())
+    return;
+
+  if (type.is_if()) {
+    for (const auto &itr_nid : children(opr_nid)) {
+      if (get_type(itr_nid).is_phi()) {
+        auto lhs_nid = get_first_child(itr_nid);
+        defs.insert_or_assign(get_name(lhs_nid), get_subs(lhs_nid));
+      }
+    }
+    return;
+  }
+
+  if (type.is_tuple_add() || type.is_tuple_set()) {
+    auto first_child  = get_first_child(opr_nid);
+    auto second_child = get_sibling_next(first_child);
+    if (!second_child.is_invalid() && get_type(second_child).is_assign()) {
+      for (auto itr_opd : children(opr_nid)) {
+        if (itr_opd == first_child)
+          continue;
+        collect_ssa_rhs_defs(itr_opd, defs);
+      }
+    }
+  }
+
+  if (is_leaf(opr_nid))
+    return;
+
+  auto lhs_nid  = get_first_child(opr_nid);
+  auto lhs_name = get_name(lhs_nid);
+  if (lhs_name.size() > 4 && lhs_name.substr(0, 3) == "___")
+    return;
+
+  defs.insert_or_assign(lhs_name, get_subs(lhs_nid));
+}
+
+void Lnast::resolve_ssa_rhs_subs(Ssa_rhs_region &region) {
+  auto &rhs_tables = region.tables;
+  rhs_tables[region.psts_nid] = std::move(region.seed);
+
+  for (auto opr_nid = region.first; !opr_nid.is_invalid(); opr_nid = get_sibling_next(opr_nid)) {
     auto type = get_type(opr_nid);
     if (type.is_func_def()) {
-      continue;
+      // nothing to do
     } else if (type.is_if()) {
-      ssa_rhs_if_subtree(opr_nid);
+      ssa_rhs_if_subtree(rhs_tables, opr_nid);
     } else {
-      ssa_rhs_handle_a_statement(psts_nid, opr_nid);
+      ssa_rhs_handle_a_statement(rhs_tables, region.psts_nid, opr_nid);
     }
+
+    if (opr_nid == region.last)
+      break;
   }
 }
 
-void Lnast::ssa_rhs_if_subtree(const Lnast_nid &if_nid) {
+void Lnast::ssa_rhs_if_subtree(Cnt_rtable_map &rhs_tables, const Lnast_nid &if_nid) {
   for (const auto &itr_nid : children(if_nid)) {
     if (get_type(itr_nid).is_stmts()) {
       Cnt_rtable if_sts_ssa_rhs_cnt_table;
-      ssa_rhs_cnt_tables[itr_nid] = if_sts_ssa_rhs_cnt_table;
+      rhs_tables[itr_nid] = if_sts_ssa_rhs_cnt_table;
 
       for (const auto &opr_nid : children(itr_nid)) {
         auto type = get_type(opr_nid);
         I(!type.is_func_def());
         if (type.is_if()) {
-          ssa_rhs_if_subtree(opr_nid);
+          ssa_rhs_if_subtree(rhs_tables, opr_nid);
         } else {
-          ssa_rhs_handle_a_statement(itr_nid, opr_nid);
+          ssa_rhs_handle_a_statement(rhs_tables, itr_nid, opr_nid);
         }
       }
     } else if (get_type(itr_nid).is_phi()) {
-      update_rhs_ssa_cnt_table(get_parent(if_nid), get_first_child(itr_nid));
+      update_rhs_ssa_cnt_table(rhs_tables, get_parent(if_nid), get_first_child(itr_nid));
     } else {  // condition node
       continue;
     }
   }
 }
 
-void Lnast::ssa_rhs_handle_a_statement(const Lnast_nid &psts_nid, const Lnast_nid &opr_nid) {
+void Lnast::ssa_rhs_handle_a_statement(Cnt_rtable_map &rhs_tables, const Lnast_nid &psts_nid, const Lnast_nid &opr_nid) {
   const auto type = get_type(opr_nid);
   if (type.is_invalid())
     return;
@@ -764,14 +895,14 @@ void Lnast::ssa_rhs_handle_a_statement(const Lnast_nid &psts_nid, const Lnast_ni
     for (auto itr_opd : children(opr_nid)) {
       if (itr_opd == get_first_child(opr_nid))
         continue;
-      ssa_rhs_handle_a_statement(psts_nid, itr_opd);
+      ssa_rhs_handle_a_statement(rhs_tables, psts_nid, itr_opd);
     }
   } else {
     // handle statement rhs of normal operators
     for (auto itr_opd : children(opr_nid)) {
       if (itr_opd == get_first_child(opr_nid))
         continue;
-      ssa_rhs_handle_a_operand(psts_nid, itr_opd);
+      ssa_rhs_handle_a_operand(rhs_tables, psts_nid, itr_opd);
     }
   }
 
@@ -788,7 +919,7 @@ void Lnast::ssa_rhs_handle_a_statement(const Lnast_nid &psts_nid, const Lnast_ni
   if (lhs_name.size() > 4 && lhs_name.substr(0, 3) == "___")
     return;
 
-  update_rhs_ssa_cnt_table(psts_nid, lhs_nid);
+  update_rhs_ssa_cnt_table(rhs_tables, psts_nid, lhs_nid);
   //}
 }
 
@@ -880,8 +1011,8 @@ void Lnast::ssa_rhs_handle_a_operand_special(const Lnast_nid &gpsts_nid, const L
   }
 }
 
-void Lnast::ssa_rhs_handle_a_operand(const Lnast_nid &gpsts_nid, const Lnast_nid &opd_nid) {
-  auto &     ssa_rhs_cnt_table = ssa_rhs_cnt_tables[gpsts_nid];
+void Lnast::ssa_rhs_handle_a_operand(Cnt_rtable_map &rhs_tables, const Lnast_nid &gpsts_nid, const Lnast_nid &opd_nid) {
+  auto &     ssa_rhs_cnt_table = rhs_tables[gpsts_nid];
   auto       opd_name          = get_name(opd_nid);
   const auto opd_type          = get_type(opd_nid);
   if (opd_type.is_invalid())
@@ -893,7 +1024,7 @@ void Lnast::ssa_rhs_handle_a_operand(const Lnast_nid &gpsts_nid, const Lnast_nid
     auto new_subs = ssa_rhs_cnt_table[opd_name];
     set_data(opd_nid, Lnast_node(opd_type, ori_token, new_subs));
   } else {
-    auto new_subs               = check_rhs_cnt_table_parents_chain(gpsts_nid, opd_nid);
+    auto new_subs               = check_rhs_cnt_table_parents_chain(rhs_tables, gpsts_nid, opd_nid);
     ssa_rhs_cnt_table[opd_name] = new_subs;
     set_data(opd_nid, Lnast_node(opd_type, ori_token, new_subs));
   }
@@ -1136,14 +1267,14 @@ void Lnast::update_global_lhs_ssa_cnt_table(const Lnast_nid &lhs_nid) {
 
 // note: the subs of the lhs of the operator has already handled clearly in first round ssa process, just copy into the
 // rhs_ssa_cnt_table fine.
-void Lnast::update_rhs_ssa_cnt_table(const Lnast_nid &psts_nid, const Lnast_nid &target_key) {
-  auto &     ssa_rhs_cnt_table   = ssa_rhs_cnt_tables[psts_nid];
+void Lnast::update_rhs_ssa_cnt_table(Cnt_rtable_map &rhs_tables, const Lnast_nid &psts_nid, const Lnast_nid &target_key) {
+  auto &     ssa_rhs_cnt_table   = rhs_tables[psts_nid];
   const auto target_name         = get_name(target_key);
   ssa_rhs_cnt_table[target_name] = ref_data(target_key)->subs;
 }
 
-int8_t Lnast::check_rhs_cnt_table_parents_chain(const Lnast_nid &psts_nid, const Lnast_nid &target_key) {
-  auto &     ssa_rhs_cnt_table = ssa_rhs_cnt_tables[psts_nid];
+int8_t Lnast::check_rhs_cnt_table_parents_chain(Cnt_rtable_map &rhs_tables, const Lnast_nid &psts_nid, const Lnast_nid &target_key) {
+  auto &     ssa_rhs_cnt_table = rhs_tables[psts_nid];
   const auto target_name       = get_name(target_key);
   auto       itr               = ssa_rhs_cnt_table.find(target_name);
 
@@ -1156,7 +1287,7 @@ int8_t Lnast::check_rhs_cnt_table_parents_chain(const Lnast_nid &psts_nid, const
   } else {
     auto tmp_if_nid   = get_parent(psts_nid);
     auto new_psts_nid = get_parent(tmp_if_nid);
-    return check_rhs_cnt_table_parents_chain(new_psts_nid, target_key);
+    return check_rhs_cnt_table_parents_chain(rhs_tables, new_psts_nid, target_key);
   }
 }
 
@@ -10,6 +10,7 @@
 using Lnast_nid                     = mmap_lib::Tree_index;
 using Phi_rtable                    = absl::flat_hash_map<mmap_lib::str, Lnast_nid>;  // rtable = resolve_table
 using Cnt_rtable                    = absl::flat_hash_map<mmap_lib::str, int16_t>;
+using Cnt_rtable_map                = absl::flat_hash_map<Lnast_nid, Cnt_rtable>;  // statements node -> Cnt_rtable
 using Selc_lrhs_table               = absl::flat_hash_map<Lnast_nid, std::pair<bool, Lnast_nid>>;  // sel -> (lrhs, paired opr node)
 using Tuple_var_1st_scope_ssa_table = absl::flat_hash_map<mmap_lib::str, Lnast_nid>;            // rtable = resolve_table
 
@@ -128,11 +129,24 @@ private:
   Lnast_nid        undefined_var_nid;
   uint32_t         tmp_var_cnt = 0;
 
+  // RHS SSA work unit: a run of consecutive statements of one scope. seed has
+  // the subs of the lhs defined by the statements before the region.
+  struct Ssa_rhs_region {
+    Lnast_nid      psts_nid;
+    Lnast_nid      first;
+    Lnast_nid      last;
+    Cnt_rtable     seed;
+    Cnt_rtable_map tables;
+  };
+  size_t ssa_rhs_region_size = 256;  // statements per RHS SSA region (0: one serial region per scope)
+
   void      do_ssa_trans(const Lnast_nid &top_nid);
+  void      resolve_ssa_rhs_subs_regions();
+  void      collect_ssa_rhs_defs(const Lnast_nid &opr_nid, Cnt_rtable &defs) const;
   void      ssa_lhs_handle_a_statement(const Lnast_nid &psts_nid, const Lnast_nid &opr_nid);
-  void      ssa_rhs_handle_a_statement(const Lnast_nid &psts_nid, const Lnast_nid &opr_nid);
+  void      ssa_rhs_handle_a_statement(Cnt_rtable_map &rhs_tables, const Lnast_nid &psts_nid, const Lnast_nid &opr_nid);
   void      ssa_lhs_if_subtree(const Lnast_nid &if_nid);
-  void      ssa_rhs_if_subtree(const Lnast_nid &if_nid);
+  void      ssa_rhs_if_subtree(Cnt_rtable_map &rhs_tables, const Lnast_nid &if_nid);
   void      opr_lhs_merge_if_subtree(const Lnast_nid &if_nid);
   void      opr_lhs_merge_handle_a_statement(const Lnast_nid &opr_nid);
   void      ssa_handle_phi_nodes(const Lnast_nid &if_nid);
@@ -143,19 +157,19 @@ private:
   Lnast_nid get_complement_nid(const mmap_lib::str &brother_name, const Lnast_nid &psts_nid, bool false_path);
   Lnast_nid check_phi_table_parents_chain(const mmap_lib::str &brother_name, const Lnast_nid &psts_nid);
   void      resolve_ssa_lhs_subs(const Lnast_nid &psts_nid);
-  void      resolve_ssa_rhs_subs(const Lnast_nid &psts_nid);
+  void      resolve_ssa_rhs_subs(Ssa_rhs_region &region);
   void      opr_lhs_merge(const Lnast_nid &psts_nid);
   void      update_global_lhs_ssa_cnt_table(const Lnast_nid &target_nid);
   void      respect_latest_global_lhs_ssa(const Lnast_nid &target_nid);
-  int8_t    check_rhs_cnt_table_parents_chain(const Lnast_nid &psts_nid, const Lnast_nid &target_key);
-  void      update_rhs_ssa_cnt_table(const Lnast_nid &psts_nid, const Lnast_nid &target_key);
+  int8_t    check_rhs_cnt_table_parents_chain(Cnt_rtable_map &rhs_tables, const Lnast_nid &psts_nid, const Lnast_nid &target_key);
+  void      update_rhs_ssa_cnt_table(Cnt_rtable_map &rhs_tables, const Lnast_nid &psts_nid, const Lnast_nid &target_key);
   void      analyze_selc_lrhs(const Lnast_nid &psts_nid);
   void      analyze_selc_lrhs_if_subtree(const Lnast_nid &if_nid);
   void      analyze_selc_lrhs_handle_a_statement(const Lnast_nid &psts_nid, const Lnast_nid &opr_nid);
   void      insert_implicit_dp_parent(const Lnast_nid &opr_nid);
 
   bool is_special_case_of_sel_rhs(const Lnast_nid &psts_nid, const Lnast_nid &opr_nid);
-  void ssa_rhs_handle_a_operand(const Lnast_nid &gpsts_nid, const Lnast_nid &opd_nid);  // gpsts = grand parent
+  void ssa_rhs_handle_a_operand(Cnt_rtable_map &rhs_tables, const Lnast_nid &gpsts_nid, const Lnast_nid &opd_nid);  // gpsts = grand parent
   void ssa_rhs_handle_a_operand_special(const Lnast_nid &gpsts_nid, const Lnast_nid &opd_nid);
 
   // tuple operator process
@@ -178,7 +192,7 @@ private:
 
   // hierarchical statements node -> symbol table
   absl::flat_hash_map<Lnast_nid, Phi_rtable>       phi_resolve_tables;
-  absl::flat_hash_map<Lnast_nid, Cnt_rtable>       ssa_rhs_cnt_tables;
+  Cnt_rtable_map                                   ssa_rhs_cnt_tables;
   absl::flat_hash_map<Lnast_nid, Selc_lrhs_table>  selc_lrhs_tables;
   absl::flat_hash_map<Lnast_nid, Phi_rtable>       new_added_phi_node_tables;  // for each if-subtree scope
   absl::flat_hash_set<mmap_lib::str>               tuplized_table;
@@ -195,6 +209,10 @@ private:
 
   uint32_t tup_internal_cnt = 0;
 
+  // statements nodes (top and func_def) waiting for the RHS SSA and LHS merge
+  std::vector<Lnast_nid> ssa_rhs_scopes;
+  int                    ssa_trans_depth = 0;
+
 public:
   explicit Lnast() : top_module_name("noname"), source_filename("") {}
   ~Lnast();
@@ -203,6 +221,7 @@ public:
       : top_module_name(_module_name), source_filename(_file_name) {}
 
   void ssa_trans() { do_ssa_trans(mmap_lib::Tree_index::root()); };
+  void set_ssa_rhs_region_size(size_t sz) { ssa_rhs_region_size = sz; }
 
   const mmap_lib::str &get_top_module_name() const { return top_module_name; }
   const mmap_lib::str &get_source() const { return source_filename; }
@@ -0,0 +1,275 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "lnast_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "absl/container/flat_hash_map.h"
+#include "lnast_flat.hpp"
+#include "woothash.hpp"
+
+uint64_t Lnast_cache::source_hash(const mmap_lib::str &src_file) {
+  int fd = ::open(src_file.to_s().c_str(), O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    ::close(fd);
+    return 0;
+  }
+
+  uint64_t hash = 1;  // empty file is still a valid source
+  if (sb.st_size) {
+    auto *b = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (b == MAP_FAILED) {
+      ::close(fd);
+      return 0;
+    }
+    hash = mmap_lib::woothash64(b, sb.st_size) | 1;
+    munmap(b, sb.st_size);
+  }
+  ::close(fd);
+
+  return hash;
+}
+
+uint64_t Lnast_cache::frontend_hash(const mmap_lib::str &frontend) {
+  auto txt = frontend.to_s();
+  return mmap_lib::woothash64(txt.data(), txt.size());
+}
+
+std::string Lnast_cache::cache_file(const mmap_lib::str &path, const mmap_lib::str &src_file) {
+  auto src      = src_file.to_s();
+  auto basename = src_file.get_str_after_last_if_exists('/');
+
+  return fmt::format("{}/lnast_cache_{}_{:016x}", path, basename, mmap_lib::woothash64(src.data(), src.size()));
+}
+
+bool Lnast_cache::save(const std::vector<std::shared_ptr<Lnast>> &lnasts, const mmap_lib::str &path,
+                       const mmap_lib::str &src_file, const mmap_lib::str &frontend) {
+  auto hash = source_hash(src_file);
+  if (hash == 0)
+    return false;
+
+  {
+    auto        spath = path.to_s();
+    struct stat sb;
+    if (stat(spath.c_str(), &sb) != 0 || !S_ISDIR(sb.st_mode)) {
+      if (mkdir(spath.c_str(), 0755) != 0)
+        return false;
+    }
+  }
+
+  std::vector<mmap_lib::str>                   texts;
+  absl::flat_hash_map<mmap_lib::str, uint32_t> text2id;
+  auto                                         intern = [&texts, &text2id](const mmap_lib::str &txt) {
+    auto [it, inserted] = text2id.try_emplace(txt, texts.size());
+    if (inserted)
+      texts.emplace_back(txt);
+    return it->second;
+  };
+
+  std::vector<Entry> entries;
+  std::vector<Node>  nodes(1);  // 0 is the invalid node (same as tree2)
+  for (const auto &ln : lnasts) {
+    Lnast_flat flat(*ln);
+
+    std::vector<uint32_t> text_map(flat.get_num_texts());
+    for (auto i = 0u; i < text_map.size(); ++i) {
+      text_map[i] = intern(flat.get_text(i));
+    }
+
+    // tree2 index i (1..size) goes to base + i
+    uint32_t base = nodes.size() - 1;
+    entries.emplace_back(Entry{intern(ln->get_top_module_name()), base + 1});
+
+    // Lnast_flat drops the token positions, get them in the same preorder
+    std::vector<const Etoken *> tokens;
+    tokens.reserve(flat.size());
+    auto add_tokens = [&ln, &tokens](const Lnast_nid &nid, auto &&self) -> void {
+      tokens.emplace_back(&ln->get_data(nid).token);
+      if (ln->is_leaf(nid))
+        return;
+      for (auto child = ln->get_first_child(nid); !child.is_invalid(); child = ln->get_sibling_next(child)) {
+        self(child, self);
+      }
+    };
+    add_tokens(Lnast_nid::root(), add_tokens);
+    I(tokens.size() == static_cast<size_t>(flat.size()));
+
+    auto remap = [base](Lnast_flat_nid nid) -> uint32_t { return nid ? base + nid : 0; };
+    for (Lnast_flat_nid nid = 1; nid <= flat.size(); ++nid) {
+      const auto &data  = flat.get_data(nid);
+      const auto *token = tokens[nid - 1];
+
+      Node node;
+      node.type         = data.type.get_raw_ntype();
+      node.tok          = token->tok;
+      node.subs         = data.subs;
+      node.text_id      = text_map[data.text_id];
+      node.first_child  = remap(flat.get_first_child(nid));
+      node.next_sibling = remap(flat.get_sibling_next(nid));
+      node.line         = token->line;
+      node.pad          = 0;
+      node.pos1         = token->pos1;
+      node.pos2         = token->pos2;
+      nodes.emplace_back(node);
+    }
+  }
+
+  auto source_id = intern(src_file);
+
+  std::vector<uint64_t> text_offsets;
+  text_offsets.reserve(texts.size() + 1);
+  uint64_t text_bytes = 0;
+  for (const auto &txt : texts) {
+    text_offsets.emplace_back(text_bytes);
+    text_bytes += txt.size();
+  }
+  text_offsets.emplace_back(text_bytes);
+
+  Header header;
+  memcpy(header.magic, magic_id, sizeof(header.magic));
+  header.source_hash    = hash;
+  header.frontend_hash  = frontend_hash(frontend);
+  header.format_version = cache_format_version;
+  header.n_ntypes       = Lnast_ntype::Lnast_ntype_last_invalid;
+  header.n_lnasts       = entries.size();
+  header.n_nodes        = nodes.size();
+  header.n_texts        = texts.size();
+  header.source_id      = source_id;
+  header.text_bytes     = text_bytes;
+
+  // write to a temporary and rename, so a reader never maps a partial file
+  auto fname = cache_file(path, src_file);
+  auto tmp   = fname + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+    out.write(reinterpret_cast<const char *>(nodes.data()), nodes.size() * sizeof(Node));
+    out.write(reinterpret_cast<const char *>(text_offsets.data()), text_offsets.size() * sizeof(uint64_t));
+    for (const auto &txt : texts) {
+      auto s = txt.to_s();
+      out.write(s.data(), s.size());
+    }
+    if (!out)
+      return false;
+  }
+
+  return rename(tmp.c_str(), fname.c_str()) == 0;
+}
+
+std::vector<std::shared_ptr<Lnast>> Lnast_cache::load(const mmap_lib::str &path, const mmap_lib::str &src_file,
+                                                      const mmap_lib::str &frontend) {
+  std::vector<std::shared_ptr<Lnast>> lnasts;
+
+  auto hash = source_hash(src_file);
+  if (hash == 0)
+    return lnasts;
+
+  auto fname = cache_file(path, src_file);
+  int  fd    = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+    return lnasts;
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0 || sb.st_size < static_cast<off_t>(sizeof(Header))) {
+    ::close(fd);
+    return lnasts;
+  }
+
+  auto *base = static_cast<const char *>(mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0));
+  ::close(fd);
+  if (base == MAP_FAILED)
+    return lnasts;
+
+  const auto *header = reinterpret_cast<const Header *>(base);
+  size_t      size   = sizeof(Header) + static_cast<size_t>(header->n_lnasts) * sizeof(Entry)
+                + static_cast<size_t>(header->n_nodes) * sizeof(Node) + (static_cast<size_t>(header->n_texts) + 1) * sizeof(uint64_t)
+                + header->text_bytes;
+  if (memcmp(header->magic, magic_id, sizeof(header->magic)) != 0 || header->format_version != cache_format_version
+      || header->n_ntypes != Lnast_ntype::Lnast_ntype_last_invalid || header->frontend_hash != frontend_hash(frontend)
+      || header->source_hash != hash || header->text_bytes > static_cast<uint64_t>(sb.st_size)
+      || size != static_cast<size_t>(sb.st_size) || header->n_nodes == 0 || header->source_id >= header->n_texts) {
+    munmap(const_cast<char *>(base), sb.st_size);
+    return lnasts;
+  }
+
+  const auto *entries      = reinterpret_cast<const Entry *>(base + sizeof(Header));
+  const auto *nodes        = reinterpret_cast<const Node *>(entries + header->n_lnasts);
+  const auto *text_offsets = reinterpret_cast<const uint64_t *>(nodes + header->n_nodes);
+  const auto *text_base    = reinterpret_cast<const char *>(text_offsets + header->n_texts + 1);
+
+  std::vector<mmap_lib::str> texts;
+  texts.reserve(header->n_texts);
+  bool ok = true;
+  for (auto i = 0u; i < header->n_texts && ok; ++i) {
+    ok = text_offsets[i] <= text_offsets[i + 1] && text_offsets[i + 1] <= header->text_bytes;
+    if (ok)
+      texts.emplace_back(std::string_view(text_base + text_offsets[i], text_offsets[i + 1] - text_offsets[i]));
+  }
+
+  auto valid_node = [&](uint32_t idx) {
+    return idx && idx < header->n_nodes && nodes[idx].type < Lnast_ntype::Lnast_ntype_last_invalid
+           && nodes[idx].text_id < header->n_texts;
+  };
+  auto make_node = [&](uint32_t idx) {
+    const auto &n = nodes[idx];
+    // SSA leaves invalid (merged) nodes, so no Lnast_node constructor with subs
+    Lnast_node node(Lnast_ntype::create_from_raw(static_cast<Lnast_ntype::Lnast_ntype_int>(n.type)),
+                    Etoken(n.tok, n.pos1, n.pos2, n.line, texts[n.text_id]));
+    node.subs = n.subs;
+    return node;
+  };
+
+  for (auto e = 0u; e < header->n_lnasts && ok; ++e) {
+    const auto &entry = entries[e];
+    if (entry.name_id >= header->n_texts || !valid_node(entry.root)) {
+      ok = false;
+      break;
+    }
+
+    auto ln = std::make_shared<Lnast>(texts[entry.name_id], texts[header->source_id]);
+    ln->set_root(make_node(entry.root));
+
+    // nodes are in preorder, so a stack of (file node, parent) rebuilds the tree in order
+    std::vector<std::pair<uint32_t, Lnast_nid>> stack;
+    stack.emplace_back(nodes[entry.root].first_child, Lnast_nid::root());
+    size_t n_added = 0;
+    while (!stack.empty() && ok) {
+      auto [idx, parent] = stack.back();
+      if (idx == 0) {
+        stack.pop_back();
+        continue;
+      }
+      if (!valid_node(idx) || ++n_added >= header->n_nodes) {  // a loop in the links means corruption
+        ok = false;
+        break;
+      }
+      stack.back().first = nodes[idx].next_sibling;
+
+      auto nid = ln->add_child(parent, make_node(idx));
+      stack.emplace_back(nodes[idx].first_child, nid);
+    }
+
+    lnasts.emplace_back(std::move(ln));
+  }
+
+  munmap(const_cast<char *>(base), sb.st_size);
+
+  if (!ok)
+    lnasts.clear();  // corrupted file, same as a miss
+
+  return lnasts;
+}
@@ -0,0 +1,71 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lnast.hpp"
+
+// On-disk LNAST cache. One file per source file keeps all the LNASTs
+// generated from it as a flat preorder node array (Lnast_flat layout plus the
+// token id/position/line of each node) and an interned text table. Loading is
+// not zero copy: it mmaps the file and rebuilds each Lnast node by node from
+// the mapped arrays (texts are copied too, the map is released before
+// returning). It skips the front end (scan, parse, LNAST generation), not the
+// tree construction. The header has the source path (the loaded Lnast source),
+// its contents hash, the file format and Lnast_ntype versions, and a hash of
+// the front end name/version, so a cache written by another front end or build
+// is ignored.
+class Lnast_cache {
+protected:
+  struct Header {
+    char     magic[8];
+    uint64_t source_hash;
+    uint64_t frontend_hash;
+    uint32_t format_version;
+    uint32_t n_ntypes;  // Lnast_ntype_last_invalid when saved (the node type ids change with it)
+    uint32_t n_lnasts;
+    uint32_t n_nodes;  // includes the invalid node 0
+    uint32_t n_texts;
+    uint32_t source_id;  // text id of the source path
+    uint64_t text_bytes;
+  };
+
+  struct Entry {
+    uint32_t name_id;
+    uint32_t root;
+  };
+
+  struct Node {
+    uint8_t  type;
+    uint8_t  tok;  // Etoken fields, so errors in later passes still point to the source
+    int16_t  subs;
+    uint32_t text_id;
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint32_t line;
+    uint32_t pad;
+    uint64_t pos1;
+    uint64_t pos2;
+  };
+  static_assert(sizeof(Node) == 40);
+
+  static constexpr char     magic_id[8]         = "LNASTC3";
+  static constexpr uint32_t cache_format_version = 3;
+
+  static uint64_t frontend_hash(const mmap_lib::str &frontend);
+
+public:
+  static uint64_t    source_hash(const mmap_lib::str &src_file);  // 0 if the file can not be read
+  static std::string cache_file(const mmap_lib::str &path, const mmap_lib::str &src_file);
+
+  // frontend names the front end (and its version) that generated the LNASTs
+  static bool save(const std::vector<std::shared_ptr<Lnast>> &lnasts, const mmap_lib::str &path, const mmap_lib::str &src_file,
+                   const mmap_lib::str &frontend);
+
+  // Empty when there is no cache entry for src_file, it is stale, it was
+  // written by another front end or format version, or it is corrupted
+  static std::vector<std::shared_ptr<Lnast>> load(const mmap_lib::str &path, const mmap_lib::str &src_file,
+                                                  const mmap_lib::str &frontend);
+};
@@ -0,0 +1,68 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "lnast_flat.hpp"
+
+Lnast_flat::Lnast_flat(const mmap_lib::str &_module_name) : top_module_name(_module_name) {
+  intern(""_str);
+}
+
+Lnast_flat::Lnast_flat(const Lnast &ln) : top_module_name(ln.get_top_module_name()) {
+  intern(""_str);
+
+  const auto &root = ln.get_data(Lnast_nid::root());
+  set_root(Lnast_flat_node(root.type, intern(root.token.get_text()), root.subs));
+
+  copy_children(ln, Lnast_nid::root(), root_index());
+}
+
+uint32_t Lnast_flat::intern(const mmap_lib::str &txt) {
+  auto [it, inserted] = text2id.try_emplace(txt, texts.size());
+  if (inserted)
+    texts.emplace_back(txt);
+
+  return it->second;
+}
+
+void Lnast_flat::copy_children(const Lnast &ln, const Lnast_nid &src_nid, const Lnast_flat_nid dst_nid) {
+  if (ln.is_leaf(src_nid))
+    return;
+
+  // depth first, so the flat array is in preorder
+  for (auto child = ln.get_first_child(src_nid); !child.is_invalid(); child = ln.get_sibling_next(child)) {
+    const auto &node = ln.get_data(child);
+    auto        nid  = add_child(dst_nid, Lnast_flat_node(node.type, intern(node.token.get_text()), node.subs));
+    copy_children(ln, child, nid);
+  }
+}
+
+void Lnast_flat::copy_children(Lnast &ln, const Lnast_flat_nid src_nid, const Lnast_nid &dst_nid) const {
+  for (auto child : children(src_nid)) {
+    const auto &node = get_data(child);
+    auto        nid  = ln.add_child(dst_nid, Lnast_node(node.type, Etoken(0, 0, 0, 0, texts[node.text_id])));
+    ln.ref_data(nid)->subs = node.subs;  // SSA can leave invalid nodes, so no Lnast_node constructor with subs
+    copy_children(ln, child, nid);
+  }
+}
+
+std::unique_ptr<Lnast> Lnast_flat::to_lnast() const {
+  auto ln = std::make_unique<Lnast>(top_module_name);
+  if (empty())
+    return ln;
+
+  const auto &root = get_data(root_index());
+  ln->set_root(Lnast_node(root.type, Etoken(0, 0, 0, 0, texts[root.text_id])));
+
+  copy_children(*ln, root_index(), Lnast_nid::root());
+
+  return ln;
+}
+
+void Lnast_flat::dump() const {
+  for (const auto &nid : depth_preorder()) {
+    std::string indent(get_level(nid) * 2, ' ');
+    fmt::print("{} {} {}", indent, get_type(nid).debug_name(), get_name(nid));
+    if (get_subs(nid))
+      fmt::print(" subs:{}", get_subs(nid));
+    fmt::print("\n");
+  }
+}
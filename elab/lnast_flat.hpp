@@ -0,0 +1,67 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "lnast.hpp"
+#include "mmap_str.hpp"
+#include "mmap_tree2.hpp"
+
+using Lnast_flat_nid = mmap_lib::Tree2_index;
+
+// Compact LNAST node: 8 bytes instead of the full Etoken in Lnast_node. The
+// text is interned in the owning Lnast_flat. The token position/line is not
+// kept.
+struct Lnast_flat_node {
+  Lnast_ntype type;
+  int16_t     subs;  // ssa subscript
+  uint32_t    text_id;
+
+  constexpr Lnast_flat_node() : type(Lnast_ntype::create_invalid()), subs(0), text_id(0) {}
+  constexpr Lnast_flat_node(Lnast_ntype _type, uint32_t _text_id, int16_t _subs) : type(_type), subs(_subs), text_id(_text_id) {}
+};
+
+// Alternate LNAST store on the flat array tree (mmap_lib::tree2). It is
+// read-mostly: build it from an Lnast (nodes end up in preorder) or with
+// add_child, traverse it, and go back with to_lnast() for the passes that
+// still need Lnast (SSA, Lnast_tolg).
+class Lnast_flat : public mmap_lib::tree2<Lnast_flat_node> {
+protected:
+  mmap_lib::str top_module_name;
+
+  std::vector<mmap_lib::str>                   texts;  // text_id -> text (0 is "")
+  absl::flat_hash_map<mmap_lib::str, uint32_t> text2id;
+
+  void copy_children(const Lnast &ln, const Lnast_nid &src_nid, const Lnast_flat_nid dst_nid);
+  void copy_children(Lnast &ln, const Lnast_flat_nid src_nid, const Lnast_nid &dst_nid) const;
+
+public:
+  explicit Lnast_flat(const mmap_lib::str &_module_name);
+  explicit Lnast_flat(const Lnast &ln);
+
+  uint32_t intern(const mmap_lib::str &txt);
+
+  using mmap_lib::tree2<Lnast_flat_node>::add_child;
+  Lnast_flat_nid add_child(const Lnast_flat_nid parent, Lnast_ntype type, const mmap_lib::str &txt, int16_t subs = 0) {
+    return add_child(parent, Lnast_flat_node(type, intern(txt), subs));
+  }
+
+  const mmap_lib::str &get_top_module_name() const { return top_module_name; }
+
+  size_t               get_num_texts() const { return texts.size(); }
+  const mmap_lib::str &get_text(uint32_t text_id) const { return texts[text_id]; }
+
+  const mmap_lib::str &get_name(const Lnast_flat_nid nid) const { return texts[get_data(nid).text_id]; }
+  Lnast_ntype          get_type(const Lnast_flat_nid nid) const { return get_data(nid).type; }
+  int16_t              get_subs(const Lnast_flat_nid nid) const { return get_data(nid).subs; }
+  mmap_lib::str        get_sname(const Lnast_flat_nid nid) const {  // sname = ssa name
+    if (get_type(nid).is_const())
+      return get_name(nid);
+    return mmap_lib::str::concat(get_name(nid), "_"_str, get_subs(nid));
+  }
+
+  std::unique_ptr<Lnast> to_lnast() const;
+
+  void dump() const;
+};
@@ -172,6 +172,8 @@ public:
   Lnast_ntype_int get_raw_ntype() const { return val; }
 
   static constexpr Lnast_ntype create_invalid() { return Lnast_ntype(Lnast_ntype_invalid); }
+  // for deserialization (raw must come from get_raw_ntype)
+  static constexpr Lnast_ntype create_from_raw(Lnast_ntype_int raw) { return Lnast_ntype(raw); }
   static constexpr Lnast_ntype create_top() { return Lnast_ntype(Lnast_ntype_top); }
 
   static constexpr Lnast_ntype create_stmts() { return Lnast_ntype(Lnast_ntype_stmts); }
@@ -0,0 +1,116 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+#include "elab_prescan.hpp"
+#include "elab_scanner.hpp"
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "lrand.hpp"
+
+class Bench_scanner : public Elab_scanner {
+public:
+  Token_list tokens;
+
+  void elaborate() final { tokens.swap(token_list); }
+
+  bool same_tokens(const Bench_scanner &other) const {
+    if (tokens.size() != other.tokens.size())
+      return false;
+    for (auto i = 0u; i < tokens.size(); ++i) {
+      const auto &a = tokens[i];
+      const auto &b = other.tokens[i];
+      if (a.tok != b.tok || a.pos1 != b.pos1 || a.pos2 != b.pos2 || a.line != b.line || a.get_text() != b.get_text())
+        return false;
+    }
+    return true;
+  }
+};
+
+class Elab_scanner_bench : public ::testing::Test {
+protected:
+  static inline std::string fname = "elab_scanner_bench.v";
+  static inline size_t      fsize = 0;
+
+  static void SetUpTestSuite() {
+    mmap_lib::str::setup();
+
+    Lrand<int>  rng;
+    std::string txt;
+
+    // netlist like text with all the scanner corner cases (comments, strings, fused tokens)
+    txt.append("/* header comment\n * more header /* nested */ still comment\n */\n");
+    int n = 0;
+    while (txt.size() < (32 << 20)) {
+      ++n;
+      switch (rng.max(8)) {
+        case 0: txt.append(fmt::format("  wire [{}:0] net_{}_{}; // translate_off\n", rng.max(64), n, rng.max(1000))); break;
+        case 1: txt.append(fmt::format("  assign n{} = (a_{} & b_{})|c;\t\t// some comment here {}\n", n, n, n, n)); break;
+        case 2: txt.append(fmt::format("  always @(posedge clk) q{} <= d{} + 8'hFF;\n", n, n)); break;
+        case 3: txt.append(fmt::format("  $display(\"value {} \\\" %d\", x{});\n", n, n)); break;
+        case 4: txt.append(fmt::format("  #reg{} = $inp{} >= %out{} == 0b1?01;\n", n, n, n)); break;
+        case 5: txt.append(fmt::format("  (* keep *) cell_{} u{} (.A(a{}), .Y(y{})); /* inline {} */\r\n", n, n, n, n, n)); break;
+        case 6: txt.append(fmt::format("{:>{}}very_long_identifier_name_for_the_bench_{}_{}\n", "", rng.max(40), n, n)); break;
+        default: txt.append(fmt::format("  /* multi\n     line {} */ x{} := y{} != z{};\f\n", n, n, n, n)); break;
+      }
+    }
+    txt.append("endmodule");
+
+    std::ofstream(fname) << txt;
+    fsize = txt.size();
+  }
+
+  static void TearDownTestSuite() { unlink(fname.c_str()); }
+
+  static double scan(Bench_scanner &scanner) {
+    auto start = std::chrono::steady_clock::now();
+    scanner.parse_file(mmap_lib::str(fname));
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+TEST_F(Elab_scanner_bench, same_tokens_all_impl) {
+  Elab_prescan::set_impl(Elab_prescan::Impl::Scalar);
+  Bench_scanner ref;
+  auto          secs = scan(ref);
+  fmt::print("elab_scanner impl:{} tokens:{} MB/s:{:.1f}\n", Elab_prescan::get_impl_name(), ref.tokens.size(), fsize / secs / 1e6);
+
+  for (auto impl : {Elab_prescan::Impl::SSE42, Elab_prescan::Impl::AVX2}) {
+    if (!Elab_prescan::set_impl(impl))
+      continue;
+
+    Bench_scanner scanner;
+    secs = scan(scanner);
+    fmt::print("elab_scanner impl:{} tokens:{} MB/s:{:.1f}\n",
+               Elab_prescan::get_impl_name(),
+               scanner.tokens.size(),
+               fsize / secs / 1e6);
+
+    EXPECT_TRUE(scanner.same_tokens(ref));
+  }
+}
+
+TEST_F(Elab_scanner_bench, prescan_blocks) {
+  std::string txt = "abc_DEF_0123456789_zz_abc_DEF_0123456789_zz_abc_DEF_0123456789 \t \t     \t    \t    \t  .x";
+  for (auto impl : {Elab_prescan::Impl::Scalar, Elab_prescan::Impl::SSE42, Elab_prescan::Impl::AVX2}) {
+    if (!Elab_prescan::set_impl(impl))
+      continue;
+
+    auto pos = Elab_prescan::skip_alnum(txt.data(), 0, txt.size());
+    EXPECT_EQ(pos, txt.find(' '));
+    pos = Elab_prescan::skip_blank(txt.data(), pos, txt.size());
+    EXPECT_EQ(pos, txt.find('.'));
+    EXPECT_EQ(Elab_prescan::skip_alnum(txt.data(), 0, 5), 5);  // never past end
+
+    std::string cmt(100, 'x');
+    cmt[70] = '*';
+    cmt[90] = '\r';
+    EXPECT_EQ(Elab_prescan::skip_comment_body(cmt.data(), 3, cmt.size()), 70);
+    EXPECT_EQ(Elab_prescan::skip_to_newline(cmt.data(), 3, cmt.size()), 90);
+    EXPECT_EQ(Elab_prescan::skip_to_newline(cmt.data(), 3, 80), 80);
+  }
+}
@@ -48,12 +48,37 @@ static void BM_assign_pyrope_const(benchmark::State& state) {
 
 //--------------------------------------------------------------------
 
+static void BM_ssa_trans(benchmark::State& state) {
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    Lnast_create ln;
+    ln.new_lnast(mmap_lib::str::concat("ssa", state.range(0)));
+
+    // long single scope (like FIRRTL modules): x_i = x_(i-1) + y_i
+    for (int j = 0; j < state.range(0); ++j) {
+      auto a   = mmap_lib::str::concat("x", j % 64);
+      auto b   = mmap_lib::str::concat("y", j % 16);
+      auto tmp = ln.create_plus_stmts(a, b);
+      ln.create_assign_stmts(mmap_lib::str::concat("x", (j + 1) % 64), tmp);
+    }
+    state.ResumeTiming();
+
+    ln.lnast->ssa_trans();
+  }
+  state.counters["speed"] = benchmark::Counter(state.iterations() * state.range(0), benchmark::Counter::kIsRate);
+}
+
+//--------------------------------------------------------------------
+
 #ifndef NDEBUG
 BENCHMARK(BM_assign_const)->Range(16,1<<10)->Threads(2);
 BENCHMARK(BM_assign_pyrope_const)->Range(8,1<<10)->Threads(2);
+BENCHMARK(BM_ssa_trans)->Range(16,1<<12);
 #else
 BENCHMARK(BM_assign_const)->Range(16,1<<18)->ThreadRange(1,2);
 BENCHMARK(BM_assign_pyrope_const)->Range(8,1<<18)->ThreadRange(1,2);
+BENCHMARK(BM_ssa_trans)->Range(16,1<<18);
 #endif
 
 #if 0
@@ -0,0 +1,148 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "lnast_cache.hpp"
+#include "lnast_create.hpp"
+
+class Lnast_cache_test : public ::testing::Test {
+protected:
+  mmap_lib::str path;
+  mmap_lib::str src;
+  mmap_lib::str frontend;
+
+  std::vector<std::shared_ptr<Lnast>> lnasts;
+
+  static void write_file(const std::string &name, const std::string &txt) {
+    std::ofstream f(name, std::ios::binary | std::ios::trunc);
+    f << txt;
+  }
+
+  static std::string read_file(const std::string &name) {
+    std::ifstream f(name, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+  }
+
+  static std::vector<std::string> flatten(const Lnast *lnast) {
+    std::vector<std::string> flat;
+    flat.emplace_back(lnast->get_top_module_name().to_s());
+    for (const auto &nid : lnast->depth_preorder()) {
+      const auto &node = lnast->get_data(nid);
+      const auto &tok  = node.token;
+      flat.emplace_back(fmt::format("{} {} {} {} {} {} {} {}",
+                                    nid.level,
+                                    node.type.to_str(),
+                                    tok.get_text(),
+                                    node.subs,
+                                    tok.tok,
+                                    tok.pos1,
+                                    tok.pos2,
+                                    tok.line));
+    }
+    return flat;
+  }
+
+  void SetUp() override {
+    mmap_lib::str::setup();
+
+    path     = "lgdb_lnast_cache_test";
+    src      = "lnast_cache_test.prp";
+    frontend = "inou.test 1";
+
+    write_file(src.to_s(), "a = b + 1\n");
+
+    for (auto i = 0; i < 3; ++i) {
+      Lnast_create ln;
+      ln.new_lnast(mmap_lib::str::concat("mod", i));
+      for (auto j = 0; j < 50 * (i + 1); ++j) {
+        auto tmp = ln.create_plus_stmts(mmap_lib::str::concat("x", j % 7), mmap_lib::str(j));
+        ln.create_assign_stmts(mmap_lib::str::concat("x", (j + 1) % 7), tmp);
+      }
+      if (i == 2)
+        ln.lnast->ssa_trans();  // subs and invalid (merged) nodes
+
+      // Lnast_create has no source positions, fake them
+      uint64_t pos = 0;
+      for (const auto &nid : ln.lnast->depth_preorder()) {
+        auto &tok = ln.lnast->ref_data(nid)->token;
+        tok       = Etoken(pos % 7, pos, pos + 3, pos / 5 + 1, tok.get_text());
+        pos += 4;
+      }
+      lnasts.emplace_back(ln.lnast);
+    }
+
+    ASSERT_TRUE(Lnast_cache::save(lnasts, path, src, frontend));
+  }
+
+  // Replace len bytes at offset in the cache file, then load must not crash
+  std::vector<std::shared_ptr<Lnast>> load_patched(size_t offset, const std::string &bytes) {
+    auto fname = Lnast_cache::cache_file(path, src);
+    auto data  = read_file(fname);
+    if (offset + bytes.size() <= data.size())
+      data.replace(offset, bytes.size(), bytes);
+    write_file(fname, data);
+
+    return Lnast_cache::load(path, src, frontend);
+  }
+};
+
+TEST_F(Lnast_cache_test, round_trip) {
+  auto loaded = Lnast_cache::load(path, src, frontend);
+  ASSERT_EQ(loaded.size(), lnasts.size());
+
+  for (auto i = 0u; i < lnasts.size(); ++i) {
+    EXPECT_EQ(flatten(lnasts[i].get()), flatten(loaded[i].get()));
+    EXPECT_EQ(loaded[i]->get_source(), src);
+  }
+}
+
+TEST_F(Lnast_cache_test, stale) {
+  EXPECT_TRUE(Lnast_cache::load(path, src, "inou.other 1").empty());  // another front end
+
+  write_file(src.to_s(), "a = b + 2\n");  // edited source
+  EXPECT_TRUE(Lnast_cache::load(path, src, frontend).empty());
+
+  unlink(src.to_s().c_str());
+  EXPECT_TRUE(Lnast_cache::load(path, src, frontend).empty());
+}
+
+TEST_F(Lnast_cache_test, corrupted) {
+  auto fname = Lnast_cache::cache_file(path, src);
+  auto good  = read_file(fname);
+  ASSERT_GT(good.size(), 200u);
+
+  // truncated
+  write_file(fname, good.substr(0, good.size() / 2));
+  EXPECT_TRUE(Lnast_cache::load(path, src, frontend).empty());
+
+  write_file(fname, good.substr(0, 10));
+  EXPECT_TRUE(Lnast_cache::load(path, src, frontend).empty());
+
+  // format version, huge counts, bad magic
+  write_file(fname, good);
+  EXPECT_TRUE(load_patched(24, std::string(4, '\x7f')).empty());
+  write_file(fname, good);
+  EXPECT_TRUE(load_patched(32, std::string(8, '\xff')).empty());
+  write_file(fname, good);
+  EXPECT_TRUE(load_patched(0, "XXXX").empty());
+
+  // random garbage in the node and text area: a miss or a tree, never a crash
+  std::mt19937 rng(7);
+  for (auto i = 0; i < 200; ++i) {
+    write_file(fname, good);
+    std::string garbage(1 + rng() % 8, ' ');
+    for (auto &ch : garbage) ch = static_cast<char>(rng());
+    load_patched(64 + rng() % (good.size() - 72), garbage);
+  }
+
+  write_file(fname, good);
+  EXPECT_EQ(Lnast_cache::load(path, src, frontend).size(), lnasts.size());
+}
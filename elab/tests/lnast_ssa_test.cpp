@@ -0,0 +1,64 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "lnast_create.hpp"
+
+// The RHS SSA splits each scope in regions that run in the thread pool. The
+// result must match one serial region per scope.
+
+class Lnast_ssa_test : public ::testing::Test {
+protected:
+  // long scope of x_i = x_(i-1) + y_i with an if every 100 statements
+  static Lnast_create create(int n_stmts) {
+    Lnast_create ln;
+    ln.new_lnast("lnast_ssa_test"_str);
+
+    for (int j = 0; j < n_stmts; ++j) {
+      auto a   = mmap_lib::str::concat("x", j % 64);
+      auto b   = mmap_lib::str::concat("y", j % 16);
+      auto tmp = ln.create_plus_stmts(a, b);
+      ln.create_assign_stmts(mmap_lib::str::concat("x", (j + 1) % 64), tmp);
+
+      if (j % 100 == 50) {
+        auto &lnast  = ln.lnast;
+        auto  if_nid = lnast->add_child(ln.idx_stmts, Lnast_node::create_if());
+        lnast->add_child(if_nid, Lnast_node::create_ref(mmap_lib::str::concat("y", j % 16)));
+        for (auto v : {"x3", "x7"}) {
+          auto stmts_nid = lnast->add_child(if_nid, Lnast_node::create_stmts());
+          auto asg_nid   = lnast->add_child(stmts_nid, Lnast_node::create_assign());
+          lnast->add_child(asg_nid, Lnast_node::create_ref(mmap_lib::str::concat("x", (j + 2) % 64)));
+          lnast->add_child(asg_nid, Lnast_node::create_ref(mmap_lib::str(v)));
+        }
+      }
+    }
+
+    return ln;
+  }
+
+  static std::vector<std::string> flatten(Lnast *lnast) {
+    std::vector<std::string> flat;
+    for (const auto &nid : lnast->depth_preorder()) {
+      const auto &node = lnast->get_data(nid);
+      flat.emplace_back(fmt::format("{} {} {} {}", nid.level, node.type.to_str(), node.token.get_text(), node.subs));
+    }
+    return flat;
+  }
+};
+
+TEST_F(Lnast_ssa_test, regions_match_serial) {
+  auto serial = create(3000);
+  serial.lnast->set_ssa_rhs_region_size(0);
+  serial.lnast->ssa_trans();
+
+  for (auto sz : {1, 7, 256}) {
+    auto parallel = create(3000);
+    parallel.lnast->set_ssa_rhs_region_size(sz);
+    parallel.lnast->ssa_trans();
+
+    EXPECT_TRUE(flatten(serial.lnast.get()) == flatten(parallel.lnast.get())) << "region size " << sz;
+  }
+}
@@ -0,0 +1,1067 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "cgen_simlib.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "pass.hpp"
+
+Cgen_simlib::Cgen_simlib(bool _verbose, const mmap_lib::str _odir, int _lanes) : verbose(_verbose), odir(_odir), lanes(_lanes) {}
+
+// Alphanumerics are kept, other chars are escaped as _xHH (and a '_' before an
+// 'x' as _x5f), so different names never map to the same C++ name.
+mmap_lib::str Cgen_simlib::get_cpp_name(const mmap_lib::str &name) {
+  auto txt = name.to_s();
+  if (!txt.empty() && txt.front() == '%')
+    txt = txt.substr(txt.size() > 1 && txt[1] == '.' ? 2 : 1);
+
+  std::string out;
+  for (auto i = 0u; i < txt.size(); ++i) {
+    auto ch = txt[i];
+    bool keep;
+    if (ch == '_')
+      keep = i + 1 == txt.size() || txt[i + 1] != 'x';
+    else
+      keep = std::isalnum(ch) && (i != 0 || !std::isdigit(ch));
+
+    if (keep) {
+      out.push_back(ch);
+    } else {
+      char buf[5];
+      snprintf(buf, sizeof(buf), "_x%02x", static_cast<unsigned char>(ch));
+      out.append(buf);
+    }
+  }
+  if (out.empty())
+    out = "_";
+
+  return mmap_lib::str(out);
+}
+
+mmap_lib::str Cgen_simlib::get_stage_name(const mmap_lib::str &lg_name) {
+  auto txt = get_cpp_name(lg_name).to_s();
+  if (std::islower(txt.front()))
+    txt[0] = std::toupper(txt[0]);
+
+  return mmap_lib::str::concat(txt, "_stage");
+}
+
+mmap_lib::str Cgen_simlib::get_inst_name(const Node &node) {
+  return mmap_lib::str::concat("s_", node.has_name() ? get_cpp_name(node.get_name()) : mmap_lib::str("sub"), "_", node.get_nid().value);
+}
+
+Bits_t Cgen_simlib::get_bits(const Node_pin &dpin, Bits_t default_bits) {
+  if (dpin.is_type_const())
+    return std::max<Bits_t>(dpin.get_type_const().get_bits(), 1);
+
+  auto bits = dpin.get_bits();
+  return bits ? bits : default_bits;
+}
+
+mmap_lib::str Cgen_simlib::get_const(const Lconst &v, Bits_t bits) const {
+  if (v.is_string() || v.has_unknowns()) {
+    Pass::info("inou.cgen.simlib constant {} is not a number, using zero", v.to_pyrope());
+    return mmap_lib::str::concat(get_type(bits), "(0)");
+  }
+
+  if (bits < 64) {
+    auto val = v.sext_op(bits - 1);
+    return mmap_lib::str::concat(get_type(bits), "(", val.to_i(), "ll)");
+  }
+
+  // wide constant as a hex string of the two's complement bits
+  auto pattern = v.and_op(Lconst::get_mask_value(bits));
+
+  std::string hex;
+  for (auto i = 0u; i < bits; i += 32) {
+    auto chunk = static_cast<uint32_t>(pattern.and_op(Lconst(0xFFFFFFFF)).to_i());
+    pattern    = pattern.rsh_op(32);
+
+    char buf[9];
+    snprintf(buf, sizeof(buf), "%08x", chunk);
+    hex = buf + hex;
+  }
+
+  return mmap_lib::str::concat(get_type(bits), "(std::string(\"0x", hex, "\"))");
+}
+
+void Cgen_simlib::get_io(Lgraph *lg, std::vector<Io> &inputs, std::vector<Io> &outputs) {
+  lg->each_graph_input([&inputs](const Node_pin &dpin) { inputs.emplace_back(Io{dpin.get_name(), get_bits(dpin)}); });
+  lg->each_graph_output([&outputs](const Node_pin &dpin) { outputs.emplace_back(Io{dpin.get_name(), get_bits(dpin)}); });
+
+  // the caller and the sub stage must agree on the cycle() argument order
+  auto by_name = [](const Io &a, const Io &b) { return a.name.to_s() < b.name.to_s(); };
+  std::sort(inputs.begin(), inputs.end(), by_name);
+  std::sort(outputs.begin(), outputs.end(), by_name);
+}
+
+mmap_lib::str Cgen_simlib::get_expr(const Node_pin &dpin) const {
+  if (dpin.is_type_const())
+    return get_const(dpin.get_type_const(), get_bits(dpin));
+
+  auto it = pin2var.find(dpin.get_compact_class_driver());
+  if (it != pin2var.end())
+    return it->second;
+
+  return mmap_lib::str::concat(get_type(get_bits(dpin)), "(0)");  // disconnected or not supported
+}
+
+mmap_lib::str Cgen_simlib::get_resized(const Node_pin &dpin, Bits_t bits) const {
+  if (get_bits(dpin) == bits)
+    return get_expr(dpin);
+
+  return mmap_lib::str::concat("simlib::resize<", bits, ">(", get_expr(dpin), ")");
+}
+
+mmap_lib::str Cgen_simlib::get_local(const Node_pin &dpin) {
+  mmap_lib::str name;
+  if (verbose && dpin.has_name())
+    name = mmap_lib::str::concat("t", dpin.get_node().get_nid().value, "_", get_cpp_name(dpin.get_name()));
+  else if (dpin.get_pid())
+    name = mmap_lib::str::concat("t", dpin.get_node().get_nid().value, "_", dpin.get_pid());
+  else
+    name = mmap_lib::str::concat("t", dpin.get_node().get_nid().value);
+
+  pin2var[dpin.get_compact_class_driver()] = name;
+  return name;
+}
+
+bool Cgen_simlib::setup_memory(Node &node) {
+  auto &mem = node2mem[node.get_compact_class()];
+
+  for (const auto &e : node.inp_edges()) {
+    auto pin_name = e.sink.get_pin_name();
+
+    size_t port_id = e.sink.get_pid() / 11;
+    if (mem.ports.size() <= port_id)
+      mem.ports.resize(1 + port_id);
+
+    if (pin_name == "bits" || pin_name == "size" || pin_name == "type" || pin_name == "rdport") {
+      if (!e.driver.is_type_const()) {
+        Pass::error("memory {} should have a constant for {} not {}", node.debug_name(), pin_name, e.driver.get_node().debug_name());
+        return false;
+      }
+      auto v = e.driver.get_type_const();
+      if (pin_name == "bits")
+        mem.bits = v.to_i();
+      else if (pin_name == "size")
+        mem.size = v.to_i();
+      else if (pin_name == "type")
+        mem.type = v.to_i();
+      else
+        mem.ports[port_id].rdport = !v.is_known_false();
+    } else if (pin_name == "addr") {
+      mem.ports[port_id].addr = e.driver;
+    } else if (pin_name == "enable") {
+      mem.ports[port_id].enable = e.driver;
+    } else if (pin_name == "din") {
+      mem.ports[port_id].din = e.driver;
+    }
+  }
+
+  if (mem.bits <= 0 || mem.size <= 0) {
+    Pass::error("memory {} should have positive bits and size", node.debug_name());
+    return false;
+  }
+
+  auto mem_name = mmap_lib::str::concat("m_", node.get_nid().value);
+  fmembers->append("  std::array<", get_type(mem.bits), ", ", mem.size, "> ", mem_name, ";\n");
+  freset->append("  ", mem_name, ".fill(", get_type(mem.bits), "(0));\n");
+  fsign->append("  sign.append_field(this, ", mem_name, ", \"", mem_name, "\");\n");
+
+  if (mem.type == 1) {  // sync read ports are registered
+    auto n_pos = 0;
+    for (const auto &p : mem.ports) {
+      if (p.rdport) {
+        auto dout     = node.setup_driver_pin_raw(n_pos);
+        auto dout_var = mmap_lib::str::concat(mem_name, "_rd", n_pos);
+        fmembers->append("  ", get_type(mem.bits), " ", dout_var, ";\n");
+        freset->append("  ", dout_var, " = ", get_type(mem.bits), "(0);\n");
+        fsign->append("  sign.append_field(this, ", dout_var, ", \"", dout_var, "\");\n");
+        pin2var[dout.get_compact_class_driver()] = dout_var;
+      }
+      ++n_pos;
+    }
+  }
+
+  return true;
+}
+
+void Cgen_simlib::process_flop(Node &node) {
+  auto dpin = node.get_driver_pin();
+  auto bits = get_bits(dpin);
+
+  mmap_lib::str q_name;
+  if (dpin.has_name())
+    q_name = mmap_lib::str::concat("r_", get_cpp_name(dpin.get_name()), "_", node.get_nid().value);
+  else
+    q_name = mmap_lib::str::concat("r_", node.get_nid().value);
+
+  pin2var[dpin.get_compact_class_driver()] = q_name;
+
+  fmembers->append("  ", get_type(bits), " ", q_name, ";\n");
+  fsign->append("  sign.append_field(this, ", q_name, ", \"", q_name, "\");\n");
+}
+
+void Cgen_simlib::process_memory_ports(Node &node) {
+  // next state of flops and memories (after all the combinational values are computed)
+  if (node.get_type_op() == Ntype_op::Flop) {
+    auto dpin   = node.get_driver_pin();
+    auto bits   = get_bits(dpin);
+    auto q_name = get_expr(dpin);
+
+    Node_pin din, enable, reset, initial;
+    bool     negreset = false;
+    for (const auto &e : node.inp_edges()) {
+      auto pin_name = e.sink.get_pin_name();
+      if (pin_name == "din")
+        din = e.driver;
+      else if (pin_name == "enable")
+        enable = e.driver;
+      else if (pin_name == "reset")
+        reset = e.driver;
+      else if (pin_name == "initial")
+        initial = e.driver;
+      else if (pin_name == "negreset" && e.driver.is_type_const())
+        negreset = !e.driver.get_type_const().is_known_false();
+    }
+
+    auto init_expr = initial.is_invalid() ? mmap_lib::str::concat(get_type(bits), "(0)") : get_resized(initial, bits);
+    if (initial.is_invalid() || initial.is_type_const())
+      freset->append("  ", q_name, " = ", init_expr, ";\n");
+    else
+      freset->append("  ", q_name, " = ", get_type(bits), "(0);\n");
+
+    if (din.is_invalid()) {
+      Pass::info("inou.cgen.simlib flop {} has no din", node.debug_name());
+      return;
+    }
+
+    auto next = get_resized(din, bits);
+    if (!enable.is_invalid())
+      next = mmap_lib::str::concat("simlib::select(", get_expr(enable), ", ", next, ", ", q_name, ")");
+    if (!reset.is_invalid()) {
+      if (negreset)
+        next = mmap_lib::str::concat("simlib::select(", get_expr(reset), ", ", next, ", ", init_expr, ")");
+      else
+        next = mmap_lib::str::concat("simlib::select(", get_expr(reset), ", ", init_expr, ", ", next, ")");
+    }
+
+    fmembers->append("  ", get_type(bits), " ", q_name, "_next;\n");
+    fnext->append("  ", q_name, "_next = ", next, ";\n");
+    fupdate->append("  ", q_name, " = ", q_name, "_next;\n");
+    return;
+  }
+
+  I(node.get_type_op() == Ntype_op::Memory);
+  const auto &mem      = node2mem[node.get_compact_class()];
+  auto        mem_name = mmap_lib::str::concat("m_", node.get_nid().value);
+  if (mem.type == 2)
+    return;  // arrays are combinational
+
+  auto n_pos = 0;
+  for (const auto &p : mem.ports) {
+    if (p.rdport && mem.type == 1) {
+      auto dout_var = mmap_lib::str::concat(mem_name, "_rd", n_pos);
+      auto rd       = mmap_lib::str::concat("simlib::mem_read(", mem_name, ", ", get_expr(p.addr), ")");
+      if (!p.enable.is_invalid())
+        rd = mmap_lib::str::concat("simlib::select(", get_expr(p.enable), ", ", rd, ", ", dout_var, ")");
+      fmembers->append("  ", get_type(mem.bits), " ", dout_var, "_next;\n");
+      fnext->append("  ", dout_var, "_next = ", rd, ";\n");
+      fupdate->append("  ", dout_var, " = ", dout_var, "_next;\n");
+    } else if (!p.rdport && !p.addr.is_invalid() && !p.din.is_invalid()) {
+      // the write port values are kept for posedge, memory writes after all the reads
+      auto wr_var = mmap_lib::str::concat(mem_name, "_wr", n_pos);
+      fmembers->append("  ", get_type(get_bits(p.addr)), " ", wr_var, "_addr;\n");
+      fmembers->append("  ", get_type(mem.bits), " ", wr_var, "_din;\n");
+      fnext->append("  ", wr_var, "_addr = ", get_expr(p.addr), ";\n");
+      fnext->append("  ", wr_var, "_din = ", get_resized(p.din, mem.bits), ";\n");
+
+      fupdate->append("  simlib::mem_write(", mem_name, ", ", wr_var, "_addr, ", wr_var, "_din");
+      if (!p.enable.is_invalid()) {
+        fmembers->append("  ", get_type(get_bits(p.enable)), " ", wr_var, "_enable;\n");
+        fnext->append("  ", wr_var, "_enable = ", get_expr(p.enable), ";\n");
+        fupdate->append(", ", wr_var, "_enable");
+      }
+      fupdate->append(");\n");
+    }
+    ++n_pos;
+  }
+}
+
+void Cgen_simlib::process_memory_reads(Node &node) {
+  const auto &mem      = node2mem[node.get_compact_class()];
+  auto        mem_name = mmap_lib::str::concat("m_", node.get_nid().value);
+  if (mem.type == 1)
+    return;  // registered in process_memory_ports
+
+  auto n_pos = 0;
+  for (const auto &p : mem.ports) {
+    if (!p.rdport) {
+      ++n_pos;
+      continue;
+    }
+    auto dout = node.setup_driver_pin_raw(n_pos);
+    auto var  = get_local(dout);
+    auto type = get_type(mem.bits);
+
+    if (mem.type == 0) {
+      fcomb->append("  const ", type, " ", var, " = simlib::mem_read(", mem_name, ", ", get_expr(p.addr), ");\n");
+      ++n_pos;
+      continue;
+    }
+
+    // array: cleared each cycle, the last enabled write port wins
+    fcomb->append("  ", type, " ", var, "(0);\n");
+    for (const auto &w : mem.ports) {
+      if (w.rdport || w.addr.is_invalid() || w.din.is_invalid())
+        continue;
+      fcomb->append("  ", var, " = simlib::fwd_write(", var, ", ", get_expr(p.addr), ", ", get_expr(w.addr), ", ");
+      fcomb->append(get_resized(w.din, mem.bits));
+      if (!w.enable.is_invalid())
+        fcomb->append(", ", get_expr(w.enable));
+      fcomb->append(");\n");
+    }
+    ++n_pos;
+  }
+}
+
+void Cgen_simlib::process_sub_decl(Node &node) {
+  if (!node.is_type_sub_present()) {
+    Pass::error("inou.cgen.simlib sub {} does not have an lgraph", node.debug_name());
+    return;
+  }
+  auto *sub_lg = node.ref_type_sub_lgraph();
+
+  std::vector<Io> inputs;
+  std::vector<Io> outputs;
+  get_io(sub_lg, inputs, outputs);
+
+  auto stage_name = get_stage_name(sub_lg->get_name());
+  auto inst_name  = get_inst_name(node);
+
+  sub_includes.insert(mmap_lib::str::concat(get_cpp_name(sub_lg->get_name()), "_stage.hpp"));
+  sub_inits.emplace_back(inst_name);
+  fmembers->append("  ", stage_name, " ", inst_name, ";\n");
+  freset->append("  ", inst_name, ".reset_cycle();\n");
+  fupdate->append("  ", inst_name, ".posedge();\n");
+  fsign->append("  sign.append_field(this, ", inst_name, ", \"", inst_name, "\");\n");
+  fsign->append("  ", inst_name, ".add_signature(sign);\n");
+
+  absl::flat_hash_map<mmap_lib::str, Node_pin> out_dpin;
+  for (auto &dpin : node.out_connected_pins()) {
+    out_dpin[dpin.get_pin_name()] = dpin;
+  }
+
+  for (const auto &io : outputs) {
+    auto it = out_dpin.find(io.name);
+
+    mmap_lib::str var;
+    if (it == out_dpin.end())
+      var = mmap_lib::str::concat("t", node.get_nid().value, "_", get_cpp_name(io.name), "_unused");
+    else
+      var = get_local(it->second);
+
+    fcomb->append("  ", get_type(io.bits), " ", var, ";\n");
+  }
+}
+
+// state_only: the inputs are not computed yet, only the sub outputs that do
+// not depend on them are used (get_comb_outputs)
+void Cgen_simlib::process_sub(Node &node, bool state_only) {
+  auto *sub_lg = node.ref_type_sub_lgraph();
+
+  std::vector<Io> inputs;
+  std::vector<Io> outputs;
+  get_io(sub_lg, inputs, outputs);
+
+  absl::flat_hash_map<mmap_lib::str, Node_pin> inp_driver;
+  for (const auto &e : node.inp_edges()) {
+    inp_driver[e.sink.get_pin_name()] = e.driver;
+  }
+
+  absl::flat_hash_map<mmap_lib::str, Node_pin> out_dpin;
+  for (auto &dpin : node.out_connected_pins()) {
+    out_dpin[dpin.get_pin_name()] = dpin;
+  }
+
+  std::vector<mmap_lib::str> args;
+  for (const auto &io : inputs) {
+    auto it = inp_driver.find(io.name);
+    if (it == inp_driver.end() || state_only)
+      args.emplace_back(mmap_lib::str::concat(get_type(io.bits), "(0)"));
+    else
+      args.emplace_back(get_resized(it->second, io.bits));
+  }
+  for (const auto &io : outputs) {
+    auto it = out_dpin.find(io.name);
+    if (it == out_dpin.end())
+      args.emplace_back(mmap_lib::str::concat("t", node.get_nid().value, "_", get_cpp_name(io.name), "_unused"));
+    else
+      args.emplace_back(get_expr(it->second));
+  }
+
+  fcomb->append("  ", get_inst_name(node), ".comb(");
+  for (auto i = 0u; i < args.size(); ++i) {
+    fcomb->append(i ? ", " : "", args[i]);
+  }
+  fcomb->append(");\n");
+}
+
+void Cgen_simlib::process_mux(Node &node) {
+  auto dpin = node.get_driver_pin();
+  auto bits = get_bits(dpin);
+  auto type = get_type(bits);
+
+  Node_pin              sel;
+  std::vector<Node_pin> options;
+  for (const auto &e : node.inp_edges()) {
+    auto pid = e.sink.get_pid();
+    if (pid == 0) {
+      sel = e.driver;
+      continue;
+    }
+    if (options.size() < pid)
+      options.resize(pid);
+    options[pid - 1] = e.driver;
+  }
+
+  auto var = get_local(dpin);
+  if (sel.is_invalid() || options.empty()) {
+    fcomb->append("  const ", type, " ", var, "(0);\n");
+    return;
+  }
+
+  if (options.size() == 2 && get_bits(sel) == 1 && !options[0].is_invalid() && !options[1].is_invalid()) {
+    fcomb->append("  const ", type, " ", var, " = simlib::select(", get_expr(sel), ", ", get_resized(options[1], bits), ", ",
+                  get_resized(options[0], bits), ");\n");
+    return;
+  }
+
+  fcomb->append("  ", type, " ", var, "(0);\n");
+  if (lanes > 1) {  // each lane selects its own option
+    for (auto i = 0u; i < options.size(); ++i) {
+      if (options[i].is_invalid())
+        continue;
+      fcomb->append("  ", var, " = simlib::select(simlib::eq_index(", get_expr(sel), ", ", i, "), ", get_resized(options[i], bits), ", ", var, ");\n");
+    }
+    return;
+  }
+
+  fcomb->append("  switch (simlib::to_index(", get_expr(sel), ")) {\n");
+  for (auto i = 0u; i < options.size(); ++i) {
+    if (options[i].is_invalid())
+      continue;
+    fcomb->append("    case ", i, ": ", var, " = ", get_resized(options[i], bits), "; break;\n");
+  }
+  fcomb->append("    default: break;\n");
+  fcomb->append("  }\n");
+}
+
+void Cgen_simlib::process_mask(Node &node) {
+  auto op   = node.get_type_op();
+  auto dpin = node.get_driver_pin();
+  auto bits = get_bits(dpin);
+  auto type = get_type(bits);
+
+  Node_pin a, value;
+  Lconst   mask(-1);
+  for (const auto &e : node.inp_edges()) {
+    auto pin_name = e.sink.get_pin_name();
+    if (pin_name == "a") {
+      a = e.driver;
+    } else if (pin_name == "value") {
+      value = e.driver;
+    } else if (pin_name == "mask") {
+      if (!e.driver.is_type_const()) {
+        Pass::error("inou.cgen.simlib {} should have a constant mask not {}", node.debug_name(), e.driver.get_node().debug_name());
+        return;
+      }
+      mask = e.driver.get_type_const();
+    }
+  }
+
+  auto a_expr = a.is_invalid() ? mmap_lib::str::concat(type, "(0)") : get_expr(a);
+  auto a_bits = a.is_invalid() ? bits : get_bits(a);
+
+  // a negative mask selects all the upper bits
+  uint32_t limit = mask.get_bits();
+  if (mask.is_negative()) {
+    limit = std::max<uint32_t>(limit, a_bits);
+    if (op == Ntype_op::Set_mask)
+      limit = std::max<uint32_t>(limit, bits);
+  }
+
+  std::vector<uint32_t> positions;
+  for (auto i = 0u; i < limit; ++i) {
+    if (!mask.and_op(Lconst(1).lsh_op(i)).is_known_false())
+      positions.emplace_back(i);
+  }
+  bool range = positions.empty() || (positions.back() - positions.front() + 1) == positions.size();
+
+  auto var = get_local(dpin);
+  fcomb->append("  const ", type, " ", var, " = ");
+
+  if (op == Ntype_op::Get_mask) {
+    if (positions.empty())
+      fcomb->append(type, "(0);\n");
+    else if (range)
+      fcomb->append("simlib::get_range<", bits, ">(", a_expr, ", ", positions.front(), ", ", positions.back() + 1, ");\n");
+    else
+      fcomb->append("simlib::get_mask<", bits, ">(", a_expr, ", {");
+  } else {
+    auto value_expr = value.is_invalid() ? mmap_lib::str::concat(type, "(0)") : get_expr(value);
+    if (positions.empty())
+      fcomb->append("simlib::resize<", bits, ">(", a_expr, ");\n");
+    else if (range)
+      fcomb->append("simlib::set_range<", bits, ">(", a_expr, ", ", value_expr, ", ", positions.front(), ", ", positions.back() + 1, ");\n");
+    else
+      fcomb->append("simlib::set_mask<", bits, ">(", a_expr, ", ", value_expr, ", {");
+  }
+
+  if (!range) {
+    for (auto i = 0u; i < positions.size(); ++i) {
+      fcomb->append(i ? ", " : "", positions[i]);
+    }
+    fcomb->append("});\n");
+  }
+}
+
+bool Cgen_simlib::process_simple_node(Node &node) {
+  auto op   = node.get_type_op();
+  auto dpin = node.get_driver_pin();
+
+  Bits_t default_bits = 64;
+  if (op == Ntype_op::Ror || op == Ntype_op::LT || op == Ntype_op::GT || op == Ntype_op::EQ)
+    default_bits = 1;
+  auto bits = get_bits(dpin, default_bits);
+  auto type = get_type(bits);
+
+  std::vector<Node_pin> a_pins;  // pid 0
+  std::vector<Node_pin> b_pins;  // other pids
+  Bits_t                max_bits = bits;
+  for (const auto &e : node.inp_edges()) {
+    if (e.sink.get_pid() == 0)
+      a_pins.emplace_back(e.driver);
+    else
+      b_pins.emplace_back(e.driver);
+    max_bits = std::max(max_bits, get_bits(e.driver));
+  }
+
+  mmap_lib::str expr;
+  switch (op) {
+    case Ntype_op::Sum: {
+      expr = a_pins.empty() ? mmap_lib::str::concat(type, "(0)") : get_resized(a_pins[0], bits);
+      for (auto i = 1u; i < a_pins.size(); ++i) {
+        expr = mmap_lib::str::concat(expr, ".addw(", get_resized(a_pins[i], bits), ")");
+      }
+      for (const auto &b : b_pins) {
+        expr = mmap_lib::str::concat(expr, ".subw(", get_resized(b, bits), ")");
+      }
+    } break;
+    case Ntype_op::Mult:
+    case Ntype_op::And:
+    case Ntype_op::Or:
+    case Ntype_op::Xor: {
+      a_pins.insert(a_pins.end(), b_pins.begin(), b_pins.end());
+      if (a_pins.empty())
+        return false;
+      expr = get_resized(a_pins[0], bits);
+      for (auto i = 1u; i < a_pins.size(); ++i) {
+        if (op == Ntype_op::Mult)
+          expr = mmap_lib::str::concat("simlib::mulw(", expr, ", ", get_resized(a_pins[i], bits), ")");
+        else
+          expr = mmap_lib::str::concat("(", expr, op == Ntype_op::And ? " & " : (op == Ntype_op::Or ? " | " : " ^ "), get_resized(a_pins[i], bits), ").asSInt()");
+      }
+    } break;
+    case Ntype_op::Div: {
+      if (a_pins.size() != 1 || b_pins.size() != 1)
+        return false;
+      if (max_bits > 64) {
+        Pass::error("inou.cgen.simlib division {} is wider than 64 bits", node.debug_name());
+        return false;
+      }
+      expr = mmap_lib::str::concat("simlib::resize<", bits, ">(simlib::div(", get_resized(a_pins[0], max_bits), ", ", get_resized(b_pins[0], max_bits), "))");
+    } break;
+    case Ntype_op::Not: {
+      if (a_pins.size() != 1)
+        return false;
+      expr = mmap_lib::str::concat("(~", get_resized(a_pins[0], bits), ").asSInt()");
+    } break;
+    case Ntype_op::Ror: {
+      a_pins.insert(a_pins.end(), b_pins.begin(), b_pins.end());
+      expr = mmap_lib::str::concat(type, "(0)");
+      for (auto i = 0u; i < a_pins.size(); ++i) {
+        auto v = mmap_lib::str::concat("simlib::ror<", bits, ">(", get_expr(a_pins[i]), ")");
+        expr   = i ? mmap_lib::str::concat("simlib::lor(", expr, ", ", v, ")") : v;
+      }
+    } break;
+    case Ntype_op::LT:
+    case Ntype_op::GT: {
+      expr       = mmap_lib::str::concat(type, "(1)");  // true
+      bool first = true;
+      for (const auto &a : a_pins) {
+        for (const auto &b : b_pins) {
+          auto v = mmap_lib::str::concat(op == Ntype_op::LT ? "simlib::lt<" : "simlib::gt<",
+                                         bits,
+                                         ">(",
+                                         get_resized(a, max_bits),
+                                         ", ",
+                                         get_resized(b, max_bits),
+                                         ")");
+          expr   = first ? v : mmap_lib::str::concat("simlib::land(", expr, ", ", v, ")");
+          first  = false;
+        }
+      }
+    } break;
+    case Ntype_op::EQ: {
+      a_pins.insert(a_pins.end(), b_pins.begin(), b_pins.end());
+      expr = mmap_lib::str::concat(type, "(1)");  // true
+      for (auto i = 1u; i < a_pins.size(); ++i) {
+        auto v = mmap_lib::str::concat("simlib::eq<", bits, ">(", get_resized(a_pins[0], max_bits), ", ", get_resized(a_pins[i], max_bits), ")");
+        expr   = i > 1 ? mmap_lib::str::concat("simlib::land(", expr, ", ", v, ")") : v;
+      }
+    } break;
+    case Ntype_op::SHL: {
+      if (a_pins.size() != 1 || b_pins.empty())
+        return false;
+      auto a_expr = get_resized(a_pins[0], bits);
+      expr        = mmap_lib::str::concat("simlib::shl(", a_expr, ", ", get_expr(b_pins[0]), ")");
+      for (auto i = 1u; i < b_pins.size(); ++i) {
+        expr = mmap_lib::str::concat("(", expr, " | simlib::shl(", a_expr, ", ", get_expr(b_pins[i]), ")).asSInt()");
+      }
+    } break;
+    case Ntype_op::SRA:
+    case Ntype_op::Sext: {
+      if (a_pins.size() != 1 || b_pins.size() != 1)
+        return false;
+      auto m = std::max(bits, get_bits(a_pins[0]));
+      expr   = mmap_lib::str::concat("simlib::resize<",
+                                   bits,
+                                   ">(simlib::",
+                                   op == Ntype_op::SRA ? "sra(" : "sext(",
+                                   get_resized(a_pins[0], m),
+                                   ", ",
+                                   get_expr(b_pins[0]),
+                                   "))");
+    } break;
+    default: return false;
+  }
+
+  auto var = get_local(dpin);
+  fcomb->append("  const ", type, " ", var, " = ", expr, ";\n");
+  return true;
+}
+
+int Cgen_simlib::get_mem_type(const Node &node) {
+  for (const auto &e : node.inp_edges()) {
+    if (e.sink.get_pin_name() == "type" && e.driver.is_type_const())
+      return e.driver.get_type_const().to_i();
+  }
+  return 2;  // array by default
+}
+
+// the sink node uses the value in the same cycle, not only at the clock edge
+bool Cgen_simlib::is_comb_sink(const XEdge &e) {
+  auto node = e.sink.get_node();
+  auto op   = node.get_type_op();
+  if (op == Ntype_op::Flop)
+    return false;
+  if (op == Ntype_op::Memory) {
+    auto type = get_mem_type(node);
+    if (type == 1)
+      return false;
+    if (type != 0)
+      return true;
+
+    // async reads only depend on the read address, writes happen at the clock edge
+    if (e.sink.get_pin_name() != "addr")
+      return false;
+    auto port_id = e.sink.get_pid() / 11;
+    for (const auto &e2 : node.inp_edges()) {
+      if (e2.sink.get_pid() / 11 == port_id && e2.sink.get_pin_name() == "rdport" && e2.driver.is_type_const())
+        return !e2.driver.get_type_const().is_known_false();
+    }
+    return false;
+  }
+
+  return true;
+}
+
+bool Cgen_simlib::is_comb_dependence(const Node &node, const XEdge &e) const {
+  (void)node;
+
+  auto op = e.driver.get_node().get_type_op();
+  if (op == Ntype_op::Const || op == Ntype_op::Flop || e.driver.is_graph_input())
+    return false;
+  if (op == Ntype_op::Memory) {
+    auto it = node2mem.find(e.driver.get_node().get_compact_class());
+    if (it == node2mem.end() || it->second.type == 1)
+      return false;
+  }
+
+  return is_comb_sink(e);
+}
+
+const absl::flat_hash_set<mmap_lib::str> &Cgen_simlib::get_comb_outputs(Lgraph *lg) {
+  auto it = lg2comb_outputs.find(lg->get_lgid().value);
+  if (it != lg2comb_outputs.end())
+    return it->second;
+
+  absl::flat_hash_set<mmap_lib::str> comb_outputs;
+
+  // forward from the inputs through the combinational edges (and sub comb outputs)
+  absl::flat_hash_set<Node_pin::Compact_class_driver> reached;
+  std::vector<Node_pin>                               pending;
+  lg->each_graph_input([&](const Node_pin &dpin) {
+    reached.insert(dpin.get_compact_class_driver());
+    pending.emplace_back(dpin);
+  });
+
+  while (!pending.empty()) {
+    auto dpin = pending.back();
+    pending.pop_back();
+
+    for (const auto &e : dpin.out_edges()) {
+      if (e.sink.is_graph_output()) {
+        comb_outputs.insert(e.sink.get_pin_name());
+        continue;
+      }
+      if (!is_comb_sink(e))
+        continue;
+
+      auto                                      node     = e.sink.get_node();
+      const absl::flat_hash_set<mmap_lib::str> *sub_comb = nullptr;
+      if (node.get_type_op() == Ntype_op::Sub && node.is_type_sub_present())
+        sub_comb = &get_comb_outputs(node.ref_type_sub_lgraph());
+
+      for (auto &out : node.out_connected_pins()) {
+        if (sub_comb && !sub_comb->contains(out.get_pin_name()))
+          continue;
+        if (reached.insert(out.get_compact_class_driver()).second)
+          pending.emplace_back(out);
+      }
+    }
+  }
+
+  return lg2comb_outputs[lg->get_lgid().value] = std::move(comb_outputs);
+}
+
+bool Cgen_simlib::create_combinational(Lgraph *lg) {
+  std::vector<Node> comb_nodes;
+  std::vector<Node> state_nodes;
+
+  for (auto node : lg->fast()) {
+    auto op = node.get_type_op();
+    if (op == Ntype_op::Const)
+      continue;
+    if (op == Ntype_op::Flop) {
+      process_flop(node);
+      state_nodes.emplace_back(node);
+      continue;
+    }
+    if (op == Ntype_op::Memory) {
+      if (!setup_memory(node))
+        return false;
+      state_nodes.emplace_back(node);
+      if (node2mem[node.get_compact_class()].type == 1)
+        continue;
+    }
+    comb_nodes.emplace_back(node);
+  }
+
+  // levelize (Kahn) the combinational nodes, flops and sync memories break the
+  // loops. A sub with outputs that only depend on its state has a second
+  // vertex (after the comb nodes) for them, so a feedback through the sub
+  // flops is not a loop.
+  absl::flat_hash_map<Node::Compact_class, size_t> node2pos;
+  for (auto i = 0u; i < comb_nodes.size(); ++i) {
+    node2pos[comb_nodes[i].get_compact_class()] = i;
+  }
+
+  std::vector<size_t>                                    vertex2node(comb_nodes.size());
+  absl::flat_hash_map<size_t, size_t>                    node2pre;
+  absl::flat_hash_map<size_t, absl::flat_hash_set<mmap_lib::str>> node2comb_outputs;
+  for (auto i = 0u; i < comb_nodes.size(); ++i) {
+    vertex2node[i] = i;
+
+    auto &node = comb_nodes[i];
+    if (node.get_type_op() != Ntype_op::Sub || !node.is_type_sub_present())
+      continue;
+
+    const auto &comb_outputs = get_comb_outputs(node.ref_type_sub_lgraph());
+    for (auto &dpin : node.out_connected_pins()) {
+      if (!comb_outputs.contains(dpin.get_pin_name())) {
+        node2pre[i] = vertex2node.size();
+        vertex2node.emplace_back(i);
+        node2comb_outputs[i] = comb_outputs;
+        break;
+      }
+    }
+  }
+
+  std::vector<int>                 n_pending(vertex2node.size(), 0);
+  std::vector<std::vector<size_t>> consumers(vertex2node.size());
+  for (const auto &[i, pre] : node2pre) {
+    consumers[pre].emplace_back(i);  // the full call after the state only call
+    ++n_pending[i];
+  }
+  for (auto i = 0u; i < comb_nodes.size(); ++i) {
+    for (const auto &e : comb_nodes[i].inp_edges()) {
+      if (!is_comb_dependence(comb_nodes[i], e))
+        continue;
+      auto it = node2pos.find(e.driver.get_node().get_compact_class());
+      if (it == node2pos.end())
+        continue;
+
+      auto src    = it->second;
+      auto pre_it = node2pre.find(src);
+      if (pre_it != node2pre.end() && !node2comb_outputs[src].contains(e.driver.get_pin_name()))
+        src = pre_it->second;
+
+      consumers[src].emplace_back(i);
+      ++n_pending[i];
+    }
+  }
+
+  std::vector<size_t> order;
+  for (auto v = 0u; v < vertex2node.size(); ++v) {
+    if (n_pending[v] == 0)
+      order.emplace_back(v);
+  }
+  for (auto pos = 0u; pos < order.size(); ++pos) {
+    for (auto c : consumers[order[pos]]) {
+      if (--n_pending[c] == 0)
+        order.emplace_back(c);
+    }
+  }
+
+  if (order.size() != vertex2node.size()) {
+    for (auto v = 0u; v < vertex2node.size(); ++v) {
+      if (n_pending[v]) {
+        Pass::error("inou.cgen.simlib lgraph {} has a combinational loop through {}",
+                    lg->get_name(),
+                    comb_nodes[vertex2node[v]].debug_name());
+        return false;
+      }
+    }
+  }
+
+  // the state only call is needed when a state output is used before the full call
+  std::vector<size_t> vertex2order(vertex2node.size());
+  for (auto pos = 0u; pos < order.size(); ++pos) {
+    vertex2order[order[pos]] = pos;
+  }
+  absl::flat_hash_set<size_t> needs_pre;
+  for (const auto &[i, pre] : node2pre) {
+    for (auto c : consumers[pre]) {
+      if (vertex2order[c] < vertex2order[i])
+        needs_pre.insert(i);
+    }
+  }
+
+  std::vector<bool> sub_declared(comb_nodes.size(), false);
+  for (auto v : order) {
+    auto  i    = vertex2node[v];
+    auto &node = comb_nodes[i];
+    auto  op   = node.get_type_op();
+
+    if (op == Ntype_op::Sub) {
+      if (v != i && !needs_pre.contains(i))
+        continue;
+      if (!sub_declared[i]) {
+        process_sub_decl(node);
+        sub_declared[i] = true;
+      }
+      process_sub(node, v != i);
+      continue;
+    }
+
+    if (!node.has_outputs())
+      continue;
+
+    switch (op) {
+      case Ntype_op::Memory: process_memory_reads(node); break;
+      case Ntype_op::Mux: process_mux(node); break;
+      case Ntype_op::Get_mask:
+      case Ntype_op::Set_mask: process_mask(node); break;
+      default:
+        if (!process_simple_node(node)) {
+          Pass::error("inou.cgen.simlib does not support {} nodes ({})", node.get_type_name(), node.debug_name());
+          return false;
+        }
+    }
+  }
+
+  for (auto &node : state_nodes) {
+    process_memory_ports(node);
+  }
+
+  return true;
+}
+
+void Cgen_simlib::create_outputs(Lgraph *lg) {
+  lg->each_graph_output([this](const Node_pin &dpin) {
+    auto bits = get_bits(dpin);
+    auto spin = dpin.change_to_sink_from_graph_out_driver();
+
+    fcomb->append("  o_", get_cpp_name(dpin.get_name()), " = ");
+    if (spin.is_connected())
+      fcomb->append(get_resized(spin.get_driver_pin(), bits), ";\n");
+    else
+      fcomb->append(get_type(bits), "(0);\n");
+  });
+}
+
+mmap_lib::str Cgen_simlib::get_io_args(const std::vector<Io> &inputs, const std::vector<Io> &outputs) const {
+  mmap_lib::str args;
+  for (const auto &io : inputs) {
+    args = mmap_lib::str::concat(args, args.empty() ? "" : ", ", get_type(io.bits), " i_", get_cpp_name(io.name));
+  }
+  for (const auto &io : outputs) {
+    args = mmap_lib::str::concat(args, args.empty() ? "" : ", ", get_type(io.bits), " &o_", get_cpp_name(io.name));
+  }
+  return args;
+}
+
+void Cgen_simlib::create_header(Lgraph *lg, const std::vector<Io> &inputs, const std::vector<Io> &outputs) {
+  auto base       = get_cpp_name(lg->get_name());
+  auto stage_name = get_stage_name(lg->get_name());
+
+  mmap_lib::str filename;
+  if (odir.empty())
+    filename = mmap_lib::str::concat(base, "_stage.hpp");
+  else
+    filename = mmap_lib::str::concat(odir, "/", base, "_stage.hpp");
+
+  auto fout = std::make_shared<File_output>(filename);
+
+  fout->append("// Generated by inou.cgen.simlib from lgraph ", lg->get_name(), "\n");
+  fout->append("#pragma once\n\n");
+  fout->append("#include <array>\n#include <string>\n\n");
+  if (lanes > 1)
+    fout->append("#include \"sint_lanes.hpp\"\n");
+  else
+    fout->append("#include \"simlib_cgen.hpp\"\n");
+  fout->append("#include \"simlib_signature.hpp\"\n");
+
+  std::vector<std::string> includes;
+  for (const auto &inc : sub_includes) {
+    includes.emplace_back(inc.to_s());
+  }
+  std::sort(includes.begin(), includes.end());
+  for (const auto &inc : includes) {
+    fout->append("#include \"", inc, "\"\n");
+  }
+
+  fout->append("\nstruct ", stage_name, " {\n");
+  fout->append("  uint64_t hidx;\n\n");
+  fout->append_buffer(*fmembers);
+
+  fout->append("\n  ", stage_name, "(uint64_t _hidx);\n");
+  fout->append("  void reset_cycle();\n");
+  auto args = get_io_args(inputs, outputs);
+  fout->append("  void comb(", args, ");\n");
+  fout->append("  void posedge();\n");
+  fout->append("  void cycle(", args, ");\n\n");
+  fout->append("#ifdef SIMLIB_TRACE\n");
+  fout->append("  void add_signature(Simlib_signature &sign);\n");
+  fout->append("#endif\n");
+  fout->append("};\n");
+}
+
+void Cgen_simlib::create_source(Lgraph *lg, const std::vector<Io> &inputs, const std::vector<Io> &outputs) {
+  auto base       = get_cpp_name(lg->get_name());
+  auto stage_name = get_stage_name(lg->get_name());
+
+  mmap_lib::str filename;
+  if (odir.empty())
+    filename = mmap_lib::str::concat(base, "_stage.cpp");
+  else
+    filename = mmap_lib::str::concat(odir, "/", base, "_stage.cpp");
+
+  auto fout = std::make_shared<File_output>(filename);
+
+  fout->append("// Generated by inou.cgen.simlib from lgraph ", lg->get_name(), "\n");
+  fout->append("#include \"", base, "_stage.hpp\"\n\n");
+
+  fout->append(stage_name, "::", stage_name, "(uint64_t _hidx) : hidx(_hidx)");
+  for (const auto &s : sub_inits) {
+    fout->append(", ", s, "(_hidx)");
+  }
+  fout->append(" { reset_cycle(); }\n\n");
+
+  fout->append("void ", stage_name, "::reset_cycle() {\n");
+  fout->append_buffer(*freset);
+  fout->append("}\n\n");
+
+  auto args = get_io_args(inputs, outputs);
+
+  fout->append("void ", stage_name, "::comb(", args, ") {\n");
+  fout->append_buffer(*fcomb);
+  fout->append("\n  // next state (committed by posedge)\n");
+  fout->append_buffer(*fnext);
+  fout->append("}\n\n");
+
+  fout->append("void ", stage_name, "::posedge() {\n");
+  fout->append_buffer(*fupdate);
+  fout->append("}\n\n");
+
+  fout->append("void ", stage_name, "::cycle(", args, ") {\n");
+  fout->append("  comb(");
+  bool first = true;
+  for (const auto &io : inputs) {
+    fout->append(first ? "" : ", ", "i_", get_cpp_name(io.name));
+    first = false;
+  }
+  for (const auto &io : outputs) {
+    fout->append(first ? "" : ", ", "o_", get_cpp_name(io.name));
+    first = false;
+  }
+  fout->append(");\n");
+  fout->append("  posedge();\n");
+  fout->append("}\n\n");
+
+  fout->append("#ifdef SIMLIB_TRACE\n");
+  fout->append("void ", stage_name, "::add_signature(Simlib_signature &sign) {\n");
+  fout->append("  sign.append(\"", stage_name, "\");\n");
+  fout->append("  sign.append(sizeof(*this));\n");
+  fout->append_buffer(*fsign);
+  fout->append("}\n");
+  fout->append("#endif\n");
+}
+
+void Cgen_simlib::do_from_lgraph(Lgraph *lg) {
+  Lbench b("inou.cgen.simlib");
+
+  pin2var.clear();
+  node2mem.clear();
+  sub_includes.clear();
+  sub_inits.clear();
+
+  fmembers = std::make_shared<File_output>();
+  freset   = std::make_shared<File_output>();
+  fcomb    = std::make_shared<File_output>();
+  fnext    = std::make_shared<File_output>();
+  fupdate  = std::make_shared<File_output>();
+  fsign    = std::make_shared<File_output>();
+
+  std::vector<Io> inputs;
+  std::vector<Io> outputs;
+  get_io(lg, inputs, outputs);
+
+  lg->each_graph_input([this](const Node_pin &dpin) {
+    pin2var[dpin.get_compact_class_driver()] = mmap_lib::str::concat("i_", get_cpp_name(dpin.get_name()));
+  });
+
+  if (!create_combinational(lg))
+    return;
+  create_outputs(lg);
+
+  create_header(lg, inputs, outputs);
+  create_source(lg, inputs, outputs);
+}
@@ -0,0 +1,106 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
+#include "file_output.hpp"
+#include "lgraph.hpp"
+
+// Generates a simlib stage (foo_stage.hpp/foo_stage.cpp) per lgraph. Each wire
+// is a SInt<bits> (SIntN<bits, lanes> for multi-lane stages). The combinational nodes are levelized and emitted as
+// straight line code in comb(), which also computes the next state of the flops
+// and memories (stage members). posedge() commits it. Sub-graphs are member
+// stages, their comb() is called in order and their posedge() in posedge().
+// cycle() is comb() followed by posedge().
+class Cgen_simlib {
+private:
+  const bool          verbose;
+  const mmap_lib::str odir;
+  const int           lanes;  // independent stimulus lanes per cycle (1 is scalar)
+
+  struct Io {
+    mmap_lib::str name;
+    Bits_t        bits;
+  };
+
+  struct Port_field {
+    bool     rdport = false;
+    Node_pin enable;
+    Node_pin addr;
+    Node_pin din;
+  };
+
+  struct Mem_info {
+    int                     bits = 0;
+    int                     size = 0;
+    int                     type = 2;  // array by default
+    std::vector<Port_field> ports;
+  };
+
+  absl::flat_hash_map<Node_pin::Compact_class_driver, mmap_lib::str> pin2var;
+  absl::flat_hash_map<Node::Compact_class, Mem_info>                 node2mem;
+
+  // per lgraph, the outputs with a combinational path from some input
+  absl::node_hash_map<Lg_type_id::type, absl::flat_hash_set<mmap_lib::str>> lg2comb_outputs;
+
+  std::shared_ptr<File_output> fmembers;  // stage struct members
+  std::shared_ptr<File_output> freset;    // reset_cycle body
+  std::shared_ptr<File_output> fcomb;     // combinational part of comb
+  std::shared_ptr<File_output> fnext;     // next state (flop/memory) computation, end of comb
+  std::shared_ptr<File_output> fupdate;   // next state commit (posedge body)
+  std::shared_ptr<File_output> fsign;     // add_signature body
+
+  absl::flat_hash_set<mmap_lib::str> sub_includes;
+  std::vector<mmap_lib::str>         sub_inits;
+
+  static mmap_lib::str get_cpp_name(const mmap_lib::str &name);
+  static mmap_lib::str get_stage_name(const mmap_lib::str &lg_name);
+  static mmap_lib::str get_inst_name(const Node &node);
+  mmap_lib::str get_type(Bits_t bits) const {
+    if (lanes > 1)
+      return mmap_lib::str::concat("SIntN<", bits, ", ", lanes, ">");
+    return mmap_lib::str::concat("SInt<", bits, ">");
+  }
+  static Bits_t        get_bits(const Node_pin &dpin, Bits_t default_bits = 64);
+  mmap_lib::str get_const(const Lconst &v, Bits_t bits) const;
+
+  static void get_io(Lgraph *lg, std::vector<Io> &inputs, std::vector<Io> &outputs);
+
+  mmap_lib::str get_expr(const Node_pin &dpin) const;
+  mmap_lib::str get_resized(const Node_pin &dpin, Bits_t bits) const;
+  mmap_lib::str get_local(const Node_pin &dpin);
+
+  bool setup_memory(Node &node);
+  bool is_comb_dependence(const Node &node, const XEdge &e) const;
+
+  static int get_mem_type(const Node &node);
+  static bool is_comb_sink(const XEdge &e);
+  const absl::flat_hash_set<mmap_lib::str> &get_comb_outputs(Lgraph *lg);
+
+  void process_flop(Node &node);
+  void process_memory_ports(Node &node);
+  void process_memory_reads(Node &node);
+  void process_sub_decl(Node &node);
+  void process_sub(Node &node, bool state_only);
+  void process_mux(Node &node);
+  void process_mask(Node &node);
+  bool process_simple_node(Node &node);
+
+  bool create_combinational(Lgraph *lg);
+  void create_outputs(Lgraph *lg);
+
+  mmap_lib::str get_io_args(const std::vector<Io> &inputs, const std::vector<Io> &outputs) const;
+  void create_header(Lgraph *lg, const std::vector<Io> &inputs, const std::vector<Io> &outputs);
+  void create_source(Lgraph *lg, const std::vector<Io> &inputs, const std::vector<Io> &outputs);
+
+public:
+  void do_from_lgraph(Lgraph *lg);
+
+  Cgen_simlib(bool _verbose, const mmap_lib::str _odir, int _lanes = 1);
+};
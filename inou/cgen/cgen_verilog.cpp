@@ -12,8 +12,14 @@
 #include "mmap_gc.hpp"
 #include "pass.hpp"
 #include "lbench.hpp"
-
-Cgen_verilog::Cgen_verilog(bool _verbose, const mmap_lib::str _odir) : verbose(_verbose), odir(_odir), nrunning(0) {
+#include "thread_pool.hpp"
+
+Cgen_verilog::Cgen_verilog(bool _verbose, const mmap_lib::str _odir, int _jobs)
+    : verbose(_verbose)
+    , odir(_odir)
+    , jobs(_jobs != 0 ? _jobs : (thread_pool.size() > 1 ? thread_pool.size() + 1 : 1))
+    , nrunning(0)
+    , n_parallel(0) {
   if (reserved_keyword.empty()) {
     std::lock_guard<std::mutex> guard(lgs_mutex);
 
@@ -404,7 +410,9 @@ void Cgen_verilog::process_mux(std::shared_ptr<File_output> fout, Node &node) {
   }
 }
 
-void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &node) {
+// Returns true (and sets expr) when the node is an inlined expression (no var).
+// It only reads pin2expr/pin2var, so nodes without dependences can run in parallel
+bool Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &node, Expr &expr) {
   auto dpin = node.get_driver_pin();
   auto op   = node.get_type_op();
   I(!Ntype::is_multi_driver(op));
@@ -520,7 +528,7 @@ void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &
           replace = mmap_lib::str::concat("[", range_end-1,":",range_begin, "] = ");
         }
         fout->append("  ", var_it->second, replace, value , ";\n");
-        return; // special case, multiple statements
+        return false; // special case, multiple statements
 
 #if 0
         mmap_lib::str a_high;
@@ -663,13 +671,13 @@ void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &
     final_expr = mmap_lib::str::concat(val_expr, " >>> ", amt_expr);
   } else if (op == Ntype_op::Const) {
     // final_expr = node.get_type_const().to_verilog();
-    return;  // Done before at create_locals
+    return false;  // Done before at create_locals
   } else if (op == Ntype_op::TupAdd || op == Ntype_op::TupGet || op == Ntype_op::AttrSet || op == Ntype_op::AttrGet) {
     node.dump();
     Pass::error("could not generate verilog unless it is low level Lgraph node:{} is type {}\n",
                 node.debug_name(),
                 Ntype::get_name(op));
-    return;
+    return false;
   } else {
     mmap_lib::str txt_op;
     if (op == Ntype_op::Mult)
@@ -698,10 +706,23 @@ void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &
 
   auto var_it = pin2var.find(dpin.get_compact_class());
   if (var_it == pin2var.end()) {
-    pin2expr.emplace(dpin.get_compact_class(), Expr(final_expr, true));
-  } else {
-    fout->append("  ", var_it->second, " = ", final_expr, ";\n");
+    expr = Expr(final_expr, true);
+    return true;
   }
+
+  fout->append("  ", var_it->second, " = ", final_expr, ";\n");
+  return false;
+}
+
+void Cgen_verilog::process_comb_node(std::shared_ptr<File_output> fout, Node &node) {
+  if (node.get_type_op() == Ntype_op::Mux) {
+    process_mux(fout, node);
+    return;
+  }
+
+  Expr expr;
+  if (process_simple_node(fout, node, expr))
+    pin2expr.emplace(node.get_driver_pin().get_compact_class(), expr);
 }
 
 void Cgen_verilog::create_module_io(std::shared_ptr<File_output> fout, Lgraph *lg) {
@@ -781,6 +802,9 @@ void Cgen_verilog::create_combinational(std::shared_ptr<File_output> fout, Lgrap
 
   fout->append("always_comb begin\n");
 
+  std::vector<Node> comb_nodes;
+  bool              parallel_ok = is_parallel();
+
   for (auto node : lg->forward()) {
     auto op = node.get_type_op();
     if (Ntype::is_multi_driver(op)) {
@@ -795,17 +819,100 @@ void Cgen_verilog::create_combinational(std::shared_ptr<File_output> fout, Lgrap
       Pass::error("node:{} does not have bits set. It needs bits to generate correct verilog", node.debug_name());
     }
 
+    // Pass::error can not be raised from a thread_pool job
+    if (op == Ntype_op::TupAdd || op == Ntype_op::TupGet || op == Ntype_op::AttrSet || op == Ntype_op::AttrGet)
+      parallel_ok = false;
+
+    comb_nodes.emplace_back(node);
+  }
+
+  if (parallel_ok && comb_nodes.size() >= min_parallel_nodes) {
+    create_combinational_parallel(fout, comb_nodes);
+  } else {
     // flops added to the last always with outputs
-    if (op == Ntype_op::Mux) {
-      process_mux(fout, node);
-    } else {
-      process_simple_node(fout, node);
+    for (auto &node : comb_nodes) {
+      process_comb_node(fout, node);
     }
   }
 
   fout->append("end\n");
 }
 
+void Cgen_verilog::create_combinational_parallel(std::shared_ptr<File_output> fout, const std::vector<Node> &comb_nodes) {
+  ++n_parallel;
+
+  // Levelize: a node depends only on inputs that become a pin2expr in this
+  // block (pin2var and create_locals constants are already known). The nodes
+  // in a level are independent, and pin2expr is only updated between levels.
+  // Each var/mux node writes to its own buffer, and the buffers are appended
+  // in forward order, so the output is the same as the serial one.
+
+  Node_side_array<uint32_t>        node2level;
+  std::vector<std::vector<size_t>> levels;
+
+  for (auto i = 0u; i < comb_nodes.size(); ++i) {
+    const auto &node  = comb_nodes[i];
+    uint32_t    level = 0;
+    for (auto e : node.inp_edges()) {
+      if (pin2var.contains(e.driver.get_compact_class()))
+        continue;
+      auto it = node2level.find(e.driver.get_node().get_compact_class());
+      if (it != node2level.end())
+        level = std::max(level, it->second + 1);
+    }
+    node2level.insert({node.get_compact_class(), level});
+    if (levels.size() <= level)
+      levels.resize(level + 1);
+    levels[level].emplace_back(i);
+  }
+
+  std::vector<std::shared_ptr<File_output>> node_out(comb_nodes.size());
+  std::vector<Expr>                         node_expr(comb_nodes.size());
+  std::vector<uint8_t>                      node_has_expr(comb_nodes.size(), 0);  // not vector<bool>, written by many threads
+
+  for (const auto &level : levels) {
+    std::atomic<int> pending = 0;
+
+    auto chunk_size = std::max(parallel_chunk_size, (level.size() + jobs - 1) / jobs);
+
+    for (size_t start = 0; start < level.size(); start += chunk_size) {
+      auto end = std::min(level.size(), start + chunk_size);
+
+      ++pending;
+      thread_pool.add([this, &level, &comb_nodes, &node_out, &node_expr, &node_has_expr, &pending, start, end]() -> void {
+        for (auto j = start; j < end; ++j) {
+          auto idx  = level[j];
+          auto node = comb_nodes[idx];
+
+          if (node.get_type_op() == Ntype_op::Mux) {
+            node_out[idx] = std::make_shared<File_output>();
+            process_mux(node_out[idx], node);
+            continue;
+          }
+          // Only var nodes write statements, the rest produce an expression
+          if (pin2var.contains(node.get_driver_pin().get_compact_class()))
+            node_out[idx] = std::make_shared<File_output>();
+
+          node_has_expr[idx] = process_simple_node(node_out[idx], node, node_expr[idx]);
+        }
+        --pending;
+      });
+    }
+
+    thread_pool.wait_until_done(pending);
+
+    for (auto idx : level) {
+      if (node_has_expr[idx])
+        pin2expr.emplace(comb_nodes[idx].get_driver_pin().get_compact_class(), node_expr[idx]);
+    }
+  }
+
+  for (const auto &out : node_out) {
+    if (out)
+      fout->append_buffer(*out);
+  }
+}
+
 void Cgen_verilog::create_outputs(std::shared_ptr<File_output> fout, Lgraph *lg) {
 
   fout->append("always_comb begin\n");
@@ -1032,6 +1139,8 @@ void Cgen_verilog::do_from_lgraph(Lgraph *lg) {
   pin2var   .clear();
   pin2expr  .clear();
   mux2vector.clear();
+  pin2var   .setup(lg);
+  pin2expr  .setup(lg);
   first_array_block = true;
 
   mmap_lib::str filename;
@@ -1049,11 +1158,39 @@ void Cgen_verilog::do_from_lgraph(Lgraph *lg) {
 
   create_locals        (fout, lg);  // pin2expr, pin2var & mux2vector adds
   create_memories      (fout, lg);  // no local access
-  create_subs          (fout, lg);  // no local access
 
-  create_combinational (fout, lg);  // pin2expr adds, reads pin2var & mux2vector
-  create_outputs       (fout, lg);  // reads pin2expr
-  create_registers     (fout, lg);  // reads pin2var
+  if (is_parallel() && lg->size() >= min_parallel_nodes) {
+    // subs and registers do not touch pin2expr, so they run while the
+    // combinational block is generated. Buffers are appended in the serial order.
+    auto fout_subs = std::make_shared<File_output>();
+    auto fout_comb = std::make_shared<File_output>();
+    auto fout_regs = std::make_shared<File_output>();
+
+    std::atomic<int> pending = 2;
+    thread_pool.add([this, fout_subs, lg, &pending]() -> void {
+      create_subs(fout_subs, lg);
+      --pending;
+    });
+    thread_pool.add([this, fout_regs, lg, &pending]() -> void {
+      create_registers(fout_regs, lg);
+      --pending;
+    });
+
+    create_combinational (fout_comb, lg);  // pin2expr adds, reads pin2var & mux2vector
+    create_outputs       (fout_comb, lg);  // reads pin2expr
+
+    thread_pool.wait_until_done(pending);
+
+    fout->append_buffer(*fout_subs);
+    fout->append_buffer(*fout_comb);
+    fout->append_buffer(*fout_regs);
+  } else {
+    create_subs          (fout, lg);  // no local access
+
+    create_combinational (fout, lg);  // pin2expr adds, reads pin2var & mux2vector
+    create_outputs       (fout, lg);  // reads pin2expr
+    create_registers     (fout, lg);  // reads pin2var
+  }
 
   fout->append("endmodule\n");
 
@@ -8,27 +8,37 @@
 
 #include "lgraph.hpp"
 #include "file_output.hpp"
+#include "side_array.hpp"
+#include "thread_pool.hpp"
 
 class Cgen_verilog {
 private:
   const bool          verbose;
   const mmap_lib::str odir;
+  const int           jobs;  // threads per module (1 is serial)
 
   using pin2str_type = absl::flat_hash_map<Node_pin::Compact_class, mmap_lib::str>;
 
   struct Expr {
+    Expr() : needs_parenthesis(false) { }
     Expr(mmap_lib::str v, bool n) : var(v), needs_parenthesis(n) { }
     mmap_lib::str var;
     bool needs_parenthesis;
   };
 
-  absl::flat_hash_map<Node_pin::Compact_class, Expr>           pin2expr;
-  absl::flat_hash_map<Node_pin::Compact_class, mmap_lib::str>  pin2var;
-  absl::flat_hash_map<Node    ::Compact_class, mmap_lib::str>  mux2vector;
+  Pin_side_array<Expr>           pin2expr;
+  Pin_side_array<mmap_lib::str>  pin2var;
+  Node_side_array<mmap_lib::str> mux2vector;
 
   bool first_array_block;
 
+  // Below this many nodes, a module is generated by a single thread
+  static constexpr size_t min_parallel_nodes = 4096;
+  // Minimum nodes per thread_pool job in each combinational level (at most jobs per level)
+  static constexpr size_t parallel_chunk_size = 512;
+
   std::atomic<int> nrunning;
+  std::atomic<int> n_parallel;  // combinational blocks generated by levels
   inline static std::mutex lgs_mutex; // just needed for the once at a time setup of static reserved_keyword
   inline static absl::flat_hash_set<mmap_lib::str> reserved_keyword;
 
@@ -43,19 +53,27 @@ private:
   void process_flop(std::shared_ptr<File_output> fout, Node &node);
   void process_memory(std::shared_ptr<File_output> fout, Node &node);
   void process_mux(std::shared_ptr<File_output> fout, Node &node);
-  void process_simple_node(std::shared_ptr<File_output> fout, Node &node);
+  bool process_simple_node(std::shared_ptr<File_output> fout, Node &node, Expr &expr);
+  void process_comb_node(std::shared_ptr<File_output> fout, Node &node);
 
   void create_module_io(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_memories(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_subs(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_combinational(std::shared_ptr<File_output> fout, Lgraph *lg);
+  void create_combinational_parallel(std::shared_ptr<File_output> fout, const std::vector<Node> &comb_nodes);
   void create_outputs(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_registers(std::shared_ptr<File_output> fout, Lgraph *lg);
 
   void add_to_pin2var(std::shared_ptr<File_output> fout, Node_pin &dpin, const mmap_lib::str name, bool out_unsigned);
   void create_locals(std::shared_ptr<File_output> fout, Lgraph *lg);
+
+  // wait_until_done also runs pending jobs, so jobs>1 is correct even with a single thread_pool thread
+  bool is_parallel() const { return jobs > 1; }
 public:
   void do_from_lgraph(Lgraph *lg_parent);
 
-  Cgen_verilog(bool _verbose, const mmap_lib::str _odir);
+  int get_n_parallel() const { return n_parallel; }
+
+  // jobs==0 uses all the thread_pool threads (serial if the thread_pool has one)
+  Cgen_verilog(bool _verbose, const mmap_lib::str _odir, int _jobs = 0);
 };
@@ -2,6 +2,7 @@
 
 #include "inou_cgen.hpp"
 
+#include "cgen_simlib.hpp"
 #include "cgen_verilog.hpp"
 #include "eprp_utils.hpp"
 #include "thread_pool.hpp"
@@ -17,7 +18,14 @@ void Inou_cgen::setup() {
   Eprp_method m1(mmap_lib::str("inou.cgen.verilog"), mmap_lib::str("export verilog from an Lgraph"), &Inou_cgen::to_cgen_verilog);
 
   m1.add_label_optional("verbose", mmap_lib::str("dump bits and wirename (true/false)"), "false");
+  m1.add_label_optional("jobs", mmap_lib::str("threads per large module (0 uses the thread pool, 1 is serial)"), "0");
   register_inou("cgen", m1);
+
+  Eprp_method m2(mmap_lib::str("inou.cgen.simlib"), mmap_lib::str("export simlib C++ stages from an Lgraph"), &Inou_cgen::to_cgen_simlib);
+
+  m2.add_label_optional("verbose", mmap_lib::str("keep the wirenames in the generated code (true/false)"), "false");
+  m2.add_label_optional("lanes", mmap_lib::str("independent stimulus lanes per stage (1 is scalar SInt, >1 uses SIntN)"), "1");
+  register_inou("cgen", m2);
 }
 
 void Inou_cgen::to_cgen_verilog(Eprp_var &var) {
@@ -26,9 +34,16 @@ void Inou_cgen::to_cgen_verilog(Eprp_var &var) {
   auto dir     = pp.get_odir(var);
   auto verbose = pp.verbose;
 
+  auto jobs_txt = var.get("jobs");
+  if (!jobs_txt.is_i() || jobs_txt.to_i() < 0) {
+    pp.error("inou.cgen.verilog jobs:{} should be zero or positive", jobs_txt);
+    return;
+  }
+  int jobs = jobs_txt.to_i();
+
   for (auto *lg : var.lgs) {
-    thread_pool.add([lg, verbose, dir]() -> void {
-      Cgen_verilog p(verbose, dir);
+    thread_pool.add([lg, verbose, dir, jobs]() -> void {
+      Cgen_verilog p(verbose, dir, jobs);
       p.do_from_lgraph(lg);
     });
   }
@@ -36,3 +51,25 @@ void Inou_cgen::to_cgen_verilog(Eprp_var &var) {
   // no need to sync for cgen. It will sync before exit lgshell if needed
 }
 
+void Inou_cgen::to_cgen_simlib(Eprp_var &var) {
+  Inou_cgen pp(var);
+
+  auto dir     = pp.get_odir(var);
+  auto verbose = pp.verbose;
+
+  auto lanes_txt = var.get("lanes");
+  if (!lanes_txt.is_i() || lanes_txt.to_i() <= 0) {
+    pp.error("inou.cgen.simlib lanes:{} should be bigger than zero", lanes_txt);
+    return;
+  }
+  int lanes = lanes_txt.to_i();
+
+  // one stage per lgraph, each stage is compiled by itself
+  for (auto *lg : var.lgs) {
+    thread_pool.add([lg, verbose, dir, lanes]() -> void {
+      Cgen_simlib p(verbose, dir, lanes);
+      p.do_from_lgraph(lg);
+    });
+  }
+}
+
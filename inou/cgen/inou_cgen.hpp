@@ -10,6 +10,7 @@ private:
 
 protected:
   static void to_cgen_verilog(Eprp_var &var);
+  static void to_cgen_simlib(Eprp_var &var);
 
 public:
   Inou_cgen(const Eprp_var &var);
@@ -0,0 +1,103 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// End-to-end inou.cgen.verilog time, output MB/s and peak RSS on a large
+// synthetic module (the File_output streaming is most of the output cost).
+//
+// cgen_verilog_bench [n_nodes] [jobs]
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "cgen_verilog.hpp"
+#include "fmt/format.h"
+#include "lbench.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+static long get_peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static Lgraph *create_design(int n_nodes) {
+  auto *lg = Lgraph::create("lgdb_cgen_bench", "cgen_bench", "-");
+
+  Lrand<int> rng;
+
+  auto clk_dpin = lg->add_graph_input("clock", 0, 1);
+
+  std::vector<Node_pin> dpins;
+  for (auto i = 0; i < 32; ++i) {
+    dpins.emplace_back(lg->add_graph_input(mmap_lib::str::concat("i", std::to_string(i)), 1 + i, 32));
+  }
+
+  auto pick = [&]() { return dpins[dpins.size() - 1 - rng.max(std::min<int>(dpins.size(), 128))]; };
+
+  for (auto i = 0; i < n_nodes; ++i) {
+    Node node;
+    auto kind = rng.max(10);
+    if (kind < 4) {
+      node = lg->create_node(Ntype_op::Sum, 32);
+      node.setup_sink_pin("A").connect_driver(pick());
+      node.setup_sink_pin("B").connect_driver(pick());
+    } else if (kind < 7) {
+      node = lg->create_node(Ntype_op::Xor, 32);
+      node.setup_sink_pin("A").connect_driver(pick());
+      node.setup_sink_pin("A").connect_driver(pick());
+    } else if (kind < 9) {
+      node = lg->create_node(Ntype_op::Mux, 32);
+      node.setup_sink_pin("0").connect_driver(pick());
+      node.setup_sink_pin("1").connect_driver(pick());
+      node.setup_sink_pin("2").connect_driver(pick());
+    } else {
+      node = lg->create_node(Ntype_op::Flop, 32);
+      node.setup_sink_pin("clock").connect_driver(clk_dpin);
+      node.setup_sink_pin("din").connect_driver(pick());
+    }
+    dpins.emplace_back(node.setup_driver_pin());
+  }
+
+  for (auto i = 0; i < 32; ++i) {
+    auto out = lg->add_graph_output(mmap_lib::str::concat("o", std::to_string(i)), 33 + i, 32);
+    dpins[dpins.size() - 1 - i].connect_sink(out);
+  }
+
+  return lg;
+}
+
+int main(int argc, char **argv) {
+  int n_nodes = argc > 1 ? std::stoi(argv[1]) : 500000;
+  int jobs    = argc > 2 ? std::stoi(argv[2]) : 1;
+
+  auto *lg = create_design(n_nodes);
+
+  mkdir("cgen_bench", 0755);
+
+  auto rss_start = get_peak_rss_kb();
+  {
+    Lbench b("inou.cgen.verilog.bench");
+
+    Cgen_verilog p(false, "cgen_bench", jobs);
+    p.do_from_lgraph(lg);
+
+    struct stat st;
+    stat("cgen_bench/cgen_bench.v", &st);
+
+    auto secs = b.get_secs();
+    fmt::print("inou.cgen.verilog nodes:{} jobs:{} secs:{:.3f} output:{}MB MB/s:{:.1f} peak_rss_delta:{}KB\n",
+               n_nodes,
+               jobs,
+               secs,
+               st.st_size / 1000000,
+               st.st_size / secs / 1e6,
+               get_peak_rss_kb() - rss_start);
+  }
+
+  lg->sync();
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cgen_verilog.hpp"
+#include "gtest/gtest.h"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+#include "thread_pool.hpp"
+
+// The parallel Verilog generation (jobs>1) must write the same file as the
+// serial one (jobs:1). The module is above min_parallel_nodes and has
+// combinational levels, muxes, flops and sub instances.
+
+class Cgen_verilog_jobs_test : public ::testing::Test {
+protected:
+  Lgraph *top = nullptr;
+
+  static std::string read_file(const std::string &name) {
+    std::ifstream     f(name);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+  }
+
+  void SetUp() override {
+    auto *sub = Lgraph::create("lgdb_cgen_jobs", "cgen_jobs_sub", "-");
+    {
+      auto a_dpin = sub->add_graph_input("a", 0, 8);
+      auto z_dpin = sub->add_graph_output("z", 1, 8);
+      a_dpin.connect_sink(z_dpin);
+    }
+
+    top = Lgraph::create("lgdb_cgen_jobs", "cgen_jobs_top", "-");
+
+    Lrand<int> rng;
+
+    auto clk_dpin = top->add_graph_input("clock", 0, 1);
+
+    std::vector<Node_pin> dpins;
+    std::vector<Node>     flops;
+    for (auto i = 0; i < 8; ++i) {
+      dpins.emplace_back(top->add_graph_input(mmap_lib::str::concat("i", std::to_string(i)), 1 + i, 8));
+    }
+
+    auto pick = [&]() { return dpins[dpins.size() - 1 - rng.max(std::min<int>(dpins.size(), 32))]; };
+
+    for (auto i = 0; i < 20000; ++i) {
+      Node node;
+      auto kind = rng.max(20);
+      if (kind < 6) {
+        node = top->create_node(Ntype_op::Sum, 8);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("B").connect_driver(pick());
+      } else if (kind < 10) {
+        node = top->create_node(Ntype_op::And, 8);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("A").connect_driver(pick());
+      } else if (kind < 13) {
+        node = top->create_node(Ntype_op::Xor, 8);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("A").connect_driver(pick());
+      } else if (kind < 17) {
+        auto sel = top->create_node(Ntype_op::EQ, 1);
+        sel.setup_sink_pin("A").connect_driver(pick());
+        sel.setup_sink_pin("A").connect_driver(pick());
+
+        node = top->create_node(Ntype_op::Mux, 8);
+        node.setup_sink_pin("0").connect_driver(sel.setup_driver_pin());
+        node.setup_sink_pin("1").connect_driver(pick());
+        node.setup_sink_pin("2").connect_driver(pick());
+      } else if (kind < 19) {
+        node = top->create_node(Ntype_op::Flop, 8);
+        node.setup_sink_pin("clock").connect_driver(clk_dpin);
+        node.setup_sink_pin("din").connect_driver(pick());
+        flops.emplace_back(node);
+      } else {
+        node = top->create_node_sub("cgen_jobs_sub");
+        node.setup_sink_pin("a").connect_driver(pick());
+        auto z_dpin = node.setup_driver_pin("z");
+        z_dpin.set_bits(8);
+        dpins.emplace_back(z_dpin);
+        continue;
+      }
+      dpins.emplace_back(node.setup_driver_pin());
+    }
+
+    for (auto i = 0; i < 8; ++i) {
+      auto out = top->add_graph_output(mmap_lib::str::concat("o", std::to_string(i)), 9 + i, 8);
+      dpins[dpins.size() - 1 - i].connect_sink(out);
+    }
+
+    // a flop needs a wire name (connected output)
+    auto or_node = top->create_node(Ntype_op::Or, 8);
+    for (auto &flop : flops) {
+      if (!flop.get_driver_pin().is_connected())
+        or_node.setup_sink_pin("A").connect_driver(flop.get_driver_pin());
+    }
+    or_node.setup_driver_pin().connect_sink(top->add_graph_output("o_flops", 17, 8));
+  }
+
+  void TearDown() override { top->sync(); }
+};
+
+TEST_F(Cgen_verilog_jobs_test, same_output) {
+  mkdir("cgen_jobs_1", 0755);
+  mkdir("cgen_jobs_n", 0755);
+
+  {
+    Cgen_verilog p(false, "cgen_jobs_1", 1);
+    p.do_from_lgraph(top);
+    EXPECT_EQ(p.get_n_parallel(), 0);
+  }
+
+  // jobs>1 runs the parallel path even if the thread_pool has a single thread
+  int n = std::max<int>(4, thread_pool.size() + 1);
+  {
+    Cgen_verilog p(false, "cgen_jobs_n", n);
+    p.do_from_lgraph(top);
+    EXPECT_EQ(p.get_n_parallel(), 1);
+  }
+
+  auto serial   = read_file("cgen_jobs_1/cgen_jobs_top.v");
+  auto parallel = read_file("cgen_jobs_n/cgen_jobs_top.v");
+
+  EXPECT_FALSE(serial.empty());
+  EXPECT_EQ(serial.size(), parallel.size());
+  EXPECT_TRUE(serial == parallel);  // not EXPECT_EQ, the diff of a large file is useless
+}
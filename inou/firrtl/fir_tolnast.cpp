@@ -2,7 +2,6 @@
 //
 
 #include <cstdint>
-#include <fstream>
 #include <iostream>
 #include <queue>
 #include <string>
@@ -10,9 +9,11 @@
 
 #include "absl/strings/match.h"
 #include "firrtl.pb.h"
+#include "firrtl_pb_reader.hpp"
 #include "google/protobuf/util/time_util.h"
 #include "inou_firrtl.hpp"
 #include "lbench.hpp"
+#include "thread_pool.hpp"
 
 using google::protobuf::util::TimeUtil;
 
@@ -27,20 +28,25 @@ void Inou_firrtl::toLNAST(Eprp_var& var) {
 
   Inou_firrtl p(var);
 
+  auto jobs_txt = var.get("jobs");
+  if (!jobs_txt.empty()) {
+    if (!jobs_txt.is_i() || jobs_txt.to_i() < 0) {
+      p.error("inou.firrtl.tolnast jobs:{} should be zero or positive", jobs_txt);
+      return;
+    }
+    p.jobs = jobs_txt.to_i();
+  }
+
   if (var.has_label("files")) {
     auto files = var.get("files");
     for (const auto& f : files.split(',')) {
       fmt::print("FILE: {}\n", f);
-      firrtl::FirrtlPB firrtl_input;
-      std::fstream     input(f.to_s().c_str(), std::ios::in | std::ios::binary);
-      if (!firrtl_input.ParseFromIstream(&input)) {
+      Firrtl_pb_reader reader(f);
+      if (!reader.is_valid()) {
         Pass::error("Failed to parse FIRRTL from protobuf format: {}", f);
         return;
       }
-      p.tmp_var_cnt         = 0;
-      p.seq_cnt             = 0;
-      p.dummy_expr_node_cnt = 0;
-      p.IterateCircuits(var, firrtl_input, f);
+      p.IterateCircuits(var, reader, f);
     }
   } else {
     fmt::print("No file provided. This requires a file input.\n");
@@ -548,15 +554,18 @@ void Inou_firrtl::create_module_inst(Lnast& lnast, const firrtl::FirrtlPB_Statem
 
   // If any parameters exist (for ext module), specify those.
   // NOTE->hunter: We currently specify parameters the same way as inputs.
-  for (const auto& param : emod_to_param_map[mmap_lib::str(inst.module_id())]) {
-    auto idx_dot_p = lnast.add_child(parent_node, Lnast_node::create_tuple_add());
-    if (isdigit(param.second[0])) {
-      lnast.add_child(idx_dot_p, Lnast_node::create_const(param.second));
-    } else {
-      lnast.add_child(idx_dot_p, Lnast_node::create_ref(param.second));
+  auto param_it = circuit_info->emod_to_param_map.find(mmap_lib::str(inst.module_id()));
+  if (param_it != circuit_info->emod_to_param_map.end()) {
+    for (const auto& param : param_it->second) {
+      auto idx_dot_p = lnast.add_child(parent_node, Lnast_node::create_tuple_add());
+      if (isdigit(param.second[0])) {
+        lnast.add_child(idx_dot_p, Lnast_node::create_const(param.second));
+      } else {
+        lnast.add_child(idx_dot_p, Lnast_node::create_ref(param.second));
+      }
+      lnast.add_child(idx_dot_p, Lnast_node::create_ref(inp_name));
+      lnast.add_child(idx_dot_p, Lnast_node::create_ref(param.first));
     }
-    lnast.add_child(idx_dot_p, Lnast_node::create_ref(inp_name));
-    lnast.add_child(idx_dot_p, Lnast_node::create_ref(param.first));
   }
 }
 
@@ -862,7 +871,10 @@ void Inou_firrtl::HandleBundVecAcc(Lnast& lnast, const firrtl::FirrtlPB_Expressi
     }
 
     auto module_name = inst_to_mod_map[inst_name];
-    auto dir         = mod_to_io_dir_map[std::make_pair(module_name, str_without_inst)];
+    uint8_t dir      = 0;
+    auto    dir_it   = circuit_info->mod_to_io_dir_map.find(std::make_pair(module_name, str_without_inst));
+    if (dir_it != circuit_info->mod_to_io_dir_map.end())
+      dir = dir_it->second;
 
     if (is_hier_io) {
       if (dir == 1) {  // PORT_DIRECTION_IN
@@ -1915,7 +1927,7 @@ void Inou_firrtl::FinalMemInterfaceAssign(Lnast& lnast, Lnast_nid& parent_node)
 
 //--------------Modules/Circuits--------------------
 // Create basis of LNAST tree. Set root to "top" and have "stmts" be top's child.
-void Inou_firrtl::ListUserModuleInfo(Eprp_var& var, const firrtl::FirrtlPB_Module& fmodule, const mmap_lib::str& file_name) {
+std::unique_ptr<Lnast> Inou_firrtl::ListUserModuleInfo(const firrtl::FirrtlPB_Module& fmodule, const mmap_lib::str& file_name) {
 
 #ifndef NDEBUG
   fmt::print("Module (user): {}\n", fmodule.user_module().id());
@@ -1943,46 +1955,48 @@ void Inou_firrtl::ListUserModuleInfo(Eprp_var& var, const firrtl::FirrtlPB_Modul
   }
 
   FinalMemInterfaceAssign(*lnast, idx_stmts);
-  var.add(std::move(lnast));
+  return lnast;
 }
 
-void Inou_firrtl::ListModuleInfo(Eprp_var& var, const firrtl::FirrtlPB_Module& fmodule, const mmap_lib::str& file_name) {
-  if (fmodule.has_external_module()) {
-    GrabExtModuleInfo(fmodule.external_module());
-  } else if (fmodule.has_user_module()) {
-    ListUserModuleInfo(var, fmodule, file_name);
-  } else {
-    Pass::error("Module not set.");
-  }
-}
+void Inou_firrtl::PopulateAllModsIO(Eprp_var& var, const Firrtl_pb_reader::Circuit_view& circuit, const mmap_lib::str& file_name) {
+  // Only the IO is needed (the user module statements are not parsed), so
+  // each module lives in the arena just long enough. External modules are
+  // complete, and they only add circuit level info.
+  google::protobuf::Arena arena;
+
+  for (const auto& bytes : circuit.modules) {
+    const auto* fmodule = Firrtl_pb_reader::parse_module_io(arena, bytes);
+    if (fmodule == nullptr) {
+      Pass::error("Failed to parse FIRRTL module from protobuf format: {}", file_name);
+    }
+
+    if (fmodule->has_external_module()) {
+      GrabExtModuleInfo(fmodule->external_module());
 
-void Inou_firrtl::PopulateAllModsIO(Eprp_var& var, const firrtl::FirrtlPB_Circuit& circuit, const mmap_lib::str& file_name) {
-  for (int i = 0; i < circuit.module_size(); i++) {
-    // std::vector<std::pair<std::string, uint8_t>> vec;
-    if (circuit.module(i).has_external_module()) {
       /* NOTE->hunter: This is a Verilog blackbox. If we want to link it, it'd have to go through either V->LG
        * or V->LN->LG. I will create a Sub_Node in case the Verilog isn't provided. */
-      auto     module_i_external_module_id =  mmap_lib::str(circuit.module(i).external_module().id());
+      auto     module_i_external_module_id =  mmap_lib::str(fmodule->external_module().id());
       auto     sub     = AddModToLibrary(var, module_i_external_module_id, file_name);
       uint64_t inp_pos = 0;
       uint64_t out_pos = 0;
-      for (int j = 0; j < circuit.module(i).external_module().port_size(); j++) {
-        auto port = circuit.module(i).external_module().port(j);
+      for (int j = 0; j < fmodule->external_module().port_size(); j++) {
+        const auto& port = fmodule->external_module().port(j);
         AddPortToMap(module_i_external_module_id, port.type(), port.direction(), mmap_lib::str(port.id()), sub, inp_pos, out_pos);
       }
-      continue;
-    } else if (circuit.module(i).has_user_module()) {
-      auto     module_i_user_module_id =  mmap_lib::str(circuit.module(i).user_module().id());
+    } else if (fmodule->has_user_module()) {
+      auto     module_i_user_module_id =  mmap_lib::str(fmodule->user_module().id());
       auto     sub     = AddModToLibrary(var, module_i_user_module_id, file_name);
       uint64_t inp_pos = 0;
       uint64_t out_pos = 0;
-      for (int j = 0; j < circuit.module(i).user_module().port_size(); j++) {
-        auto port = circuit.module(i).user_module().port(j);
+      for (int j = 0; j < fmodule->user_module().port_size(); j++) {
+        const auto& port = fmodule->user_module().port(j);
         AddPortToMap(module_i_user_module_id, port.type(), port.direction(), mmap_lib::str(port.id()), sub, inp_pos, out_pos);
       }
     } else {
       Pass::error("Module not set.");
     }
+
+    arena.Reset();
   }
 }
 
@@ -2020,13 +2034,13 @@ void Inou_firrtl::AddPortToMap(const mmap_lib::str& mod_id, const firrtl::Firrtl
     case firrtl::FirrtlPB_Type::kResetType:    // Reset type
     case firrtl::FirrtlPB_Type::kClockType: {  // Clock type
       AddPortToSub(sub, inp_pos, out_pos, port_id, dir);
-      mod_to_io_dir_map[std::make_pair(mod_id, port_id)] = dir;
+      circuit_info->mod_to_io_dir_map[std::make_pair(mod_id, port_id)] = dir;
       // mod_to_io_map[mod_id].insert({port_id, 1, dir, false});
       break;
     }
     case firrtl::FirrtlPB_Type::kAsyncResetType: {  // AsyncReset type
       AddPortToSub(sub, inp_pos, out_pos, port_id, dir);
-      mod_to_io_dir_map[std::make_pair(mod_id, port_id)] = dir;
+      circuit_info->mod_to_io_dir_map[std::make_pair(mod_id, port_id)] = dir;
       // mod_to_io_map[mod_id].insert({port_id, 1, dir, false});
       async_rst_names.insert(port_id);
       break;
@@ -2050,7 +2064,7 @@ void Inou_firrtl::AddPortToMap(const mmap_lib::str& mod_id, const firrtl::Firrtl
       break;
     }
     case firrtl::FirrtlPB_Type::kVectorType: {  // Vector type
-      mod_to_io_dir_map[std::make_pair(mod_id, port_id)] = dir;
+      circuit_info->mod_to_io_dir_map[std::make_pair(mod_id, port_id)] = dir;
       for (uint32_t i = 0; i < type.vector_type().size(); i++) {
         AddPortToMap(mod_id, type.vector_type().type(), dir, mmap_lib::str::concat(port_id, ".", i), sub, inp_pos, out_pos);
       }
@@ -2098,12 +2112,12 @@ void Inou_firrtl::GrabExtModuleInfo(const firrtl::FirrtlPB_Module_ExternalModule
         break;
       default: I(false);
     }
-    emod_to_param_map[mmap_lib::str(emod.defined_name())].insert({mmap_lib::str(emod.parameter(j).id()), param_str});
+    circuit_info->emod_to_param_map[mmap_lib::str(emod.defined_name())].insert({mmap_lib::str(emod.parameter(j).id()), param_str});
   }
 
   // Add them to the map to let us know what ports exist in this module.
   for (const auto &elem : port_list) {
-    mod_to_io_dir_map[std::make_pair(mmap_lib::str(emod.defined_name()), mmap_lib::str(std::get<0>(elem)))] = std::get<1>(elem);
+    circuit_info->mod_to_io_dir_map[std::make_pair(mmap_lib::str(emod.defined_name()), mmap_lib::str(std::get<0>(elem)))] = std::get<1>(elem);
     // mod_to_io_map[emod.defined_name()].insert({std::get<0>(elem), std::get<2>(elem), std::get<1>(elem), std::get<3>(elem)});
   }
 }
@@ -2132,46 +2146,75 @@ mmap_lib::str Inou_firrtl::ConvertBigIntToStr(const firrtl::FirrtlPB_BigInt &big
 
 
 
-void Inou_firrtl::IterateModules(Eprp_var& var, const firrtl::FirrtlPB_Circuit& circuit, const mmap_lib::str& file_name) {
-  if (circuit.top_size() > 1) {
+void Inou_firrtl::IterateModules(Eprp_var& var, const Firrtl_pb_reader::Circuit_view& circuit, const mmap_lib::str& file_name) {
+  if (circuit.n_tops > 1) {
     Pass::error("More than 1 top module specified.");
     I(false);
   }
 
-  // Create ModuleName to I/O Pair List
+  // Create ModuleName to I/O Pair List (and the external module info)
   PopulateAllModsIO(var, circuit, file_name);
 
-  for (int i = 0; i < circuit.module_size(); i++) {
-    // Between modules, module specific lists.
-    tmp_var_cnt         = 0;
-    dummy_expr_node_cnt = 0;
-    input_names.clear();
-    output_names.clear();
-    memory_names.clear();
-    async_rst_names.clear();
-    mport_usage_visited.clear();
-
-    reg2qpin.clear();
-    inst_to_mod_map.clear();
-    reg_name2rst_init_expr.clear();
-    mem2port_cnt.clear();
-    mem2wensize.clear();
-    mem2initial_idx.clear();
-    mport2mem.clear();
-    mem2din_fields.clear();
-
-    ListModuleInfo(var, circuit.module(i), file_name);
+  const auto n_mods = circuit.modules.size();
+
+  // User modules in parallel (serial with jobs:1). Each job does the only
+  // full parse of its module, into its own arena (freed once the LNAST is
+  // built), and gets a new Inou_firrtl (clean module state). The LNASTs are
+  // added to var in the circuit order.
+  std::vector<std::unique_ptr<Lnast>> lnasts(n_mods);
+  std::vector<std::exception_ptr>     errors(n_mods);
+  std::atomic<int>                    pending = 0;
+
+  auto translate = [this, &var, &circuit, &file_name, &lnasts, &errors](size_t i) {
+    try {
+      google::protobuf::Arena arena;
+      const auto*             fmodule = Firrtl_pb_reader::parse_module(arena, circuit.modules[i]);
+      if (fmodule == nullptr) {
+        Pass::error("Failed to parse FIRRTL module from protobuf format: {}", file_name);
+      }
+
+      Inou_firrtl p(var);
+      p.circuit_info = circuit_info;
+      lnasts[i]      = p.ListUserModuleInfo(*fmodule, file_name);
+    } catch (...) {
+      errors[i] = std::current_exception();  // Pass::error can not cross the thread_pool
+    }
+  };
+
+  for (size_t i = 0; i < n_mods; i++) {
+    if (!circuit.user_module[i])
+      continue;
+
+    if (jobs == 1) {
+      translate(i);
+      continue;
+    }
+
+    ++pending;
+    thread_pool.add([&translate, &pending, i]() -> void {
+      translate(i);
+      --pending;
+    });
+  }
+
+  thread_pool.wait_until_done(pending);
+
+  for (const auto& e : errors) {
+    if (e)
+      std::rethrow_exception(e);
+  }
+
+  for (auto& lnast : lnasts) {
+    if (lnast)
+      var.add(std::move(lnast));
   }
 }
 
 // Iterate over every FIRRTL circuit (design), each circuit can contain multiple modules.
-void Inou_firrtl::IterateCircuits(Eprp_var& var, const firrtl::FirrtlPB& firrtl_input, const mmap_lib::str& file_name) {
-  for (int i = 0; i < firrtl_input.circuit_size(); i++) {
-    mod_to_io_dir_map.clear();
-    // mod_to_io_map.clear();
-    emod_to_param_map.clear();
+void Inou_firrtl::IterateCircuits(Eprp_var& var, const Firrtl_pb_reader& reader, const mmap_lib::str& file_name) {
+  for (const auto& circuit : reader.get_circuits()) {
+    circuit_info = std::make_shared<Circuit_info>();
 
-    const firrtl::FirrtlPB_Circuit& circuit = firrtl_input.circuit(i);
     IterateModules(var, circuit, file_name);
   }
 }
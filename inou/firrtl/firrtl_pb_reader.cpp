@@ -0,0 +1,198 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "firrtl_pb_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "iassert.hpp"
+
+// protobuf wire types
+static constexpr uint32_t wire_varint  = 0;
+static constexpr uint32_t wire_fixed64 = 1;
+static constexpr uint32_t wire_length  = 2;
+static constexpr uint32_t wire_fixed32 = 5;
+
+// FirrtlPB / FirrtlPB.Circuit / FirrtlPB.Module field numbers (firrtl.proto)
+static constexpr uint64_t firrtl_pb_circuit   = 1;
+static constexpr uint64_t circuit_pb_module   = 1;
+static constexpr uint64_t circuit_pb_top      = 2;
+static constexpr uint64_t module_pb_user      = 2;
+static constexpr uint64_t user_module_pb_id   = 1;
+static constexpr uint64_t user_module_pb_port = 2;
+
+Firrtl_pb_reader::Firrtl_pb_reader(const mmap_lib::str &fname) {
+  fd = ::open(fname.to_s().c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0)
+    return;
+
+  size = sb.st_size;
+  if (size == 0) {
+    valid = true;  // empty FirrtlPB
+    return;
+  }
+
+  void *b = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (b == MAP_FAILED) {
+    size = 0;
+    return;
+  }
+  ::madvise(b, size, MADV_SEQUENTIAL);
+
+  base  = static_cast<const char *>(b);
+  valid = scan();
+}
+
+Firrtl_pb_reader::~Firrtl_pb_reader() {
+  if (base)
+    ::munmap(const_cast<char *>(base), size);
+  if (fd >= 0)
+    ::close(fd);
+}
+
+bool Firrtl_pb_reader::read_varint(const char *&ptr, const char *end, uint64_t &val) {
+  val = 0;
+  for (int shift = 0; shift < 64 && ptr < end; shift += 7) {
+    auto b = static_cast<uint8_t>(*ptr++);
+    val |= static_cast<uint64_t>(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool Firrtl_pb_reader::skip_field(const char *&ptr, const char *end, uint32_t wire_type) {
+  uint64_t len = 0;
+  switch (wire_type) {
+    case wire_varint: return read_varint(ptr, end, len);
+    case wire_fixed64: len = 8; break;
+    case wire_fixed32: len = 4; break;
+    case wire_length:
+      if (!read_varint(ptr, end, len))
+        return false;
+      break;
+    default: return false;  // groups are not used in firrtl.proto
+  }
+  if (len > static_cast<uint64_t>(end - ptr))
+    return false;
+  ptr += len;
+  return true;
+}
+
+bool Firrtl_pb_reader::is_user_module(const char *ptr, const char *end) {
+  // oneof module, so the first field is the only one
+  uint64_t tag;
+  if (!read_varint(ptr, end, tag))
+    return false;
+  return (tag >> 3) == module_pb_user;
+}
+
+bool Firrtl_pb_reader::scan_circuit(const char *ptr, const char *end, Circuit_view &circuit) const {
+  while (ptr < end) {
+    uint64_t tag;
+    if (!read_varint(ptr, end, tag))
+      return false;
+
+    auto field     = tag >> 3;
+    auto wire_type = static_cast<uint32_t>(tag & 7);
+
+    if ((field == circuit_pb_module || field == circuit_pb_top) && wire_type == wire_length) {
+      uint64_t len;
+      if (!read_varint(ptr, end, len) || len > static_cast<uint64_t>(end - ptr))
+        return false;
+      if (field == circuit_pb_module) {
+        circuit.modules.emplace_back(ptr, len);
+        circuit.user_module.emplace_back(is_user_module(ptr, ptr + len));
+      } else {
+        ++circuit.n_tops;
+      }
+      ptr += len;
+    } else if (!skip_field(ptr, end, wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Firrtl_pb_reader::scan() {
+  const char *ptr = base;
+  const char *end = base + size;
+
+  while (ptr < end) {
+    uint64_t tag;
+    if (!read_varint(ptr, end, tag))
+      return false;
+
+    auto field     = tag >> 3;
+    auto wire_type = static_cast<uint32_t>(tag & 7);
+
+    if (field == firrtl_pb_circuit && wire_type == wire_length) {
+      uint64_t len;
+      if (!read_varint(ptr, end, len) || len > static_cast<uint64_t>(end - ptr))
+        return false;
+      circuits.emplace_back();
+      if (!scan_circuit(ptr, ptr + len, circuits.back()))
+        return false;
+      ptr += len;
+    } else if (!skip_field(ptr, end, wire_type)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+const firrtl::FirrtlPB_Module *Firrtl_pb_reader::parse_module(google::protobuf::Arena &arena, std::string_view bytes) {
+  auto *mod = google::protobuf::Arena::CreateMessage<firrtl::FirrtlPB_Module>(&arena);
+  if (!mod->ParseFromArray(bytes.data(), static_cast<int>(bytes.size())))
+    return nullptr;
+  return mod;
+}
+
+const firrtl::FirrtlPB_Module *Firrtl_pb_reader::parse_module_io(google::protobuf::Arena &arena, std::string_view bytes) {
+  const char *ptr = bytes.data();
+  const char *end = ptr + bytes.size();
+
+  uint64_t tag;
+  if (!read_varint(ptr, end, tag))
+    return nullptr;
+  if ((tag >> 3) != module_pb_user || (tag & 7) != wire_length)
+    return parse_module(arena, bytes);
+
+  uint64_t len;
+  if (!read_varint(ptr, end, len) || len > static_cast<uint64_t>(end - ptr))
+    return nullptr;
+  end = ptr + len;
+
+  auto *mod  = google::protobuf::Arena::CreateMessage<firrtl::FirrtlPB_Module>(&arena);
+  auto *umod = mod->mutable_user_module();
+
+  while (ptr < end) {
+    if (!read_varint(ptr, end, tag))
+      return nullptr;
+
+    auto field     = tag >> 3;
+    auto wire_type = static_cast<uint32_t>(tag & 7);
+
+    if ((field == user_module_pb_id || field == user_module_pb_port) && wire_type == wire_length) {
+      if (!read_varint(ptr, end, len) || len > static_cast<uint64_t>(end - ptr))
+        return nullptr;
+      if (field == user_module_pb_id) {
+        umod->set_id(std::string(ptr, len));
+      } else if (!umod->add_port()->ParseFromArray(ptr, static_cast<int>(len))) {
+        return nullptr;
+      }
+      ptr += len;
+    } else if (!skip_field(ptr, end, wire_type)) {  // statements
+      return nullptr;
+    }
+  }
+
+  return mod;
+}
@@ -0,0 +1,58 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#pragma GCC diagnostic ignored "-Wsign-compare"
+#include "firrtl.pb.h"
+#include "google/protobuf/arena.h"
+#pragma GCC diagnostic pop
+
+#include "mmap_str.hpp"
+
+// Lazy reader for FIRRTL protobuf files. The file is mmapped and split into
+// circuits/modules by walking the length-delimited fields (no message is
+// parsed). Each module is parsed on demand into a protobuf Arena, so the
+// peak heap is bounded by the modules being translated, not the whole file.
+class Firrtl_pb_reader {
+public:
+  struct Circuit_view {
+    std::vector<std::string_view> modules;      // serialized FirrtlPB.Circuit.Module
+    std::vector<bool>             user_module;  // modules[i] is a UserModule (else an ExternalModule)
+    size_t                        n_tops = 0;
+  };
+
+  explicit Firrtl_pb_reader(const mmap_lib::str &fname);
+  ~Firrtl_pb_reader();
+
+  Firrtl_pb_reader(const Firrtl_pb_reader &)            = delete;
+  Firrtl_pb_reader &operator=(const Firrtl_pb_reader &) = delete;
+
+  bool is_valid() const { return valid; }
+
+  const std::vector<Circuit_view> &get_circuits() const { return circuits; }
+
+  // nullptr if the bytes are not a valid module. The module lives in the arena.
+  static const firrtl::FirrtlPB_Module *parse_module(google::protobuf::Arena &arena, std::string_view bytes);
+  // Like parse_module, but a UserModule only gets the id and the ports (the
+  // statements are skipped without parsing them). ExternalModules are complete.
+  static const firrtl::FirrtlPB_Module *parse_module_io(google::protobuf::Arena &arena, std::string_view bytes);
+
+protected:
+  const char *base = nullptr;
+  size_t      size = 0;
+  int         fd   = -1;
+  bool        valid = false;
+
+  std::vector<Circuit_view> circuits;
+
+  static bool read_varint(const char *&ptr, const char *end, uint64_t &val);
+  static bool skip_field(const char *&ptr, const char *end, uint32_t wire_type);
+  static bool is_user_module(const char *ptr, const char *end);
+
+  bool scan_circuit(const char *ptr, const char *end, Circuit_view &circuit) const;
+  bool scan();
+};
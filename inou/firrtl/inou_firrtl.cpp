@@ -15,6 +15,7 @@ void Inou_firrtl::setup() {
   Eprp_method m1(mmap_lib::str("inou.firrtl.tolnast"), mmap_lib::str("Translate FIRRTL to LNAST (in progress)"), &Inou_firrtl::toLNAST);
   m1.add_label_required("files", mmap_lib::str("FIRRTL-protobuf data file[s]"));
   m1.add_label_optional("path", mmap_lib::str("location to store lgraph subgraph nodes"), "lgdb");
+  m1.add_label_optional("jobs", mmap_lib::str("user modules translated at once (0 uses the thread pool, 1 is serial)"), "0");
   register_inou("firrtl", m1);
 
   Eprp_method m2(mmap_lib::str("inou.firrtl.tofirrtl"), mmap_lib::str("LNAST to FIRRTL"), &Inou_firrtl::toFIRRTL);
@@ -22,7 +23,7 @@ void Inou_firrtl::setup() {
   register_inou("firrtl", m2);
 }
 
-Inou_firrtl::Inou_firrtl(const Eprp_var &var) : Pass("firrtl", var) {
+Inou_firrtl::Inou_firrtl(const Eprp_var &var) : Pass("firrtl", var), dummy_expr_node_cnt(0), tmp_var_cnt(0), jobs(0) {
   if (op2firsub.empty()) {
     op2firsub.emplace(firrtl::FirrtlPB_Expression_PrimOp_Op_OP_ADD, "__fir_add");
     op2firsub.emplace(firrtl::FirrtlPB_Expression_PrimOp_Op_OP_SUB, "__fir_sub");
@@ -15,6 +15,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "firrtl.pb.h"
+#include "firrtl_pb_reader.hpp"
 
 #pragma GCC diagnostic pop
 // LiveHD includes
@@ -108,7 +109,7 @@ protected:
   void ListStatementInfo(Lnast &lnast, const firrtl::FirrtlPB_Statement &stmt, Lnast_nid &parent_node);
   void FinalMemInterfaceAssign(Lnast &lnast, Lnast_nid &parent_node);
 
-  void     PopulateAllModsIO(Eprp_var &var, const firrtl::FirrtlPB_Circuit &circuit, const mmap_lib::str &file_name);
+  void     PopulateAllModsIO(Eprp_var &var, const Firrtl_pb_reader::Circuit_view &circuit, const mmap_lib::str &file_name);
   void     AddPortToMap(const mmap_lib::str &mod_id, const firrtl::FirrtlPB_Type &type, uint8_t dir, const mmap_lib::str &port_id,
                         Sub_node &sub, uint64_t &inp_pos, uint64_t &out_pos);
   void     AddPortToSub(Sub_node &sub, uint64_t &inp_pos, uint64_t &out_pos, const mmap_lib::str &port_id, const uint8_t &dir);
@@ -116,11 +117,10 @@ protected:
 
   mmap_lib::str ConvertBigIntToStr(const firrtl::FirrtlPB_BigInt &bigint);
 
-  void ListUserModuleInfo(Eprp_var &var, const firrtl::FirrtlPB_Module &fmodule, const mmap_lib::str &file_name);
-  void GrabExtModuleInfo(const firrtl::FirrtlPB_Module_ExternalModule &emod);
-  void ListModuleInfo(Eprp_var &var, const firrtl::FirrtlPB_Module &fmodule, const mmap_lib::str &file_name);
-  void IterateModules(Eprp_var &var, const firrtl::FirrtlPB_Circuit &circuit, const mmap_lib::str &file_name);
-  void IterateCircuits(Eprp_var &var, const firrtl::FirrtlPB &firrtl_input, const mmap_lib::str &file_name);
+  std::unique_ptr<Lnast> ListUserModuleInfo(const firrtl::FirrtlPB_Module &fmodule, const mmap_lib::str &file_name);
+  void                   GrabExtModuleInfo(const firrtl::FirrtlPB_Module_ExternalModule &emod);
+  void IterateModules(Eprp_var &var, const Firrtl_pb_reader::Circuit_view &circuit, const mmap_lib::str &file_name);
+  void IterateCircuits(Eprp_var &var, const Firrtl_pb_reader &reader, const mmap_lib::str &file_name);
 
   static void toLNAST(Eprp_var &var);
 
@@ -178,6 +178,19 @@ protected:
 
 private:
   //----------- For toLNAST ----------
+  // Circuit level info. Filled serially (PopulateAllModsIO and external
+  // modules), then shared read-only by the per-module translations.
+  struct Circuit_info {
+    // Maps (module name + I/O name) pair to direction of that I/O in that module.
+    absl::flat_hash_map<std::pair<mmap_lib::str, mmap_lib::str>, uint8_t> mod_to_io_dir_map;
+    // Map used by external modules to indicate parameters names + values.
+    absl::flat_hash_map<mmap_lib::str, absl::flat_hash_set<std::pair<mmap_lib::str, mmap_lib::str>>> emod_to_param_map;
+  };
+  std::shared_ptr<Circuit_info> circuit_info;
+
+  // The rest of the toLNAST fields are per module. Each user module is
+  // translated by its own Inou_firrtl object (the module context), so the
+  // modules can run in parallel.
   absl::flat_hash_set<mmap_lib::str> input_names;
   absl::flat_hash_set<mmap_lib::str> output_names;
   absl::flat_hash_set<mmap_lib::str> memory_names;
@@ -190,14 +203,10 @@ private:
   absl::flat_hash_map<mmap_lib::str, mmap_lib::str> reg2qpin;
   // Maps an instance name to the module name.
   absl::flat_hash_map<mmap_lib::str, mmap_lib::str> inst_to_mod_map;
-  // Maps (module name + I/O name) pair to direction of that I/O in that module.
-  absl::flat_hash_map<std::pair<mmap_lib::str, mmap_lib::str>, uint8_t> mod_to_io_dir_map;
   /* Used when a submodule inst is created, have to specify bw of all IO in module.
      Maps module name to list of tuples of (signal name + signal biwdith + signal dir + sign). */
   absl::flat_hash_map<mmap_lib::str, absl::flat_hash_set<std::tuple<mmap_lib::str, uint32_t, uint8_t, bool>>> mod_to_io_map;
 
-  // Map used by external modules to indicate parameters names + values.
-  absl::flat_hash_map<mmap_lib::str, absl::flat_hash_set<std::pair<mmap_lib::str, mmap_lib::str>>> emod_to_param_map;
 
   absl::flat_hash_map<mmap_lib::str, std::pair<firrtl::FirrtlPB_Expression, firrtl::FirrtlPB_Expression>> reg_name2rst_init_expr;
 
@@ -213,9 +222,13 @@ private:
   // mem -> <(rd_port_name1,1), (rd_port_name_foo, 7)>
   absl::flat_hash_map<mmap_lib::str, std::vector<std::pair<mmap_lib::str, uint8_t>>> mem2rd_mports;
 
+  // Temporary name counters (___F<n> and _._M<n>). The serial translation
+  // reset them before each module, and a module context starts at zero, so
+  // the names do not depend on the module order or on the jobs.
   uint32_t dummy_expr_node_cnt;
   uint32_t tmp_var_cnt;
-  uint32_t seq_cnt;
+
+  int jobs;  // 1 translates the user modules serially, else one thread_pool job per module
 
   //----------- FOR toFIRRTL ---------
   absl::flat_hash_map<mmap_lib::str, firrtl::FirrtlPB_Port *>      io_map;
@@ -0,0 +1,82 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+#include <vector>
+
+#include "eprp_var.hpp"
+#include "gtest/gtest.h"
+#include "inou_firrtl.hpp"
+#include "lnast.hpp"
+
+// The user modules translated in parallel (one thread_pool job per module)
+// must give the same LNASTs, in the same order, as the serial translation
+// (jobs:1). The .pb (argv[1]) is a circuit with many user modules.
+
+static mmap_lib::str pb_file;
+
+class Inou_firrtl_access : public Inou_firrtl {
+public:
+  using Inou_firrtl::toLNAST;
+};
+
+class Fir_tolnast_jobs_test : public ::testing::Test {
+protected:
+  // module name plus every node (level, type, text, ssa subs) in preorder
+  static std::string to_text(const Lnast &lnast) {
+    std::string txt = lnast.get_top_module_name().to_s();
+    txt += '\n';
+    for (const auto &it : lnast.depth_preorder(Lnast_nid::root())) {
+      const auto &node = lnast.get_data(it);
+      txt += std::to_string(it.level);
+      txt += ' ';
+      txt += node.type.to_str().to_s();
+      txt += ' ';
+      txt += node.token.get_text().to_s();
+      txt += ' ';
+      txt += std::to_string(node.subs);
+      txt += '\n';
+    }
+    return txt;
+  }
+
+  static std::vector<std::string> translate(const mmap_lib::str &jobs) {
+    Eprp_var var;
+    var.add("files", pb_file);
+    var.add("path", "lgdb_fir_tolnast_jobs");
+    var.add("jobs", jobs);
+
+    Inou_firrtl_access::toLNAST(var);
+
+    std::vector<std::string> lnasts;
+    for (const auto &lnast : var.lnasts) {
+      lnasts.emplace_back(to_text(*lnast));
+    }
+    return lnasts;
+  }
+};
+
+TEST_F(Fir_tolnast_jobs_test, same_lnasts) {
+  auto serial = translate("1");
+  EXPECT_GT(serial.size(), 2u);
+
+  // several times, the job order changes from run to run
+  for (auto i = 0; i < 3; ++i) {
+    auto parallel = translate("0");  // thread_pool
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (auto j = 0u; j < serial.size(); ++j) {
+      EXPECT_TRUE(serial[j] == parallel[j]) << "lnast " << j << " differs";  // not EXPECT_EQ, the diff is useless
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage:\n\t%s file.pb\n", argv[0]);
+    return 1;
+  }
+  pb_file = mmap_lib::str(argv[1]);
+
+  return RUN_ALL_TESTS();
+}
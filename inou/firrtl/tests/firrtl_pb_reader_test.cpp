@@ -0,0 +1,148 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "eprp_var.hpp"
+#include "firrtl_pb_reader.hpp"
+#include "gtest/gtest.h"
+#include "inou_firrtl.hpp"
+#include "lnast.hpp"
+
+// The lazy reader (mmapped file, one module parsed at a time) must see the
+// same modules as an eager parse of the whole FirrtlPB, and toLNAST must
+// give the same LNASTs for the original file and for the eager FirrtlPB
+// serialized again. The .pb files are the arguments.
+
+static std::vector<std::string> pb_files;
+
+class Inou_firrtl_access : public Inou_firrtl {
+public:
+  using Inou_firrtl::toLNAST;
+};
+
+class Firrtl_pb_reader_test : public ::testing::Test {
+protected:
+  static bool parse_eager(const std::string &fname, firrtl::FirrtlPB &firrtl_input) {
+    std::fstream input(fname, std::ios::in | std::ios::binary);
+    return firrtl_input.ParseFromIstream(&input);
+  }
+
+  // module name plus every node (level, type, text, ssa subs) in preorder
+  static std::string to_text(const Lnast &lnast) {
+    std::string txt = lnast.get_top_module_name().to_s();
+    txt += '\n';
+    for (const auto &it : lnast.depth_preorder(Lnast_nid::root())) {
+      const auto &node = lnast.get_data(it);
+      txt += std::to_string(it.level);
+      txt += ' ';
+      txt += node.type.to_str().to_s();
+      txt += ' ';
+      txt += node.token.get_text().to_s();
+      txt += ' ';
+      txt += std::to_string(node.subs);
+      txt += '\n';
+    }
+    return txt;
+  }
+
+  static std::vector<std::string> translate(const std::string &fname) {
+    Eprp_var var;
+    var.add("files", mmap_lib::str(fname));
+    var.add("path", "lgdb_firrtl_pb_reader");
+
+    Inou_firrtl_access::toLNAST(var);
+
+    std::vector<std::string> lnasts;
+    for (const auto &lnast : var.lnasts) {
+      lnasts.emplace_back(to_text(*lnast));
+    }
+    return lnasts;
+  }
+};
+
+TEST_F(Firrtl_pb_reader_test, same_modules) {
+  for (const auto &fname : pb_files) {
+    firrtl::FirrtlPB eager;
+    ASSERT_TRUE(parse_eager(fname, eager)) << fname;
+
+    Firrtl_pb_reader lazy{mmap_lib::str(fname)};
+    ASSERT_TRUE(lazy.is_valid()) << fname;
+
+    const auto &circuits = lazy.get_circuits();
+    ASSERT_EQ(circuits.size(), static_cast<size_t>(eager.circuit_size())) << fname;
+
+    for (auto i = 0u; i < circuits.size(); ++i) {
+      const auto &circuit = circuits[i];
+      const auto &eager_circuit = eager.circuit(i);
+
+      EXPECT_EQ(circuit.n_tops, static_cast<size_t>(eager_circuit.top_size()));
+      ASSERT_EQ(circuit.modules.size(), static_cast<size_t>(eager_circuit.module_size()));
+      ASSERT_EQ(circuit.user_module.size(), circuit.modules.size());
+
+      for (auto j = 0u; j < circuit.modules.size(); ++j) {
+        const auto &eager_mod = eager_circuit.module(j);
+        EXPECT_EQ(circuit.user_module[j], eager_mod.has_user_module());
+
+        google::protobuf::Arena arena;
+
+        const auto *mod = Firrtl_pb_reader::parse_module(arena, circuit.modules[j]);
+        ASSERT_NE(mod, nullptr);
+        EXPECT_TRUE(mod->SerializeAsString() == eager_mod.SerializeAsString()) << fname << " module " << j;
+
+        const auto *mod_io = Firrtl_pb_reader::parse_module_io(arena, circuit.modules[j]);
+        ASSERT_NE(mod_io, nullptr);
+        if (!eager_mod.has_user_module()) {
+          EXPECT_TRUE(mod_io->SerializeAsString() == eager_mod.SerializeAsString());
+          continue;
+        }
+
+        const auto &umod    = mod_io->user_module();
+        const auto &eager_u = eager_mod.user_module();
+        EXPECT_EQ(umod.id(), eager_u.id());
+        EXPECT_EQ(umod.statement_size(), 0);
+        ASSERT_EQ(umod.port_size(), eager_u.port_size());
+        for (auto k = 0; k < umod.port_size(); ++k) {
+          EXPECT_TRUE(umod.port(k).SerializeAsString() == eager_u.port(k).SerializeAsString());
+        }
+      }
+    }
+  }
+}
+
+TEST_F(Firrtl_pb_reader_test, same_lnasts) {
+  for (const auto &fname : pb_files) {
+    firrtl::FirrtlPB eager;
+    ASSERT_TRUE(parse_eager(fname, eager)) << fname;
+
+    const std::string eager_fname = "firrtl_pb_reader_eager.pb";
+    {
+      std::fstream output(eager_fname, std::ios::out | std::ios::trunc | std::ios::binary);
+      ASSERT_TRUE(eager.SerializeToOstream(&output));
+    }
+
+    auto lazy_lnasts  = translate(fname);
+    auto eager_lnasts = translate(eager_fname);
+
+    EXPECT_FALSE(lazy_lnasts.empty()) << fname;
+    ASSERT_EQ(lazy_lnasts.size(), eager_lnasts.size()) << fname;
+    for (auto j = 0u; j < lazy_lnasts.size(); ++j) {
+      EXPECT_TRUE(lazy_lnasts[j] == eager_lnasts[j]) << fname << " lnast " << j << " differs";  // the diff is useless
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage:\n\t%s file.pb...\n", argv[0]);
+    return 1;
+  }
+  for (auto i = 1; i < argc; ++i) {
+    pb_files.emplace_back(argv[i]);
+  }
+
+  return RUN_ALL_TESTS();
+}
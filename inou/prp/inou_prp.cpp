@@ -2,6 +2,10 @@
 
 #include "inou_prp.hpp"
 
+#include <filesystem>
+
+#include "absl/container/flat_hash_map.h"
+
 #include "annotate.hpp"
 #include "lbench.hpp"
 #include "lgedgeiter.hpp"
@@ -13,24 +17,65 @@ static Pass_plugin sample("inou_prp", Inou_prp::setup);
 void Inou_prp::setup() {
   Eprp_method m1("inou.prp", mmap_lib::str("Parse the input file and convert to an LNAST"), &Inou_prp::parse_to_lnast);
   m1.add_label_required("files", mmap_lib::str("prp files to process (comma separated)"));
+  m1.add_label_optional("verbose", mmap_lib::str("print the incremental reparse statistics"), "false");
 
   register_pass(m1);
 }
 
-Inou_prp::Inou_prp(const Eprp_var &var) : Pass("inou.prp", var) {}
+Inou_prp::Inou_prp(const Eprp_var &var) : Pass("inou.prp", var) {
+  auto verbose_txt = var.get("verbose");
+
+  if (verbose_txt != "false" && verbose_txt != "0")
+    verbose = true;
+  else
+    verbose = false;
+}
 
 void Inou_prp::parse_to_lnast(Eprp_var &var) {
   Lbench      b("inou.PRP_parse_to_lnast");
   Inou_prp p(var);
 
+  // Keep the converters alive across commands so that parsing an edited
+  // file again only regenerates the top-level statements that changed. The
+  // key is the canonical path (the same file named from another directory
+  // shares it). Each converter keeps the file, the tree-sitter tree and the
+  // cached LNAST, so only the most recently used ones are kept.
+  struct Converter_entry {
+    std::unique_ptr<Prp2lnast> converter;
+    uint64_t                   last_use;
+  };
+  constexpr size_t                                        max_converters = 16;
+  static absl::flat_hash_map<std::string, Converter_entry> converters;
+  static uint64_t                                         use_cnt = 0;
+
   for (auto f : p.files.split(',')) {
     auto basename       = f.get_str_after_last_if_exists('/');
     auto basename_noext = basename.get_str_before_first('.');
 
-    Prp2lnast converter(f, basename_noext);
+    std::error_code ec;
+    auto            path = std::filesystem::weakly_canonical(f.to_s(), ec).string();
+    if (ec)
+      path = f.to_s();
+
+    auto &entry    = converters[path];
+    entry.last_use = ++use_cnt;
+    if (entry.converter) {
+      entry.converter->reparse(f, p.verbose);  // diffs the content, a replaced file is fully processed
+    } else {
+      entry.converter = std::make_unique<Prp2lnast>(f, basename_noext);
+    }
 
-    auto lnast = converter.get_lnast();
+    auto lnast = entry.converter->get_lnast();
 
     var.add(std::move(lnast));
+
+    if (converters.size() > max_converters) {
+      auto lru = converters.begin();
+      for (auto it = converters.begin(); it != converters.end(); ++it) {
+        if (it->second.last_use < lru->second.last_use)
+          lru = it;
+      }
+      converters.erase(lru);
+    }
   }
 }
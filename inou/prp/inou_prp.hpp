@@ -5,6 +5,8 @@
 
 class Inou_prp : public Pass {
 protected:
+  bool verbose;
+
   void to_lgraph(std::string_view file);
 
   void do_work(const Lgraph *g);
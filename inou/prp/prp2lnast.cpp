@@ -1,5 +1,6 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <algorithm>
 #include <fstream>
 
 #include "prp2lnast.hpp"
@@ -9,23 +10,14 @@
 
 extern "C" TSLanguage *tree_sitter_pyrope();
 
-Prp2lnast::Prp2lnast(const mmap_lib::str filename, const mmap_lib::str module_name) {
-  lnast = std::make_unique<Lnast>(module_name);
-
-  lnast->set_root(Lnast_node(Lnast_ntype::create_top()));
-
-  {
-    auto ss = std::ostringstream{};
-    std::ifstream file(filename.to_s());
-    ss << file.rdbuf();
-    prp_file = ss.str();
-  }
+Prp2lnast::Prp2lnast(const mmap_lib::str filename, const mmap_lib::str _module_name) : module_name(_module_name) {
+  prp_file = read_file(filename);
 
   parser = ts_parser_new();
   ts_parser_set_language(parser, tree_sitter_pyrope());
 
-  TSTree *tst_tree = ts_parser_parse_string(parser, NULL, prp_file.data(), prp_file.size());
-  ts_root_node = ts_tree_root_node(tst_tree);
+  ts_tree      = ts_parser_parse_string(parser, NULL, prp_file.data(), prp_file.size());
+  ts_root_node = ts_tree_root_node(ts_tree);
 
   dump();
 
@@ -34,9 +26,169 @@ Prp2lnast::Prp2lnast(const mmap_lib::str filename, const mmap_lib::str module_na
 
 Prp2lnast::~Prp2lnast() {
 
+  ts_tree_delete(ts_tree);
   ts_parser_delete(parser);
 }
 
+std::string Prp2lnast::read_file(const mmap_lib::str &filename) {
+  auto ss = std::ostringstream{};
+  std::ifstream file(filename.to_s());
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+void Prp2lnast::reparse(const mmap_lib::str filename, bool verbose) {
+  auto new_file = read_file(filename);
+
+  changed_ranges.clear();
+  if (new_file != prp_file) {
+    apply_edit(new_file);
+
+    TSTree *new_tree = ts_parser_parse_string(parser, ts_tree, new_file.data(), new_file.size());
+
+    uint32_t n_ranges;
+    TSRange *ranges = ts_tree_get_changed_ranges(ts_tree, new_tree, &n_ranges);
+    changed_ranges.insert(changed_ranges.end(), ranges, ranges + n_ranges);
+    free(ranges);
+
+    ts_tree_delete(ts_tree);
+    ts_tree  = new_tree;
+    prp_file = std::move(new_file);
+  }
+  ts_root_node = ts_tree_root_node(ts_tree);
+
+  if (verbose)
+    dump();
+
+  process_root();
+
+  if (verbose)
+    fmt::print("prp2lnast {} reused:{} processed:{} top-level statements\n", module_name, num_reused, num_processed);
+}
+
+void Prp2lnast::apply_edit(const std::string &new_file) {
+  // single edit covering the bytes that differ between the old and new file
+  uint32_t min_size = std::min(prp_file.size(), new_file.size());
+
+  uint32_t prefix = 0;
+  while (prefix < min_size && prp_file[prefix] == new_file[prefix]) ++prefix;
+
+  uint32_t suffix = 0;
+  while (suffix < min_size - prefix && prp_file[prp_file.size() - 1 - suffix] == new_file[new_file.size() - 1 - suffix]) ++suffix;
+
+  auto point_at = [](const std::string &txt, uint32_t byte) {
+    TSPoint p{0, 0};
+    for (uint32_t i = 0; i < byte; ++i) {
+      if (txt[i] == '\n') {
+        ++p.row;
+        p.column = 0;
+      } else {
+        ++p.column;
+      }
+    }
+    return p;
+  };
+
+  TSInputEdit edit;
+  edit.start_byte    = prefix;
+  edit.old_end_byte  = prp_file.size() - suffix;
+  edit.new_end_byte  = new_file.size() - suffix;
+  edit.start_point   = point_at(prp_file, edit.start_byte);
+  edit.old_end_point = point_at(prp_file, edit.old_end_byte);
+  edit.new_end_point = point_at(new_file, edit.new_end_byte);
+
+  ts_tree_edit(ts_tree, &edit);
+
+  // The edited bytes are changed even when the tree shape is the same
+  changed_ranges.emplace_back(TSRange{edit.start_point, edit.new_end_point, edit.start_byte, edit.new_end_byte});
+
+  // Shift the cached statements like ts_tree_edit shifts the old tree nodes
+  std::vector<Stmt_cache> shifted;
+  shifted.reserve(stmt_cache.size());
+  for (auto &entry : stmt_cache) {
+    if (entry.end_byte <= edit.start_byte) {
+      shifted.emplace_back(std::move(entry));
+    } else if (entry.start_byte >= edit.old_end_byte) {
+      entry.start_byte = entry.start_byte - edit.old_end_byte + edit.new_end_byte;
+      entry.end_byte   = entry.end_byte - edit.old_end_byte + edit.new_end_byte;
+      entry.pos_delta += static_cast<int64_t>(edit.new_end_byte) - edit.old_end_byte;
+      entry.line_delta += static_cast<int32_t>(edit.new_end_point.row) - static_cast<int32_t>(edit.old_end_point.row);
+      shifted.emplace_back(std::move(entry));
+    }
+  }
+  stmt_cache.swap(shifted);
+}
+
+bool Prp2lnast::is_changed(uint32_t start_byte, uint32_t end_byte) const {
+  for (const auto &r : changed_ranges) {
+    if (r.start_byte < end_byte && start_byte < r.end_byte)  // also catches an empty range (deletion) inside
+      return true;
+  }
+  return false;
+}
+
+const Prp2lnast::Stmt_cache *Prp2lnast::find_stmt_cache(uint32_t start_byte, uint32_t end_byte) const {
+  auto it = std::lower_bound(stmt_cache.begin(), stmt_cache.end(), start_byte, [](const Stmt_cache &e, uint32_t b) {
+    return e.start_byte < b;
+  });
+  if (it == stmt_cache.end() || it->start_byte != start_byte || it->end_byte != end_byte)
+    return nullptr;
+  return &(*it);
+}
+
+void Prp2lnast::record_stmt(const TSNode &stmt, const Lnast_nid &prev_last) {
+  auto &entry      = next_stmt_cache.emplace_back();
+  entry.start_byte = ts_node_start_byte(stmt);
+  entry.end_byte   = ts_node_end_byte(stmt);
+  entry.pos_delta  = 0;
+  entry.line_delta = 0;
+
+  Lnast_nid first;
+  if (!prev_last.is_invalid())
+    first = lnast->get_sibling_next(prev_last);
+  else if (!lnast->is_leaf(stmts_nid))
+    first = lnast->get_first_child(stmts_nid);
+
+  std::vector<std::pair<int, Lnast_nid>> stack;
+  for (auto top = first; !top.is_invalid(); top = lnast->get_sibling_next(top)) {
+    stack.emplace_back(1, top);
+    while (!stack.empty()) {
+      auto [depth, nid] = stack.back();
+      stack.pop_back();
+
+      entry.nodes.emplace_back(depth, lnast->get_data(nid));
+      if (lnast->is_leaf(nid))
+        continue;
+
+      auto pos = stack.size();
+      for (auto child = lnast->get_first_child(nid); !child.is_invalid(); child = lnast->get_sibling_next(child)) {
+        stack.emplace_back(depth + 1, child);
+      }
+      std::reverse(stack.begin() + pos, stack.end());
+    }
+  }
+}
+
+void Prp2lnast::replay_stmt(const Stmt_cache &entry) {
+  auto &next      = next_stmt_cache.emplace_back(entry);
+  next.pos_delta  = 0;
+  next.line_delta = 0;
+
+  std::vector<Lnast_nid> parents;
+  parents.emplace_back(stmts_nid);
+
+  for (auto &[depth, node] : next.nodes) {
+    if (node.token.pos2 > node.token.pos1) {  // token from the file, move it to the current position
+      node.token.pos1 += entry.pos_delta;
+      node.token.pos2 += entry.pos_delta;
+      node.token.line += entry.line_delta;
+    }
+
+    parents.resize(depth);
+    parents.emplace_back(lnast->add_child(parents.back(), node));
+  }
+}
+
 bool Prp2lnast::is_lhs_fcall_or_variable(TSTreeCursor *tc) const {
   auto tc2 = ts_tree_cursor_copy(tc);
 
@@ -121,6 +273,20 @@ void Prp2lnast::process_multiple_stmt(TSTreeCursor *tc) {
   }
 }
 
+void Prp2lnast::process_stmt(TSTreeCursor *tc) {
+
+  const TSNode stmt = ts_tree_cursor_current_node(tc);
+
+  mmap_lib::str stmt_type(ts_node_type(stmt));
+  if (stmt_type == "multiple_stmt") {
+    ts_tree_cursor_goto_first_child(tc);
+    process_multiple_stmt(tc);
+    ts_tree_cursor_goto_parent(tc);
+  }else{
+    fmt::print("FIXME: add {} to process_stmt_seq\n", stmt_type);
+  }
+}
+
 void Prp2lnast::process_stmt_seq(TSTreeCursor *tc) {
 
   const TSNode node = ts_tree_cursor_current_node(tc);
@@ -133,14 +299,24 @@ void Prp2lnast::process_stmt_seq(TSTreeCursor *tc) {
   auto has_stmt = ts_tree_cursor_goto_first_child(tc);
   while (has_stmt) {
     const TSNode stmt = ts_tree_cursor_current_node(tc);
-    mmap_lib::str stmt_type(ts_node_type(stmt));
-
-    if (stmt_type == "multiple_stmt") {
-      ts_tree_cursor_goto_first_child(tc);
-      process_multiple_stmt(tc);
-      ts_tree_cursor_goto_parent(tc);
-    }else{
-      fmt::print("FIXME: add {} to process_stmt_seq\n", stmt_type);
+    auto start_byte   = ts_node_start_byte(stmt);
+    auto end_byte     = ts_node_end_byte(stmt);
+
+    const Stmt_cache *entry = nullptr;
+    if (!is_changed(start_byte, end_byte))
+      entry = find_stmt_cache(start_byte, end_byte);
+
+    if (entry) {
+      replay_stmt(*entry);
+      ++num_reused;
+    } else {
+      Lnast_nid prev_last;
+      if (!lnast->is_leaf(stmts_nid))
+        prev_last = lnast->get_last_child(stmts_nid);
+
+      process_stmt(tc);
+      record_stmt(stmt, prev_last);
+      ++num_processed;
     }
 
     has_stmt = ts_tree_cursor_goto_next_sibling(tc);
@@ -186,6 +362,14 @@ void Prp2lnast::dump() const {
 }
 
 void Prp2lnast::process_root() {
+  lnast = std::make_unique<Lnast>(module_name);
+
+  lnast->set_root(Lnast_node(Lnast_ntype::create_top()));
+  stmts_nid = lnast->add_child(mmap_lib::Tree_index::root(), Lnast_node::create_stmts());
+
+  num_reused    = 0;
+  num_processed = 0;
+  next_stmt_cache.clear();
 
   auto tc = ts_tree_cursor_new(ts_root_node);
 
@@ -201,5 +385,8 @@ void Prp2lnast::process_root() {
   }
 
   ts_tree_cursor_delete(&tc);
+
+  stmt_cache.swap(next_stmt_cache);
+  next_stmt_cache.clear();
 }
 
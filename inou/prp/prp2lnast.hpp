@@ -1,5 +1,7 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <vector>
+
 #include "tree_sitter/api.h"
 
 #include "lnast.hpp"
@@ -8,13 +10,38 @@
 class Prp2lnast {
 protected:
 
+  // LNAST generated by one top-level statement. The nodes are in preorder
+  // with the depth relative to the stmts node, so they can be replayed in a
+  // new Lnast when the statement did not change between parses. Edits before
+  // the statement move it: pos_delta/line_delta are added to the node tokens
+  // when the statement is replayed.
+  struct Stmt_cache {
+    uint32_t start_byte;
+    uint32_t end_byte;
+    int64_t  pos_delta;
+    int32_t  line_delta;
+    std::vector<std::pair<int, Lnast_node>> nodes;
+  };
+
   std::unique_ptr<Lnast> lnast;
+  mmap_lib::str          module_name;
 
   std::string prp_file;
   TSParser   *parser;
+  TSTree     *ts_tree;
   TSNode      ts_root_node;
   bool        in_lhs;
 
+  Lnast_nid               stmts_nid;
+  std::vector<Stmt_cache> stmt_cache;      // sorted by start_byte
+  std::vector<Stmt_cache> next_stmt_cache;
+  std::vector<TSRange>    changed_ranges;
+
+  size_t num_reused;
+  size_t num_processed;
+
+  static std::string read_file(const mmap_lib::str &filename);
+
   mmap_lib::str get_text(const TSNode &node) const;
   mmap_lib::str get_trivial_identifier(const TSNode &node) const {
     return get_text(node);
@@ -23,8 +50,15 @@ protected:
 
   bool is_lhs_fcall_or_variable(TSTreeCursor *tc) const;
 
+  void apply_edit(const std::string &new_file);
+  bool is_changed(uint32_t start_byte, uint32_t end_byte) const;
+  const Stmt_cache *find_stmt_cache(uint32_t start_byte, uint32_t end_byte) const;
+  void record_stmt(const TSNode &stmt, const Lnast_nid &prev_last);
+  void replay_stmt(const Stmt_cache &entry);
+
   void process_fcall_or_variable(TSTreeCursor *tc);
   void process_multiple_stmt(TSTreeCursor *tc);
+  void process_stmt(TSTreeCursor *tc);
   void process_stmt_seq(TSTreeCursor *tc);
   void process_root();
 
@@ -33,11 +67,19 @@ public:
 
   ~Prp2lnast();
 
+  // Reparse filename (a new version of the file already parsed). The old
+  // tree-sitter tree is edited with the byte diff and reused by the parser,
+  // and only the top-level statements that changed regenerate LNAST.
+  void reparse(const mmap_lib::str filename, bool verbose = false);
+
   std::unique_ptr<Lnast> get_lnast() {
     return std::move(lnast);
   }
+
+  size_t get_num_reused() const { return num_reused; }
+  size_t get_num_processed() const { return num_processed; }
+
   void dump_tree_sitter() const;
   void dump_tree_sitter(TSTreeCursor *tc, int level) const;
   void dump() const;
 };
-
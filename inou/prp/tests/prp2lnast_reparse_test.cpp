@@ -0,0 +1,91 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "prp2lnast.hpp"
+
+// Prp2lnast::reparse must build the same LNAST as a fresh parse of the new
+// file, and only process again the top-level statements that changed.
+
+class Prp2lnast_reparse_test : public ::testing::Test {
+protected:
+  const mmap_lib::str file{"prp2lnast_reparse_test.prp"};
+
+  void write_file(const std::string &txt) const {
+    std::ofstream f(file.to_s());
+    f << txt;
+  }
+
+  // level, type, token text, position and line in preorder
+  static std::vector<std::string> flatten(Lnast *lnast) {
+    std::vector<std::string> flat;
+    for (const auto &nid : lnast->depth_preorder()) {
+      const auto &node = lnast->get_data(nid);
+      flat.emplace_back(fmt::format("{} {} {} {}:{} {}",
+                                    nid.level,
+                                    node.type.to_str(),
+                                    node.token.get_text(),
+                                    node.token.pos1,
+                                    node.token.pos2,
+                                    node.token.line));
+    }
+    return flat;
+  }
+
+  void check_same_as_fresh(Prp2lnast &incremental) const {
+    auto lnast_inc = incremental.get_lnast();
+
+    Prp2lnast fresh(file, "reparse");
+    auto      lnast_fresh = fresh.get_lnast();
+
+    EXPECT_EQ(flatten(lnast_inc.get()), flatten(lnast_fresh.get()));
+    EXPECT_EQ(incremental.get_num_reused() + incremental.get_num_processed(), fresh.get_num_processed());
+  }
+};
+
+TEST_F(Prp2lnast_reparse_test, reuse_counts) {
+  write_file("a = 1\nb = 2\nc = 3\n");
+  Prp2lnast p(file, "reparse");
+  EXPECT_EQ(p.get_num_reused(), 0u);
+  auto n_stmts = p.get_num_processed();
+  EXPECT_GE(n_stmts, 3u);
+  p.get_lnast();
+
+  p.reparse(file);  // no change
+  EXPECT_EQ(p.get_num_reused(), n_stmts);
+  EXPECT_EQ(p.get_num_processed(), 0u);
+  check_same_as_fresh(p);
+
+  write_file("a = 1\nb = 22\nc = 3\n");  // one statement changed
+  p.reparse(file);
+  EXPECT_GE(p.get_num_processed(), 1u);
+  EXPECT_GE(p.get_num_reused(), 2u);  // a and c
+  check_same_as_fresh(p);
+
+  write_file("x = 0\n\na = 1\nb = 22\nc = 3\n");  // new statement moves the rest
+  p.reparse(file);
+  EXPECT_GE(p.get_num_processed(), 1u);
+  EXPECT_GE(p.get_num_reused(), 3u);
+  check_same_as_fresh(p);  // the replayed tokens have the new positions and lines
+
+  write_file("x = 0\n\nc = 3\n");  // deleted statements
+  p.reparse(file);
+  EXPECT_GE(p.get_num_reused(), 2u);
+  check_same_as_fresh(p);
+}
+
+TEST_F(Prp2lnast_reparse_test, replaced_file) {
+  write_file("a = 1\nb = 2\n");
+  Prp2lnast p(file, "reparse");
+  p.get_lnast();
+
+  write_file("foo = bar\n");
+  p.reparse(file);
+  EXPECT_EQ(p.get_num_reused(), 0u);
+  EXPECT_GE(p.get_num_processed(), 1u);
+  check_same_as_fresh(p);
+}
@@ -15,12 +15,13 @@ inline void Prp::eat_comments() {
   }
 }
 
-uint8_t Prp::rule_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_start(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_start.");
 
   eat_comments();
-  if (scan_is_end())
-    return true;
+  if (scan_is_end()) {
+    RULE_SUCCESS("Matched rule_start (empty).\n", Prp_rule_start);
+  }
 
   base_token = scan_token_entry() - 1;
   if (!CHECK_RULE(&Prp::rule_code_blocks)) {
@@ -33,7 +34,7 @@ uint8_t Prp::rule_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list)
   RULE_SUCCESS("Matched rule_start.\n", Prp_rule_start);
 }
 
-uint8_t Prp::rule_code_blocks(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_code_blocks(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_code_blocks.");
 
   if (!CHECK_RULE(&Prp::rule_code_block_int)) {
@@ -60,7 +61,7 @@ uint8_t Prp::rule_code_blocks(std::list<std::tuple<Rule_id, Token_entry>> &pass_
   RULE_SUCCESS("Matched rule_code_blocks.\n", Prp_rule_code_blocks);
 }
 
-uint8_t Prp::rule_code_block_int(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_code_block_int(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_code_block_int.");
 
   check_lb();
@@ -95,7 +96,7 @@ uint8_t Prp::rule_code_block_int(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_FAILED("Failed rule_code_block_int.\n");
 }
 
-uint8_t Prp::rule_if_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_if_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_if_statement.");
 
   // optional
@@ -138,7 +139,7 @@ uint8_t Prp::rule_if_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass
   RULE_SUCCESS("Matched rule_if_statement (with condition).\n", Prp_rule_if_statement);
 }
 
-uint8_t Prp::rule_for_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_for_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_for_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_for)) {
@@ -159,7 +160,7 @@ uint8_t Prp::rule_for_statement(std::list<std::tuple<Rule_id, Token_entry>> &pas
 }
 
 // NOTE: modified from PEGjs grammar: range notation now allowed.
-uint8_t Prp::rule_for_in_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_for_in_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_in_notation.");
 
   if (!CHECK_RULE(&Prp::rule_identifier)) {
@@ -177,7 +178,7 @@ uint8_t Prp::rule_for_in_notation(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Matched rule_in_notation.\n", Prp_rule_for_in_notation);
 }
 
-uint8_t Prp::rule_for_index(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_for_index(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_for_index.");
 
   if (!CHECK_RULE(&Prp::rule_for_in_notation)) {
@@ -208,7 +209,7 @@ uint8_t Prp::rule_for_index(std::list<std::tuple<Rule_id, Token_entry>> &pass_li
   RULE_SUCCESS("Matched rule_for_index.\n", Prp_rule_for_index);
 }
 
-uint8_t Prp::rule_else_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_else_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_else_statement.");
 
   // option 1
@@ -246,7 +247,7 @@ uint8_t Prp::rule_else_statement(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_else_statement.\n", Prp_rule_else_statement);
 }
 
-uint8_t Prp::rule_while_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_while_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_while_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_while)) {
@@ -266,7 +267,7 @@ uint8_t Prp::rule_while_statement(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Failed rule_while_statement; couldn't find a while token.\n", Prp_rule_while_statement);
 }
 
-uint8_t Prp::rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_try_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_try_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_try, Prp_rule_try_statement)) {
@@ -293,7 +294,7 @@ uint8_t Prp::rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pas
 }
 
 // TODO: check correctness of scanner with ASSERTION token ("I")
-/*uint8_t Prp::rule_assertion_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+/*uint8_t Prp::rule_assertion_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_assertion_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_assertion, Prp_rule_assertion_statement)) {
@@ -308,7 +309,7 @@ uint8_t Prp::rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pas
 }
 
 // TODO: check correctness of scanner with NEGATION token ("N")
-uint8_t Prp::rule_negation_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_negation_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_negation_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_negation)) {
@@ -322,7 +323,7 @@ uint8_t Prp::rule_negation_statement(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_logical_expression.\n", Prp_rule_negation_statement);
 }*/
 
-uint8_t Prp::rule_empty_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_empty_scope_colon(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_empty_scope_colon.");
 
   check_ws();
@@ -343,7 +344,7 @@ uint8_t Prp::rule_empty_scope_colon(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_empty_scope_colon.\n", Prp_rule_empty_scope_colon);
 }
 
-uint8_t Prp::rule_scope_else(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_else(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_else.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_else, Prp_rule_scope_else)) {
@@ -367,7 +368,7 @@ uint8_t Prp::rule_scope_else(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
 }
 
 // WARNING: this rule was modified to look more like block_body
-uint8_t Prp::rule_scope_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_body(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_body.");
 
   // option 1 and 2 - logical expression inside only or just a closing brace
@@ -406,7 +407,7 @@ uint8_t Prp::rule_scope_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
   RULE_SUCCESS("Matched rule_scope_body (option 3).\n", Prp_rule_scope_body);
 }
 
-uint8_t Prp::rule_scope(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope.");
 
   if (SCAN_IS_TOKEN(Token_id_or, Prp_rule_scope)) {
@@ -424,7 +425,7 @@ uint8_t Prp::rule_scope(std::list<std::tuple<Rule_id, Token_entry>> &pass_list)
   RULE_FAILED("Failed rule_scope; generic.\n");
 }
 
-uint8_t Prp::rule_scope_condition(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_condition(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_condition.");
   (void)starting_line;
   (void)starting_pos;
@@ -436,7 +437,7 @@ uint8_t Prp::rule_scope_condition(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Matched rule_scope_condition.\n", Prp_rule_scope_condition);
 }
 
-uint8_t Prp::rule_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_colon(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_colon.");
 
   check_ws();
@@ -463,7 +464,7 @@ uint8_t Prp::rule_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_
   RULE_SUCCESS("Matched rule_scope_colon.\n", Prp_rule_scope_colon);
 }
 
-uint8_t Prp::rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_argument(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_argument.");
   if (!CHECK_RULE(&Prp::rule_fcall_arg_notation)) {
     RULE_FAILED("Failed rule_scope_argument; couldn't find an fcall_arg_notation.\n");
@@ -472,7 +473,7 @@ uint8_t Prp::rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_scope_argument.\n", Prp_rule_scope_argument);
 }
 
-/*uint8_t Prp::rule_punch_format(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+/*uint8_t Prp::rule_punch_format(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_punch_format.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_punch)) {
@@ -492,8 +493,9 @@ uint8_t Prp::rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_punch_format.\n", Prp_rule_punch_format);
 }*/
 
-uint8_t Prp::rule_scope_declaration(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_scope_declaration(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_scope_declaration.");
+  MEMO_FUNCTION(Prp_rule_scope_declaration);
 
   if (!CHECK_RULE(&Prp::rule_scope)) {
     RULE_FAILED("Failed rule_scope_declaration; couldn't find a scope.\n");
@@ -523,7 +525,7 @@ uint8_t Prp::rule_scope_declaration(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_scope_declaration.\n", Prp_rule_scope_declaration);
 }
 
-uint8_t Prp::rule_punch_rhs(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_punch_rhs(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_punch_rhs.");
 
   if (!SCAN_IS_TOKEN(Token_id_div)) {
@@ -570,8 +572,9 @@ uint8_t Prp::rule_punch_rhs(std::list<std::tuple<Rule_id, Token_entry>> &pass_li
   RULE_SUCCESS("Matched rule_punch_rhs.\n", Prp_rule_punch_rhs);
 }
 
-uint8_t Prp::rule_function_pipe(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_function_pipe(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_function_pipe.");
+  MEMO_FUNCTION(Prp_rule_function_pipe);
 
   check_ws();
   if (!SCAN_IS_TOKEN(Token_id_pipe, Prp_rule_function_pipe)) {
@@ -610,8 +613,9 @@ uint8_t Prp::rule_function_pipe(std::list<std::tuple<Rule_id, Token_entry>> &pas
   RULE_SUCCESS("Matched rule_function_pipe.\n", Prp_rule_function_pipe);
 }
 
-uint8_t Prp::rule_fcall_explicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_explicit(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_explicit.");
+  MEMO_FUNCTION(Prp_rule_fcall_explicit);
 
   INIT_PSEUDO_FAIL();
   UPDATE_PSEUDO_FAIL();
@@ -657,7 +661,7 @@ uint8_t Prp::rule_fcall_explicit(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_fcall_explicit", Prp_rule_fcall_explicit);
 }
 
-uint8_t Prp::rule_fcall_arg_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_arg_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_arg_notation.");
 
   if (!SCAN_IS_TOKEN(Token_id_op, Prp_rule_fcall_arg_notation)) {
@@ -700,7 +704,7 @@ uint8_t Prp::rule_fcall_arg_notation(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_fcall_arg_notation.\n", Prp_rule_fcall_arg_notation);
 }
 
-uint8_t Prp::rule_fcall_implicit_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_implicit_start(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_implicit_start.");
 
   // option 1
@@ -755,8 +759,9 @@ uint8_t Prp::rule_fcall_implicit_start(std::list<std::tuple<Rule_id, Token_entry
   RULE_SUCCESS("Matched rule_fcall_implicit.\n", Prp_rule_fcall_implicit);
 }
 
-uint8_t Prp::rule_fcall_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_fcall_implicit(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_fcall_implicit.");
+  MEMO_FUNCTION(Prp_rule_fcall_implicit);
 
   if (CHECK_RULE(&Prp::rule_constant)) {
     RULE_FAILED("Failed rule_fcall_implicit; found a constant.\n");
@@ -793,7 +798,7 @@ uint8_t Prp::rule_fcall_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_fcall_implicit.\n", Prp_rule_fcall_implicit);
 }
 
-uint8_t Prp::rule_not_in_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_not_in_implicit(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_not_in_implicit");
 
   if (SCAN_IS_TOKEN(Token_id_colon)) {
@@ -865,8 +870,9 @@ uint8_t Prp::rule_not_in_implicit(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_FAILED("Failed rule_not_in_implicit.\n");
 }
 
-uint8_t Prp::rule_assignment_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_assignment_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_assignment_expression.");
+  MEMO_FUNCTION(Prp_rule_assignment_expression);
 
   if (CHECK_RULE(&Prp::rule_constant)) {
     RULE_FAILED("Failed rule_assignment_expression; found a constant.\n");
@@ -901,7 +907,7 @@ uint8_t Prp::rule_assignment_expression(std::list<std::tuple<Rule_id, Token_entr
   RULE_SUCCESS("Matched rule_assignment_expression.\n", Prp_rule_assignment_expression);
 }
 
-uint8_t Prp::rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_return_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_return_statement.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_return)) {
@@ -914,7 +920,7 @@ uint8_t Prp::rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &
   RULE_SUCCESS("Matched rule_return_statement.\n", Prp_rule_return_statement);
 }
 
-/*uint8_t Prp::rule_compile_check_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+/*uint8_t Prp::rule_compile_check_statement(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_compile_check_statement.");
 
   if (!scan_is_token(Token_id_pound)) {
@@ -927,7 +933,7 @@ uint8_t Prp::rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &
   RULE_SUCCESS("Matched rule_compile_check_statement.\n", Prp_rule_compile_check_statement);
 }*/
 
-uint8_t Prp::rule_block_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_block_body(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_block_body.\n");
 
   // optional
@@ -943,8 +949,9 @@ uint8_t Prp::rule_block_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
   RULE_SUCCESS("Matched rule_block_body.\n", Prp_rule_block_body);
 }
 
-uint8_t Prp::rule_lhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_lhs_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_lhs_expression.");
+  MEMO_FUNCTION(Prp_rule_lhs_expression);
 
   if (SCAN_IS_TOKEN(Token_id_backslash)) {
     if (!SCAN_IS_TOKEN(Token_id_backslash)) {
@@ -960,8 +967,9 @@ uint8_t Prp::rule_lhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_lhs_expression.\n", Prp_rule_lhs_expression);
 }
 
-uint8_t Prp::rule_tuple_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_notation.");
+  MEMO_FUNCTION(Prp_rule_tuple_notation);
 
   // options 1 and 2
   if (SCAN_IS_TOKEN(Token_id_op, Prp_rule_tuple_notation)) {
@@ -1021,7 +1029,7 @@ uint8_t Prp::rule_tuple_notation(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_tuple_notation; fourth option.\n", Prp_rule_tuple_notation);
 }
 
-uint8_t Prp::rule_range_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_range_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_range_notation.");
 
   // optional
@@ -1042,7 +1050,7 @@ uint8_t Prp::rule_range_notation(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_range_notation.\n", Prp_rule_range_notation);
 }
 
-uint8_t Prp::rule_bit_selection_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_bit_selection_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_bit_selection_notation.");
 
   if (!CHECK_RULE(&Prp::rule_tuple_dot_notation)) {
@@ -1055,8 +1063,9 @@ uint8_t Prp::rule_bit_selection_notation(std::list<std::tuple<Rule_id, Token_ent
   RULE_SUCCESS("Matched rule_bit_selection_notation.\n", Prp_rule_bit_selection_notation);
 }
 
-uint8_t Prp::rule_tuple_dot_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_dot_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_dot_notation.");
+  MEMO_FUNCTION(Prp_rule_tuple_dot_notation);
 
   if (!CHECK_RULE(&Prp::rule_tuple_array_notation)) {
     RULE_FAILED("Failed tuple_dot_notation; couldn't find a tuple_array_notation.\n");
@@ -1068,7 +1077,7 @@ uint8_t Prp::rule_tuple_dot_notation(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_tuple_dot_notation.\n", Prp_rule_tuple_dot_notation);
 }
 
-uint8_t Prp::rule_tuple_dot_dot(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_dot_dot(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_dot_dot.");
   (void)starting_line;
   (void)starting_pos;
@@ -1096,7 +1105,7 @@ uint8_t Prp::rule_tuple_dot_dot(std::list<std::tuple<Rule_id, Token_entry>> &pas
   RULE_SUCCESS("Matched rule_tuple_dot_dot\n", Prp_rule_tuple_dot_dot);
 }
 
-uint8_t Prp::rule_tuple_array_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_array_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_array_notation.");
 
   if (!CHECK_RULE(&Prp::rule_lhs_var_name)) {
@@ -1109,7 +1118,7 @@ uint8_t Prp::rule_tuple_array_notation(std::list<std::tuple<Rule_id, Token_entry
   RULE_SUCCESS("Matched rule_tuple_array_notation.\n", Prp_rule_tuple_array_notation);
 }
 
-uint8_t Prp::rule_lhs_var_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_lhs_var_name(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_lhs_var_name.");
 
   if (!(CHECK_RULE(&Prp::rule_identifier) || CHECK_RULE(&Prp::rule_constant))) {
@@ -1119,7 +1128,7 @@ uint8_t Prp::rule_lhs_var_name(std::list<std::tuple<Rule_id, Token_entry>> &pass
   RULE_SUCCESS("Matched rule_lhs_var_name.\n", Prp_rule_lhs_var_name);
 }
 
-uint8_t Prp::rule_tuple_array_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_array_bracket(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_array_bracket.");
   (void)starting_line;
   (void)starting_pos;
@@ -1147,7 +1156,7 @@ uint8_t Prp::rule_tuple_array_bracket(std::list<std::tuple<Rule_id, Token_entry>
   RULE_SUCCESS("Matched rule_tuple_array_bracket.\n", Prp_rule_tuple_array_bracket);
 }
 
-uint8_t Prp::rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_identifier(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_identifier.");
 
   if (CHECK_RULE(&Prp::rule_keyword)) {
@@ -1168,17 +1177,17 @@ uint8_t Prp::rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
     if (SCAN_IS_TOKEN(Token_id_bang, Prp_rule_reference)) {
       SCAN_IS_TOKEN(Token_id_bang, Prp_rule_reference);
       if (op) {
-        loc_list.emplace(std::next(loc_list.begin()), 0, 0);
+        loc_list.emplace(loc_list.begin() + loc_mark + 2, 0, 0);  // after the op
       } else {
-        loc_list.emplace(loc_list.begin(), 0, 0);
+        loc_list.emplace(loc_list.begin() + loc_mark + 1, 0, 0);  // after the placeholder
       }
       loc_list.emplace_back(Prp_rule_reference, 0);
     }
   } else {
     if (op) {
-      loc_list.emplace(std::next(loc_list.begin()), 0, 0);
+      loc_list.emplace(loc_list.begin() + loc_mark + 2, 0, 0);
     } else {
-      loc_list.emplace(loc_list.begin(), 0, 0);
+      loc_list.emplace(loc_list.begin() + loc_mark + 1, 0, 0);
     }
     loc_list.emplace_back(Prp_rule_reference, 0);
   }
@@ -1187,7 +1196,7 @@ uint8_t Prp::rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_l
 }
 
 // some rules want there to not be a constant; in this case, we don't want AST changes or tokens consumed if the rule is matched.
-uint8_t Prp::rule_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_constant(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_constant");
 
   // option 1 - numerical constant
@@ -1209,7 +1218,7 @@ uint8_t Prp::rule_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_lis
   RULE_FAILED("Failed rule_constant.\n", Prp_rule_constant);
 }
 
-uint8_t Prp::rule_numerical_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_numerical_constant(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_numerical_constant.");
 
   SCAN_IS_TOKEN(Token_id_minus, Prp_rule_numerical_constant);
@@ -1222,7 +1231,7 @@ uint8_t Prp::rule_numerical_constant(std::list<std::tuple<Rule_id, Token_entry>>
 }
 
 // TODO: add support for single tick strings
-uint8_t Prp::rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_string_constant(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_string_constant.");
 
   // option 1: double " string
@@ -1255,7 +1264,7 @@ uint8_t Prp::rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &p
   RULE_SUCCESS("Matched rule_string_constant.\n", Prp_rule_string_constant);
 }
 
-uint8_t Prp::rule_assignment_operator(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_assignment_operator(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_assignment_operator.");
 
 #ifdef DEBUG_AST
@@ -1319,7 +1328,7 @@ uint8_t Prp::rule_assignment_operator(std::list<std::tuple<Rule_id, Token_entry>
   RULE_FAILED("Failed rule_assignment_operator; couldn't find any of the operators.\n");
 }
 
-uint8_t Prp::rule_tuple_by_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_tuple_by_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_tuple_by_notation.");
 
   if (!SCAN_IS_TOKEN(Pyrope_id_by)) {
@@ -1332,7 +1341,7 @@ uint8_t Prp::rule_tuple_by_notation(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_tuple_by_notation.\n", Prp_rule_tuple_by_notation);
 }
 
-uint8_t Prp::rule_bit_selection_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_bit_selection_bracket(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_bit_selection_bracket.");
   (void)starting_line;
   (void)starting_pos;
@@ -1357,8 +1366,9 @@ uint8_t Prp::rule_bit_selection_bracket(std::list<std::tuple<Rule_id, Token_entr
   RULE_SUCCESS("Matched rule_bit_selection_bracket.\n", Prp_rule_bit_selection_bracket);
 }
 
-uint8_t Prp::rule_logical_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_logical_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_logical_expression.");
+  MEMO_FUNCTION(Prp_rule_logical_expression);
 
   if (!CHECK_RULE(&Prp::rule_relational_expression)) {
     RULE_FAILED("Failed rule_logical_expression; couldn't find a relational_expression.\n");
@@ -1395,7 +1405,7 @@ uint8_t Prp::rule_logical_expression(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_logical_expression.\n", Prp_rule_logical_expression);
 }
 
-uint8_t Prp::rule_relational_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_relational_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_relational_expression.");
 
   if (!CHECK_RULE(&Prp::rule_additive_expression)) {
@@ -1431,7 +1441,7 @@ uint8_t Prp::rule_relational_expression(std::list<std::tuple<Rule_id, Token_entr
   RULE_SUCCESS("Matched rule_relational_expression.\n", Prp_rule_relational_expression);
 }
 
-uint8_t Prp::rule_additive_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_additive_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_additive_expression.");
 
   if (!CHECK_RULE(&Prp::rule_unary_expression)) {
@@ -1512,7 +1522,7 @@ uint8_t Prp::rule_additive_expression(std::list<std::tuple<Rule_id, Token_entry>
   RULE_SUCCESS("Matched rule_additive_expression.\n", Prp_rule_additive_expression);
 }
 
-uint8_t Prp::rule_bitwise_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_bitwise_expression(Prp_event_list &pass_list) {
   fmt::print("BITWISE EXPRESSION RULE CURRENTLY UNUSED. THERE IS A BUG. EXITING...\n");
   exit(1);
   INIT_FUNCTION("rule_bitwise_expression.");
@@ -1551,7 +1561,7 @@ uint8_t Prp::rule_bitwise_expression(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_SUCCESS("Matched rule_bitwise_expression.\n", Prp_rule_bitwise_expression);
 }
 
-uint8_t Prp::rule_multiplicative_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_multiplicative_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_multiplicative_expression.");
 
   if (!CHECK_RULE(&Prp::rule_unary_expression)) {
@@ -1588,7 +1598,7 @@ uint8_t Prp::rule_multiplicative_expression(std::list<std::tuple<Rule_id, Token_
   RULE_SUCCESS("Matched rule_multiplicative_expression.\n", Prp_rule_multiplicative_expression);
 }
 
-uint8_t Prp::rule_unary_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_unary_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_unary_expression.");
 
   // option 1
@@ -1605,7 +1615,7 @@ uint8_t Prp::rule_unary_expression(std::list<std::tuple<Rule_id, Token_entry>> &
   RULE_SUCCESS("Matched rule_unary_expression, option 2.\n", Prp_rule_unary_expression);
 }
 
-uint8_t Prp::rule_factor(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_factor(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_factor.");
 
   // option 1
@@ -1638,7 +1648,7 @@ uint8_t Prp::rule_factor(std::list<std::tuple<Rule_id, Token_entry>> &pass_list)
   RULE_SUCCESS("Matched rule_factor; option 2.\n", Prp_rule_factor);
 }
 
-uint8_t Prp::rule_overload_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_overload_notation(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_overload_notation.");
 
   if (!SCAN_IS_TOKEN(Token_id_dot, Prp_rule_overload_notation)) {
@@ -1661,7 +1671,7 @@ uint8_t Prp::rule_overload_notation(std::list<std::tuple<Rule_id, Token_entry>>
 }
 
 // WARNING: not sure how this behaves when we aren't explicitly looking for a line terminator
-uint8_t Prp::rule_overload_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_overload_name(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_overload_name.");
 
   if (!CHECK_RULE(&Prp::rule_overload_exception)) {
@@ -1699,7 +1709,7 @@ uint8_t Prp::rule_overload_name(std::list<std::tuple<Rule_id, Token_entry>> &pas
   RULE_SUCCESS("Matched rule_overload_name.\n", Prp_rule_overload_name);
 }
 
-uint8_t Prp::rule_overload_exception(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_overload_exception(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_overload_exception.\n");
 
   Token_id toks[] = {Token_id_dot,
@@ -1727,8 +1737,9 @@ uint8_t Prp::rule_overload_exception(std::list<std::tuple<Rule_id, Token_entry>>
   RULE_FAILED("Failed rule_overload_exception; couldn't find an excepting character.\n");
 }
 
-uint8_t Prp::rule_rhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_rhs_expression(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_rhs_expression.");
+  MEMO_FUNCTION(Prp_rule_rhs_expression);
 
   if (!(CHECK_RULE(&Prp::rule_fcall_explicit) || CHECK_RULE(&Prp::rule_lhs_expression)
         || CHECK_RULE(&Prp::rule_scope_declaration))) {
@@ -1738,7 +1749,7 @@ uint8_t Prp::rule_rhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pa
   RULE_SUCCESS("Matched rule_rhs_expression.\n", Prp_rule_rhs_expression);
 }
 
-uint8_t Prp::rule_keyword(std::list<std::tuple<Rule_id, Token_entry>> &pass_list) {
+uint8_t Prp::rule_keyword(Prp_event_list &pass_list) {
   INIT_FUNCTION("rule_keyword");
 
   Token_id toks[] = {Pyrope_id_TRUE,
@@ -1845,8 +1856,10 @@ void Prp::elaborate() {
   PRINT_DBG_AST("RULE AND AST CALL TRACE \n\n");
 
   ast = std::make_unique<Ast_parser>(get_memblock(), Prp_rule);
-  std::list<std::tuple<Rule_id, Token_entry>> loc_list;
+  Prp_event_list loc_list;
+  loc_list.reserve(2 * token_list.size());  // avoid most of the reallocations
   gen_ws_map();
+  memo_clear();
 
   int      failed  = 0;
   uint64_t sub_cnt = 0;
@@ -1906,6 +1919,13 @@ void Prp::elaborate() {
   PRINT_DBG_AST(fmt::format("Number of ast->up() calls: {}\n", debug_stat.ast_up_calls));
   PRINT_DBG_AST(fmt::format("Number of ast->down() calls: {}\n", debug_stat.ast_down_calls));
   PRINT_DBG_AST(fmt::format("Number of ast_add() calls: {}\n", debug_stat.ast_add_calls));
+  PRINT_DBG_AST(fmt::format("Number of memo hits: {}\n", debug_stat.memo_hits));
+  PRINT_DBG_AST(fmt::format("Number of memo misses: {}\n", debug_stat.memo_misses));
+  PRINT_DBG_AST(fmt::format("Number of memo events saved: {}\n", debug_stat.memo_events_saved));
+  PRINT_DBG_AST(fmt::format("Number of memo events replayed: {}\n", debug_stat.memo_events_replayed));
+  PRINT_DBG_AST(fmt::format("Number of AST events: {} (memo: {})\n", loc_list.size(), memo_events.size()));
+
+  memo_clear();
 }
 
 void Prp::gen_ws_map() {
@@ -1991,8 +2011,11 @@ void Prp::ast_dump(mmap_lib::Tree_index tree_idx) const {
   }
 }
 
-void Prp::ast_builder(std::list<std::tuple<Rule_id, Token_entry>> &passed_list) {
-  for (auto ast_op : passed_list) {
+void Prp::ast_builder(Prp_event_list &passed_list) {
+  for (const auto &ast_op : passed_list) {
+    if (ast_op == Prp_event_skip)
+      continue;
+
     auto rule_id = std::get<0>(ast_op);
     if (rule_id == 0) {
       ast->down();
@@ -2012,8 +2035,123 @@ void Prp::ast_builder(std::list<std::tuple<Rule_id, Token_entry>> &passed_list)
   }
 }
 
-uint8_t Prp::check_function(uint8_t (Prp::*rule)(std::list<std::tuple<Rule_id, Token_entry>> &), uint64_t *sub_cnt,
-                            std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+void Prp::close_loc_list(Prp_event_list &loc_list, size_t loc_mark, uint64_t sub_cnt, Rule_id rule) const {
+  I(loc_list.size() > loc_mark);
+  I(loc_list[loc_mark] == Prp_event_skip);
+
+  if (sub_cnt > 1) {
+    loc_list[loc_mark] = Prp_event(0, 0);  // the placeholder becomes the subtree down
+    loc_list.emplace_back(rule, 0);
+  } else if (loc_list.size() == loc_mark + 1) {
+    loc_list.pop_back();  // nothing added by the rule
+  }
+}
+
+bool Prp::memo_hit(Rule_id rule, Prp_event_list &loc_list, size_t loc_mark, int64_t &memo_idx, bool &result) {
+  Memo_key key{rule, scanner_pos, cur_line, cur_pos};
+
+  auto [it, inserted] = memo_map.try_emplace(key, memo_entries.size());
+  if (inserted) {
+    memo_idx = it->second;
+    memo_entries.emplace_back(Memo_entry{false, false, false, scanner_pos, tokens_consumed, scanner_pos, 0, 0, 0, 0, 0});
+    debug_stat.memo_misses++;
+    return false;
+  }
+
+  const auto &m = memo_entries[it->second];
+  if (!m.done) {
+    memo_idx = -1;  // same rule and state still being parsed (recursion). Parse it again, no memo
+    return false;
+  }
+
+  debug_stat.memo_hits++;
+#ifdef DEBUG_AST
+  PRINT_DBG_AST("Memo hit for rule {} ({})\n", rule_id_to_string(rule), m.result);
+  rule_call_stack.pop_back();
+#endif
+
+  loc_list_truncate(loc_list, loc_mark);  // remove placeholder
+  if (m.result && m.events_size) {
+    debug_stat.memo_events_replayed += m.events_size;
+    if (m.live) {  // no backtrack since the rule matched, the events are still in loc_list
+      loc_list.reserve(loc_list.size() + m.events_size);
+      for (auto i = m.events_start; i < m.events_start + m.events_size; ++i) {
+        loc_list.emplace_back(loc_list[i]);
+      }
+    } else {
+      auto start = memo_events.begin() + m.events_start;
+      loc_list.insert(loc_list.end(), start, start + m.events_size);
+    }
+  }
+
+  scanner_pos = m.end_scanner_pos;
+  tokens_consumed += m.end_tokens_delta;
+  cur_line = m.end_line;
+  cur_pos  = m.end_pos;
+
+  result = m.result;
+  return true;
+}
+
+void Prp::memo_store(int64_t memo_idx, const Prp_event_list &loc_list, size_t loc_mark, bool result) {
+  if (memo_idx < 0)
+    return;
+
+  auto &m = memo_entries[memo_idx];
+  I(!m.done);
+
+  m.done             = true;
+  m.result           = result;
+  m.end_scanner_pos  = scanner_pos;
+  m.end_tokens_delta = tokens_consumed - m.start_tokens;
+  m.end_line         = cur_line;
+  m.end_pos          = cur_pos;
+
+  if (result && loc_list.size() > loc_mark) {
+    m.live         = true;  // no copy, moved to memo_events by loc_list_truncate if needed
+    m.events_start = loc_mark;
+    m.events_size  = loc_list.size() - loc_mark;
+    memo_live.emplace_back(memo_idx);
+  }
+}
+
+void Prp::memo_clear() {
+  memo_map.clear();
+  memo_entries.clear();
+  memo_events.clear();
+  memo_live.clear();
+}
+
+void Prp::loc_list_truncate(Prp_event_list &loc_list, size_t size) {
+  // The live entries that completed after loc_list had "size" events are a
+  // suffix of memo_live (rules are nested, so each starts at or after size).
+  // Their ranges are nested or disjoint: a single copy from the first one
+  // keeps all of them, inner rules are not copied again with the outer one.
+  auto   n     = memo_live.size();
+  size_t first = loc_list.size();
+  while (n > 0 && memo_entries[memo_live[n - 1]].events_start >= size) {
+    --n;
+    first = std::min(first, memo_entries[memo_live[n]].events_start);
+  }
+
+  if (n < memo_live.size()) {
+    auto base = memo_events.size();
+    memo_events.insert(memo_events.end(), loc_list.begin() + first, loc_list.end());
+    debug_stat.memo_events_saved += loc_list.size() - first;
+
+    for (auto i = n; i < memo_live.size(); ++i) {
+      auto &m        = memo_entries[memo_live[i]];
+      m.live         = false;
+      m.events_start = base + m.events_start - first;
+    }
+    memo_live.resize(n);
+  }
+
+  loc_list.resize(size);
+}
+
+uint8_t Prp::check_function(uint8_t (Prp::*rule)(Prp_event_list &), uint64_t *sub_cnt,
+                            Prp_event_list &loc_list) {
   PRINT_DBG_AST("Called check_function.\n");
 
   uint64_t starting_size = loc_list.size();
@@ -2030,7 +2168,7 @@ uint8_t Prp::check_function(uint8_t (Prp::*rule)(std::list<std::tuple<Rule_id, T
   return ret;
 }
 
-bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, Prp_event_list &loc_list) {
   // PRINT_DBG_AST("Checking  token {} from rule {}.\n", scan_text(scan_token_entry()), rule_id_to_string(rid));
   if (tok != TOKEN_ID_ANY) {
     if (!scan_is_token(tok))
@@ -2123,7 +2261,7 @@ bool Prp::chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::lis
 }
 
 bool Prp::chk_and_consume_options(Token_id *toks, uint8_t tok_cnt, Rule_id rid, uint64_t *sub_cnt,
-                                  std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+                                  Prp_event_list &loc_list) {
   PRINT_DBG_AST("Checking many tokens from rule {}.\n", rule_id_to_string(rid));
   bool found = false;
   int  i;
@@ -2283,7 +2421,7 @@ mmap_lib::str Prp::rule_id_to_string(Rule_id rid) {
 }
 
 #ifdef DEBUG_AST
-inline void Prp::print_loc_list(std::list<std::tuple<Rule_id, Token_entry>> &loc_list) {
+inline void Prp::print_loc_list(Prp_event_list &loc_list) {
   int i = 0;
   for (auto it = loc_list.begin(); it != loc_list.end(); it++) {
     PRINT_DBG_AST("loc_list[{}]:rule: {} token: {}.\n", i++, rule_id_to_string(std::get<0>(*it)), scan_text(std::get<1>(*it)));
@@ -5,12 +5,20 @@
 #include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "ast.hpp"
 #include "elab_scanner.hpp"
 
+// AST event: (0,0) down, (rule,0) up, (rule,token) add. (0,1) is a skipped
+// placeholder (see INIT_FUNCTION)
+using Prp_event      = std::tuple<Rule_id, Token_entry>;
+using Prp_event_list = std::vector<Prp_event>;
+
+inline const Prp_event Prp_event_skip{0, 1};
+
 //#define OUTPUT_AST
 //#define OUTPUT_LN
 
@@ -60,31 +68,49 @@
 #endif
 
 // function-like macros
+//
+// The AST events of all the rules go to a single Prp_event_list. A rule owns
+// the events from loc_mark to the end: loc_mark has a placeholder for the
+// subtree down (0,0), failing truncates back to loc_mark, and the memo (rules
+// with MEMO_FUNCTION) replays a previous outcome at the same parser state.
 #ifdef DEBUG_AST
-#define INIT_FUNCTION(...)                                                       \
-  debug_stat.rules_called++;                                                     \
-  rule_call_stack.push_back(__VA_ARGS__);                                        \
-  print_rule_call_stack();                                                       \
-  auto                                        starting_tokens = tokens_consumed; \
-  auto                                        starting_line   = cur_line;        \
-  auto                                        starting_pos    = cur_pos;         \
-  uint64_t                                    sub_cnt         = 0;               \
-  std::list<std::tuple<Rule_id, Token_entry>> loc_list
+#define INIT_FUNCTION(...)                            \
+  debug_stat.rules_called++;                          \
+  rule_call_stack.push_back(__VA_ARGS__);             \
+  print_rule_call_stack();                            \
+  auto           starting_tokens = tokens_consumed;   \
+  auto           starting_line   = cur_line;          \
+  auto           starting_pos    = cur_pos;           \
+  uint64_t       sub_cnt         = 0;                 \
+  int64_t        memo_idx        = -1;                \
+  const size_t   loc_mark        = pass_list.size();  \
+  Prp_event_list &loc_list       = pass_list;         \
+  loc_list.emplace_back(Prp_event_skip)
 #else
-#define INIT_FUNCTION(...)                                                       \
-  auto                                        starting_tokens = tokens_consumed; \
-  auto                                        starting_line   = cur_line;        \
-  auto                                        starting_pos    = cur_pos;         \
-  uint64_t                                    sub_cnt         = 0;               \
-  std::list<std::tuple<Rule_id, Token_entry>> loc_list
+#define INIT_FUNCTION(...)                            \
+  auto           starting_tokens = tokens_consumed;   \
+  auto           starting_line   = cur_line;          \
+  auto           starting_pos    = cur_pos;           \
+  uint64_t       sub_cnt         = 0;                 \
+  int64_t        memo_idx        = -1;                \
+  const size_t   loc_mark        = pass_list.size();  \
+  Prp_event_list &loc_list       = pass_list;         \
+  loc_list.emplace_back(Prp_event_skip)
 #endif
 
+#define MEMO_FUNCTION(rule)                                     \
+  {                                                             \
+    bool memo_result = false;                                   \
+    if (memo_hit(rule, loc_list, loc_mark, memo_idx, memo_result)) \
+      return memo_result;                                       \
+  }
+
 #ifdef DEBUG_AST
 #define RULE_FAILED(...)                                                        \
   fmt::print(__VA_ARGS__);                                                      \
   rule_call_stack.pop_back();                                                   \
   print_rule_call_stack();                                                      \
-  if (loc_list.size() > 0) {                                                    \
+  if (loc_list.size() > (loc_mark + 1)) {                                       \
     PRINT_DBG_AST("tokens_consumed: {}.\n", tokens_consumed - starting_tokens); \
     print_loc_list(loc_list);                                                   \
   } else {                                                                      \
@@ -93,13 +119,17 @@
   go_back(tokens_consumed - starting_tokens);                                   \
   cur_line = starting_line;                                                     \
   cur_pos  = starting_pos;                                                      \
+  loc_list_truncate(loc_list, loc_mark);                                        \
+  memo_store(memo_idx, loc_list, loc_mark, false);                              \
   debug_stat.rules_failed++;                                                    \
   return false
 #else
-#define RULE_FAILED(...)                      \
-  go_back(tokens_consumed - starting_tokens); \
-  cur_line = starting_line;                   \
-  cur_pos  = starting_pos;                    \
+#define RULE_FAILED(...)                           \
+  go_back(tokens_consumed - starting_tokens);      \
+  cur_line = starting_line;                        \
+  cur_pos  = starting_pos;                         \
+  loc_list_truncate(loc_list, loc_mark);           \
+  memo_store(memo_idx, loc_list, loc_mark, false); \
   return false
 #endif
 
@@ -112,18 +142,14 @@
   fmt::print("Rule {} had a sub_cnt of {}.\n", rule_id_to_string(rule), sub_cnt);                                       \
   if (sub_cnt > 1) {                                                                                                    \
     fmt::print("Had a subtree of at least size two in rule {} it was of size {}.\n", rule_id_to_string(rule), sub_cnt); \
-    loc_list.push_front(std::make_tuple(0, 0));                                                                         \
-    loc_list.push_back(std::make_tuple(rule, 0));                                                                       \
   }                                                                                                                     \
-  pass_list.splice(pass_list.end(), loc_list);                                                                          \
+  close_loc_list(loc_list, loc_mark, sub_cnt, rule);                                                                    \
+  memo_store(memo_idx, loc_list, loc_mark, true);                                                                       \
   return true
 #else
-#define RULE_SUCCESS(message, rule)            \
-  if (sub_cnt > 1) {                           \
-    loc_list.emplace_front(0, 0);              \
-    loc_list.emplace_back(rule, 0);            \
-  }                                            \
-  pass_list.splice(pass_list.end(), loc_list); \
+#define RULE_SUCCESS(message, rule)                 \
+  close_loc_list(loc_list, loc_mark, sub_cnt, rule); \
+  memo_store(memo_idx, loc_list, loc_mark, true);   \
   return true
 #endif
 
@@ -146,7 +172,7 @@
 #define PSEUDO_FAIL()                                                                                 \
   PRINT_DBG_AST("Pseudo fail: tokens_consumed = {}, cur_tokens = {}\n", tokens_consumed, cur_tokens); \
   go_back(tokens_consumed - cur_tokens);                                                              \
-  loc_list.resize(cur_loc_list_size);                                                                 \
+  loc_list_truncate(loc_list, cur_loc_list_size);                                                     \
   sub_cnt  = sub_cnt_start;                                                                           \
   cur_line = lines_start;                                                                             \
   cur_pos  = pos_start
@@ -205,9 +231,13 @@ protected:
     uint32_t ast_up_calls;
     uint32_t ast_down_calls;
     uint32_t ast_add_calls;
+    uint32_t memo_hits;
+    uint32_t memo_misses;
+    uint64_t memo_events_saved;
+    uint64_t memo_events_replayed;
   };
 
-  debug_statistics         debug_stat{0, 0, 0, 0, 0, 0, 0, 0};
+  debug_statistics         debug_stat{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
   std::vector<mmap_lib::str> ast_call_trace;
 
   uint64_t tokens_consumed = 0;
@@ -223,72 +253,97 @@ protected:
   std::vector<mmap_lib::str> rule_call_stack;
   uint64_t                 term_token = 1;
 
+  // Packrat memo. A rule outcome only depends on the scanner position and
+  // cur_line/cur_pos, so backtracking alternatives reuse it instead of parsing
+  // again. The events of a successful rule stay in the parse event list
+  // (live) until a backtrack truncates them; only then they are moved, once,
+  // to memo_events. Nested memoized rules share the same moved events.
+  struct Memo_entry {
+    bool        done;
+    bool        result;
+    bool        live;
+    Token_entry start_scanner_pos;
+    uint64_t    start_tokens;
+    Token_entry end_scanner_pos;
+    uint64_t    end_tokens_delta;
+    uint64_t    end_line;
+    uint64_t    end_pos;
+    size_t      events_start;
+    size_t      events_size;
+  };
+  using Memo_key = std::tuple<Rule_id, uint32_t, uint64_t, uint64_t>;  // rule, scanner_pos, cur_line, cur_pos
+
+  absl::flat_hash_map<Memo_key, int64_t> memo_map;
+  std::vector<Memo_entry>               memo_entries;
+  Prp_event_list                        memo_events;
+  std::vector<int64_t>                  memo_live;  // live entries, in completion order
+
   void elaborate();
 
-  uint8_t rule_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_code_blocks(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_code_block_int(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_if_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_else_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_for_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_while_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_try_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_punch_format(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_function_pipe(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_explicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_implicit_start(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_for_index(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_assignment_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_logical_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_relational_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_additive_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_bitwise_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_multiplicative_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_unary_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_factor(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_by_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_notation_no_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_notation_with_object(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_range_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_bit_selection_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_bit_selection_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_array_bracket(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_array_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_lhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_lhs_var_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_rhs_expression_property(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_rhs_expression(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_identifier(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_reference(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_assignment_operator(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_dot_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_tuple_dot_dot(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_overload_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_overload_name(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_overload_exception(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_else(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_declaration(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_condition(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_argument(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_punch_rhs(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_fcall_arg_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_return_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_compile_check_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_block_body(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_empty_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_assertion_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_negation_statement(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_scope_colon(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_numerical_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_string_constant(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_for_in_notation(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_not_in_implicit(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
-  uint8_t rule_keyword(std::list<std::tuple<Rule_id, Token_entry>> &pass_list);
+  uint8_t rule_start(Prp_event_list &pass_list);
+  uint8_t rule_code_blocks(Prp_event_list &pass_list);
+  uint8_t rule_code_block_int(Prp_event_list &pass_list);
+  uint8_t rule_if_statement(Prp_event_list &pass_list);
+  uint8_t rule_else_statement(Prp_event_list &pass_list);
+  uint8_t rule_for_statement(Prp_event_list &pass_list);
+  uint8_t rule_while_statement(Prp_event_list &pass_list);
+  uint8_t rule_try_statement(Prp_event_list &pass_list);
+  uint8_t rule_punch_format(Prp_event_list &pass_list);
+  uint8_t rule_function_pipe(Prp_event_list &pass_list);
+  uint8_t rule_fcall_explicit(Prp_event_list &pass_list);
+  uint8_t rule_fcall_implicit_start(Prp_event_list &pass_list);
+  uint8_t rule_fcall_implicit(Prp_event_list &pass_list);
+  uint8_t rule_for_index(Prp_event_list &pass_list);
+  uint8_t rule_assignment_expression(Prp_event_list &pass_list);
+  uint8_t rule_logical_expression(Prp_event_list &pass_list);
+  uint8_t rule_relational_expression(Prp_event_list &pass_list);
+  uint8_t rule_additive_expression(Prp_event_list &pass_list);
+  uint8_t rule_bitwise_expression(Prp_event_list &pass_list);
+  uint8_t rule_multiplicative_expression(Prp_event_list &pass_list);
+  uint8_t rule_unary_expression(Prp_event_list &pass_list);
+  uint8_t rule_factor(Prp_event_list &pass_list);
+  uint8_t rule_tuple_by_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_notation_no_bracket(Prp_event_list &pass_list);
+  uint8_t rule_tuple_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_notation_with_object(Prp_event_list &pass_list);
+  uint8_t rule_range_notation(Prp_event_list &pass_list);
+  uint8_t rule_bit_selection_bracket(Prp_event_list &pass_list);
+  uint8_t rule_bit_selection_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_array_bracket(Prp_event_list &pass_list);
+  uint8_t rule_tuple_array_notation(Prp_event_list &pass_list);
+  uint8_t rule_lhs_expression(Prp_event_list &pass_list);
+  uint8_t rule_lhs_var_name(Prp_event_list &pass_list);
+  uint8_t rule_rhs_expression_property(Prp_event_list &pass_list);
+  uint8_t rule_rhs_expression(Prp_event_list &pass_list);
+  uint8_t rule_identifier(Prp_event_list &pass_list);
+  uint8_t rule_reference(Prp_event_list &pass_list);
+  uint8_t rule_constant(Prp_event_list &pass_list);
+  uint8_t rule_assignment_operator(Prp_event_list &pass_list);
+  uint8_t rule_tuple_dot_notation(Prp_event_list &pass_list);
+  uint8_t rule_tuple_dot_dot(Prp_event_list &pass_list);
+  uint8_t rule_overload_notation(Prp_event_list &pass_list);
+  uint8_t rule_overload_name(Prp_event_list &pass_list);
+  uint8_t rule_overload_exception(Prp_event_list &pass_list);
+  uint8_t rule_scope_else(Prp_event_list &pass_list);
+  uint8_t rule_scope_body(Prp_event_list &pass_list);
+  uint8_t rule_scope_declaration(Prp_event_list &pass_list);
+  uint8_t rule_scope(Prp_event_list &pass_list);
+  uint8_t rule_scope_condition(Prp_event_list &pass_list);
+  uint8_t rule_scope_argument(Prp_event_list &pass_list);
+  uint8_t rule_punch_rhs(Prp_event_list &pass_list);
+  uint8_t rule_fcall_arg_notation(Prp_event_list &pass_list);
+  uint8_t rule_return_statement(Prp_event_list &pass_list);
+  uint8_t rule_compile_check_statement(Prp_event_list &pass_list);
+  uint8_t rule_block_body(Prp_event_list &pass_list);
+  uint8_t rule_empty_scope_colon(Prp_event_list &pass_list);
+  uint8_t rule_assertion_statement(Prp_event_list &pass_list);
+  uint8_t rule_negation_statement(Prp_event_list &pass_list);
+  uint8_t rule_scope_colon(Prp_event_list &pass_list);
+  uint8_t rule_numerical_constant(Prp_event_list &pass_list);
+  uint8_t rule_string_constant(Prp_event_list &pass_list);
+  uint8_t rule_for_in_notation(Prp_event_list &pass_list);
+  uint8_t rule_not_in_implicit(Prp_event_list &pass_list);
+  uint8_t rule_keyword(Prp_event_list &pass_list);
 
   inline void check_lb();
   inline void check_ws();
@@ -301,17 +356,23 @@ protected:
   bool        go_back(uint64_t num_tok);
   static mmap_lib::str rule_id_to_string(Rule_id rid);
 
-  uint8_t check_function(uint8_t (Prp::*rule)(std::list<std::tuple<Rule_id, Token_entry>> &), uint64_t *sub_cnt,
-                         std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
-  bool    chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
+  uint8_t check_function(uint8_t (Prp::*rule)(Prp_event_list &), uint64_t *sub_cnt,
+                         Prp_event_list &loc_list);
+  bool    chk_and_consume(Token_id tok, Rule_id rid, uint64_t *sub_cnt, Prp_event_list &loc_list);
   bool    chk_and_consume_options(Token_id *toks, uint8_t tok_cnt, Rule_id rid, uint64_t *sub_cnt,
-                                  std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
+                                  Prp_event_list &loc_list);
+
+  void close_loc_list(Prp_event_list &loc_list, size_t loc_mark, uint64_t sub_cnt, Rule_id rule) const;
+  bool memo_hit(Rule_id rule, Prp_event_list &loc_list, size_t loc_mark, int64_t &memo_idx, bool &result);
+  void memo_store(int64_t memo_idx, const Prp_event_list &loc_list, size_t loc_mark, bool result);
+  void memo_clear();
+  void loc_list_truncate(Prp_event_list &loc_list, size_t size);
 
   void ast_handler();
-  void ast_builder(std::list<std::tuple<Rule_id, Token_entry>> &passed_list);
+  void ast_builder(Prp_event_list &passed_list);
 
 #ifdef DEBUG_AST
-  void print_loc_list(std::list<std::tuple<Rule_id, Token_entry>> &loc_list);
+  void print_loc_list(Prp_event_list &loc_list);
   void print_rule_call_stack();
 #endif
 
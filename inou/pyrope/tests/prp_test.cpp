@@ -3,9 +3,23 @@
 #include "prp.hpp"
 
 #include <stdio.h>
+#include <sys/resource.h>
 
 #include "lbench.hpp"
 
+// Parse time, peak RSS and packrat memo statistics (events moved to the memo
+// on backtracking vs events replayed from it)
+class Prp_stats : public Prp {
+public:
+  void print_stats() const {
+    fmt::print("memo hits:{} misses:{} events saved:{} replayed:{}\n",
+               debug_stat.memo_hits,
+               debug_stat.memo_misses,
+               debug_stat.memo_events_saved,
+               debug_stat.memo_events_replayed);
+  }
+};
+
 int main(int argc, char **argv) {
   if (argc != 2) {
     printf("Usage: %s file\n", argv[0]);
@@ -14,9 +28,15 @@ int main(int argc, char **argv) {
 
   Lbench bench("inou.PYROPE_prp");
 
-  Prp scanner;
+  Prp_stats scanner;
 
   scanner.parse_file(mmap_lib::str(argv[1]));
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fmt::print("parse secs:{:.3f} peak_rss:{}KB\n", bench.get_secs(), usage.ru_maxrss);
+  scanner.print_stats();
+
   scanner.ast_dump(mmap_lib::Tree_index::root());
 
   return 0;
@@ -14,7 +14,7 @@ public:
       patch_pass(pyrope_keyword);
 
       ast = std::make_unique<Ast_parser>(get_memblock(), Prp_rule);
-      std::list<std::tuple<Rule_id, Token_entry>> loc_list;
+      Prp_event_list loc_list;
       gen_ws_map();
 
       int      failed  = 0;
@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <cassert>
+#include <vector>
 
 // Base-inline lop use by dlop and slop
 
@@ -34,11 +35,16 @@ public:
   static void addn(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t *src2) {
     assert(dest_sz>=1);
 
-    uint64_t carry = __builtin_uaddll_overflow(src1[0], src2[0], reinterpret_cast<unsigned long long*>(dest));
+    // results go through a local, gcc miscomputes the carry when dest aliases src1
+    using ull = unsigned long long;
+    ull      res;
+    uint64_t carry = __builtin_uaddll_overflow(src1[0], src2[0], &res);
+    dest[0]        = res;
     for(auto i=1u;i<dest_sz-1;++i) {
-      unsigned long long tmp;
+      ull tmp;
       carry =  __builtin_uaddll_overflow(src1[i], carry, &tmp);
-      carry |= __builtin_uaddll_overflow(tmp, src2[i], reinterpret_cast<unsigned long long*>(dest + i));
+      carry |= __builtin_uaddll_overflow(tmp, src2[i], &res);
+      dest[i] = res;
     }
     assert(carry == 0 || carry == 1);
     dest[dest_sz-1] = src1[dest_sz-1] + src2[dest_sz-1] + carry;
@@ -57,11 +63,16 @@ public:
   static void subn(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t *src2) {
     assert(dest_sz>=1);
 
-    uint64_t carry = __builtin_usubll_overflow(src1[0], src2[0], reinterpret_cast<unsigned long long*>(dest));
+    // results go through a local, gcc miscomputes the carry when dest aliases src1
+    using ull = unsigned long long;
+    ull      res;
+    uint64_t carry = __builtin_usubll_overflow(src1[0], src2[0], &res);
+    dest[0]        = res;
     for(auto i=1u;i<dest_sz-1;++i) {
-      unsigned long long tmp;
+      ull tmp;
       carry =  __builtin_usubll_overflow(src1[i], carry, &tmp);
-      carry |= __builtin_usubll_overflow(tmp, src2[i], reinterpret_cast<unsigned long long*>(dest + i));
+      carry |= __builtin_usubll_overflow(tmp, src2[i], &res);
+      dest[i] = res;
     }
     assert(carry == 0 || carry == 1);
     dest[dest_sz-1] = src1[dest_sz-1] - src2[dest_sz-1] - carry;
@@ -139,6 +150,22 @@ public:
     }
   }
 
+  // shrn that also sign-fills the upper word_down words (arithmetic shift)
+  static void sran(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t src2) {
+    assert(dest_sz>=1);
+    assert(src2>=0);
+
+    uint64_t word_down = src2 / 64;
+    assert(word_down<dest_sz);
+
+    const int64_t sign = src1[dest_sz-1] < 0 ? -1 : 0;  // read before dest (may be src1) is updated
+
+    shrn(dest, dest_sz, src1, src2);
+    for (auto i = dest_sz - word_down; i < dest_sz; ++i) {
+      dest[i] = sign;
+    }
+  }
+
   //---------------------------------------------------------------------------
   // OR
   //---------------------------------------------------------------------------
@@ -165,6 +192,77 @@ public:
     }
   }
 
+  //---------------------------------------------------------------------------
+  // AND
+  //---------------------------------------------------------------------------
+  static void and8(int8_t &dest, const int8_t src1, const int8_t src2) {
+    dest = src1 & src2;
+  }
+  static void and64(int64_t &dest, const int64_t src1, const int64_t src2) {
+    dest = src1 & src2;
+  }
+
+  static void andn(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t *src2) {
+    assert(dest_sz>=1);
+    for (auto i = 0u; i < dest_sz; i++) {
+      dest[i] = src1[i] & src2[i];
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // XOR
+  //---------------------------------------------------------------------------
+  static void xor8(int8_t &dest, const int8_t src1, const int8_t src2) {
+    dest = src1 ^ src2;
+  }
+  static void xor64(int64_t &dest, const int64_t src1, const int64_t src2) {
+    dest = src1 ^ src2;
+  }
+
+  static void xorn(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t *src2) {
+    assert(dest_sz>=1);
+    for (auto i = 0u; i < dest_sz; i++) {
+      dest[i] = src1[i] ^ src2[i];
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // NOT
+  //---------------------------------------------------------------------------
+  static void not64(int64_t &dest, const int64_t src1) {
+    dest = ~src1;
+  }
+
+  static void notn(int64_t *dest, size_t dest_sz, const int64_t *src1) {
+    assert(dest_sz>=1);
+    for (auto i = 0u; i < dest_sz; i++) {
+      dest[i] = ~src1[i];
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // COMPARE (signed, same size)
+  //---------------------------------------------------------------------------
+  static bool eqn(const int64_t *src1, const int64_t *src2, size_t sz) {
+    assert(sz>=1);
+    for (auto i = 0u; i < sz; i++) {
+      if (src1[i] != src2[i])
+        return false;
+    }
+    return true;
+  }
+
+  static bool ltn(const int64_t *src1, const int64_t *src2, size_t sz) {
+    assert(sz>=1);
+    if (src1[sz-1] != src2[sz-1])
+      return src1[sz-1] < src2[sz-1];
+    for (int i = sz-2; i >= 0; --i) {
+      if (src1[i] != src2[i])
+        return static_cast<uint64_t>(src1[i]) < static_cast<uint64_t>(src2[i]);
+    }
+    return false;
+  }
+
   //---------------------------------------------------------------------------
   // MULT
   //---------------------------------------------------------------------------
@@ -175,19 +273,35 @@ public:
     dest = src1 * src2;
   }
 
+  // Two's complement product truncated to dest_sz words (src1/src2 are
+  // dest_sz words sign extended). dest can not be src1 or src2.
   static void multn(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t *src2) {
-    (void)dest;
-    (void)dest_sz;
-    (void)src1;
-    (void)src2;
-    assert(false);
+    assert(dest_sz>=1);
+    assert(dest != src1 && dest != src2);
+
+    for (auto i = 0u; i < dest_sz; i++) {
+      dest[i] = 0;
+    }
+
+    for (auto i = 0u; i < dest_sz; i++) {
+      unsigned __int128 carry = 0;
+      for (auto j = 0u; i + j < dest_sz; j++) {
+        unsigned __int128 tmp = static_cast<unsigned __int128>(static_cast<uint64_t>(src1[i]))
+                                * static_cast<uint64_t>(src2[j]);
+        tmp += static_cast<uint64_t>(dest[i + j]);
+        tmp += carry;
+        dest[i + j] = static_cast<int64_t>(static_cast<uint64_t>(tmp));
+        carry       = tmp >> 64;
+      }
+    }
   }
 
   static void multn(int64_t *dest, size_t dest_sz, const int64_t *src1, const int64_t src2) {
-    (void)dest;
-    (void)dest_sz;
-    (void)src1;
-    (void)src2;
-    assert(false);
+    std::vector<int64_t> tmp(2 * dest_sz);  // src1 copy (dest can be src1 in Dlop::mult_base) and src2
+    for (auto i = 0u; i < dest_sz; i++) {
+      tmp[i] = src1[i];
+    }
+    extend(tmp.data() + dest_sz, dest_sz, src2);
+    multn(dest, dest_sz, tmp.data(), tmp.data() + dest_sz);
   }
 };
@@ -0,0 +1,945 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "emu_program.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "blop.hpp"
+#include "fmt/format.h"
+
+uint32_t Emu_program::add_var(uint16_t bits) {
+  assert(bits > 0);
+
+  Var v;
+  v.offset = state.size();
+  v.words  = (bits + 63) / 64;
+  v.bits   = bits;
+
+  state.resize(state.size() + v.words, 0);
+  vars.emplace_back(v);
+
+  if (scratch.size() < n_scratch * v.words)
+    scratch.resize(n_scratch * v.words);
+
+  return vars.size() - 1;
+}
+
+uint32_t Emu_program::add_const(const Lconst &v, uint16_t bits) {
+  if (bits == 0)
+    bits = std::max<Bits_t>(v.get_bits(), 1);
+
+  auto var = add_var(bits);
+  set(var, v);
+
+  return var;
+}
+
+uint32_t Emu_program::add_memory(uint32_t bits, uint32_t size) {
+  assert(bits > 0);
+
+  auto &mem = memories.emplace_back();
+  mem.bits  = bits;
+  mem.size  = size;
+  mem.words = (bits + 63) / 64;
+  mem.data.resize(static_cast<size_t>(size) * mem.words, 0);
+
+  return memories.size() - 1;
+}
+
+void Emu_program::add_inst(Op op, uint32_t dst, const std::vector<Arg> &inst_args) {
+  assert(dst < vars.size());
+
+  Inst inst;
+  inst.op        = op;
+  inst.dst       = dst;
+  inst.arg_begin = args.size();
+  inst.aux       = 0;
+  inst.wide      = vars[dst].words > 1;
+
+  for (const auto &a : inst_args) {
+    assert(a.var < vars.size());
+    inst.wide |= vars[a.var].words > 1;
+    args.emplace_back(a);
+  }
+  inst.arg_end = args.size();
+
+  insts.emplace_back(inst);
+  levelized = false;
+}
+
+void Emu_program::to_words(const Lconst &v, int64_t *dest, size_t sz) {
+  if (v.is_string() || v.has_unknowns()) {  // no x in the emulator, use zero
+    Blop::extend(dest, sz, 0);
+    return;
+  }
+
+  auto num = v.get_num();
+  if (num < 0)
+    num += Lconst::Number(1) << (64 * sz);
+
+  for (auto i = 0u; i < sz; ++i) {
+    dest[i] = static_cast<int64_t>(static_cast<uint64_t>(num & Lconst::Number(std::numeric_limits<uint64_t>::max())));
+    num >>= 64;
+  }
+}
+
+void Emu_program::add_get_mask(uint32_t dst, uint32_t a, const Lconst &mask) {
+  add_inst(Op::Get_mask, dst, {{a, 0}});
+  insts.back().aux = masks.size();
+
+  // a negative mask selects all the upper bits of a (sign extended)
+  uint32_t limit = mask.get_bits();
+  if (mask.is_negative())
+    limit = std::max<uint32_t>(limit, vars[a].bits);
+
+  size_t               sz = (limit + 63) / 64 + 1;
+  std::vector<int64_t> mask_words(sz);
+  to_words(mask, mask_words.data(), sz);
+
+  auto &m = masks.emplace_back();
+  for (auto i = 0u; i < limit; ++i) {
+    if ((mask_words[i / 64] >> (i & 63)) & 1)
+      m.positions.emplace_back(i);
+  }
+
+  m.range = m.positions.empty() || (m.positions.back() - m.positions.front() + 1) == m.positions.size();
+  m.begin = m.positions.empty() ? 0 : m.positions.front();
+  m.end   = m.positions.empty() ? 0 : m.positions.back() + 1;
+}
+
+void Emu_program::add_set_mask(uint32_t dst, uint32_t a, const Lconst &mask, uint32_t value) {
+  add_inst(Op::Set_mask, dst, {{a, 0}, {value, 4}});
+  insts.back().aux = masks.size();
+
+  // a negative mask sets all the upper bits from value
+  uint32_t limit = mask.get_bits();
+  if (mask.is_negative())
+    limit = std::max<uint32_t>({limit, vars[a].bits, vars[dst].bits});
+
+  size_t               sz = (limit + 63) / 64 + 1;
+  std::vector<int64_t> mask_words(sz);
+  to_words(mask, mask_words.data(), sz);
+
+  auto &m = masks.emplace_back();
+  for (auto i = 0u; i < limit; ++i) {
+    if ((mask_words[i / 64] >> (i & 63)) & 1)
+      m.positions.emplace_back(i);
+  }
+
+  m.range = m.positions.empty() || (m.positions.back() - m.positions.front() + 1) == m.positions.size();
+  m.begin = m.positions.empty() ? 0 : m.positions.front();
+  m.end   = m.positions.empty() ? 0 : m.positions.back() + 1;
+  if (mask.is_negative() && m.range)
+    m.end = std::numeric_limits<uint32_t>::max();
+}
+
+void Emu_program::add_flop(uint32_t q, uint32_t din, uint32_t enable, uint32_t reset, uint32_t initial, bool negreset) {
+  assert(q < vars.size() && din < vars.size());
+
+  Flop f;
+  f.q        = q;
+  f.din      = din;
+  f.enable   = enable;
+  f.reset    = reset;
+  f.initial  = initial;
+  f.negreset = negreset;
+  f.next     = next_state.size();
+
+  next_state.resize(next_state.size() + vars[q].words, 0);
+  flops.emplace_back(f);
+}
+
+void Emu_program::add_mem_read(uint32_t mem, uint32_t dout, uint32_t addr, uint32_t enable, bool sync, bool fwd) {
+  assert(mem < memories.size());
+
+  if (!sync) {
+    std::vector<Arg> rd_args{{addr, 0}};
+    for (const auto &w : writes) {
+      if (!fwd || w.mem != mem)
+        continue;
+      rd_args.push_back({w.addr, 1});
+      rd_args.push_back({w.data, 2});
+      if (w.enable != invalid_var)
+        rd_args.push_back({w.enable, 3});
+    }
+    add_inst(Op::Mem_rd, dout, rd_args);
+    insts.back().aux = mem;
+    return;
+  }
+
+  Mem_port p;
+  p.mem    = mem;
+  p.addr   = addr;
+  p.data   = dout;
+  p.enable = enable;
+  p.next   = next_state.size();
+  p.fwd    = fwd;
+
+  next_state.resize(next_state.size() + vars[dout].words, 0);
+  sync_reads.emplace_back(p);
+}
+
+void Emu_program::add_mem_write(uint32_t mem, uint32_t addr, uint32_t din, uint32_t enable) {
+  assert(mem < memories.size());
+
+  Mem_port p;
+  p.mem    = mem;
+  p.addr   = addr;
+  p.data   = din;
+  p.enable = enable;
+  p.next   = 0;
+  p.fwd    = false;
+
+  writes.emplace_back(p);
+}
+
+void Emu_program::levelize() {
+  std::vector<uint32_t> producer(vars.size(), std::numeric_limits<uint32_t>::max());
+  for (auto i = 0u; i < insts.size(); ++i) {
+    auto &p = producer[insts[i].dst];
+    if (p != std::numeric_limits<uint32_t>::max())
+      throw std::runtime_error(fmt::format("ERROR: emulator var {} has multiple drivers", insts[i].dst));
+    p = i;
+  }
+
+  std::vector<uint32_t>              n_pending(insts.size(), 0);
+  std::vector<std::vector<uint32_t>> consumers(insts.size());
+  for (auto i = 0u; i < insts.size(); ++i) {
+    for (auto j = insts[i].arg_begin; j < insts[i].arg_end; ++j) {
+      auto p = producer[args[j].var];
+      if (p == std::numeric_limits<uint32_t>::max())
+        continue;
+      consumers[p].emplace_back(i);
+      ++n_pending[i];
+    }
+  }
+
+  std::vector<uint32_t> order;
+  order.reserve(insts.size());
+  for (auto i = 0u; i < insts.size(); ++i) {
+    if (n_pending[i] == 0)
+      order.emplace_back(i);
+  }
+  for (auto pos = 0u; pos < order.size(); ++pos) {
+    for (auto c : consumers[order[pos]]) {
+      if (--n_pending[c] == 0)
+        order.emplace_back(c);
+    }
+  }
+
+  if (order.size() != insts.size()) {
+    for (auto i = 0u; i < insts.size(); ++i) {
+      if (n_pending[i])
+        throw std::runtime_error(fmt::format("ERROR: emulator combinational loop through var {}", insts[i].dst));
+    }
+  }
+
+  std::vector<Inst> sorted;
+  sorted.reserve(insts.size());
+  for (auto i : order) {
+    sorted.emplace_back(insts[i]);
+  }
+  insts.swap(sorted);
+
+  levelized = true;
+}
+
+void Emu_program::load(uint32_t var, int64_t *dest, size_t dest_sz) const {
+  const auto &v   = vars[var];
+  const auto *src = &state[v.offset];
+
+  auto n = std::min<size_t>(v.words, dest_sz);
+  for (auto i = 0u; i < n; ++i) {
+    dest[i] = src[i];
+  }
+  const int64_t sign = src[v.words - 1] < 0 ? -1 : 0;
+  for (auto i = n; i < dest_sz; ++i) {
+    dest[i] = sign;
+  }
+}
+
+void Emu_program::store(uint32_t var, const int64_t *src, size_t src_sz) {
+  const auto &v    = vars[var];
+  auto       *dest = &state[v.offset];
+
+  auto n = std::min<size_t>(v.words, src_sz);
+  for (auto i = 0u; i < n; ++i) {
+    dest[i] = src[i];
+  }
+  const int64_t sign = src[src_sz - 1] < 0 ? -1 : 0;
+  for (auto i = n; i < v.words; ++i) {
+    dest[i] = sign;
+  }
+
+  wrap(var);
+}
+
+void Emu_program::wrap(uint32_t var) {
+  const auto &v     = vars[var];
+  auto        extra = 64 * v.words - v.bits;
+  if (extra == 0)
+    return;
+
+  auto &top = state[v.offset + v.words - 1];
+  top       = static_cast<int64_t>(static_cast<uint64_t>(top) << extra) >> extra;
+}
+
+bool Emu_program::is_true(uint32_t var) const {
+  const auto &v = vars[var];
+  for (auto i = 0u; i < v.words; ++i) {
+    if (state[v.offset + i])
+      return true;
+  }
+  return false;
+}
+
+uint64_t Emu_program::get_index(uint32_t var) const {
+  const auto &v = vars[var];
+  if (v.words > 1) {
+    for (auto i = 1u; i < v.words; ++i) {
+      if (state[v.offset + i])
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(state[v.offset]);
+  }
+
+  auto val = static_cast<uint64_t>(state[v.offset]);
+  if (v.bits < 64)
+    val &= (uint64_t(1) << v.bits) - 1;
+  return val;
+}
+
+void Emu_program::set(uint32_t var, int64_t val) {
+  const auto &v = vars[var];
+  Blop::extend(&state[v.offset], v.words, val);
+  wrap(var);
+}
+
+void Emu_program::set(uint32_t var, const Lconst &val) {
+  const auto &v = vars[var];
+  to_words(val, &state[v.offset], v.words);
+  wrap(var);
+}
+
+int64_t Emu_program::get(uint32_t var) const { return get64(var); }
+
+Lconst Emu_program::get_lconst(uint32_t var) const {
+  const auto &v = vars[var];
+
+  Lconst::Number num;
+  for (int i = v.words - 1; i >= 0; --i) {
+    num <<= 64;
+    num |= static_cast<uint64_t>(state[v.offset + i]);
+  }
+  if (state[v.offset + v.words - 1] < 0)
+    num -= Lconst::Number(1) << (64 * v.words);
+
+  return Lconst(num);
+}
+
+void Emu_program::run_mask(const Inst &inst, const int64_t *a, const int64_t *value, int64_t *dest, size_t sz) const {
+  const auto &m      = masks[inst.aux];
+  const auto  n_bits = 64 * sz;
+
+  auto get_bit = [n_bits](const int64_t *src, size_t sz2, uint64_t pos) -> int64_t {
+    if (pos >= n_bits)
+      return src[sz2 - 1] < 0 ? 1 : 0;
+    return (src[pos / 64] >> (pos & 63)) & 1;
+  };
+
+  if (inst.op == Op::Get_mask) {
+    Blop::extend(dest, sz, 0);
+
+    if (m.range && sz == 1) {
+      auto width = m.end - m.begin;
+      if (width == 0)
+        return;
+      int64_t v = m.begin >= 64 ? (a[0] >> 63) : (a[0] >> m.begin);
+      if (width < 64)
+        v &= (int64_t(1) << width) - 1;
+      dest[0] = v;
+      return;
+    }
+
+    for (auto k = 0u; k < m.positions.size() && k < n_bits; ++k) {
+      if (get_bit(a, sz, m.positions[k]))
+        dest[k / 64] |= int64_t(1) << (k & 63);
+    }
+    return;
+  }
+
+  assert(inst.op == Op::Set_mask);
+  for (auto i = 0u; i < sz; ++i) {
+    dest[i] = a[i];
+  }
+
+  if (m.range) {
+    auto end = std::min<uint64_t>(m.end, n_bits);
+    if (sz == 1 && m.begin < 64) {
+      auto     width = end - m.begin;
+      uint64_t bits  = width >= 64 ? ~uint64_t(0) : ((uint64_t(1) << width) - 1);
+      uint64_t mask  = bits << m.begin;
+      dest[0]        = static_cast<int64_t>((static_cast<uint64_t>(a[0]) & ~mask) | ((static_cast<uint64_t>(value[0]) << m.begin) & mask));
+      return;
+    }
+    for (auto pos = static_cast<uint64_t>(m.begin); pos < end; ++pos) {
+      auto b = get_bit(value, sz, pos - m.begin);
+      if (b)
+        dest[pos / 64] |= int64_t(1) << (pos & 63);
+      else
+        dest[pos / 64] &= ~(int64_t(1) << (pos & 63));
+    }
+    return;
+  }
+
+  for (auto k = 0u; k < m.positions.size(); ++k) {
+    auto pos = m.positions[k];
+    if (pos >= n_bits)
+      break;
+    if (get_bit(value, sz, k))
+      dest[pos / 64] |= int64_t(1) << (pos & 63);
+    else
+      dest[pos / 64] &= ~(int64_t(1) << (pos & 63));
+  }
+}
+
+void Emu_program::run_mem(const Inst &inst) {
+  const auto &mem  = memories[inst.aux];
+  auto        addr = get_index(args[inst.arg_begin].var);
+
+  auto data = fwd_data(inst, addr);
+  if (data != invalid_var) {
+    auto  words = vars[inst.dst].words;
+    auto *tmp   = scratch.data();
+    load(data, tmp, words);
+    store(inst.dst, tmp, words);
+    return;
+  }
+
+  if (addr >= mem.size) {
+    set(inst.dst, 0);
+    return;
+  }
+
+  store(inst.dst, &mem.data[addr * mem.words], mem.words);
+}
+
+uint32_t Emu_program::fwd_data(const Inst &inst, uint64_t addr) const {
+  uint32_t data = invalid_var;
+  for (auto j = inst.arg_begin + 1; j < inst.arg_end;) {
+    assert(args[j].pid == 1 && j + 1 < inst.arg_end);
+    auto wr_addr = args[j].var;
+    auto wr_din  = args[j + 1].var;
+    j += 2;
+
+    bool enabled = true;
+    if (j < inst.arg_end && args[j].pid == 3) {
+      enabled = is_true(args[j].var);
+      ++j;
+    }
+    if (enabled && get_index(wr_addr) == addr)
+      data = wr_din;
+  }
+
+  return data;
+}
+
+// the array is cleared every cycle, the last enabled write port wins
+void Emu_program::run_array(const Inst &inst) {
+  auto data = fwd_data(inst, get_index(args[inst.arg_begin].var));
+  if (data == invalid_var) {
+    set(inst.dst, 0);
+    return;
+  }
+
+  auto  words = vars[inst.dst].words;
+  auto *tmp   = scratch.data();
+  load(data, tmp, words);
+  store(inst.dst, tmp, words);
+}
+
+void Emu_program::run64(const Inst &inst) {
+  const Arg *a = &args[inst.arg_begin];
+  const Arg *e = &args[inst.arg_end];
+
+  int64_t res = 0;
+  switch (inst.op) {
+    case Op::Copy: res = get64(a->var); break;
+    case Op::Sum: {
+      uint64_t acc = 0;
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          acc += static_cast<uint64_t>(get64(a->var));
+        else
+          acc -= static_cast<uint64_t>(get64(a->var));
+      }
+      res = static_cast<int64_t>(acc);
+    } break;
+    case Op::Mult: {
+      uint64_t acc = 1;
+      for (; a != e; ++a) {
+        acc *= static_cast<uint64_t>(get64(a->var));
+      }
+      res = static_cast<int64_t>(acc);
+    } break;
+    case Op::Div: {
+      int64_t lhs = 0;
+      int64_t rhs = 0;
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          lhs = get64(a->var);
+        else
+          rhs = get64(a->var);
+      }
+      if (rhs == 0)
+        res = 0;
+      else if (rhs == -1)
+        res = static_cast<int64_t>(0 - static_cast<uint64_t>(lhs));
+      else
+        res = lhs / rhs;
+    } break;
+    case Op::And:
+      res = -1;
+      for (; a != e; ++a) {
+        Blop::and64(res, res, get64(a->var));
+      }
+      break;
+    case Op::Or:
+      for (; a != e; ++a) {
+        Blop::or64(res, res, get64(a->var));
+      }
+      break;
+    case Op::Xor:
+      for (; a != e; ++a) {
+        Blop::xor64(res, res, get64(a->var));
+      }
+      break;
+    case Op::Ror:
+      for (; a != e; ++a) {
+        if (get64(a->var)) {
+          res = 1;
+          break;
+        }
+      }
+      break;
+    case Op::Not: Blop::not64(res, get64(a->var)); break;
+    case Op::LT:
+    case Op::GT: {
+      res = 1;
+      for (auto *l = a; l != e && res; ++l) {
+        if (l->pid != 0)
+          continue;
+        for (auto *r = a; r != e; ++r) {
+          if (r->pid == 0)
+            continue;
+          bool ok = inst.op == Op::LT ? get64(l->var) < get64(r->var) : get64(l->var) > get64(r->var);
+          if (!ok) {
+            res = 0;
+            break;
+          }
+        }
+      }
+    } break;
+    case Op::EQ: {
+      res        = 1;
+      auto first = get64(a->var);
+      for (++a; a != e; ++a) {
+        if (get64(a->var) != first) {
+          res = 0;
+          break;
+        }
+      }
+    } break;
+    case Op::SHL: {
+      int64_t val = 0;
+      for (auto *i = a; i != e; ++i) {
+        if (i->pid == 0)
+          val = get64(i->var);
+      }
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          continue;
+        auto amt = get_index(a->var);
+        if (amt < 64)
+          res |= static_cast<int64_t>(static_cast<uint64_t>(val) << amt);
+      }
+    } break;
+    case Op::SRA:
+    case Op::Sext: {
+      int64_t  val = 0;
+      uint64_t amt = 0;
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          val = get64(a->var);
+        else
+          amt = get_index(a->var);
+      }
+      if (inst.op == Op::SRA) {
+        res = amt >= 64 ? (val >> 63) : (val >> amt);
+      } else if (amt >= 63) {
+        res = val;
+      } else {
+        auto sa = 63 - amt;
+        res     = static_cast<int64_t>(static_cast<uint64_t>(val) << sa) >> sa;
+      }
+    } break;
+    case Op::Get_mask:
+    case Op::Set_mask: {
+      int64_t val   = 0;
+      int64_t value = 0;
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          val = get64(a->var);
+        else
+          value = get64(a->var);
+      }
+      run_mask(inst, &val, &value, &res, 1);
+    } break;
+    case Op::Mux: {
+      uint64_t sel = 0;
+      for (auto *i = a; i != e; ++i) {
+        if (i->pid == 0)
+          sel = get_index(i->var);
+      }
+      for (; a != e; ++a) {
+        if (a->pid != 0 && a->pid == sel + 1) {
+          res = get64(a->var);
+          break;
+        }
+      }
+    } break;
+    default: assert(false);
+  }
+
+  state[vars[inst.dst].offset] = res;
+  wrap(inst.dst);
+}
+
+// shift-subtract on the magnitudes, rounds toward zero like the 64-bit path
+void Emu_program::div_wide(int64_t *dest, size_t sz, const int64_t *a, const int64_t *b, int64_t *work) {
+  auto *zero = work;
+  auto *num  = work + sz;
+  auto *den  = work + 2 * sz;
+  auto *rem  = work + 3 * sz;
+  Blop::extend(zero, sz, 0);
+
+  Blop::extend(dest, sz, 0);
+  if (Blop::eqn(b, zero, sz))
+    return;
+
+  bool a_neg = a[sz - 1] < 0;
+  bool b_neg = b[sz - 1] < 0;
+  if (a_neg)
+    Blop::subn(num, sz, zero, a);
+  else
+    std::copy(a, a + sz, num);
+  if (b_neg)
+    Blop::subn(den, sz, zero, b);
+  else
+    std::copy(b, b + sz, den);
+
+  Blop::extend(rem, sz, 0);
+  for (int i = 64 * sz - 1; i >= 0; --i) {
+    Blop::shln(rem, sz, rem, 1);
+    rem[0] |= (static_cast<uint64_t>(num[i / 64]) >> (i & 63)) & 1;
+
+    // unsigned rem >= den
+    bool ge = true;
+    for (int w = sz - 1; w >= 0; --w) {
+      if (rem[w] != den[w]) {
+        ge = static_cast<uint64_t>(rem[w]) > static_cast<uint64_t>(den[w]);
+        break;
+      }
+    }
+    if (ge) {
+      Blop::subn(rem, sz, rem, den);
+      dest[i / 64] |= int64_t(1) << (i & 63);
+    }
+  }
+
+  if (a_neg != b_neg)
+    Blop::subn(dest, sz, zero, dest);
+}
+
+void Emu_program::run_wide(const Inst &inst) {
+  size_t sz = vars[inst.dst].words;
+  for (auto j = inst.arg_begin; j < inst.arg_end; ++j) {
+    sz = std::max<size_t>(sz, vars[args[j].var].words);
+  }
+
+  const Arg *a = &args[inst.arg_begin];
+  const Arg *e = &args[inst.arg_end];
+
+  auto *acc  = scratch.data();
+  auto *tmp  = acc + sz;
+  auto *tmp2 = tmp + sz;
+  Blop::extend(acc, sz, 0);
+
+  switch (inst.op) {
+    case Op::Copy: load(a->var, acc, sz); break;
+    case Op::Sum:
+      for (; a != e; ++a) {
+        load(a->var, tmp, sz);
+        if (a->pid == 0)
+          Blop::addn(acc, sz, acc, tmp);
+        else
+          Blop::subn(acc, sz, acc, tmp);
+      }
+      break;
+    case Op::Mult:
+      Blop::extend(acc, sz, 1);
+      for (; a != e; ++a) {
+        load(a->var, tmp, sz);
+        Blop::multn(tmp2, sz, acc, tmp);
+        std::copy(tmp2, tmp2 + sz, acc);
+      }
+      break;
+    case Op::Div:
+      Blop::extend(tmp, sz, 0);
+      Blop::extend(tmp2, sz, 0);
+      for (; a != e; ++a) {
+        load(a->var, a->pid == 0 ? tmp : tmp2, sz);
+      }
+      div_wide(acc, sz, tmp, tmp2, tmp2 + sz);
+      break;
+    case Op::And:
+      Blop::extend(acc, sz, -1);
+      for (; a != e; ++a) {
+        load(a->var, tmp, sz);
+        Blop::andn(acc, sz, acc, tmp);
+      }
+      break;
+    case Op::Or:
+      for (; a != e; ++a) {
+        load(a->var, tmp, sz);
+        Blop::orn(acc, sz, acc, tmp);
+      }
+      break;
+    case Op::Xor:
+      for (; a != e; ++a) {
+        load(a->var, tmp, sz);
+        Blop::xorn(acc, sz, acc, tmp);
+      }
+      break;
+    case Op::Ror:
+      for (; a != e; ++a) {
+        if (is_true(a->var)) {
+          acc[0] = 1;
+          break;
+        }
+      }
+      break;
+    case Op::Not:
+      load(a->var, tmp, sz);
+      Blop::notn(acc, sz, tmp);
+      break;
+    case Op::LT:
+    case Op::GT: {
+      bool ok = true;
+      for (auto *l = a; l != e && ok; ++l) {
+        if (l->pid != 0)
+          continue;
+        load(l->var, tmp, sz);
+        for (auto *r = a; r != e && ok; ++r) {
+          if (r->pid == 0)
+            continue;
+          load(r->var, tmp2, sz);
+          ok = inst.op == Op::LT ? Blop::ltn(tmp, tmp2, sz) : Blop::ltn(tmp2, tmp, sz);
+        }
+      }
+      acc[0] = ok ? 1 : 0;
+    } break;
+    case Op::EQ: {
+      bool ok = true;
+      load(a->var, tmp, sz);
+      for (++a; a != e && ok; ++a) {
+        load(a->var, tmp2, sz);
+        ok = Blop::eqn(tmp, tmp2, sz);
+      }
+      acc[0] = ok ? 1 : 0;
+    } break;
+    case Op::SHL:
+      Blop::extend(tmp2, sz, 0);
+      for (auto *i = a; i != e; ++i) {
+        if (i->pid == 0)
+          load(i->var, tmp2, sz);
+      }
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          continue;
+        auto amt = get_index(a->var);
+        if (amt >= 64 * sz)
+          continue;
+        Blop::shln(tmp, sz, tmp2, amt);
+        Blop::orn(acc, sz, acc, tmp);
+      }
+      break;
+    case Op::SRA:
+    case Op::Sext: {
+      uint64_t amt = 0;
+      Blop::extend(tmp, sz, 0);
+      for (; a != e; ++a) {
+        if (a->pid == 0)
+          load(a->var, tmp, sz);
+        else
+          amt = get_index(a->var);
+      }
+      if (inst.op == Op::SRA) {
+        if (amt >= 64 * sz)
+          Blop::extend(acc, sz, tmp[sz - 1] < 0 ? -1 : 0);
+        else
+          Blop::sran(acc, sz, tmp, amt);
+      } else if (amt >= 64 * sz - 1) {
+        std::copy(tmp, tmp + sz, acc);
+      } else {
+        auto sa = 64 * sz - 1 - amt;
+        Blop::shln(tmp2, sz, tmp, sa);
+        Blop::sran(acc, sz, tmp2, sa);
+      }
+    } break;
+    case Op::Get_mask:
+    case Op::Set_mask:
+      Blop::extend(tmp, sz, 0);
+      Blop::extend(tmp2, sz, 0);
+      for (; a != e; ++a) {
+        load(a->var, a->pid == 0 ? tmp : tmp2, sz);
+      }
+      run_mask(inst, tmp, tmp2, acc, sz);
+      break;
+    case Op::Mux: {
+      uint64_t sel = 0;
+      for (auto *i = a; i != e; ++i) {
+        if (i->pid == 0)
+          sel = get_index(i->var);
+      }
+      for (; a != e; ++a) {
+        if (a->pid != 0 && a->pid == sel + 1) {
+          load(a->var, acc, sz);
+          break;
+        }
+      }
+    } break;
+    default: assert(false);
+  }
+
+  store(inst.dst, acc, sz);
+}
+
+void Emu_program::run(const Inst &inst) {
+  if (inst.op == Op::Mem_rd)
+    run_mem(inst);
+  else if (inst.op == Op::Array_rd)
+    run_array(inst);
+  else if (inst.wide)
+    run_wide(inst);
+  else
+    run64(inst);
+}
+
+void Emu_program::reset_state() {
+  for (const auto &f : flops) {
+    if (f.initial != invalid_var) {
+      load(f.initial, scratch.data(), vars[f.q].words);
+      store(f.q, scratch.data(), vars[f.q].words);
+    } else {
+      set(f.q, 0);
+    }
+  }
+  for (const auto &p : sync_reads) {
+    set(p.data, 0);
+  }
+  for (auto &mem : memories) {
+    std::fill(mem.data.begin(), mem.data.end(), 0);
+  }
+  n_cycles = 0;
+}
+
+void Emu_program::cycle() {
+  if (!levelized)
+    levelize();
+
+  for (const auto &inst : insts) {
+    run(inst);
+  }
+
+  // clock edge: compute all the next values before updating any state
+  for (const auto &f : flops) {
+    auto  words = vars[f.q].words;
+    auto *next  = &next_state[f.next];
+    if (f.reset != invalid_var && is_true(f.reset) != f.negreset) {
+      if (f.initial != invalid_var)
+        load(f.initial, next, words);
+      else
+        Blop::extend(next, words, 0);
+    } else if (f.enable != invalid_var && !is_true(f.enable)) {
+      load(f.q, next, words);
+    } else {
+      load(f.din, next, words);
+    }
+  }
+
+  for (const auto &p : sync_reads) {
+    auto  words = vars[p.data].words;
+    auto *next  = &next_state[p.next];
+    if (p.enable != invalid_var && !is_true(p.enable)) {
+      load(p.data, next, words);
+      continue;
+    }
+    const auto &mem  = memories[p.mem];
+    auto        addr = get_index(p.addr);
+
+    uint32_t data = invalid_var;
+    for (const auto &w : writes) {  // the last enabled write port wins
+      if (!p.fwd || w.mem != p.mem || (w.enable != invalid_var && !is_true(w.enable)))
+        continue;
+      if (get_index(w.addr) == addr)
+        data = w.data;
+    }
+    if (data != invalid_var) {
+      load(data, next, words);
+      continue;
+    }
+
+    if (addr >= mem.size) {
+      Blop::extend(next, words, 0);
+      continue;
+    }
+    const auto *entry = &mem.data[addr * mem.words];
+    auto        n     = std::min<size_t>(words, mem.words);
+    std::copy(entry, entry + n, next);
+    for (auto i = n; i < words; ++i) {
+      next[i] = entry[mem.words - 1] < 0 ? -1 : 0;
+    }
+  }
+
+  for (const auto &p : writes) {
+    if (p.enable != invalid_var && !is_true(p.enable))
+      continue;
+    auto &mem  = memories[p.mem];
+    auto  addr = get_index(p.addr);
+    if (addr >= mem.size)
+      continue;
+
+    auto *entry = &mem.data[addr * mem.words];
+    load(p.data, entry, mem.words);
+    auto extra = 64 * mem.words - mem.bits;
+    if (extra)
+      entry[mem.words - 1] = static_cast<int64_t>(static_cast<uint64_t>(entry[mem.words - 1]) << extra) >> extra;
+  }
+
+  for (const auto &f : flops) {
+    store(f.q, &next_state[f.next], vars[f.q].words);
+  }
+  for (const auto &p : sync_reads) {
+    store(p.data, &next_state[p.next], vars[p.data].words);
+  }
+
+  ++n_cycles;
+}
+
+void Emu_program::cycles(uint64_t n) {
+  for (auto i = 0u; i < n; ++i) {
+    cycle();
+  }
+}
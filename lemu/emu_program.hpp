@@ -0,0 +1,171 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "lconst.hpp"
+
+// Dense bit-parallel emulator. A netlist is compiled to a flat array of
+// instructions over word vectors. Each variable is stored signed (two's
+// complement) in (bits+63)/64 words. Instructions with all the operands in a
+// single word use the 64-bit fast path, the rest use the Blop kernels.
+//
+// The instruction semantic follows the Lgraph cells (Ntype_op). The arg pid is
+// the Lgraph sink pid (Sum: 0 add 1 sub, Mux: 0 select 1.. options...).
+
+class Emu_program {
+public:
+  static constexpr uint32_t invalid_var = std::numeric_limits<uint32_t>::max();
+
+  enum class Op : uint8_t {
+    Copy,
+    Sum,
+    Mult,
+    Div,
+    And,
+    Or,
+    Xor,
+    Ror,
+    Not,
+    Get_mask,
+    Set_mask,
+    Sext,
+    LT,
+    GT,
+    EQ,
+    SHL,
+    SRA,
+    Mux,
+    Mem_rd,    // async read  : 0 addr, then with fwd the write ports like Array_rd
+    Array_rd,  // comb array: 0 addr, then per write port 1 addr, 2 din, 3 enable (optional)
+  };
+
+  struct Arg {
+    uint32_t var;
+    uint32_t pid;
+  };
+
+protected:
+  static constexpr size_t n_scratch = 7;  // run_wide acc/tmp/tmp2 + div_wide zero/num/den/rem
+
+  struct Var {
+    uint32_t offset;
+    uint16_t words;
+    uint16_t bits;
+  };
+
+  struct Inst {
+    Op       op;
+    bool     wide;  // some operand does not fit in 64 bits
+    uint32_t dst;
+    uint32_t arg_begin;
+    uint32_t arg_end;
+    uint32_t aux;  // mask or memory id
+  };
+
+  struct Mask {
+    std::vector<uint32_t> positions;  // bits selected (ascending)
+    uint32_t              begin;
+    uint32_t              end;
+    bool                  range;  // positions == [begin,end)
+  };
+
+  struct Flop {
+    uint32_t q;
+    uint32_t din;
+    uint32_t enable;   // invalid_var if always enabled
+    uint32_t reset;    // invalid_var if no reset
+    uint32_t initial;  // invalid_var for zero
+    bool     negreset;
+    uint32_t next;  // offset in next_state
+  };
+
+  struct Memory {
+    uint32_t             bits;
+    uint32_t             size;
+    uint32_t             words;  // per entry
+    std::vector<int64_t> data;
+  };
+
+  struct Mem_port {
+    uint32_t mem;
+    uint32_t addr;
+    uint32_t data;    // din for writes, dout for sync reads
+    uint32_t enable;  // invalid_var if always enabled
+    uint32_t next;    // offset in next_state (sync reads)
+    bool     fwd;     // sync reads: a same cycle write to addr is read
+  };
+
+  std::vector<Var>      vars;
+  std::vector<int64_t>  state;
+  std::vector<int64_t>  next_state;
+  std::vector<Inst>     insts;
+  std::vector<Arg>      args;
+  std::vector<Mask>     masks;
+  std::vector<Flop>     flops;
+  std::vector<Memory>   memories;
+  std::vector<Mem_port> sync_reads;
+  std::vector<Mem_port> writes;
+  std::vector<int64_t>  scratch;  // n_scratch x the widest var words, temporaries of the wide path
+  bool                  levelized = false;
+  uint64_t              n_cycles  = 0;
+
+  const int64_t *ref(uint32_t var) const { return &state[vars[var].offset]; }
+  int64_t       *ref(uint32_t var) { return &state[vars[var].offset]; }
+  int64_t        get64(uint32_t var) const { return state[vars[var].offset]; }
+
+  void load(uint32_t var, int64_t *dest, size_t dest_sz) const;  // sign extend to dest_sz
+  void store(uint32_t var, const int64_t *src, size_t src_sz);    // truncate/extend + wrap to bits
+  void wrap(uint32_t var);
+
+  bool     is_true(uint32_t var) const;
+  uint64_t get_index(uint32_t var) const;  // unsigned value of the var bits (saturated)
+
+  void run(const Inst &inst);
+  void run64(const Inst &inst);
+  void run_wide(const Inst &inst);
+  void run_mask(const Inst &inst, const int64_t *a, const int64_t *value, int64_t *dest, size_t sz) const;
+  void     run_mem(const Inst &inst);
+  void     run_array(const Inst &inst);
+  uint32_t fwd_data(const Inst &inst, uint64_t addr) const;  // din of the last enabled write port to addr
+
+  static void to_words(const Lconst &v, int64_t *dest, size_t sz);
+  static void div_wide(int64_t *dest, size_t sz, const int64_t *a, const int64_t *b, int64_t *work);  // work: 4*sz
+
+public:
+  Emu_program() = default;
+
+  uint32_t add_var(uint16_t bits);
+  uint32_t add_const(const Lconst &v, uint16_t bits = 0);
+  uint32_t add_memory(uint32_t bits, uint32_t size);
+
+  void add_inst(Op op, uint32_t dst, const std::vector<Arg> &inst_args);
+  void add_get_mask(uint32_t dst, uint32_t a, const Lconst &mask);
+  void add_set_mask(uint32_t dst, uint32_t a, const Lconst &mask, uint32_t value);
+  void add_flop(uint32_t q, uint32_t din, uint32_t enable, uint32_t reset, uint32_t initial, bool negreset);
+  // with fwd, a write in the same cycle to the read addr is read (the write
+  // ports of mem must be added before)
+  void add_mem_read(uint32_t mem, uint32_t dout, uint32_t addr, uint32_t enable, bool sync, bool fwd = false);
+  void add_mem_write(uint32_t mem, uint32_t addr, uint32_t din, uint32_t enable);
+
+  // Sort the instructions in dependence order. Throws on combinational loops
+  void levelize();
+
+  void set(uint32_t var, int64_t v);
+  void set(uint32_t var, const Lconst &v);
+  int64_t get(uint32_t var) const;  // low word
+  Lconst  get_lconst(uint32_t var) const;
+  uint16_t get_bits(uint32_t var) const { return vars[var].bits; }
+
+  void     reset_state();  // flops/memories to zero (or initial)
+  void     cycle();
+  void     cycles(uint64_t n);
+  uint64_t get_cycles() const { return n_cycles; }
+
+  size_t get_num_insts() const { return insts.size(); }
+  size_t get_num_vars() const { return vars.size(); }
+  size_t get_num_flops() const { return flops.size(); }
+  size_t get_num_words() const { return state.size(); }
+};
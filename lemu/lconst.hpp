@@ -34,6 +34,8 @@ private:
          -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
 
 protected:
+  friend class Emu_program;
+
   using Number = boost::multiprecision::cpp_int;
 
   bool explicit_str;
@@ -83,3 +83,55 @@ TEST_F(Blop_test, dlop_from_pyrope) {
 
   c->dump();
 }
+
+TEST_F(Blop_test, mult) {
+
+  int64_t src1[3] = { -1, 0, 0};  // 2**64-1
+  int64_t src2[3] = { -1, 0, 0};
+
+  int64_t dst1[3];
+  Blop::multn(dst1, 3, src1, src2);  // 2**128 - 2**65 + 1
+
+  EXPECT_EQ(dst1[0], 1);
+  EXPECT_EQ(dst1[1], -2);
+  EXPECT_EQ(dst1[2], 0);
+
+  int64_t neg[3] = { -3, -1, -1};
+  Blop::multn(dst1, 3, neg, 5);
+
+  EXPECT_EQ(dst1[0], -15);
+  EXPECT_EQ(dst1[1], -1);
+  EXPECT_EQ(dst1[2], -1);
+}
+
+TEST_F(Blop_test, shr_sign) {
+
+  int64_t src1[3] = { 0, 7, -2};
+
+  int64_t dst1[3];
+  Blop::sran(dst1, 3, src1, 129);
+
+  EXPECT_EQ(dst1[0], -1);
+  EXPECT_EQ(dst1[1], -1);
+  EXPECT_EQ(dst1[2], -1);
+
+  Blop::sran(src1, 3, src1, 64);  // self update
+
+  EXPECT_EQ(src1[0], 7);
+  EXPECT_EQ(src1[1], -2);
+  EXPECT_EQ(src1[2], -1);
+
+  int64_t src2[3] = { 0, 7, -2};
+  int64_t dst2[3] = { 1, 2, 3};
+  Blop::shrn(dst2, 3, src2, 64);  // shrn does not write the upper words
+
+  EXPECT_EQ(dst2[0], 7);
+  EXPECT_EQ(dst2[1], -2);
+  EXPECT_EQ(dst2[2], 3);
+
+  int64_t a[2] = { 5, -1};
+  int64_t b[2] = { 6, -1};
+  EXPECT_TRUE(Blop::ltn(a, b, 2));
+  EXPECT_FALSE(Blop::ltn(b, a, 2));
+  EXPECT_TRUE(Blop::eqn(a, a, 2));
+}
@@ -0,0 +1,246 @@
+
+#include "emu_program.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "lconst.hpp"
+#include "lrand.hpp"
+
+class Emu_program_test : public ::testing::Test {
+protected:
+  Lrand<uint64_t> rng;
+
+  Lconst rand_lconst(int bits) {
+    Lconst v(0);
+    for (auto i = 0; i < bits; i += 32) {
+      v = v.lsh_op(32).or_op(Lconst(static_cast<int64_t>(rng.any() & 0xFFFFFFFF)));
+    }
+    return v.sext_op(bits - 1);
+  }
+
+public:
+  void TearDown() override { mmap_lib::str::nuke(); }
+
+  void SetUp() override { mmap_lib::str::setup(); };
+};
+
+TEST_F(Emu_program_test, counter) {
+  Emu_program emu;
+
+  auto q     = emu.add_var(8);
+  auto din   = emu.add_var(8);
+  auto one   = emu.add_const(Lconst(1));
+  auto reset = emu.add_var(1);
+
+  emu.add_inst(Emu_program::Op::Sum, din, {{q, 0}, {one, 0}});
+  emu.add_flop(q, din, Emu_program::invalid_var, reset, Emu_program::invalid_var, false);
+
+  emu.set(reset, -1);
+  emu.cycle();
+  EXPECT_EQ(emu.get(q), 0);
+
+  emu.set(reset, 0);
+  emu.cycles(100);
+  EXPECT_EQ(emu.get(q), 100);
+
+  emu.cycles(28);
+  EXPECT_EQ(emu.get(q), -128);  // signed 8 bits wraps around
+
+  EXPECT_EQ(emu.get_cycles(), 129);
+}
+
+TEST_F(Emu_program_test, wide_carry) {
+  Emu_program emu;
+
+  auto a   = emu.add_var(130);
+  auto b   = emu.add_var(130);
+  auto sum = emu.add_var(131);
+  auto lt  = emu.add_var(1);
+
+  emu.add_inst(Emu_program::Op::Sum, sum, {{a, 0}, {b, 0}});
+  emu.add_inst(Emu_program::Op::LT, lt, {{a, 0}, {b, 1}});
+
+  auto va = Lconst::from_pyrope("0xFFFF_FFFF_FFFF_FFFF_FFFF_FFFF_FFFF_FFFF");
+  auto vb = Lconst(1);
+  emu.set(a, va);
+  emu.set(b, vb);
+  emu.cycle();
+
+  EXPECT_EQ(emu.get_lconst(sum), va.add_op(vb));
+  EXPECT_EQ(emu.get(lt), 0);
+
+  emu.set(a, Lconst(-5));
+  emu.cycle();
+  EXPECT_EQ(emu.get_lconst(sum), Lconst(-4));
+  EXPECT_EQ(emu.get(lt), -1);
+}
+
+TEST_F(Emu_program_test, masks) {
+  Emu_program emu;
+
+  auto a    = emu.add_var(16);
+  auto val  = emu.add_var(8);
+  auto get1 = emu.add_var(8);
+  auto get2 = emu.add_var(8);
+  auto set1 = emu.add_var(16);
+  auto set2 = emu.add_var(16);
+
+  emu.add_get_mask(get1, a, Lconst(0xF0));
+  emu.add_get_mask(get2, a, Lconst(0x5));  // non-contiguous
+  emu.add_set_mask(set1, a, Lconst(0xF0), val);
+  emu.add_set_mask(set2, a, Lconst(0x5), val);
+
+  emu.set(a, 0x1234);
+  emu.set(val, 0x1);
+  emu.cycle();
+
+  EXPECT_EQ(emu.get(get1), 0x3);
+  EXPECT_EQ(emu.get(get2), 0x2);
+  EXPECT_EQ(emu.get(set1), 0x1214);
+  EXPECT_EQ(emu.get(set2), 0x1231);
+}
+
+TEST_F(Emu_program_test, memory) {
+  Emu_program emu;
+
+  auto mem    = emu.add_memory(70, 4);
+  auto wr_en  = emu.add_var(1);
+  auto addr   = emu.add_var(3);
+  auto din    = emu.add_var(70);
+  auto dout   = emu.add_var(70);
+  auto a_dout = emu.add_var(70);
+
+  emu.add_mem_write(mem, addr, din, wr_en);
+  emu.add_mem_read(mem, dout, addr, Emu_program::invalid_var, true);
+  emu.add_mem_read(mem, a_dout, addr, Emu_program::invalid_var, false);
+
+  emu.set(wr_en, -1);
+  for (auto i = 0; i < 4; ++i) {
+    emu.set(addr, i);
+    emu.set(din, Lconst(i + 1).lsh_op(66));
+    emu.cycle();
+  }
+
+  emu.set(wr_en, 0);
+  emu.set(addr, 2);
+  emu.cycle();
+  EXPECT_EQ(emu.get_lconst(a_dout), Lconst(3).lsh_op(66).sext_op(69));
+  EXPECT_EQ(emu.get_lconst(dout), Lconst(3).lsh_op(66).sext_op(69));
+
+  emu.set(addr, 5);  // out of range
+  emu.cycle();
+  EXPECT_EQ(emu.get(a_dout), 0);
+}
+
+TEST_F(Emu_program_test, memory_fwd) {
+  Emu_program emu;
+
+  auto mem     = emu.add_memory(8, 4);
+  auto wr_en   = emu.add_var(1);
+  auto wr_addr = emu.add_var(3);
+  auto rd_addr = emu.add_var(3);
+  auto din     = emu.add_var(8);
+  auto dout    = emu.add_var(8);
+  auto a_dout  = emu.add_var(8);
+  auto n_dout  = emu.add_var(8);
+
+  emu.add_mem_write(mem, wr_addr, din, wr_en);
+  emu.add_mem_read(mem, dout, rd_addr, Emu_program::invalid_var, true, true);
+  emu.add_mem_read(mem, a_dout, rd_addr, Emu_program::invalid_var, false, true);
+  emu.add_mem_read(mem, n_dout, rd_addr, Emu_program::invalid_var, false);
+
+  emu.set(wr_en, -1);
+  emu.set(wr_addr, 1);
+  emu.set(rd_addr, 1);
+  emu.set(din, 42);
+  emu.cycle();
+  EXPECT_EQ(emu.get(a_dout), 42);  // same cycle write is forwarded
+  EXPECT_EQ(emu.get(n_dout), 0);   // without fwd the old value is read
+  EXPECT_EQ(emu.get(dout), 42);    // latched at the edge with the forwarded value
+
+  emu.set(din, 7);
+  emu.set(rd_addr, 2);  // other address, no forwarding
+  emu.cycle();
+  EXPECT_EQ(emu.get(a_dout), 0);
+  EXPECT_EQ(emu.get(dout), 0);
+
+  emu.set(wr_en, 0);
+  emu.set(rd_addr, 1);
+  emu.cycle();
+  EXPECT_EQ(emu.get(a_dout), 7);  // written in the previous cycle
+  EXPECT_EQ(emu.get(n_dout), 7);
+}
+
+TEST_F(Emu_program_test, mux_and_loop) {
+  Emu_program emu;
+
+  auto sel = emu.add_var(2);
+  auto o1  = emu.add_const(Lconst(10));
+  auto o2  = emu.add_const(Lconst(20));
+  auto o3  = emu.add_const(Lconst(30));
+  auto out = emu.add_var(8);
+
+  emu.add_inst(Emu_program::Op::Mux, out, {{sel, 0}, {o1, 1}, {o2, 2}, {o3, 3}});
+
+  emu.set(sel, 1);
+  emu.cycle();
+  EXPECT_EQ(emu.get(out), 20);
+
+  emu.set(sel, -2);  // 2'b10
+  emu.cycle();
+  EXPECT_EQ(emu.get(out), 30);
+
+  emu.set(sel, -1);  // no option
+  emu.cycle();
+  EXPECT_EQ(emu.get(out), 0);
+
+  Emu_program loop;
+  auto        x = loop.add_var(4);
+  auto        y = loop.add_var(4);
+  loop.add_inst(Emu_program::Op::Not, x, {{y, 0}});
+  loop.add_inst(Emu_program::Op::Not, y, {{x, 0}});
+  EXPECT_THROW(loop.levelize(), std::runtime_error);
+}
+
+TEST_F(Emu_program_test, random_vs_lconst) {
+  for (auto n = 0; n < 2000; ++n) {
+    int bits = 1 + rng.max(200);
+
+    Emu_program emu;
+    auto        a    = emu.add_var(bits);
+    auto        b    = emu.add_var(bits);
+    auto        sum  = emu.add_var(bits + 1);
+    auto        sub  = emu.add_var(bits + 1);
+    auto        mult = emu.add_var(2 * bits);
+    auto        band = emu.add_var(bits);
+    auto        bor  = emu.add_var(bits);
+    auto        bnot = emu.add_var(bits);
+    auto        eq   = emu.add_var(1);
+
+    emu.add_inst(Emu_program::Op::Sum, sum, {{a, 0}, {b, 0}});
+    emu.add_inst(Emu_program::Op::Sum, sub, {{a, 0}, {b, 1}});
+    emu.add_inst(Emu_program::Op::Mult, mult, {{a, 0}, {b, 0}});
+    emu.add_inst(Emu_program::Op::And, band, {{a, 0}, {b, 0}});
+    emu.add_inst(Emu_program::Op::Or, bor, {{a, 0}, {b, 0}});
+    emu.add_inst(Emu_program::Op::Not, bnot, {{a, 0}});
+    emu.add_inst(Emu_program::Op::EQ, eq, {{a, 0}, {b, 0}});
+
+    auto va = rand_lconst(bits);
+    auto vb = rng.max(8) == 0 ? va : rand_lconst(bits);
+    emu.set(a, va);
+    emu.set(b, vb);
+    emu.cycle();
+
+    EXPECT_EQ(emu.get_lconst(a), va);
+    EXPECT_EQ(emu.get_lconst(sum), va.add_op(vb)) << fmt::format("bits:{} a:{} b:{}", bits, va.to_pyrope(), vb.to_pyrope());
+    EXPECT_EQ(emu.get_lconst(sub), va.sub_op(vb));
+    EXPECT_EQ(emu.get_lconst(mult), va.mult_op(vb));
+    EXPECT_EQ(emu.get_lconst(band), va.and_op(vb));
+    EXPECT_EQ(emu.get_lconst(bor), va.or_op(vb));
+    EXPECT_EQ(emu.get_lconst(bnot), va.not_op());
+    EXPECT_EQ(emu.get(eq), va == vb ? -1 : 0);
+  }
+}
@@ -7,6 +7,7 @@
 
 #include "graph_library.hpp"
 #include "lgraph.hpp"
+#include "lnast_cache.hpp"
 #include "main_api.hpp"
 
 void Meta_api::open(Eprp_var &var) {
@@ -170,6 +171,38 @@ void Meta_api::lnastdump(Eprp_var &var) {
   }
 }
 
+void Meta_api::lnastsave(Eprp_var &var) {
+  auto path     = var.get("path");
+  auto files    = var.get("files");
+  auto frontend = var.get("frontend");
+
+  if (files.split(',').size() != 1) {
+    Main_api::error("lnast.save needs a single source file, not {}", files);
+    return;
+  }
+
+  if (!Lnast_cache::save(var.lnasts, path, files, frontend)) {
+    Main_api::warn("lnast.save could not save the LNAST of {} in {} path", files, path);
+  }
+}
+
+void Meta_api::lnastload(Eprp_var &var) {
+  auto path     = var.get("path");
+  auto files    = var.get("files");
+  auto frontend = var.get("frontend");
+
+  for (const auto &f : files.split(',')) {
+    auto lnasts = Lnast_cache::load(path, f, frontend);
+    if (lnasts.empty()) {
+      Main_api::warn("lnast.load no up to date LNAST for {} in {} path", f, path);
+      continue;
+    }
+    for (const auto &ln : lnasts) {
+      var.add(ln);
+    }
+  }
+}
+
 void Meta_api::setup(Eprp &eprp) {
   Eprp_method m1("lgraph.open", "open an lgraph if it exists", &Meta_api::open);
   m1.add_label_optional("path", "lgraph path", "lgdb");
@@ -196,6 +229,22 @@ void Meta_api::setup(Eprp &eprp) {
 
   eprp.register_method(m4a);
   eprp.register_method(m4b);
+
+  //---------------------
+  Eprp_method m4c("lnast.save", "save the LNASTs generated from a source file to the LNAST cache", &Meta_api::lnastsave);
+  m4c.add_label_required("files", "source file the LNASTs were generated from");
+  m4c.add_label_optional("path", "lgraph path", "lgdb");
+  m4c.add_label_optional("frontend", "front end and version that generated the LNASTs (load must match)", "");
+
+  eprp.register_method(m4c);
+
+  //---------------------
+  Eprp_method m4d("lnast.load", "load LNASTs from the cache (ignored when the source file changed)", &Meta_api::lnastload);
+  m4d.add_label_required("files", "source files (comma separated)");
+  m4d.add_label_optional("path", "lgraph path", "lgdb");
+  m4d.add_label_optional("frontend", "front end and version that generated the LNASTs", "");
+
+  eprp.register_method(m4d);
   //---------------------
   Eprp_method m5("dump", "dump labels and lgraphs passed", &Meta_api::dump);
   eprp.register_method(m5);
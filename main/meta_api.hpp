@@ -21,6 +21,8 @@ protected:
 
   static void lgdump(Eprp_var &var);
   static void lnastdump(Eprp_var &var);
+  static void lnastsave(Eprp_var &var);
+  static void lnastload(Eprp_var &var);
 
   Meta_api() {}
 
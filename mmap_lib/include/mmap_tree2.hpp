@@ -1,6 +1,18 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+// Flat array n-ary tree (tree2)
+//
+// All the nodes share one index space (0 is invalid, 1 is the root) over
+// three flat vectors: the hot links used by traversals (first child, next
+// sibling), the cold links used by updates (parent, last child, prev sibling,
+// level), and the data. Builders that add nodes top-down (LNAST) leave the
+// arrays close to preorder, so traversals mostly walk memory forward instead
+// of jumping between the per-level vectors of mmap_lib::tree. Deleted nodes
+// are unlinked and keep level -1 (their slot is not reused).
+//
+// Design notes on the layouts considered for the array follow.
+//
 // Vector n-ary tree implementation:
 //
 // 2 arrays: main and overflow
@@ -246,51 +258,115 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
-#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "iassert.hpp"
-#include "mmap_map.hpp"  // To add the hash for trees
 
 namespace mmap_lib {
 
 using Tree2_index = uint64_t;
+using Tree2_level = int16_t;
 
 template <typename X>
 class tree2 {
 protected:
-  const std::string mmap_name;
+  // Hot links, used by every traversal (children, siblings, preorder)
+  struct Tree2_links {
+    uint32_t first_child;
+    uint32_t next_sibling;
+
+    constexpr Tree2_links() : first_child(0), next_sibling(0) {}
+  };
+
+  // Cold links, used by insertion/deletion and going up
+  struct Tree2_pointers {
+    uint32_t    parent;
+    uint32_t    last_child;
+    uint32_t    prev_sibling;
+    Tree2_level level;  // -1 deleted
+
+    constexpr Tree2_pointers() : parent(0), last_child(0), prev_sibling(0), level(-1) {}
+  };
+
   const std::string mmap_path;
+  const std::string mmap_name;
+
+  std::vector<X>              data_stack;
+  std::vector<Tree2_links>    links_stack;
+  std::vector<Tree2_pointers> pointers_stack;
 
-  std::vector<X>       data_stack;
-  std::vector<int16_t> level_stack;
+  Tree2_index create_node(const Tree2_index parent, const X &data) {
+    I(pointers_stack.size() < UINT32_MAX);
+    Tree2_index index = pointers_stack.size();
 
-  std::vector<X>       overflow_data_stack;
-  std::vector<int16_t> overflow_level_stack;
+    auto &p  = pointers_stack.emplace_back();
+    p.parent = parent;
+    p.level  = parent ? pointers_stack[parent].level + 1 : 0;
+    links_stack.emplace_back();
+    data_stack.emplace_back(data);
+
+    return index;
+  }
+
+  void unlink(const Tree2_index index) {
+    auto &p = pointers_stack[index];
+    auto &l = links_stack[index];
+    if (p.prev_sibling)
+      links_stack[p.prev_sibling].next_sibling = l.next_sibling;
+    else if (p.parent)
+      links_stack[p.parent].first_child = l.next_sibling;
+
+    if (l.next_sibling)
+      pointers_stack[l.next_sibling].prev_sibling = p.prev_sibling;
+    else if (p.parent)
+      pointers_stack[p.parent].last_child = p.prev_sibling;
+
+    p.level        = -1;
+    p.parent       = 0;
+    p.prev_sibling = 0;
+    l.next_sibling = 0;
+  }
 
 public:
   static constexpr Tree2_index invalid_index() { return Tree2_index(0); }
   static constexpr Tree2_index root_index() { return Tree2_index(1); }
 
-  const Tree2_index get_last_child(const Tree2_index parent_index) const;
-  const Tree2_index get_first_child(const Tree2_index parent_index) const;
+  Tree2_index get_last_child(const Tree2_index parent_index) const {
+    I(is_valid(parent_index));
+    return pointers_stack[parent_index].last_child;
+  }
+  Tree2_index get_first_child(const Tree2_index parent_index) const {
+    I(is_valid(parent_index));
+    return links_stack[parent_index].first_child;
+  }
 
-  const Tree2_index get_sibling_next(const Tree2_index sibling) const;
+  Tree2_index get_sibling_next(const Tree2_index sibling) const {
+    I(is_valid(sibling));
+    return links_stack[sibling].next_sibling;
+  }
 
-  const Tree2_index get_sibling_prev(const Tree2_index &sibling) const;
+  Tree2_index get_sibling_prev(const Tree2_index sibling) const {
+    I(is_valid(sibling));
+    return pointers_stack[sibling].prev_sibling;
+  }
+
+  Tree2_level get_level(const Tree2_index index) const {
+    I(is_valid(index));
+    return pointers_stack[index].level;
+  }
 
   class Tree2_depth_preorder_iterator {
   public:
     class CTree2_depth_preorder_iterator {
     public:
-      CTree2_depth_preorder_iterator(const Tree2_index _ti, const tree2<X> *_t) : ti(_ti), t(_t) { start_ti = _ti; }
+      CTree2_depth_preorder_iterator(const Tree2_index _ti, const tree2<X> *_t) : ti(_ti), start_ti(_ti), t(_t) {}
       CTree2_depth_preorder_iterator operator++() {
         CTree2_depth_preorder_iterator i(ti, t);
 
-        ti = t->get_depth_preorder_next(ti);
-        if (ti.level == start_ti.level && ti.pos > start_ti.pos) {
-          ti = invalid_index();
-        }
+        ti = t->get_depth_preorder_next(ti, start_ti);
         return i;
       };
       bool operator!=(const CTree2_depth_preorder_iterator &other) {
@@ -315,9 +391,7 @@ public:
     explicit Tree2_depth_preorder_iterator(const Tree2_index _b, const tree2<X> *_t) : ti(_b), t(_t) {}
 
     CTree2_depth_preorder_iterator begin() const { return CTree2_depth_preorder_iterator(ti, t); }
-    CTree2_depth_preorder_iterator end() const {
-      return CTree2_depth_preorder_iterator(get_root_index(), t);
-    }  // 0 is end index for iterator
+    CTree2_depth_preorder_iterator end() const { return CTree2_depth_preorder_iterator(invalid_index(), t); }
   };
 
   class Tree2_sibling_iterator {
@@ -361,7 +435,7 @@ public:
     CTree2_sibling_iterator end() const { return CTree2_sibling_iterator(invalid_index(), t); }
   };
 
-  tree2(){};
+  tree2() { clear(); };
 
   tree2(std::string_view _path, std::string_view _map_name)
       : mmap_path(_path.empty() ? "." : _path), mmap_name{std::string(_path) + std::string("/") + std::string(_map_name)} {
@@ -372,6 +446,7 @@ public:
         I(e >= 0);
       }
     }
+    clear();
   }
 
   [[nodiscard]] inline std::string_view get_name() const { return mmap_name; }
@@ -379,30 +454,112 @@ public:
 
   void clear() {
     data_stack.clear();
+    links_stack.clear();
     pointers_stack.clear();
 
-    overflow_data_stack.clear();
-    overflow_pointers_stack.clear();
+    // index 0 is the invalid node
+    data_stack.emplace_back();
+    links_stack.emplace_back();
+    pointers_stack.emplace_back();
+  }
+
+  void reserve(size_t n_nodes) {
+    data_stack.reserve(n_nodes + 1);
+    links_stack.reserve(n_nodes + 1);
+    pointers_stack.reserve(n_nodes + 1);
+  }
+
+  [[nodiscard]] bool   empty() const { return pointers_stack.size() <= 1; }
+  [[nodiscard]] size_t size() const { return pointers_stack.size() - 1; }  // includes deleted nodes
+
+  // Unlike mmap_lib::tree, indexes are stable: insertions never move nodes
+  Tree2_index add_child(const Tree2_index parent, const X &data) {
+    I(is_valid(parent));
+
+    auto last = pointers_stack[parent].last_child;
+    if (last)
+      return append_sibling(last, data);
+
+    auto index                         = create_node(parent, data);
+    links_stack[parent].first_child    = index;
+    pointers_stack[parent].last_child = index;
+    return index;
   }
 
-  [[nodiscard]] bool empty() const { return data_stack.empty(); }
+  bool delete_leaf(const Tree2_index child) {
+    I(is_valid(child));
+    if (!is_leaf(child))
+      return false;
+    I(!is_root(child));
 
-  // WARNING: can not return Tree2_index & because future additions can move the pointer (vector realloc)
-  const Tree2_index add_child(const Tree2_index parent, const X &data);
-  const bool        delete_leaf(const Tree2_index child);
-  const bool        delete_subtree(const Tree2_index child);
-  const Tree2_index append_sibling(const Tree2_index sibling, const X &data);
-  const Tree2_index insert_next_sibling(const Tree2_index sibling, const X &data);
-  size_t            get_tree_width(const Tree2_level level) const;
+    unlink(child);
+    return true;
+  }
+
+  bool delete_subtree(const Tree2_index child) {
+    I(is_valid(child));
+    I(!is_root(child));
+
+    std::vector<Tree2_index> pending;
+    for (auto index : depth_preorder(child)) {
+      if (index != child)
+        pending.emplace_back(index);
+    }
+    for (auto index : pending) {
+      pointers_stack[index] = Tree2_pointers();
+      links_stack[index]    = Tree2_links();
+    }
+    links_stack[child].first_child   = 0;
+    pointers_stack[child].last_child = 0;
+    unlink(child);
+    return true;
+  }
+
+  Tree2_index append_sibling(const Tree2_index sibling, const X &data) {
+    I(is_valid(sibling));
+    I(!is_root(sibling));
+
+    auto parent = pointers_stack[sibling].parent;
+    return insert_next_sibling(pointers_stack[parent].last_child, data);
+  }
+
+  Tree2_index insert_next_sibling(const Tree2_index sibling, const X &data) {
+    I(is_valid(sibling));
+    I(!is_root(sibling));
+
+    auto parent = pointers_stack[sibling].parent;
+    auto index  = create_node(parent, data);
+
+    // create_node may realloc, take refs after
+    auto next                            = links_stack[sibling].next_sibling;
+    pointers_stack[index].prev_sibling = sibling;
+    links_stack[index].next_sibling    = next;
+    if (next)
+      pointers_stack[next].prev_sibling = index;
+    else
+      pointers_stack[parent].last_child = index;
+    links_stack[sibling].next_sibling = index;
+
+    return index;
+  }
+
+  size_t get_tree_width(const Tree2_level level) const {
+    size_t n = 0;
+    for (const auto &p : pointers_stack) {
+      if (p.level == level)
+        ++n;
+    }
+    return n;
+  }
 
   void set_data(const Tree2_index index, const X &data) {
-    I((int)data_stack.size() > index);
+    I(data_stack.size() > index);
 
     data_stack[index] = data;
   }
 
   X *ref_data(const Tree2_index leaf) {
-    I((int)data_stack.size() > leaf);
+    I(data_stack.size() > leaf);
 
     return &data_stack[leaf];
   }
@@ -413,49 +570,82 @@ public:
     return data_stack[leaf];
   }
 
-  const Tree2_index get_depth_preorder_next(const Tree2_index child) const;
+  // Next node in preorder without leaving the subtree rooted at start
+  Tree2_index get_depth_preorder_next(const Tree2_index child, const Tree2_index start = root_index()) const {
+    I(is_valid(child));
 
-  const Tree2_index get_parent(const Tree2_index index) const;
+    const auto &l = links_stack[child];
+    if (l.first_child)
+      return l.first_child;
 
-  void set_root(const X &data);
+    auto index = child;
+    while (index != start) {
+      auto next = links_stack[index].next_sibling;
+      if (next)
+        return next;
+      index = pointers_stack[index].parent;
+    }
+    return invalid_index();
+  }
+
+  Tree2_index get_parent(const Tree2_index index) const {
+    I(is_valid(index));
+    return pointers_stack[index].parent;
+  }
 
-  const Tree2_index get_child(const Tree2_index start_index) const;
+  void set_root(const X &data) {
+    clear();
+    create_node(invalid_index(), data);
+  }
 
-  // tree traversals: https://en.wikipedia.org/wiki/Tree2_traversal
+  // tree traversals: https://en.wikipedia.org/wiki/Tree_traversal
   Tree2_depth_preorder_iterator depth_preorder(const Tree2_index start_index) const {
     return Tree2_depth_preorder_iterator(start_index, this);
   }
 
-  Tree2_depth_preorder_iterator depth_preorder() const { return Tree2_depth_preorder_iterator(Tree2_index::root(), this); }
+  Tree2_depth_preorder_iterator depth_preorder() const { return Tree2_depth_preorder_iterator(root_index(), this); }
 
   Tree2_sibling_iterator siblings(const Tree2_index &start_index) const { return Tree2_sibling_iterator(start_index, this); }
   Tree2_sibling_iterator children(const Tree2_index &start_index) const {
-    if (is_leaf(start_index))
-      return Tree2_sibling_iterator(invalid_index(), this);
-
     return Tree2_sibling_iterator(get_first_child(start_index), this);
   }
 
-  bool is_leaf(const Tree2_index index) const;
-  bool is_root(const Tree2_index index) constexpr { return index == 1; }
-  bool is_invalid(const Tree2_index index) constexpr { return index == 0; }
+  bool is_valid(const Tree2_index index) const {
+    return index && index < pointers_stack.size() && pointers_stack[index].level >= 0;
+  }
+  bool is_leaf(const Tree2_index index) const { return links_stack[index].first_child == 0; }
+  constexpr bool is_root(const Tree2_index index) const { return index == root_index(); }
+  constexpr bool is_invalid(const Tree2_index index) const { return index == invalid_index(); }
 
-  bool has_single_child(const Tree2_index index) const;
+  bool has_single_child(const Tree2_index index) const {
+    auto first = links_stack[index].first_child;
+    return first && first == pointers_stack[index].last_child;
+  }
 
-  bool is_child_of(const Tree2_index child, const Tree2_index potential_parent) const;
+  bool is_child_of(const Tree2_index child, const Tree2_index potential_parent) const {
+    I(is_valid(child));
+    I(is_valid(potential_parent));
+
+    auto p_level = pointers_stack[potential_parent].level;
+    auto index   = child;
+    while (pointers_stack[index].level > p_level) {
+      index = pointers_stack[index].parent;
+    }
+    return index == potential_parent;
+  }
 
   /* LCOV_EXCL_START */
   void dump() const {
     for (const auto &index : depth_preorder()) {
-      std::string indent(index.level, ' ');
-      printf("%s l:%d p:%d\n", indent.c_str(), level_stack[indexi], index);
+      std::string indent(get_level(index), ' ');
+      printf("%s l:%d p:%d\n", indent.c_str(), get_level(index), static_cast<int>(index));
     }
   }
 
   void dump_data() const {
     for (const auto &index : depth_preorder()) {
-      std::string indent(index.level, ' ');
-      printf("%s l:%d p:%d\t", indent.c_str(), level_stack[index], index);
+      std::string indent(get_level(index), ' ');
+      printf("%s l:%d p:%d\t", indent.c_str(), get_level(index), static_cast<int>(index));
       std::cout << get_data(index) << std::endl;
     }
   }
@@ -14,6 +14,7 @@
 
 #include "lbench.hpp"
 #include "mmap_tree.hpp"
+#include "mmap_tree2.hpp"
 
 class TreeBench {
 public:
@@ -97,9 +98,103 @@ public:
   };
 };
 
+// LNAST like shape: root -> stmts -> n statements with 3 operands, and an
+// if with 2 nested stmts every 16 statements.
+template <typename T, typename Index>
+void build_lnast_shape(T &t, Index root, int n) {
+  auto stmts = t.add_child(root, 1);
+  for (int i = 0; i < n; ++i) {
+    auto st = t.add_child(stmts, i);
+    t.add_child(st, i + 1);
+    t.add_child(st, i + 2);
+    t.add_child(st, i + 3);
+    if ((i & 15) == 15) {
+      auto if_st = t.add_child(stmts, i);
+      t.add_child(if_st, i);  // condition
+      for (int j = 0; j < 2; ++j) {
+        auto sub = t.add_child(if_st, j);
+        auto op  = t.add_child(sub, j);
+        t.add_child(op, j + 1);
+        t.add_child(op, j + 2);
+      }
+    }
+  }
+}
+
+void bench_traversal(int n) {
+  uint64_t total1 = 0;
+  uint64_t total2 = 0;
+
+  mmap_lib::tree<int> t1;
+  {
+    Lbench b("mmap.tree.build");
+    t1.set_root(0);
+    build_lnast_shape(t1, mmap_lib::Tree_index::root(), n);
+  }
+  mmap_lib::tree2<int> t2;
+  {
+    Lbench b("mmap.tree2.build");
+    t2.set_root(0);
+    build_lnast_shape(t2, mmap_lib::tree2<int>::root_index(), n);
+  }
+
+  {
+    Lbench b("mmap.tree.preorder");
+    for (int rep = 0; rep < 10; ++rep) {
+      for (const auto &index : t1.depth_preorder()) {
+        total1 += t1.get_data(index);
+      }
+    }
+  }
+  {
+    Lbench b("mmap.tree2.preorder");
+    for (int rep = 0; rep < 10; ++rep) {
+      for (const auto &index : t2.depth_preorder()) {
+        total2 += t2.get_data(index);
+      }
+    }
+  }
+  if (total1 != total2) {
+    std::cout << "ERROR: preorder mismatch " << total1 << " vs " << total2 << std::endl;
+    exit(-3);
+  }
+
+  // statement walk like the SSA/Lnast_tolg passes: children of stmts, then operands
+  total1 = 0;
+  total2 = 0;
+  {
+    Lbench b("mmap.tree.children");
+    for (int rep = 0; rep < 10; ++rep) {
+      auto stmts = t1.get_first_child(mmap_lib::Tree_index::root());
+      for (const auto &st : t1.children(stmts)) {
+        for (const auto &opd : t1.children(st)) {
+          total1 += t1.get_data(opd);
+        }
+      }
+    }
+  }
+  {
+    Lbench b("mmap.tree2.children");
+    for (int rep = 0; rep < 10; ++rep) {
+      auto stmts = t2.get_first_child(mmap_lib::tree2<int>::root_index());
+      for (const auto &st : t2.children(stmts)) {
+        for (const auto &opd : t2.children(st)) {
+          total2 += t2.get_data(opd);
+        }
+      }
+    }
+  }
+  if (total1 != total2) {
+    std::cout << "ERROR: children mismatch " << total1 << " vs " << total2 << std::endl;
+    exit(-3);
+  }
+}
+
 int main() {
   typedef std::chrono::duration<float> float_sec;
 
+  bench_traversal(200000);
+
   enum { times = 10000, max_times = 100000 };
   auto      ts         = std::chrono::high_resolution_clock::now();
   float_sec total_time = (ts - ts);
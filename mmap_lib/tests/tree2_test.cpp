@@ -0,0 +1,74 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mmap_tree2.hpp"
+
+class Tree2_test : public ::testing::Test {
+public:
+  mmap_lib::tree2<std::string> ast;
+
+  mmap_lib::Tree2_index c10, c11, c100, c101, c102, c110;
+
+  void SetUp() override {
+    ast.set_root("root");
+
+    c10  = ast.add_child(ast.root_index(), "child1.0");
+    c11  = ast.add_child(ast.root_index(), "child1.1");
+    c100 = ast.add_child(c10, "child1.0.0");
+    c102 = ast.add_child(c10, "child1.0.2");
+    c101 = ast.insert_next_sibling(c100, "child1.0.1");
+    c110 = ast.add_child(c11, "child1.1.0");
+  }
+
+  std::vector<std::string> preorder(mmap_lib::Tree2_index start) const {
+    std::vector<std::string> v;
+    for (auto index : ast.depth_preorder(start)) {
+      v.emplace_back(ast.get_data(index));
+    }
+    return v;
+  }
+};
+
+TEST_F(Tree2_test, links) {
+  EXPECT_EQ(ast.get_parent(c101), c10);
+  EXPECT_EQ(ast.get_first_child(c10), c100);
+  EXPECT_EQ(ast.get_last_child(c10), c102);
+  EXPECT_EQ(ast.get_sibling_next(c100), c101);
+  EXPECT_EQ(ast.get_sibling_prev(c102), c101);
+  EXPECT_EQ(ast.get_level(c110), 2);
+
+  EXPECT_TRUE(ast.is_leaf(c110));
+  EXPECT_TRUE(ast.has_single_child(c11));
+  EXPECT_FALSE(ast.has_single_child(c10));
+  EXPECT_TRUE(ast.is_child_of(c102, ast.root_index()));
+  EXPECT_FALSE(ast.is_child_of(c102, c11));
+  EXPECT_EQ(ast.get_tree_width(2), 4);
+}
+
+TEST_F(Tree2_test, traversal) {
+  std::vector<std::string> all{"root", "child1.0", "child1.0.0", "child1.0.1", "child1.0.2", "child1.1", "child1.1.0"};
+  EXPECT_EQ(preorder(ast.root_index()), all);
+
+  std::vector<std::string> sub{"child1.0", "child1.0.0", "child1.0.1", "child1.0.2"};
+  EXPECT_EQ(preorder(c10), sub);
+
+  std::vector<std::string> kids;
+  for (auto index : ast.children(c10)) {
+    kids.emplace_back(ast.get_data(index));
+  }
+  EXPECT_EQ(kids, std::vector<std::string>(sub.begin() + 1, sub.end()));
+}
+
+TEST_F(Tree2_test, delete_nodes) {
+  EXPECT_FALSE(ast.delete_leaf(c10));
+  EXPECT_TRUE(ast.delete_leaf(c101));
+  EXPECT_EQ(ast.get_sibling_next(c100), c102);
+
+  EXPECT_TRUE(ast.delete_subtree(c10));
+  std::vector<std::string> all{"root", "child1.1", "child1.1.0"};
+  EXPECT_EQ(preorder(ast.root_index()), all);
+  EXPECT_EQ(ast.get_first_child(ast.root_index()), c11);
+}
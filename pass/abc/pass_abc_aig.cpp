@@ -0,0 +1,261 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "pass_abc_aig.hpp"
+
+#include <mutex>
+
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+
+static Pass_plugin sample("pass_abc_aig", Pass_abc_aig::setup);
+
+void Pass_abc_aig::setup() {
+  Eprp_method m1("pass.abc.aig", "optimize the 1-bit boolean logic with ABC without blif files", &Pass_abc_aig::work);
+
+  m1.add_label_optional("verbose", "print the AIG size before and after the optimization", "false");
+
+  register_pass(m1);
+}
+
+Pass_abc_aig::Pass_abc_aig(const Eprp_var &var) : Pass("pass.abc.aig", var) {
+  auto verbose_txt = var.get("verbose");
+  verbose          = verbose_txt != "false" && verbose_txt != "0";
+}
+
+void Pass_abc_aig::work(Eprp_var &var) {
+  Lbench       b("pass.abc.aig");
+  Pass_abc_aig p(var);
+
+  static std::once_flag abc_started;
+  std::call_once(abc_started, []() { Abc_Start(); });
+
+  // One lgraph at a time. Each bridge owns its ABC network, but the rewriting
+  // keeps global state in ABC (the rewrite and cut managers, the frame), so
+  // the ABC calls are not thread safe even with one network per lgraph.
+  for (auto *lg : var.lgs) {
+    Abc_aig_bridge bridge(lg);
+    if (!bridge.to_aig())
+      continue;
+
+    bridge.optimize();
+    bridge.regen();
+    if (p.verbose) {
+      fmt::print("pass.abc.aig {}: {} nodes, AIG {} -> {} ands\n",
+                 lg->get_name(),
+                 bridge.get_n_island_nodes(),
+                 bridge.get_n_ands_before(),
+                 bridge.get_n_ands_after());
+    }
+  }
+}
+
+Abc_aig_bridge::Abc_aig_bridge(Lgraph *_lg) : lg(_lg), ntk(nullptr), n_ands_before(0), n_ands_after(0) {}
+
+Abc_aig_bridge::~Abc_aig_bridge() {
+  if (ntk)
+    Abc_NtkDelete(ntk);
+}
+
+bool Abc_aig_bridge::is_boolean(const Node &node) {
+  auto op = node.get_type_op();
+  if (op != Ntype_op::And && op != Ntype_op::Or && op != Ntype_op::Xor && op != Ntype_op::Not && op != Ntype_op::Mux)
+    return false;
+
+  if (node.get_driver_pin().get_bits() != 1)
+    return false;
+
+  int n_inps = 0;
+  for (const auto &e : node.inp_edges_ordered()) {
+    if (e.driver.get_bits() != 1)
+      return false;
+    if (op == Ntype_op::Mux && e.sink.get_pid() != n_inps)  // sel, false and true option
+      return false;
+    ++n_inps;
+  }
+
+  if (op == Ntype_op::Not)
+    return n_inps == 1;
+  if (op == Ntype_op::Mux)
+    return n_inps == 3;
+
+  return n_inps > 0;
+}
+
+Abc_Obj_t *Abc_aig_bridge::get_obj(const Node_pin &dpin) {
+  auto it = pin2id.find(dpin.get_compact_class_driver());
+  if (it != pin2id.end())
+    return id2obj[it->second];
+
+  if (in_island.contains(dpin.get_node().get_compact_class())) {
+    Pass::error("pass.abc.aig {} is in a combinational loop", dpin.get_node().debug_name());
+    return nullptr;
+  }
+
+  Abc_Obj_t *obj;
+  if (dpin.is_type_const() && !dpin.get_type_const().has_unknowns()) {
+    obj = Abc_AigConst1(ntk);
+    if (dpin.get_type_const().is_known_false())
+      obj = Abc_ObjNot(obj);
+  } else {
+    obj = Abc_NtkCreatePi(ntk);
+    inputs.emplace_back(dpin);
+  }
+
+  pin2id[dpin.get_compact_class_driver()] = id2obj.size();
+  id2obj.emplace_back(obj);
+
+  return obj;
+}
+
+bool Abc_aig_bridge::to_aig() {
+  for (auto node : lg->forward()) {
+    if (!is_boolean(node))
+      continue;
+    island.emplace_back(node);
+    in_island.insert(node.get_compact_class());
+  }
+
+  if (island.empty())
+    return false;
+
+  ntk       = Abc_NtkAlloc(ABC_NTK_STRASH, ABC_FUNC_AIG, 1);
+  auto *man = static_cast<Abc_Aig_t *>(ntk->pManFunc);
+
+  std::vector<Abc_Obj_t *> args;
+  for (auto &node : island) {
+    args.clear();
+    for (const auto &e : node.inp_edges_ordered()) {
+      args.emplace_back(get_obj(e.driver));
+    }
+
+    Abc_Obj_t *obj = args[0];
+    switch (node.get_type_op()) {
+      case Ntype_op::And:
+        for (auto i = 1u; i < args.size(); ++i) obj = Abc_AigAnd(man, obj, args[i]);
+        break;
+      case Ntype_op::Or:
+        for (auto i = 1u; i < args.size(); ++i) obj = Abc_AigOr(man, obj, args[i]);
+        break;
+      case Ntype_op::Xor:
+        for (auto i = 1u; i < args.size(); ++i) obj = Abc_AigXor(man, obj, args[i]);
+        break;
+      case Ntype_op::Not: obj = Abc_ObjNot(obj); break;
+      case Ntype_op::Mux: obj = Abc_AigMux(man, args[0], args[2], args[1]); break;
+      default: I(false);
+    }
+
+    pin2id[node.get_driver_pin().get_compact_class_driver()] = id2obj.size();
+    id2obj.emplace_back(obj);
+  }
+
+  // POs for the island pins read outside the island. The sinks are collected
+  // now because regen deletes the island edges.
+  for (auto &node : island) {
+    std::vector<Node_pin> sinks;
+    for (const auto &e : node.out_edges()) {
+      if (!in_island.contains(e.sink.get_node().get_compact_class()))
+        sinks.emplace_back(e.sink);
+    }
+    if (sinks.empty())
+      continue;
+
+    auto dpin = node.get_driver_pin();
+    auto *po  = Abc_NtkCreatePo(ntk);
+    Abc_ObjAddFanin(po, id2obj[pin2id[dpin.get_compact_class_driver()]]);
+    outputs.emplace_back(dpin);
+    outputs_sinks.emplace_back(std::move(sinks));
+  }
+
+  // ABC passes expect CI/CO names (they are never used to map back)
+  Abc_NtkAddDummyPiNames(ntk);
+  Abc_NtkAddDummyPoNames(ntk);
+  Abc_AigCleanup(man);
+
+  if (!Abc_NtkCheck(ntk)) {
+    Pass::error("pass.abc.aig AIG construction failed for {}", lg->get_name());
+    return false;
+  }
+
+  n_ands_before = Abc_NtkNodeNum(ntk);
+  n_ands_after  = n_ands_before;
+
+  return true;
+}
+
+void Abc_aig_bridge::optimize() {
+  // balance; rewrite; rewrite -z; balance (the start of resyn2)
+  auto *tmp = Abc_NtkBalance(ntk, 0, 0, 1);
+  Abc_NtkDelete(ntk);
+  ntk = tmp;
+
+  Abc_NtkRewrite(ntk, 1, 0, 0, 0, 0);
+  Abc_NtkRewrite(ntk, 1, 1, 0, 0, 0);
+
+  tmp = Abc_NtkBalance(ntk, 0, 0, 1);
+  Abc_NtkDelete(ntk);
+  ntk = tmp;
+
+  n_ands_after = Abc_NtkNodeNum(ntk);
+}
+
+Node_pin Abc_aig_bridge::get_pin(std::vector<Node_pin> &obj2pin, std::vector<Node_pin> &obj2not, Abc_Obj_t *obj, bool complement) {
+  auto id = Abc_ObjId(obj);
+
+  if (obj2pin[id].is_invalid()) {
+    I(obj == Abc_AigConst1(ntk));  // PIs and nodes are set in DFS order
+    obj2pin[id] = lg->create_node_const(1).setup_driver_pin();
+    obj2not[id] = lg->create_node_const(0).setup_driver_pin();
+  }
+
+  if (!complement)
+    return obj2pin[id];
+
+  if (obj2not[id].is_invalid()) {
+    auto not_node = lg->create_node(Ntype_op::Not, 1);
+    obj2pin[id].connect_sink(not_node.setup_sink_pin("a"));
+    obj2not[id] = not_node.setup_driver_pin();
+  }
+
+  return obj2not[id];
+}
+
+void Abc_aig_bridge::regen() {
+  // PIs and POs keep their position in the optimized network. The ABC objects
+  // are mapped with vectors indexed by Abc_ObjId (no names).
+  std::vector<Node_pin> obj2pin(Abc_NtkObjNumMax(ntk));
+  std::vector<Node_pin> obj2not(Abc_NtkObjNumMax(ntk));
+
+  Abc_Obj_t *obj;
+  int        i;
+  Abc_NtkForEachPi(ntk, obj, i) { obj2pin[Abc_ObjId(obj)] = inputs[i]; }
+
+  auto *nodes = Abc_AigDfs(ntk, 0, 0);
+  Vec_PtrForEachEntry(Abc_Obj_t *, nodes, obj, i) {
+    auto a = get_pin(obj2pin, obj2not, Abc_ObjFanin0(obj), Abc_ObjFaninC0(obj));
+    auto b = get_pin(obj2pin, obj2not, Abc_ObjFanin1(obj), Abc_ObjFaninC1(obj));
+
+    auto and_node = lg->create_node(Ntype_op::And, 1);
+    auto spin     = and_node.setup_sink_pin("A");
+    a.connect_sink(spin);
+    b.connect_sink(spin);
+    obj2pin[Abc_ObjId(obj)] = and_node.setup_driver_pin();
+  }
+  Vec_PtrFree(nodes);
+
+  std::vector<Node_pin> po_pins;
+  Abc_NtkForEachPo(ntk, obj, i) { po_pins.emplace_back(get_pin(obj2pin, obj2not, Abc_ObjFanin0(obj), Abc_ObjFaninC0(obj))); }
+
+  // delete the island before connecting, so each outside sink has one driver
+  for (auto &node : island) {
+    node.del_node();
+  }
+
+  for (auto j = 0u; j < po_pins.size(); ++j) {
+    for (auto &sink : outputs_sinks[j]) {
+      po_pins[j].connect_sink(sink);
+    }
+  }
+
+  Abc_NtkDelete(ntk);
+  ntk = nullptr;
+}
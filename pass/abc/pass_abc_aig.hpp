@@ -0,0 +1,76 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "lgraph.hpp"
+#include "node_pin.hpp"
+#include "pass.hpp"
+
+extern "C" {
+#include "base/abc/abc.h"
+#include "base/main/main.h"
+}
+
+// Direct bridge between the 1-bit boolean logic of an lgraph and an ABC
+// strashed AIG. There is no blif file and no pin names: the driver pins are
+// numbered densely while the AIG is built, and regen maps the ABC objects back
+// with vectors indexed by PI/PO position and Abc_ObjId.
+class Abc_aig_bridge {
+public:
+  explicit Abc_aig_bridge(Lgraph *lg);
+  ~Abc_aig_bridge();
+
+  Abc_aig_bridge(const Abc_aig_bridge &)            = delete;
+  Abc_aig_bridge &operator=(const Abc_aig_bridge &) = delete;
+
+  // reads the lgraph, false if there is no logic to optimize
+  bool to_aig();
+
+  // balance; rewrite; rewrite -z; balance on the ABC network
+  void optimize();
+
+  // replaces the lgraph logic with the optimized AIG
+  void regen();
+
+  Lgraph *get_lgraph() const { return lg; }
+  int     get_n_island_nodes() const { return island.size(); }
+  int     get_n_ands_before() const { return n_ands_before; }
+  int     get_n_ands_after() const { return n_ands_after; }
+
+private:
+  using Pin_map = absl::flat_hash_map<Node_pin::Compact_class_driver, uint32_t>;
+
+  Lgraph    *lg;
+  Abc_Ntk_t *ntk;
+
+  std::vector<Node>                        island;  // nodes replaced by regen
+  absl::flat_hash_set<Node::Compact_class> in_island;
+  Pin_map                                  pin2id;  // dense id of each driver pin read or driven by the island
+  std::vector<Abc_Obj_t *>                 id2obj;
+  std::vector<Node_pin>                    inputs;   // driver pin of each PI
+  std::vector<Node_pin>                    outputs;  // island driver pin of each PO
+  std::vector<std::vector<Node_pin>>       outputs_sinks;
+
+  int n_ands_before;
+  int n_ands_after;
+
+  static bool is_boolean(const Node &node);
+
+  Abc_Obj_t *get_obj(const Node_pin &dpin);
+  Node_pin   get_pin(std::vector<Node_pin> &obj2pin, std::vector<Node_pin> &obj2not, Abc_Obj_t *obj, bool complement);
+};
+
+class Pass_abc_aig : public Pass {
+protected:
+  bool verbose;
+
+public:
+  static void work(Eprp_var &var);
+
+  Pass_abc_aig(const Eprp_var &var);
+
+  static void setup();
+};
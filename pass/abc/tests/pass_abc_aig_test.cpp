@@ -0,0 +1,170 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "pass_abc_aig.hpp"
+
+// Lgraph -> AIG -> optimize -> regen round trip. The 1-bit logic has
+// redundancy for ABC to remove, and a multi-bit And that must stay out of the
+// AIG. The outputs are evaluated for every input value before and after, and
+// must match.
+
+class Pass_abc_aig_test : public ::testing::Test {
+protected:
+  static constexpr int n_inputs = 4;
+
+  Lgraph *lg = nullptr;
+
+  static Node_pin create_op(Lgraph *g, Ntype_op op, const std::vector<Node_pin> &inps, const mmap_lib::str &sink = "A") {
+    auto node = g->create_node(op, 1);
+    auto spin = node.setup_sink_pin(sink);
+    for (const auto &dpin : inps) {
+      dpin.connect_sink(spin);
+    }
+    return node.setup_driver_pin();
+  }
+
+  static Node_pin create_mux(Lgraph *g, const Node_pin &sel, const Node_pin &f, const Node_pin &t) {
+    auto node = g->create_node(Ntype_op::Mux, 1);
+    sel.connect_sink(node.setup_sink_pin_raw(0));
+    f.connect_sink(node.setup_sink_pin_raw(1));
+    t.connect_sink(node.setup_sink_pin_raw(2));
+    return node.setup_driver_pin();
+  }
+
+  // value of a driver pin, the graph inputs i0..i3 are the bits of val
+  static int64_t eval(const Node_pin &dpin, uint32_t val) {
+    auto node = dpin.get_node();
+    if (node.is_graph_input()) {
+      auto name = dpin.get_name();
+      if (name == "w")
+        return val & 0xF;
+      return (val >> (name.to_s()[1] - '0')) & 1;
+    }
+
+    std::vector<int64_t> inps;
+    for (const auto &e : node.inp_edges_ordered()) {
+      inps.emplace_back(eval(e.driver, val));
+    }
+
+    const int64_t mask = (int64_t{1} << dpin.get_bits()) - 1;
+    int64_t       res  = 0;
+    switch (node.get_type_op()) {
+      case Ntype_op::Const: res = node.get_type_const().to_i(); break;
+      case Ntype_op::Not: res = ~inps[0]; break;
+      case Ntype_op::And:
+        res = mask;
+        for (auto v : inps) res &= v;
+        break;
+      case Ntype_op::Or:
+        for (auto v : inps) res |= v;
+        break;
+      case Ntype_op::Xor:
+        for (auto v : inps) res ^= v;
+        break;
+      case Ntype_op::Mux: res = inps[0] ? inps[2] : inps[1]; break;
+      default: ADD_FAILURE() << "unexpected " << node.debug_name();
+    }
+    return res & mask;
+  }
+
+  std::vector<int64_t> eval_outputs() const {
+    std::vector<int64_t> res;
+    for (uint32_t val = 0; val < (1u << n_inputs); ++val) {
+      for (const auto &e : lg->get_graph_output_node().inp_edges_ordered()) {
+        res.emplace_back(eval(e.driver, val));
+      }
+    }
+    return res;
+  }
+
+  int count(Ntype_op op, int bits) const {
+    int n = 0;
+    for (auto node : lg->fast()) {
+      if (node.get_type_op() == op && node.get_driver_pin().get_bits() == bits)
+        ++n;
+    }
+    return n;
+  }
+
+  void SetUp() override {
+    lg = Lgraph::create("lgdb_pass_abc_aig", "pass_abc_aig_top", "-");
+
+    std::vector<Node_pin> i;
+    for (int k = 0; k < n_inputs; ++k) {
+      i.emplace_back(lg->add_graph_input(mmap_lib::str::concat("i", k), k, 1));
+    }
+    auto w = lg->add_graph_input("w", n_inputs, 4);
+
+    auto ab = create_op(lg, Ntype_op::And, {i[0], i[1]});
+    auto ac = create_op(lg, Ntype_op::And, {i[0], i[2]});
+    auto o0 = create_op(lg, Ntype_op::Or, {ab, ac});  // a & (b | c)
+
+    auto nn = create_op(lg, Ntype_op::Not, {create_op(lg, Ntype_op::Not, {i[3]}, "a")}, "a");
+    auto o1 = create_op(lg, Ntype_op::Xor, {nn, i[3], i[2]});  // c
+
+    auto o2 = create_mux(lg, i[1], o0, create_op(lg, Ntype_op::Not, {o1}, "a"));
+
+    auto one = lg->create_node_const(1).setup_driver_pin();
+    one.set_bits(1);  // a 1-bit input, so the And is in the AIG and the constant becomes AIG const1
+    auto o3  = create_op(lg, Ntype_op::And, {o2, one, o0});
+
+    // o4 is multi-bit, the And stays as it is and reads the island through o0
+    auto wide = lg->create_node(Ntype_op::And, 4);
+    auto spin = wide.setup_sink_pin("A");
+    w.connect_sink(spin);
+    o0.connect_sink(spin);
+
+    Port_ID pos = n_inputs + 1;
+    for (const auto &dpin : {o0, o1, o2, o3}) {
+      lg->add_graph_output(mmap_lib::str::concat("o", pos - n_inputs - 1), pos, 1).connect_driver(dpin);
+      ++pos;
+    }
+    lg->add_graph_output("o4", pos, 4).connect_driver(wide.setup_driver_pin());
+  }
+
+  void TearDown() override { lg->sync(); }
+};
+
+TEST_F(Pass_abc_aig_test, round_trip) {
+  auto before = eval_outputs();
+
+  Abc_aig_bridge bridge(lg);
+  ASSERT_TRUE(bridge.to_aig());
+  EXPECT_EQ(bridge.get_n_island_nodes(), 9);
+
+  bridge.optimize();
+  EXPECT_GT(bridge.get_n_ands_before(), 0);
+  EXPECT_LE(bridge.get_n_ands_after(), bridge.get_n_ands_before());
+
+  bridge.regen();
+
+  EXPECT_EQ(eval_outputs(), before);
+
+  // only 1-bit And/Not (and constants) are left from the island
+  EXPECT_EQ(count(Ntype_op::Or, 1), 0);
+  EXPECT_EQ(count(Ntype_op::Xor, 1), 0);
+  EXPECT_EQ(count(Ntype_op::Mux, 1), 0);
+  EXPECT_EQ(count(Ntype_op::And, 4), 1);
+}
+
+TEST_F(Pass_abc_aig_test, no_logic) {
+  auto *empty = Lgraph::create("lgdb_pass_abc_aig", "pass_abc_aig_empty", "-");
+  empty->add_graph_output("z", 0, 4).connect_driver(empty->add_graph_input("a", 1, 4));
+
+  Abc_aig_bridge bridge(empty);
+  EXPECT_FALSE(bridge.to_aig());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  Abc_Start();
+  auto res = RUN_ALL_TESTS();
+  Abc_Stop();
+
+  return res;
+}
@@ -11,10 +11,12 @@
 #include "lgraph.hpp"
 #include "pass_bitwidth.hpp"
 
-Bitwidth::Bitwidth(bool _hier, int _max_iterations) : max_iterations(_max_iterations), hier(_hier) {}
+Bitwidth::Bitwidth(bool _hier, int _max_iterations, bool _verbose)
+    : max_iterations(_max_iterations), hier(_hier), verbose(_verbose), known_const_bits(0), known_total_bits(0) {}
 
 void Bitwidth::do_trans(Lgraph *lg) {
   Lbench b("pass.bitwidth." + lg->get_name().to_s());
+  bwmap.setup(lg);
   bw_pass(lg);
 }
 
@@ -146,11 +148,13 @@ void Bitwidth::process_ror(Node &node, XEdge_iterator &inp_edges) {
 void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
   I(inp_edges.size());  // Dangling???
 
-  Lconst max_val;
-  Lconst min_val;
+  Lconst     max_val;
+  Lconst     min_val;
+  Known_bits kb;
   for (auto e : inp_edges) {
     auto it = bwmap.find(e.driver.get_compact_class());
     if (it != bwmap.end()) {
+      kb        = Known_bits::bit_not(it->second.get_known_bits());
       auto pmax = it->second.get_max().to_i();  // pmax = parent_max
       auto pmin = it->second.get_min().to_i();
       // calculate 1s'complemet value
@@ -165,7 +169,10 @@ void Bitwidth::process_not(Node &node, XEdge_iterator &inp_edges) {
     }
   }
 
-  adjust_bw(node.setup_driver_pin(), Bitwidth_range(min_val, max_val));
+  Bitwidth_range bw(min_val, max_val);
+  bw.set_known_bits(kb);
+
+  adjust_bw(node.setup_driver_pin(), bw);
 }
 
 void Bitwidth::process_mux(Node &node, XEdge_iterator &inp_edges) {
@@ -208,6 +215,7 @@ void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
   }
 
   Bitwidth_range n_bw(0);
+  bool           n_first = true;
 
   for (auto &n_dpin : node.get_sink_pin("B").inp_drivers()) {
     auto n_it = bwmap.find(n_dpin.get_compact_class());
@@ -224,7 +232,12 @@ void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
       Pass::error("node {} can be negative and feeds a SHL (only positive allowed)", n_dpin.get_node().debug_name());
     }
 
-    n_bw.set_wider_range(n_it->second);
+    if (n_first) {
+      n_bw    = n_it->second;
+      n_first = false;
+    } else {
+      n_bw.set_wider_range(n_it->second);
+    }
   }
 
   auto           max     = a_bw.get_max();
@@ -234,6 +247,15 @@ void Bitwidth::process_shl(Node &node, XEdge_iterator &inp_edges) {
   auto           min_val = Lconst(Lconst(min.get_raw_num()) << Lconst(amount));
   Bitwidth_range bw(min_val, max_val);
 
+  if (!n_bw.is_overflow() && n_bw.min >= 0 && (n_bw.max - n_bw.min) < 64) {
+    // join all the possible shift amounts
+    auto kb = Known_bits::shl(a_bw.get_known_bits(), n_bw.min);
+    for (auto i = n_bw.min + 1; i <= n_bw.max; ++i) {
+      kb = Known_bits::join(kb, Known_bits::shl(a_bw.get_known_bits(), i));
+    }
+    bw.set_known_bits(kb);
+  }
+
   adjust_bw(node.get_driver_pin(), bw);
 }
 
@@ -280,6 +302,9 @@ void Bitwidth::process_sra(Node &node, XEdge_iterator &inp_edges) {
     auto min_val = min.div_op(amount);
 
     Bitwidth_range bw(min_val, max_val);
+    if (n_bw.is_known_const()) {
+      bw.set_known_bits(Known_bits::sra(a_bw.get_known_bits(), n_bw.min));
+    }
     adjust_bw(node.get_driver_pin(), bw);
   } else {
     adjust_bw(node.get_driver_pin(), a_bw);
@@ -289,17 +314,20 @@ void Bitwidth::process_sra(Node &node, XEdge_iterator &inp_edges) {
 void Bitwidth::process_sum(Node &node, XEdge_iterator &inp_edges) {
   I(inp_edges.size());  // Dangling sum??? (delete)
 
-  Lconst max_val;
-  Lconst min_val;
+  Lconst     max_val;
+  Lconst     min_val;
+  Known_bits kb = Known_bits::from_const(0);
   for (auto e : inp_edges) {
     auto it = bwmap.find(e.driver.get_compact_class());
     if (it != bwmap.end()) {
       if (e.sink.get_pin_name() == "A") {
         max_val = max_val + it->second.get_max();
         min_val = min_val + it->second.get_min();
+        kb      = Known_bits::add(kb, it->second.get_known_bits());
       } else {
         max_val = max_val - it->second.get_min();
         min_val = min_val - it->second.get_max();
+        kb      = Known_bits::sub(kb, it->second.get_known_bits());
       }
     } else {
       debug_unconstrained_msg(node, e.driver);
@@ -310,7 +338,10 @@ void Bitwidth::process_sum(Node &node, XEdge_iterator &inp_edges) {
     }
   }
 
-  adjust_bw(node.get_driver_pin(), Bitwidth_range(min_val, max_val));
+  Bitwidth_range bw(min_val, max_val);
+  bw.set_known_bits(kb);
+
+  adjust_bw(node.get_driver_pin(), bw);
 }
 
 void Bitwidth::process_memory(Node &node) {
@@ -685,7 +716,12 @@ void Bitwidth::process_get_mask(Node &node) {
   if (val4 < min_val)
     min_val = val4;
 
-  adjust_bw(node.get_driver_pin(), Bitwidth_range(min_val, max_val));
+  Bitwidth_range bw(min_val, max_val);
+  if (mask_max == mask_min && mask_max.is_i() && mask_max.to_i() > 0) {
+    bw.set_known_bits(Known_bits::get_mask(it->second.get_known_bits(), mask_max.to_i()));
+  }
+
+  adjust_bw(node.get_driver_pin(), bw);
 }
 
 void Bitwidth::process_sext(Node &node, XEdge_iterator &inp_edges) {
@@ -785,12 +821,14 @@ void Bitwidth::process_assignment_or(Node &node, XEdge_iterator &inp_edges) {
 
 void Bitwidth::process_bit_or(Node &node, XEdge_iterator &inp_edges) {
   I(inp_edges.size() > 1);
-  Bits_t max_bits = 0;
+  Bits_t max_ubits = 0;  // always positive inputs
+  Bits_t max_sbits = 0;  // may be negative inputs
 
-  bool any_negative = false;
+  bool       any_negative = false;
+  bool       first        = true;
+  Known_bits kb;
   for (auto e : inp_edges) {
-    auto   it   = bwmap.find(e.driver.get_compact_class());
-    Bits_t bits = 0;
+    auto it = bwmap.find(e.driver.get_compact_class());
     if (it == bwmap.end()) {
       debug_unconstrained_msg(node, e.driver);
       not_finished = true;
@@ -800,31 +838,47 @@ void Bitwidth::process_bit_or(Node &node, XEdge_iterator &inp_edges) {
     any_negative = any_negative || it->second.is_always_negative();
 
     if (it->second.is_always_positive())
-      bits = it->second.get_sbits() - 1;
+      max_ubits = std::max<Bits_t>(max_ubits, it->second.get_sbits() - 1);
     else
-      bits = it->second.get_sbits();
+      max_sbits = std::max(max_sbits, it->second.get_sbits());
 
-    if (bits > max_bits)
-      max_bits = bits;
+    if (first) {
+      kb    = it->second.get_known_bits();
+      first = false;
+    } else {
+      kb = Known_bits::bit_or(kb, it->second.get_known_bits());
+    }
   }
 
-  Lconst max_val(0);
-  if (!any_negative) {
-    max_val = (Lconst(1UL) << Lconst(max_bits - 1)) - 1;
+  Lconst max_val;
+  Lconst min_val;
+  if (max_sbits == 0) {  // all positive
+    max_val = (Lconst(1UL) << Lconst(max_ubits)) - 1;
+    min_val = Lconst(0);
+  } else {
+    auto max_bits = std::max<Bits_t>(max_ubits + 1, max_sbits);
+    min_val       = ((Lconst(1UL) << Lconst(max_bits - 1)) - Lconst(1)).not_op();
+    if (any_negative)
+      max_val = Lconst(-1);
+    else
+      max_val = (Lconst(1UL) << Lconst(max_bits - 1)) - 1;
   }
 
-  auto min_val = ((Lconst(1UL) << Lconst(max_bits - 1)) - Lconst(1)).not_op();
+  Bitwidth_range bw(min_val, max_val);
+  bw.set_known_bits(kb);
 
-  adjust_bw(node.get_driver_pin(), Bitwidth_range(min_val, max_val));
+  adjust_bw(node.get_driver_pin(), bw);
 }
 
 void Bitwidth::process_bit_xor(Node &node, XEdge_iterator &inp_edges) {
   I(inp_edges.size() > 1);
-  Bits_t max_bits = 0;
+  Bits_t max_ubits = 0;  // always positive inputs
+  Bits_t max_sbits = 0;  // may be negative inputs
 
+  bool       first = true;
+  Known_bits kb;
   for (auto e : inp_edges) {
-    auto   it   = bwmap.find(e.driver.get_compact_class());
-    Bits_t bits = 0;
+    auto it = bwmap.find(e.driver.get_compact_class());
     if (it == bwmap.end()) {
       debug_unconstrained_msg(node, e.driver);
       not_finished = true;
@@ -832,18 +886,33 @@ void Bitwidth::process_bit_xor(Node &node, XEdge_iterator &inp_edges) {
     }
 
     if (it->second.is_always_positive())
-      bits = it->second.get_sbits() - 1;
+      max_ubits = std::max<Bits_t>(max_ubits, it->second.get_sbits() - 1);
     else
-      bits = it->second.get_sbits();
+      max_sbits = std::max(max_sbits, it->second.get_sbits());
 
-    if (bits > max_bits)
-      max_bits = bits;
+    if (first) {
+      kb    = it->second.get_known_bits();
+      first = false;
+    } else {
+      kb = Known_bits::bit_xor(kb, it->second.get_known_bits());
+    }
   }
 
-  auto max_val = (Lconst(1UL) << Lconst(max_bits - 1)) - 1;
-  auto min_val = Lconst(-1) - max_val;
+  Lconst max_val;
+  Lconst min_val;
+  if (max_sbits == 0) {  // all positive
+    max_val = (Lconst(1UL) << Lconst(max_ubits)) - 1;
+    min_val = Lconst(0);
+  } else {
+    auto max_bits = std::max<Bits_t>(max_ubits + 1, max_sbits);
+    max_val       = (Lconst(1UL) << Lconst(max_bits - 1)) - 1;
+    min_val       = Lconst(-1) - max_val;
+  }
 
-  adjust_bw(node.get_driver_pin(), Bitwidth_range(min_val, max_val));
+  Bitwidth_range bw(min_val, max_val);
+  bw.set_known_bits(kb);
+
+  adjust_bw(node.get_driver_pin(), bw);
 }
 
 void Bitwidth::process_bit_and(Node &node, XEdge_iterator &inp_edges) {
@@ -856,14 +925,19 @@ void Bitwidth::process_bit_and(Node &node, XEdge_iterator &inp_edges) {
   Bits_t pos_min_sbits = Bits_max;  // always positive max bits
   Bits_t unk_max_sbits = 0;         // may be negative minimum number of bits
 
+  Known_bits kb = Known_bits::from_const(-1);
+
   for (auto i = 0u; i < inp_edges.size(); ++i) {
     const auto &e  = inp_edges[i];
     auto        it = bwmap.find(e.driver.get_compact_class());
     if (it == bwmap.end()) {
       unk_max_sbits = Bits_max;  // We do not know
+      kb            = Known_bits::bit_and(kb, Known_bits());
       continue;
     }
 
+    kb = Known_bits::bit_and(kb, it->second.get_known_bits());
+
     Bits_t bw_sbits = it->second.get_sbits();
     I(bw_sbits);
 
@@ -926,6 +1000,7 @@ void Bitwidth::process_bit_and(Node &node, XEdge_iterator &inp_edges) {
   }
 
   Bitwidth_range bw(min_val, max_val);
+  bw.set_known_bits(kb);
 
   adjust_bw(node.get_driver_pin(), bw);
 
@@ -1479,6 +1554,10 @@ void Bitwidth::bw_pass(Lgraph *lg) {
     }
   }
 
+  if (!hier && !not_finished) {
+    process_known_bits(lg);
+  }
+
 #ifndef NDEBUG
   for (auto node : lg->fast(hier)) {
     for (auto dpin : node.out_connected_pins()) {
@@ -1500,6 +1579,55 @@ void Bitwidth::bw_pass(Lgraph *lg) {
 #endif
 }
 
+void Bitwidth::process_known_bits(Lgraph *lg) {
+  uint64_t const_bits  = 0;
+  uint64_t total_bits  = 0;
+  int      const_nodes = 0;
+
+  for (auto node : lg->fast()) {
+    auto op = node.get_type_op();
+    if (op != Ntype_op::Sum && op != Ntype_op::And && op != Ntype_op::Or && op != Ntype_op::Xor && op != Ntype_op::Not
+        && op != Ntype_op::SHL && op != Ntype_op::SRA && op != Ntype_op::Get_mask && op != Ntype_op::Mux)
+      continue;
+
+    auto dpin = node.get_driver_pin();
+    auto it   = bwmap.find(dpin.get_compact_class());
+    if (it == bwmap.end())
+      continue;
+
+    const auto &bw = it->second;
+    total_bits += bw.get_sbits();
+
+    // Only the pins with all the bits known are removed. The partially known
+    // pins just tighten the range (and the width that cgen emits).
+    if (!bw.is_known_const())
+      continue;
+
+    // All the bits are known, replace by a constant so that cprop/cgen do not generate logic
+    const_bits += bw.get_sbits();
+    ++const_nodes;
+
+    auto const_node = node.create_const(Lconst(bw.min));
+    auto const_dpin = const_node.setup_driver_pin();
+    bwmap.insert_or_assign(const_dpin.get_compact_class(), bw);
+    for (auto &e : node.out_edges()) {
+      e.sink.connect_driver(const_dpin);
+    }
+    node.del_node();
+  }
+
+  known_const_bits += const_bits;
+  known_total_bits += total_bits;
+
+  if (verbose) {
+    fmt::print("pass.bitwidth lgraph:{} {} nodes became constant, removed {} of {} bits\n",
+               lg->get_name(),
+               const_nodes,
+               const_bits,
+               total_bits);
+  }
+}
+
 void Bitwidth::try_delete_attr_node(Node &node) {
   I(!hier);
 
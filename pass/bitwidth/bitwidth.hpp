@@ -8,11 +8,13 @@
 #include "node.hpp"
 #include "node_pin.hpp"
 #include "pass.hpp"
+#include "side_array.hpp"
 
 class Bitwidth {
 protected:
   int  max_iterations;
   bool hier;
+  bool verbose;
   bool discovered_some_backward_nodes_try_again;
 
   enum class Attr { Set_other, Set_ubits, Set_sbits, Set_max, Set_min, Set_dp_assign };
@@ -20,7 +22,9 @@ protected:
   static Attr get_key_attr(const mmap_lib::str &key);
 
   bool                                                         not_finished;
-  absl::flat_hash_map<Node_pin::Compact_class, Bitwidth_range> bwmap;  // bwmap indexing with dpin_compact_class, nid
+  uint64_t                                                     known_const_bits;  // bits of the pins replaced by a constant
+  uint64_t                                                     known_total_bits;  // bits of the pins checked for known bits
+  Pin_side_array<Bitwidth_range>                               bwmap;  // bwmap indexing with dpin_compact_class, nid
   // absl::flat_hash_map<Node_pin::Compact_flat , Bitwidth_range> bwmap_flat;  // bwmap indexing with dpin_compact_flat, (lgid, nid)
   // absl::flat_hash_map<Node_pin::Compact      , Bitwidth_range> bwmap_hier;  // bwmap indexing with dpin_compact,      (hidx, nid)
 
@@ -60,11 +64,15 @@ protected:
   void debug_unconstrained_msg(Node &node, Node_pin &d_dpin);
   void try_delete_attr_node(Node &node);
   void set_subgraph_boundary_bw(Node &node);
+  void process_known_bits(Lgraph *lg);
 
   void bw_pass(Lgraph *lg);
 
 public:
-  Bitwidth(bool hier, int max_iterations);
+  Bitwidth(bool hier, int max_iterations, bool verbose = false);
   void do_trans(Lgraph *orig);
   bool is_finished() const { return !not_finished; }
+
+  uint64_t get_known_const_bits() const { return known_const_bits; }
+  uint64_t get_known_total_bits() const { return known_total_bits; }
 };
@@ -6,6 +6,87 @@
 #include "iassert.hpp"
 #include "likely.hpp"
 
+Known_bits Known_bits::add(const Known_bits &a, const Known_bits &b, bool carry_in) {
+  uint64_t x = a.ones + b.ones + (carry_in ? 1 : 0);  // min value
+
+  uint64_t unknowns = a.unknowns | b.unknowns | (x ^ (x + a.unknowns + b.unknowns));
+
+  return Known_bits(x, unknowns);
+}
+
+Known_bits Known_bits::bit_and(const Known_bits &a, const Known_bits &b) {
+  uint64_t ones  = a.ones & b.ones;
+  uint64_t zeros = a.get_zeros() | b.get_zeros();
+
+  return Known_bits(ones, ~(ones | zeros));
+}
+
+Known_bits Known_bits::bit_or(const Known_bits &a, const Known_bits &b) {
+  uint64_t ones  = a.ones | b.ones;
+  uint64_t zeros = a.get_zeros() & b.get_zeros();
+
+  return Known_bits(ones, ~(ones | zeros));
+}
+
+Known_bits Known_bits::bit_xor(const Known_bits &a, const Known_bits &b) {
+  return Known_bits(a.ones ^ b.ones, a.unknowns | b.unknowns);
+}
+
+Known_bits Known_bits::bit_not(const Known_bits &a) { return Known_bits(a.get_zeros(), a.unknowns); }
+
+Known_bits Known_bits::shl(const Known_bits &a, int amount) {
+  I(amount >= 0);
+  if (amount >= 64)
+    return Known_bits(0, 0);
+
+  return Known_bits(a.ones << amount, a.unknowns << amount);
+}
+
+Known_bits Known_bits::sra(const Known_bits &a, int amount) {
+  I(amount >= 0);
+  if (amount > 63)
+    amount = 63;  // only sign bits left
+
+  auto ones     = static_cast<int64_t>(a.ones) >> amount;
+  auto unknowns = static_cast<int64_t>(a.unknowns) >> amount;
+
+  return Known_bits(static_cast<uint64_t>(ones), static_cast<uint64_t>(unknowns));
+}
+
+Known_bits Known_bits::get_mask(const Known_bits &a, uint64_t mask) {
+  // Gather the masked bits to the LSB (zero extended result, pext like)
+  uint64_t ones     = 0;
+  uint64_t unknowns = 0;
+
+  int dst = 0;
+  for (int src = 0; src < 64; ++src) {
+    if (!((mask >> src) & 1))
+      continue;
+
+    ones |= ((a.ones >> src) & 1) << dst;
+    unknowns |= ((a.unknowns >> src) & 1) << dst;
+    ++dst;
+  }
+
+  return Known_bits(ones, unknowns);
+}
+
+Known_bits Known_bits::join(const Known_bits &a, const Known_bits &b) {
+  uint64_t unknowns = a.unknowns | b.unknowns | (a.ones ^ b.ones);
+
+  return Known_bits(a.ones & b.ones, unknowns);
+}
+
+Known_bits Known_bits::meet(const Known_bits &a, const Known_bits &b) {
+  uint64_t ones  = a.ones | b.ones;
+  uint64_t zeros = a.get_zeros() | b.get_zeros();
+
+  if (ones & zeros)  // conflict, keep the first one
+    return a;
+
+  return Known_bits(ones, ~(ones | zeros));
+}
+
 Lconst Bitwidth_range::to_lconst(bool overflow, int64_t val) {
   if (!overflow) {
     return Lconst(val);
@@ -35,15 +116,19 @@ Bitwidth_range::Bitwidth_range(const Lconst &val) {
       min = bits;
     }
   }
+  refine_known_from_range();
 }
 
 void Bitwidth_range::set_range(const Lconst &min_val, const Lconst &max_val) {
   I(max_val >= min_val);
 
+  kb = Known_bits();
+
   if (max_val.is_i() && min_val.is_i()) {
     overflow = false;
     max      = max_val.to_i();
     min      = min_val.to_i();
+    refine_known_from_range();
   } else {
     overflow = true;
     if (max_val == 0) {
@@ -76,6 +161,8 @@ void Bitwidth_range::set_narrower_range(const Bitwidth_range &bw) {
   if (likely(!bw.is_overflow() && !is_overflow())) {
     max = std::min(max, bw.max);
     min = std::max(min, bw.min);
+    if (min <= max)
+      set_known_bits(bw.kb);
     return;
   }
 
@@ -96,6 +183,8 @@ void Bitwidth_range::set_wider_range(const Bitwidth_range &bw) {
   if (likely(!bw.is_overflow() && !is_overflow())) {
     max = std::max(max, bw.max);
     min = std::min(min, bw.min);
+    kb  = Known_bits::join(kb, bw.kb);
+    refine_known_from_range();
     return;
   }
 
@@ -119,6 +208,7 @@ void Bitwidth_range::set_sbits_range(Bits_t size) {
     overflow = true;
     max      = 326768;
     min      = -32768;
+    kb       = Known_bits();
     return;
   }
 
@@ -133,6 +223,9 @@ void Bitwidth_range::set_sbits_range(Bits_t size) {
     // min      = -(1LL << (size - 1));
   }
   min = -max - 1;
+
+  kb = Known_bits();
+  refine_known_from_range();
 }
 
 void Bitwidth_range::set_ubits_range(Bits_t size) {
@@ -142,6 +235,7 @@ void Bitwidth_range::set_ubits_range(Bits_t size) {
     overflow = true;
     max      = 326768;
     min      = 0;
+    kb       = Known_bits();
     return;
   }
   assert(size);
@@ -155,6 +249,9 @@ void Bitwidth_range::set_ubits_range(Bits_t size) {
     overflow = false;
     max      = (1UL << size) - 1;
   }
+
+  kb = Known_bits();
+  refine_known_from_range();
 }
 
 // we get sbits from the max/min since every thing in lgraph should be initially signed
@@ -177,7 +274,86 @@ Bits_t Bitwidth_range::get_sbits() const {
   return bits;
 }
 
+void Bitwidth_range::refine_known_from_range() {
+  if (overflow) {
+    kb = Known_bits();
+    return;
+  }
+
+  if ((min < 0) != (max < 0))
+    return;  // No common prefix, nothing to learn
+
+  // Same sign: all the values in [min,max] share the bits above the highest different bit
+  auto diff = static_cast<uint64_t>(min) ^ static_cast<uint64_t>(max);
+
+  Known_bits range_kb;
+  if (diff == 0) {
+    range_kb = Known_bits::from_const(min);
+  } else {
+    auto     top      = 63 - __builtin_clzll(diff);
+    uint64_t unknowns = (top >= 63) ? ~0ULL : ((1ULL << (top + 1)) - 1);
+    range_kb          = Known_bits(static_cast<uint64_t>(min), unknowns);
+  }
+
+  kb = Known_bits::meet(range_kb, kb);
+}
+
+void Bitwidth_range::refine_range_from_known() {
+  if (overflow || kb.is_unknown())
+    return;
+
+  constexpr uint64_t sign = 1ULL << 63;
+
+  int64_t kmin;
+  int64_t kmax;
+  if (kb.unknowns & sign) {
+    kmin = static_cast<int64_t>(kb.ones | sign);
+    kmax = static_cast<int64_t>((kb.ones | kb.unknowns) & ~sign);
+  } else {
+    kmin = static_cast<int64_t>(kb.ones);
+    kmax = static_cast<int64_t>(kb.ones | kb.unknowns);
+  }
+
+  if (kmin > max || kmax < min)
+    return;  // inconsistent (should not happen), keep the range
+
+  min = std::max(min, kmin);
+  max = std::min(max, kmax);
+}
+
+bool Bitwidth_range::set_known_bits(const Known_bits &k) {
+  if (overflow)
+    return false;
+
+  if ((kb.ones | k.ones) & (kb.get_zeros() | k.get_zeros()))
+    return false;  // conflicting bits
+
+  kb = Known_bits::meet(kb, k);
+  refine_range_from_known();
+  refine_known_from_range();
+
+  return true;
+}
+
+Bits_t Bitwidth_range::get_known_const_bits() const {
+  if (overflow)
+    return 0;
+
+  auto bits = get_sbits();
+  if (bits <= 1)
+    return 0;
+
+  --bits;  // sign bit (or leading zero) is always needed
+  uint64_t mask = bits >= 64 ? ~0ULL : ((1ULL << bits) - 1);
+
+  return __builtin_popcountll(~kb.unknowns & mask);
+}
+
 void Bitwidth_range::dump() const {
   //(max, min, sbis, overflow)
-  fmt::print("({}, {}, {}b) {}\n", max, min, get_sbits(), overflow ? "overflow" : "");
+  if (has_known_bits()) {
+    fmt::print("({}, {}, {}b) {} ones:0x{:x} unknowns:0x{:x}\n", max, min, get_sbits(), overflow ? "overflow" : "", kb.ones, kb.unknowns);
+  } else {
+    fmt::print("({}, {}, {}b) {}\n", max, min, get_sbits(), overflow ? "overflow" : "");
+  }
 }
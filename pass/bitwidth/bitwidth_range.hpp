@@ -5,44 +5,50 @@
 
 #include "lconst.hpp"
 
+struct __attribute__((packed)) Known_bits {
+  uint64_t ones;      // bits guaranteed to be one
+  uint64_t unknowns;  // bits that can be zero or one
+
+  Known_bits() : ones(0), unknowns(~0ULL) {}
+  Known_bits(uint64_t o, uint64_t u) : ones(o & ~u), unknowns(u) {}
+
+  uint64_t get_zeros() const { return ~(ones | unknowns); }
+  bool     is_unknown() const { return unknowns == ~0ULL; }
+  bool     is_const() const { return unknowns == 0; }
+
+  static Known_bits from_const(int64_t val) { return Known_bits(static_cast<uint64_t>(val), 0); }
+
+  static Known_bits add(const Known_bits &a, const Known_bits &b, bool carry_in = false);
+  static Known_bits sub(const Known_bits &a, const Known_bits &b) { return add(a, bit_not(b), true); }
+  static Known_bits bit_and(const Known_bits &a, const Known_bits &b);
+  static Known_bits bit_or(const Known_bits &a, const Known_bits &b);
+  static Known_bits bit_xor(const Known_bits &a, const Known_bits &b);
+  static Known_bits bit_not(const Known_bits &a);
+  static Known_bits shl(const Known_bits &a, int amount);
+  static Known_bits sra(const Known_bits &a, int amount);
+  static Known_bits get_mask(const Known_bits &a, uint64_t mask);
+  static Known_bits join(const Known_bits &a, const Known_bits &b);  // either a or b (mux)
+  static Known_bits meet(const Known_bits &a, const Known_bits &b);  // both a and b hold
+};
+
 class __attribute__((packed)) Bitwidth_range {
 protected:
   static Lconst to_lconst(bool overflow, int64_t val);
 
-  // TODO:
-  //  It may be interesting to explore to have unknowns, known zero, know ones
-  //  for inside the valid range (when not overflow). Some code like:
-  //  https://dougallj.wordpress.com/2020/01/13/bit-twiddling-addition-with-unknown-bits/
-  //
-  // struct known_bits {
-  //   unsigned ones;
-  //   unsigned unknowns;
-  // };
-  //
-  // struct known_bits kb_add(struct known_bits a, struct known_bits b) {
-  //  struct known_bits result;
-  //  unsigned x = a.ones + b.ones;
-  //  result.unknowns = a.unknowns | b.unknowns | (x ^ (x + a.unknowns + b.unknowns));
-  //  result.ones = x & ~result.unknowns;
-  //  return result;
-  // }
-  //
-  //  This could help to find simpler code.
+  // Known bits are tracked for the 64bit two's complement value (only valid
+  // when !overflow). Based on:
+  // https://dougallj.wordpress.com/2020/01/13/bit-twiddling-addition-with-unknown-bits/
   //
   //  E.g: if the bit 1 is guarantee to be zero:
   //
   //  x = get_mask(x,-3); // 0b111...101
   //
-  //  If guaranteed to be one:
-  //
-  //  x = or(get_mask(x,-3), 0x2)
-  //
-  //  NOTE: IF lower bits are dropped, the result has less bits (get_max(x,-2)
-  //
   //  When translating to mockturtle those bits should be set to zero/one for speed and better optimization
   //
   //  When generating Verilog/Pyrope we could
   //  {x[33:2], 1'b0, x[0]} // verilog
+  void refine_known_from_range();
+  void refine_range_from_known();
 
 public:
   int64_t max;
@@ -50,19 +56,23 @@ public:
 
   bool overflow;
 
-  Bitwidth_range() : max(0), min(0), overflow(false) {}
+  Known_bits kb;
+
+  Bitwidth_range() : max(0), min(0), overflow(false), kb(Known_bits::from_const(0)) {}
 
   Bitwidth_range(const Bitwidth_range &i) {
     max = i.max;
     min = i.min;
 
     overflow = i.overflow;
+    kb       = i.kb;
   };
 
   constexpr Bitwidth_range &operator=(const Bitwidth_range &r) {
     max      = r.max;
     min      = r.min;
     overflow = r.overflow;
+    kb       = r.kb;
 
     return *this;
   }
@@ -75,6 +85,7 @@ public:
     min      = min_val;
     max      = max_val;
     overflow = false;
+    refine_known_from_range();
   }
 
   void set_narrower_range(const Bitwidth_range &bw);
@@ -99,6 +110,13 @@ public:
   Lconst get_min() const { return to_lconst(overflow, min); };
   int    get_raw_max() const { return max; };
 
+  // Narrow the known bits (and the range with them). Returns false if inconsistent with the range (ignored)
+  bool              set_known_bits(const Known_bits &k);
+  const Known_bits &get_known_bits() const { return kb; }
+  bool              has_known_bits() const { return !overflow && !kb.is_unknown(); }
+  bool              is_known_const() const { return !overflow && kb.is_const(); }
+  Bits_t            get_known_const_bits() const;  // constant bits inside the get_sbits() width
+
   bool is_always_negative() const { return max < 0; }
   bool is_always_positive() const { return min >= 0; }
   bool is_2complement() const { return min < 0; }
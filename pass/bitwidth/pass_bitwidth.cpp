@@ -14,6 +14,7 @@ void Pass_bitwidth::setup() {
 
   m1.add_label_optional("max_iterations", mmap_lib::str("maximum number of iterations to try"), "3");
   m1.add_label_optional("hier", mmap_lib::str("hierarchical bitwidth"), "false");
+  m1.add_label_optional("verbose", mmap_lib::str("print the bits replaced by constants"), "false");
 
   register_pass(m1);
 }
@@ -27,6 +28,13 @@ Pass_bitwidth::Pass_bitwidth(const Eprp_var &var) : Pass("pass.bitwidth", var) {
   else
     hier = false;
 
+  auto verbose_txt = var.get("verbose");
+
+  if (verbose_txt != "false" && verbose_txt != "0")
+    verbose = true;
+  else
+    verbose = false;
+
   if (!miters.is_i()) {
     error("pass.bitwidth max_iterations:{} should be bigger than zero and less than 100", miters);
     return;
@@ -43,10 +51,14 @@ Pass_bitwidth::Pass_bitwidth(const Eprp_var &var) : Pass("pass.bitwidth", var) {
 void Pass_bitwidth::trans(Eprp_var &var) {
   Pass_bitwidth p(var);
 
-  Bitwidth bw(p.hier, p.max_iterations);
+  Bitwidth bw(p.hier, p.max_iterations, p.verbose);
 
   std::vector<const Lgraph *> lgs;
   for (const auto &lg : var.lgs) {
     bw.do_trans(lg);
   }
+
+  if (p.verbose && bw.get_known_total_bits()) {
+    fmt::print("pass.bitwidth known bits removed {} of {} bits\n", bw.get_known_const_bits(), bw.get_known_total_bits());
+  }
 }
@@ -14,6 +14,7 @@ protected:
   int         max_iterations;
   bool        must_perform_backward;
   bool        hier;
+  bool        verbose;
   static void trans(Eprp_var &var);
 
 public:
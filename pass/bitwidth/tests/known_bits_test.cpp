@@ -0,0 +1,228 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bitwidth_range.hpp"
+#include "gtest/gtest.h"
+
+class Known_bits_test : public ::testing::Test {
+protected:
+  std::mt19937_64 rng{42};
+
+  // Random lattice value with up to 6 unknown bits (so all the values can be enumerated)
+  Known_bits random_kb() {
+    uint64_t unknowns = 0;
+    auto     n        = rng() % 7;
+    for (auto i = 0u; i < n; ++i) {
+      unknowns |= 1ULL << (rng() % 64);
+    }
+    return Known_bits(rng(), unknowns);
+  }
+
+  static std::vector<uint64_t> values(const Known_bits &k) {
+    std::vector<uint64_t> v;
+
+    uint64_t sub = 0;  // every subset of the unknown bits
+    do {
+      v.emplace_back(k.ones | sub);
+      sub = (sub - k.unknowns) & k.unknowns;
+    } while (sub != 0);
+
+    return v;
+  }
+
+  static bool contains(const Known_bits &k, uint64_t val) {
+    return (val & ~k.unknowns) == k.ones;
+  }
+};
+
+TEST_F(Known_bits_test, constructor) {
+  Known_bits unknown;
+  EXPECT_TRUE(unknown.is_unknown());
+  EXPECT_FALSE(unknown.is_const());
+
+  auto c = Known_bits::from_const(-3);
+  EXPECT_TRUE(c.is_const());
+  EXPECT_EQ(c.ones, static_cast<uint64_t>(-3));
+  EXPECT_EQ(c.get_zeros(), 2u);
+
+  Known_bits k(0xFF, 0x0F);  // ones inside the unknowns are dropped
+  EXPECT_EQ(k.ones, 0xF0u);
+  EXPECT_EQ(k.get_zeros(), ~0xFFULL);
+}
+
+TEST_F(Known_bits_test, constants) {
+  for (auto i = 0; i < 1000; ++i) {
+    auto a = static_cast<int64_t>(rng());
+    auto b = static_cast<int64_t>(rng());
+    auto s = static_cast<int>(rng() % 64);
+
+    auto ka = Known_bits::from_const(a);
+    auto kb = Known_bits::from_const(b);
+
+    EXPECT_EQ(Known_bits::add(ka, kb).ones, static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+    EXPECT_EQ(Known_bits::sub(ka, kb).ones, static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+    EXPECT_EQ(Known_bits::bit_and(ka, kb).ones, static_cast<uint64_t>(a & b));
+    EXPECT_EQ(Known_bits::bit_or(ka, kb).ones, static_cast<uint64_t>(a | b));
+    EXPECT_EQ(Known_bits::bit_xor(ka, kb).ones, static_cast<uint64_t>(a ^ b));
+    EXPECT_EQ(Known_bits::bit_not(ka).ones, ~static_cast<uint64_t>(a));
+    EXPECT_EQ(Known_bits::shl(ka, s).ones, static_cast<uint64_t>(a) << s);
+    EXPECT_EQ(Known_bits::sra(ka, s).ones, static_cast<uint64_t>(a >> s));
+
+    EXPECT_TRUE(Known_bits::add(ka, kb).is_const());
+    EXPECT_TRUE(Known_bits::bit_xor(ka, kb).is_const());
+    EXPECT_TRUE(Known_bits::sra(ka, s).is_const());
+  }
+
+  EXPECT_EQ(Known_bits::get_mask(Known_bits::from_const(0b101100), 0b111100).ones, 0b1011u);
+  EXPECT_TRUE(Known_bits::shl(Known_bits(), 64).is_const());
+}
+
+TEST_F(Known_bits_test, sound_binary_ops) {
+  // Every concrete result must be inside the abstract result
+  for (auto i = 0; i < 300; ++i) {
+    auto a = random_kb();
+    auto b = random_kb();
+
+    auto r_add = Known_bits::add(a, b);
+    auto r_sub = Known_bits::sub(a, b);
+    auto r_and = Known_bits::bit_and(a, b);
+    auto r_or  = Known_bits::bit_or(a, b);
+    auto r_xor = Known_bits::bit_xor(a, b);
+    auto r_mux = Known_bits::join(a, b);
+
+    for (auto x : values(a)) {
+      for (auto y : values(b)) {
+        EXPECT_TRUE(contains(r_add, x + y));
+        EXPECT_TRUE(contains(r_sub, x - y));
+        EXPECT_TRUE(contains(r_and, x & y));
+        EXPECT_TRUE(contains(r_or, x | y));
+        EXPECT_TRUE(contains(r_xor, x ^ y));
+      }
+      EXPECT_TRUE(contains(r_mux, x));
+    }
+    for (auto y : values(b)) {
+      EXPECT_TRUE(contains(r_mux, y));
+    }
+  }
+}
+
+TEST_F(Known_bits_test, sound_unary_ops) {
+  for (auto i = 0; i < 300; ++i) {
+    auto a    = random_kb();
+    auto s    = static_cast<int>(rng() % 70);
+    auto mask = rng();
+
+    auto r_not  = Known_bits::bit_not(a);
+    auto r_shl  = Known_bits::shl(a, s);
+    auto r_sra  = Known_bits::sra(a, s);
+    auto r_mask = Known_bits::get_mask(a, mask);
+
+    for (auto x : values(a)) {
+      EXPECT_TRUE(contains(r_not, ~x));
+      EXPECT_TRUE(contains(r_shl, s >= 64 ? 0 : x << s));
+      EXPECT_TRUE(contains(r_sra, static_cast<uint64_t>(static_cast<int64_t>(x) >> (s > 63 ? 63 : s))));
+
+      uint64_t pext = 0;
+      int      dst  = 0;
+      for (auto src = 0; src < 64; ++src) {
+        if ((mask >> src) & 1) {
+          pext |= ((x >> src) & 1) << dst++;
+        }
+      }
+      EXPECT_TRUE(contains(r_mask, pext));
+    }
+  }
+}
+
+TEST_F(Known_bits_test, precise_ops) {
+  // Known zeros/ones must survive where the operation guarantees them
+  Known_bits low_unknown(0, 0xF);  // 0..15
+
+  auto r_and = Known_bits::bit_and(low_unknown, Known_bits::from_const(0x3));
+  EXPECT_EQ(r_and.unknowns, 0x3u);
+  EXPECT_EQ(r_and.ones, 0u);
+
+  auto r_or = Known_bits::bit_or(low_unknown, Known_bits::from_const(0x10));
+  EXPECT_EQ(r_or.unknowns, 0xFu);
+  EXPECT_EQ(r_or.ones, 0x10u);
+
+  auto r_xor = Known_bits::bit_xor(low_unknown, Known_bits::from_const(0x30));
+  EXPECT_EQ(r_xor.unknowns, 0xFu);
+  EXPECT_EQ(r_xor.ones, 0x30u);
+
+  auto r_shl = Known_bits::shl(low_unknown, 4);
+  EXPECT_EQ(r_shl.unknowns, 0xF0u);
+  EXPECT_EQ(r_shl.ones, 0u);
+
+  auto r_add = Known_bits::add(low_unknown, Known_bits::from_const(0x100));
+  EXPECT_EQ(r_add.unknowns, 0xFu);
+  EXPECT_EQ(r_add.ones, 0x100u);
+
+  auto r_sra = Known_bits::sra(Known_bits::from_const(-16), 2);
+  EXPECT_EQ(r_sra.ones, static_cast<uint64_t>(-4));
+}
+
+TEST_F(Known_bits_test, merge) {
+  auto a = Known_bits::from_const(0b1100);
+  auto b = Known_bits::from_const(0b1010);
+
+  auto j = Known_bits::join(a, b);  // either one
+  EXPECT_EQ(j.unknowns, 0b0110u);
+  EXPECT_EQ(j.ones, 0b1000u);
+
+  Known_bits hi_known(0xF0, 0x0F);      // 0xF?
+  Known_bits lo_known(0x05, ~0x0FULL);  // ..?5
+
+  auto m = Known_bits::meet(hi_known, lo_known);  // both hold
+  EXPECT_TRUE(m.is_const());
+  EXPECT_EQ(m.ones, 0xF5u);
+
+  auto conflict = Known_bits::meet(a, b);  // keeps the first one
+  EXPECT_EQ(conflict.ones, a.ones);
+  EXPECT_EQ(conflict.unknowns, a.unknowns);
+
+  for (auto i = 0; i < 300; ++i) {
+    auto x = random_kb();
+    auto y = random_kb();
+
+    auto jj = Known_bits::join(x, y);
+    EXPECT_EQ(jj.unknowns & x.unknowns, x.unknowns);  // join is above both
+    EXPECT_EQ(jj.unknowns & y.unknowns, y.unknowns);
+
+    auto mm = Known_bits::meet(x, y);
+    if ((x.ones | y.ones) & (x.get_zeros() | y.get_zeros()))
+      continue;
+    for (auto v : values(mm)) {  // meet is below both
+      EXPECT_TRUE(contains(x, v));
+      EXPECT_TRUE(contains(y, v));
+    }
+  }
+}
+
+TEST_F(Known_bits_test, range_refinement) {
+  Bitwidth_range bw;
+  bw.set_range(Lconst(0x100), Lconst(0x1FF));
+
+  auto kb = bw.get_known_bits();
+  EXPECT_EQ(kb.unknowns, 0xFFu);  // common prefix of min and max
+  EXPECT_EQ(kb.ones, 0x100u);
+
+  EXPECT_TRUE(bw.set_known_bits(Known_bits(0x100, 0x0F)));  // top nibble is zero
+  EXPECT_EQ(bw.get_raw_max(), 0x10F);
+  EXPECT_EQ(bw.min, 0x100);
+
+  EXPECT_FALSE(bw.set_known_bits(Known_bits::from_const(0x3FF)));  // conflicts, ignored
+  EXPECT_EQ(bw.get_raw_max(), 0x10F);
+
+  Bitwidth_range c(Lconst(-7));
+  EXPECT_TRUE(c.is_known_const());
+
+  Bitwidth_range w(Lconst(8));
+  w.set_wider_range(Bitwidth_range(Lconst(12)));  // mux of 8 or 12
+  EXPECT_EQ(w.get_known_bits().unknowns, 0x4u);
+  EXPECT_EQ(w.get_known_bits().ones, 0x8u);
+  EXPECT_FALSE(w.is_known_const());
+}
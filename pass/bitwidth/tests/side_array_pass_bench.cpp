@@ -0,0 +1,123 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Per pass time and peak RSS for the passes that keep their per pin/node
+// tables in side arrays (pass.bitwidth bwmap and pass.cprop node2tuple).
+// The design is a large synthetic datapath: random Sum/And/Or/Xor/Not/SHL/Mux
+// nodes fed by earlier nodes, graph inputs and constants.
+//
+// side_array_pass_bench [n_nodes]
+
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+
+#include "bitwidth.hpp"
+#include "cprop.hpp"
+#include "fmt/format.h"
+#include "lbench.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+static long get_peak_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static Lgraph *create_design(int n_nodes) {
+  auto *lg = Lgraph::create("lgdb_side_array_bench", "side_array_bench", "-");
+
+  Lrand<int> rng;
+
+  std::vector<Node_pin> dpins;
+  for (auto i = 0; i < 16; ++i) {
+    dpins.emplace_back(lg->add_graph_input(mmap_lib::str::concat("i", std::to_string(i)), i, 16));
+  }
+
+  auto pick = [&]() { return dpins[dpins.size() - 1 - rng.max(std::min<int>(dpins.size(), 64))]; };
+
+  for (auto i = 0; i < n_nodes; ++i) {
+    Node node;
+    switch (rng.max(7)) {
+      case 0:
+        node = lg->create_node(Ntype_op::Sum);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("B").connect_driver(pick());
+        break;
+      case 1:
+        node = lg->create_node(Ntype_op::And);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("A").connect_driver(lg->create_node_const(rng.max(0xFFFF)).setup_driver_pin());
+        break;
+      case 2:
+        node = lg->create_node(Ntype_op::Or);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("A").connect_driver(pick());
+        break;
+      case 3:
+        node = lg->create_node(Ntype_op::Xor);
+        node.setup_sink_pin("A").connect_driver(pick());
+        node.setup_sink_pin("A").connect_driver(pick());
+        break;
+      case 4:
+        node = lg->create_node(Ntype_op::Not);
+        node.setup_sink_pin("a").connect_driver(pick());
+        break;
+      case 5:
+        node = lg->create_node(Ntype_op::SHL);
+        node.setup_sink_pin("a").connect_driver(pick());
+        node.setup_sink_pin("B").connect_driver(lg->create_node_const(rng.max(4)).setup_driver_pin());
+        break;
+      default:
+        node = lg->create_node(Ntype_op::Mux);
+        node.setup_sink_pin("0").connect_driver(pick());
+        node.setup_sink_pin("1").connect_driver(pick());
+        node.setup_sink_pin("2").connect_driver(pick());
+        break;
+    }
+    dpins.emplace_back(node.setup_driver_pin());
+  }
+
+  for (auto i = 0; i < 16; ++i) {
+    auto out = lg->add_graph_output(mmap_lib::str::concat("o", std::to_string(i)), 16 + i, 16);
+    dpins[dpins.size() - 1 - i].connect_sink(out);
+  }
+
+  return lg;
+}
+
+template <typename F>
+static void measure(const std::string &name, F fn) {
+  auto rss_start = get_peak_rss_kb();
+
+  Lbench b(name);
+  fn();
+  fmt::print("{:<14} secs:{:.3f} peak_rss_delta:{}KB peak_rss:{}KB\n",
+             name,
+             b.get_secs(),
+             get_peak_rss_kb() - rss_start,
+             get_peak_rss_kb());
+}
+
+int main(int argc, char **argv) {
+  int n_nodes = argc > 1 ? std::stoi(argv[1]) : 1000000;
+
+  Lgraph *lg = nullptr;
+  measure("create", [&]() { lg = create_design(n_nodes); });
+  fmt::print("design nodes:{}\n", lg->size());
+
+  measure("pass.cprop", [&]() {
+    Cprop cp(false);
+    cp.do_trans(lg);
+  });
+
+  measure("pass.bitwidth", [&]() {
+    Bitwidth bw(false, 3);
+    bw.do_trans(lg);
+  });
+
+  lg->sync();
+
+  return 0;
+}
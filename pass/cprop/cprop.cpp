@@ -19,7 +19,7 @@
 // Single step CPROP for debugging
 //#define TRIVIAL_CPROP
 
-Cprop::Cprop(bool _hier) : hier(_hier), tuple_found(false) {}
+Cprop::Cprop(bool _hier) : hier(_hier), tuple_found(false), node2tuple(_hier), tuple_done(_hier) {}
 
 std::tuple<Node_pin, std::shared_ptr<Lgtuple const>> Cprop::get_value(const Node &node) const {
   I(node.is_type(Ntype_op::TupAdd) || node.is_type(Ntype_op::AttrSet));
@@ -697,7 +697,7 @@ void Cprop::tuple_mux_mut(Node &node) {
 
   auto [tup, pending_iterations] = Lgtuple::get_mux_tup(tup_list);  // it can handle tuples with issues
   if (tup) {
-    node2tuple[node.get_compact()] = tup;
+    node2tuple[node] = tup;
   }
 
   if (tup == nullptr && tuple_issues)
@@ -714,20 +714,20 @@ void Cprop::tuple_mux_mut(Node &node) {
 
   if (!tup) {
     if (!tuple_issues)
-      tuple_done.insert(node.get_compact());
+      tuple_done[node] = true;
     return;
   }
   I(tup->is_correct());
 
   auto cmux_list                 = tup->make_mux(node, sel_dpin, tup_list);
-  node2tuple[node.get_compact()] = tup;
+  node2tuple[node] = tup;
   for (auto &cmux : cmux_list) {
-    tuple_done.insert(cmux);
+    tuple_done[Node(node.get_top_lgraph(), cmux)] = true;
   }
 }
 
 void Cprop::tuple_flop_mut(Node &node) {
-  I(!tuple_done.contains(node.get_compact()));
+  I(!tuple_done.contains(node));
 
   if (!node.has_outputs())
     return;
@@ -740,11 +740,11 @@ void Cprop::tuple_flop_mut(Node &node) {
 
   auto din_node = node.get_sink_pin("din").get_driver_node();
 
-  auto din_it = node2tuple.find(din_node.get_compact());
-  if (din_it == node2tuple.end())
+  auto din_it = node2tuple.find(din_node);
+  if (din_it == nullptr)
     return;
 
-  auto din_tup = din_it->second;
+  auto din_tup = *din_it;
 
   if (!din_tup->is_correct()) {
     I(tuple_issues);
@@ -753,8 +753,8 @@ void Cprop::tuple_flop_mut(Node &node) {
     return;
   }
 
-  auto node_it = node2tuple.find(node.get_compact());
-  if (node_it != node2tuple.end())
+  auto node_it = node2tuple.find(node);
+  if (node_it != nullptr)
     return;
 
   auto [flop_tup, pending_iterations] = din_tup->get_flop_tup(node);
@@ -767,18 +767,18 @@ void Cprop::tuple_flop_mut(Node &node) {
   }
 
   if (flop_tup) {
-    node2tuple[node.get_compact()] = flop_tup;
+    node2tuple[node] = flop_tup;
   }
   if (tuple_issues || !flop_tup)
     return;
 
   flop_tup = din_tup->make_flop(node);
   I(flop_tup);
-  node2tuple[node.get_compact()] = flop_tup;
+  node2tuple[node] = flop_tup;
 
   for (const auto &e : flop_tup->get_map()) {
     if (e.second.is_type_flop()) {
-      tuple_done.insert(e.second.get_node().get_compact());
+      tuple_done[e.second.get_node()] = true;
     }
   }
   tuple_issues = true;  // FIXME: trigger next iter, no issues
@@ -789,21 +789,21 @@ void Cprop::tuple_get_mask_mut(Node &node) {
   //
   // output is always scalar
 
-  auto a_it   = node2tuple.end();
+  const std::shared_ptr<Lgtuple const> *a_it = nullptr;
   auto a_spin = node.get_sink_pin("a");
   if (a_spin.is_connected()) {
     auto a_node = a_spin.get_driver_node();
-    a_it        = node2tuple.find(a_node.get_compact());
+    a_it        = node2tuple.find(a_node);
   }
 
-  auto mask_it   = node2tuple.end();
+  const std::shared_ptr<Lgtuple const> *mask_it = nullptr;
   auto mask_spin = node.get_sink_pin("mask");
   if (mask_spin.is_connected()) {
     auto mask_node = mask_spin.get_driver_node();
-    mask_it        = node2tuple.find(mask_node.get_compact());
+    mask_it        = node2tuple.find(mask_node);
   }
 
-  if (a_it == node2tuple.end() && mask_it == node2tuple.end()) {
+  if (a_it == nullptr && mask_it == nullptr) {
     return;
   }
 
@@ -814,8 +814,8 @@ void Cprop::tuple_get_mask_mut(Node &node) {
   //---------------------------------------------
   // Figure out "a" sink
 
-  if (a_it != node2tuple.end()) {
-    auto a_tup = a_it->second;
+  if (a_it != nullptr) {
+    auto a_tup = *a_it;
     I(a_tup->is_correct());
 
     if (a_tup->is_empty()) {
@@ -834,11 +834,11 @@ void Cprop::tuple_get_mask_mut(Node &node) {
 
   //---------------------------------------------
   // Figure out "mask" sink
-  if (mask_it == node2tuple.end()) {
+  if (mask_it == nullptr) {
     return;
   }
 
-  auto mask_tup = mask_it->second;
+  auto mask_tup = *mask_it;
   if (!mask_tup->is_correct())
     return;
 
@@ -1007,7 +1007,7 @@ void Cprop::tuple_subgraph(const Node &node) {
         } else {
           node_tup->add(node.setup_driver_pin_raw(0));
         }
-        node2tuple[node.get_compact()] = node_tup;
+        node2tuple[node] = node_tup;
         return;  // reconnect_sub_as_cell when no issues pending
       }
     }
@@ -1015,7 +1015,7 @@ void Cprop::tuple_subgraph(const Node &node) {
     // Still a blackbox, not much to do
     for (const auto &e : node.inp_edges()) {
       auto parent_node = e.driver.get_node();
-      if (parent_node.is_type_tup() && !node2tuple.contains(e.driver.get_node().get_compact())) {
+      if (parent_node.is_type_tup() && !node2tuple.contains(e.driver.get_node())) {
         tuple_issues = true;
         return;
       }
@@ -1025,8 +1025,8 @@ void Cprop::tuple_subgraph(const Node &node) {
     return;
   }
 
-  auto it2 = node2tuple.find(node.get_compact());
-  if (it2 != node2tuple.end())
+  auto it2 = node2tuple.find(node);
+  if (it2 != nullptr)
     return;
 
   mmap_lib::str method;
@@ -1053,7 +1053,7 @@ void Cprop::tuple_subgraph(const Node &node) {
     node_tup->add(pin_name, dpin);
   }
 
-  node2tuple[node.get_compact()] = node_tup;
+  node2tuple[node] = node_tup;
 }
 
 void Cprop::tuple_tuple_add(const Node &node) {
@@ -1192,7 +1192,7 @@ void Cprop::tuple_tuple_add(const Node &node) {
     }
   }
 
-  node2tuple[node.get_compact()] = node_tup;
+  node2tuple[node] = node_tup;
 }
 
 bool Cprop::tuple_tuple_get(const Node &node) {
@@ -1202,9 +1202,9 @@ bool Cprop::tuple_tuple_get(const Node &node) {
 
   std::shared_ptr<Lgtuple const> node_tup;
 
-  auto ptup_it = node2tuple.find(parent_node.get_compact());
-  if (ptup_it != node2tuple.end()) {
-    node_tup = ptup_it->second;
+  auto ptup_it = node2tuple.find(parent_node);
+  if (ptup_it != nullptr) {
+    node_tup = *ptup_it;
     if (!node_tup->is_correct()) {
       return false;
     }
@@ -1213,19 +1213,19 @@ bool Cprop::tuple_tuple_get(const Node &node) {
   if (key_name.empty()) {
     if (node.is_sink_connected("field") && node_tup) {
       auto field_node  = node.get_sink_pin("field").get_driver_node();
-      auto fieldtup_it = node2tuple.find(field_node.get_compact());
-      if (fieldtup_it != node2tuple.end()) {
+      auto fieldtup_it = node2tuple.find(field_node);
+      if (fieldtup_it != nullptr) {
         I(node_tup->is_correct());
 
-        auto sub_tup = node_tup->get_sub_tuple(fieldtup_it->second);
+        auto sub_tup = node_tup->get_sub_tuple(*fieldtup_it);
         if (sub_tup) {
-          node2tuple[node.get_compact()] = sub_tup;
+          node2tuple[node] = sub_tup;
           return true;
         }
-        fieldtup_it->second->dump();
+        (*fieldtup_it)->dump();
         node.dump();
         Pass::info("FIXME: need to handle runtime tuple index node:{}\n", node.debug_name());
-        fieldtup_it->second->set_issue();
+        (*fieldtup_it)->set_issue();
         tuple_issues = true;
         return false;
       }
@@ -1242,7 +1242,7 @@ bool Cprop::tuple_tuple_get(const Node &node) {
     if (key_name == "0" || parent_dpin.is_type_register()) {
       auto self_tup = std::make_shared<Lgtuple>(tup_name);
       self_tup->add(parent_dpin);
-      node2tuple[node.get_compact()] = self_tup;
+      node2tuple[node] = self_tup;
       return true;
     }
 
@@ -1286,12 +1286,12 @@ bool Cprop::tuple_tuple_get(const Node &node) {
   if (sub_tup->has_just_attributes() && !is_attr_get) {
     node_tup->dump();
     Pass::info("tuple_get {} for key:{} just has attributes (may be OK)", node.debug_name(), main_field);
-    node2tuple[node.get_compact()] = sub_tup;
+    node2tuple[node] = sub_tup;
     return true;
   }
 
   if (!is_attr_get) {
-    node2tuple[node.get_compact()] = sub_tup;
+    node2tuple[node] = sub_tup;
   }
 
   return true;
@@ -1328,12 +1328,12 @@ void Cprop::tuple_attr_set(const Node &node) {
 
   auto parent_tup = find_lgtuple(parent_spin.get_driver_node());
   if (parent_tup == nullptr) {
-    node2tuple.erase(node.get_compact());  // erase if exists
+    node2tuple.erase(node);  // erase if exists
     return;
   }
 
   if (!parent_tup->is_correct()) {
-    node2tuple[node.get_compact()] = parent_tup;
+    node2tuple[node] = parent_tup;
     return;
   }
 
@@ -1375,8 +1375,8 @@ void Cprop::tuple_attr_set(const Node &node) {
   I(node_tup);
 
   I(node_tup->is_correct());
-  tuple_done.insert(node.get_compact());
-  node2tuple[node.get_compact()] = node_tup;
+  tuple_done[node] = true;
+  node2tuple[node] = node_tup;
 }
 
 bool Cprop::scalar_mux(Node &node, XEdge_iterator &inp_edges_ordered) {
@@ -1482,20 +1482,20 @@ void Cprop::scalar_sext(Node &node, XEdge_iterator &inp_edges_ordered) {
 std::shared_ptr<Lgtuple const> Cprop::find_lgtuple(const Node_pin &up_dpin) const {
   auto up_node = up_dpin.get_node();
 
-  auto ptup_it = node2tuple.find(up_node.get_compact());
-  if (ptup_it != node2tuple.end()) {
+  auto ptup_it = node2tuple.find(up_node);
+  if (ptup_it != nullptr) {
     I(!up_node.is_type_const());
-    return ptup_it->second;
+    return *ptup_it;
   }
 
   return nullptr;
 }
 
 std::shared_ptr<Lgtuple const> Cprop::find_lgtuple(const Node &up_node) const {
-  auto ptup_it = node2tuple.find(up_node.get_compact());
-  if (ptup_it != node2tuple.end()) {
+  auto ptup_it = node2tuple.find(up_node);
+  if (ptup_it != nullptr) {
     I(!up_node.is_type_const());
-    return ptup_it->second;
+    return *ptup_it;
   }
 
   return nullptr;
@@ -1662,9 +1662,9 @@ void Cprop::reconnect_tuple_sub(Node &node) {
 
   if (!dollar_spin.is_invalid()) {
     auto parent_node = dollar_spin.get_driver_node();
-    auto it2         = node2tuple.find(parent_node.get_compact());
-    if (it2 != node2tuple.end()) {
-      try_connect_tuple_to_sub(it2->second, node, parent_node);
+    auto it2         = node2tuple.find(parent_node);
+    if (it2 != nullptr) {
+      try_connect_tuple_to_sub(*it2, node, parent_node);
 
       for (auto &spin : node.inp_connected_pins()) {
         auto instance_pid = spin.get_pid();
@@ -1723,9 +1723,9 @@ void Cprop::reconnect_tuple_add(Node &node) {
 
   std::shared_ptr<Lgtuple const> node_tup;
   {
-    auto it = node2tuple.find(node.get_compact());
-    if (it != node2tuple.end()) {
-      node_tup = it->second;
+    auto it = node2tuple.find(node);
+    if (it != nullptr) {
+      node_tup = *it;
       I(node_tup->is_correct());
     }
   }
@@ -1746,7 +1746,7 @@ void Cprop::reconnect_tuple_add(Node &node) {
     } else if (sink_type == Ntype_op::Get_mask  // get_mask handles tuples at both inputs
                || sink_type == Ntype_op::TupAdd
                || (sink_type == Ntype_op::Mux && e.sink.get_pid()
-                   && !tuple_done.contains(e.sink.get_node().get_compact()))  // mux handles tuples at inputs, not select
+                   && !tuple_done.contains(e.sink.get_node()))  // mux handles tuples at inputs, not select
                || sink_type == Ntype_op::TupGet
                || (sink_type == Ntype_op::SHL && e.sink.get_pid())  // SHL handles tuples at B (not a)
     ) {
@@ -1769,18 +1769,20 @@ void Cprop::reconnect_tuple_add(Node &node) {
 void Cprop::reconnect_tuple_get(Node &node) {
   auto [tup_name, key_name] = get_tuple_name_key(node);
 
-  auto it = node2tuple.find(node.get_compact());
+  std::shared_ptr<Lgtuple const> node_tup;  // copy, expand_data_and_attributes can add to node2tuple
+  if (const auto *tup = node2tuple.find(node))
+    node_tup = *tup;
 
   bool is_attr_get = Lgtuple::is_attribute(key_name);
   if (is_attr_get) {
     node.set_type(Ntype_op::AttrGet);
 
-    if (it != node2tuple.end()) {
+    if (node_tup) {
       node.setup_sink_pin("parent").del();
 
       auto out_edges_list = node.out_edges();
       I(!out_edges_list.empty());
-      auto new_dpin = expand_data_and_attributes(node, "", out_edges_list, it->second);
+      auto new_dpin = expand_data_and_attributes(node, "", out_edges_list, node_tup);
 
       for (auto &e : new_dpin.out_edges()) {
         node.setup_driver_pin().connect_sink(e.sink);
@@ -1792,12 +1794,12 @@ void Cprop::reconnect_tuple_get(Node &node) {
 
     return;
   }
-  I(it != node2tuple.end());
+  I(node_tup);
 
-  if (it->second->is_trivial_scalar()) {
+  if (node_tup->is_trivial_scalar()) {
     auto out_edges_list = node.out_edges();
     if (!out_edges_list.empty())
-      expand_data_and_attributes(node, "", out_edges_list, it->second);
+      expand_data_and_attributes(node, "", out_edges_list, node_tup);
   }
 }
 
@@ -1860,7 +1862,7 @@ Node_pin Cprop::expand_data_and_attributes(Node &node, const mmap_lib::str &key_
   }
 
   if (use_tup) {
-    node2tuple[value_dpin.get_node().get_compact()] = use_tup;
+    node2tuple[value_dpin.get_node()] = use_tup;
   }
 
   return value_dpin;
@@ -1991,10 +1993,13 @@ void Cprop::tuple_pass(Lgraph *lg) {
   if (!tuple_found)
     return;
 
+  node2tuple.setup(lg);
+  tuple_done.setup(lg);
+
   for (auto iter = 0; iter < 6; ++iter) {
     tuple_issues = iter == 0;  // First iter may not be correct if there are flops or subgraphs
     for (auto node : lg->forward(hier)) {
-      if (tuple_done.contains(node.get_compact()))
+      if (tuple_done.contains(node))
         continue;
 
       auto op = node.get_type_op();
@@ -2006,7 +2011,7 @@ void Cprop::tuple_pass(Lgraph *lg) {
       I(op != Ntype_op::IO);  // no IOs in fwd iterator
 
       if (iter > 0) {
-        node2tuple.erase(node.get_compact());  // no output reuse
+        node2tuple.erase(node);  // no output reuse
       }
 
       if (op == Ntype_op::Mux) {
@@ -2242,10 +2247,12 @@ void Cprop::bwd_del_node(Node &node) {
 }
 
 void Cprop::dump_node2tuples() const {
-  for (const auto &it : node2tuple) {
+  node2tuple.each([](const auto &nid, const auto &tup) {
 #ifndef NDEBUG
-    fmt::print("node nid:{}\n", it.first.get_nid());
+    fmt::print("node nid:{}\n", nid);
+#else
+    (void)nid;
 #endif
-    it.second->dump();
-  }
+    tup->dump();
+  });
 }
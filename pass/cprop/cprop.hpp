@@ -3,10 +3,76 @@
 
 #include <tuple>
 
+#include "absl/container/flat_hash_map.h"
 #include "lconst.hpp"
 #include "lgtuple.hpp"
 #include "node.hpp"
 #include "pass.hpp"
+#include "side_array.hpp"
+
+// Node to data for the tuple pass. Non-hier is a dense side array of the
+// lgraph (class nid). With hier, the forward walk visits a class node once per
+// instance, so the entries are keyed by Node::Compact (hidx and nid).
+template <typename T>
+class Cprop_node_map {
+private:
+  const bool                            hier;
+  Node_side_array<T>                    flat;
+  absl::flat_hash_map<Node::Compact, T> hier_map;
+
+  // the non hierarchical nodes (fast() iterator) are the top lgraph nodes
+  static Node::Compact get_key(const Node &node) {
+    if (node.is_hierarchical())
+      return node.get_compact();
+    return Node::Compact(Hierarchy::hierarchical_root(), node.get_nid());
+  }
+
+public:
+  explicit Cprop_node_map(bool _hier) : hier(_hier) {}
+
+  void setup(const Lgraph *lg) {
+    if (!hier)
+      flat.setup(lg);
+  }
+
+  void clear() {
+    flat.clear();
+    hier_map.clear();
+  }
+
+  bool contains(const Node &node) const {
+    return hier ? hier_map.contains(get_key(node)) : flat.contains(node.get_compact_class());
+  }
+
+  // nullptr when not present
+  const T *find(const Node &node) const {
+    if (hier) {
+      auto it = hier_map.find(get_key(node));
+      return it == hier_map.end() ? nullptr : &it->second;
+    }
+    auto it = flat.find(node.get_compact_class());
+    return it == flat.end() ? nullptr : &it->second;
+  }
+
+  T &operator[](const Node &node) { return hier ? hier_map[get_key(node)] : flat[node.get_compact_class()]; }
+
+  void erase(const Node &node) {
+    if (hier)
+      hier_map.erase(get_key(node));
+    else
+      flat.erase(node.get_compact_class());
+  }
+
+  template <typename F>
+  void each(F f) const {
+    for (const auto &it : flat) {
+      f(it.first.get_nid(), it.second);
+    }
+    for (const auto &it : hier_map) {
+      f(it.first.get_nid(), it.second);
+    }
+  }
+};
 
 class Cprop {
 private:
@@ -20,8 +86,8 @@ private:
   void connect_reset_pin_if_needed(Node &node);
 
 protected:
-  absl::flat_hash_map<Node::Compact, std::shared_ptr<Lgtuple const>> node2tuple;  // node to the most up-to-dated tuple chain
-  absl::flat_hash_set<Node::Compact>                                 tuple_done;
+  Cprop_node_map<std::shared_ptr<Lgtuple const>> node2tuple;  // node to the most up-to-dated tuple chain
+  Cprop_node_map<bool>                            tuple_done;
 
   std::tuple<Node_pin, std::shared_ptr<Lgtuple const>> get_value(const Node &node) const;
 
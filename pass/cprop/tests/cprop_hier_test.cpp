@@ -0,0 +1,91 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "cprop.hpp"
+#include "gtest/gtest.h"
+#include "lgraph.hpp"
+
+// The top and the sub lgraph have a TupAdd/TupGet chain with overlapping nids
+// but different fields. With hier:true the tuples are tracked per hierarchy
+// node, so they must not be mixed between the lgraphs (or between the two sub
+// instances). The sub lgraph is shared by the instances, so it is not edited.
+
+class Cprop_hier_test : public ::testing::Test {
+protected:
+  Lgraph *top = nullptr;
+  Lgraph *sub = nullptr;
+
+  // a.<field> = value; z = a.<field>
+  static void add_tuple_chain(Lgraph *lg, const mmap_lib::str &field, Node_pin &value_dpin) {
+    auto add_field = lg->create_node_const(Lconst::from_string(field));
+    auto tup_add   = lg->create_node(Ntype_op::TupAdd);
+    auto tup_get   = lg->create_node(Ntype_op::TupGet);
+    auto get_field = lg->create_node_const(Lconst::from_string(field));
+
+    tup_add.setup_sink_pin("field").connect_driver(add_field.setup_driver_pin());
+    tup_add.setup_sink_pin("value").connect_driver(value_dpin);
+
+    tup_get.setup_sink_pin("parent").connect_driver(tup_add.setup_driver_pin());
+    tup_get.setup_sink_pin("field").connect_driver(get_field.setup_driver_pin());
+
+    tup_get.setup_driver_pin().connect_sink(lg->get_graph_output("z"));
+  }
+
+  static Node_pin get_output_driver(Lgraph *lg, const mmap_lib::str &name) {
+    // non hierarchical, the driver of a hierarchical pin is traced inside the subs
+    return lg->get_graph_output(name).change_to_sink_from_graph_out_driver().get_non_hierarchical().get_driver_pin();
+  }
+
+  void SetUp() override {
+    sub = Lgraph::create("lgdb_cprop_hier", "cprop_hier_sub", "-");
+    top = Lgraph::create("lgdb_cprop_hier", "cprop_hier_top", "-");
+
+    {
+      auto a_dpin = sub->add_graph_input("a", 0, 8);
+      sub->add_graph_output("z", 1, 8);
+      add_tuple_chain(sub, "x", a_dpin);
+    }
+
+    {
+      auto a_dpin = top->add_graph_input("a", 0, 8);
+      top->add_graph_output("z", 1, 8);
+      top->add_graph_output("z0", 2, 8);
+      top->add_graph_output("z1", 3, 8);
+
+      auto three_dpin = top->create_node_const(3).setup_driver_pin();
+      add_tuple_chain(top, "y", three_dpin);
+
+      for (auto i = 0; i < 2; ++i) {
+        auto inst = top->create_node_sub("cprop_hier_sub");
+        inst.setup_sink_pin("a").connect_driver(a_dpin);
+        inst.setup_driver_pin("z").connect_sink(top->get_graph_output(i == 0 ? "z0" : "z1"));
+      }
+    }
+  }
+
+  void TearDown() override {
+    top->sync();
+    sub->sync();
+  }
+};
+
+TEST_F(Cprop_hier_test, tuples_per_lgraph) {
+  Cprop cp(true);
+  cp.do_trans(top);
+
+  EXPECT_FALSE(cp.has_tuple_issues());
+
+  auto top_z = get_output_driver(top, "z");
+  ASSERT_FALSE(top_z.is_invalid());
+  ASSERT_TRUE(top_z.get_node().is_type_const());
+  EXPECT_EQ(top_z.get_node().get_type_const(), Lconst(3));
+
+  auto sub_z = get_output_driver(sub, "z");
+  ASSERT_FALSE(sub_z.is_invalid());
+  EXPECT_EQ(sub_z.get_node().get_type_op(), Ntype_op::TupGet);
+
+  for (const auto &out : {mmap_lib::str("z0"), mmap_lib::str("z1")}) {  // the instances still drive the top outputs
+    auto dpin = get_output_driver(top, out);
+    ASSERT_FALSE(dpin.is_invalid());
+    EXPECT_TRUE(dpin.get_node().is_type_sub());
+  }
+}
@@ -0,0 +1,400 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#include "pass_emu.hpp"
+
+#include <chrono>
+
+#include "lbench.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "lrand.hpp"
+
+static Pass_plugin emu("pass_emu", Pass_emu::setup);
+
+void Pass_emu::setup() {
+  Eprp_method m1("pass.emu", mmap_lib::str("bit-parallel cycle emulation of an lgraph with random inputs"), &Pass_emu::work);
+
+  m1.add_label_optional("cycles", mmap_lib::str("number of cycles to emulate"), "1000");
+  m1.add_label_optional("seed", mmap_lib::str("random seed for the inputs"), "0");
+
+  register_pass(m1);
+}
+
+Pass_emu::Pass_emu(const Eprp_var &var) : Pass("pass.emu", var) {
+  auto cycles_txt = var.get("cycles");
+  auto seed_txt   = var.get("seed");
+
+  if (!cycles_txt.is_i() || cycles_txt.to_i() <= 0) {
+    error("pass.emu cycles:{} should be bigger than zero", cycles_txt);
+    return;
+  }
+  if (!seed_txt.is_i()) {
+    error("pass.emu seed:{} should be an integer", seed_txt);
+    return;
+  }
+
+  n_cycles = cycles_txt.to_i();
+  seed     = seed_txt.to_i();
+}
+
+void Pass_emu::work(Eprp_var &var) {
+  Pass_emu p(var);
+
+  for (const auto &lg : var.lgs) {
+    p.do_work(lg);
+  }
+}
+
+uint32_t Pass_emu::get_var(Var_map &map, const Node_pin &dpin, Bits_t default_bits) {
+  auto it = map.find(dpin.get_compact_class_driver());
+  if (it != map.end())
+    return it->second;
+
+  uint32_t var;
+  if (dpin.is_type_const()) {
+    var = prog.add_const(dpin.get_type_const());
+  } else {
+    auto bits = dpin.get_bits();
+    if (bits == 0)
+      bits = default_bits;
+    var = prog.add_var(bits);
+  }
+
+  map[dpin.get_compact_class_driver()] = var;
+  return var;
+}
+
+// dpin is driven by var. If dpin was already used (forward reference), copy var to it
+void Pass_emu::bind(Var_map &map, const Node_pin &dpin, uint32_t var) {
+  auto it = map.find(dpin.get_compact_class_driver());
+  if (it == map.end()) {
+    map[dpin.get_compact_class_driver()] = var;
+    return;
+  }
+  if (it->second != var)
+    prog.add_inst(Emu_program::Op::Copy, it->second, {{var, 0}});
+}
+
+void Pass_emu::compile_flop(Node &node, Var_map &map) {
+  auto q = get_var(map, node.get_driver_pin());
+
+  uint32_t din      = Emu_program::invalid_var;
+  uint32_t enable   = Emu_program::invalid_var;
+  uint32_t reset    = Emu_program::invalid_var;
+  uint32_t initial  = Emu_program::invalid_var;
+  bool     negreset = false;
+
+  for (const auto &e : node.inp_edges()) {
+    auto pin_name = e.sink.get_pin_name();
+    if (pin_name == "din") {
+      din = get_var(map, e.driver);
+    } else if (pin_name == "enable") {
+      enable = get_var(map, e.driver, 1);
+    } else if (pin_name == "reset") {
+      reset = get_var(map, e.driver, 1);
+    } else if (pin_name == "initial") {
+      initial = get_var(map, e.driver);
+    } else if (pin_name == "negreset") {
+      if (!e.driver.is_type_const()) {
+        error("pass.emu flop {} should have a constant negreset not {}", node.debug_name(), e.driver.get_node().debug_name());
+        return;
+      }
+      negreset = !e.driver.get_type_const().is_known_false();
+    }
+  }
+
+  if (din == Emu_program::invalid_var) {
+    error("pass.emu flop {} has no din", node.debug_name());
+    return;
+  }
+
+  prog.add_flop(q, din, enable, reset, initial, negreset);
+}
+
+void Pass_emu::compile_memory(Node &node, Var_map &map) {
+  struct Port_field {
+    bool     rdport = false;
+    uint32_t enable = Emu_program::invalid_var;
+    uint32_t addr   = Emu_program::invalid_var;
+    uint32_t din    = Emu_program::invalid_var;
+  };
+  std::vector<Port_field> port_vector;
+
+  int  mem_size = 0;
+  int  mem_bits = 0;
+  int  mem_type = 2;  // array by default
+  bool mem_fwd  = false;
+
+  for (const auto &e : node.inp_edges()) {
+    auto pin_name = e.sink.get_pin_name();
+
+    size_t port_id = e.sink.get_pid() / 11;
+    if (port_vector.size() <= port_id)
+      port_vector.resize(1 + port_id);
+
+    if (pin_name == "bits" || pin_name == "size" || pin_name == "type" || pin_name == "rdport" || pin_name == "fwd") {
+      if (!e.driver.is_type_const()) {
+        error("pass.emu memory {} should have a constant {} not {}", node.debug_name(), pin_name, e.driver.get_node().debug_name());
+        return;
+      }
+      auto v = e.driver.get_type_const();
+      if (pin_name == "bits")
+        mem_bits = v.to_i();
+      else if (pin_name == "size")
+        mem_size = v.to_i();
+      else if (pin_name == "type")
+        mem_type = v.to_i();
+      else if (pin_name == "fwd")
+        mem_fwd = !v.is_known_false();
+      else
+        port_vector[port_id].rdport = !v.is_known_false();
+    } else if (pin_name == "addr") {
+      port_vector[port_id].addr = get_var(map, e.driver);
+    } else if (pin_name == "enable") {
+      port_vector[port_id].enable = get_var(map, e.driver, 1);
+    } else if (pin_name == "din") {
+      port_vector[port_id].din = get_var(map, e.driver);
+    }
+    // clock, posclk and wensize do not change the emulation (single clock)
+  }
+
+  if (mem_bits <= 0 || mem_size <= 0) {
+    error("pass.emu memory {} should have positive bits and size", node.debug_name());
+    return;
+  }
+
+  std::vector<Emu_program::Arg> array_writes;
+  uint32_t                      mem = Emu_program::invalid_var;
+  if (mem_type == 0 || mem_type == 1) {
+    mem = prog.add_memory(mem_bits, mem_size);
+  }
+
+  for (const auto &p : port_vector) {
+    if (p.rdport || p.addr == Emu_program::invalid_var)
+      continue;
+    if (p.din == Emu_program::invalid_var) {
+      error("pass.emu memory {} write port is not correctly configured", node.debug_name());
+      return;
+    }
+    if (mem == Emu_program::invalid_var) {
+      array_writes.push_back({p.addr, 1});
+      array_writes.push_back({p.din, 2});
+      if (p.enable != Emu_program::invalid_var)
+        array_writes.push_back({p.enable, 3});
+    } else {
+      prog.add_mem_write(mem, p.addr, p.din, p.enable);
+    }
+  }
+
+  auto n_pos = 0;
+  for (const auto &p : port_vector) {
+    if (p.rdport) {
+      if (p.addr == Emu_program::invalid_var) {
+        error("pass.emu memory {} read port is not correctly configured", node.debug_name());
+        return;
+      }
+      auto dout = get_var(map, node.setup_driver_pin_raw(n_pos), mem_bits);
+      if (mem == Emu_program::invalid_var) {
+        std::vector<Emu_program::Arg> rd_args{{p.addr, 0}};
+        rd_args.insert(rd_args.end(), array_writes.begin(), array_writes.end());
+        prog.add_inst(Emu_program::Op::Array_rd, dout, rd_args);
+      } else {
+        prog.add_mem_read(mem, dout, p.addr, p.enable, mem_type == 1, mem_fwd);
+      }
+    }
+    ++n_pos;
+  }
+}
+
+void Pass_emu::compile_sub(Node &node, Var_map &map) {
+  if (!node.is_type_sub_present()) {
+    error("pass.emu sub {} does not have an lgraph to emulate", node.debug_name());
+    return;
+  }
+  auto *sub_lg = node.ref_type_sub_lgraph();
+
+  absl::flat_hash_map<mmap_lib::str, uint32_t> inp_vars;
+  for (const auto &e : node.inp_edges()) {
+    inp_vars[e.sink.get_pin_name()] = get_var(map, e.driver);
+  }
+
+  Var_map sub_map;
+  sub_lg->each_graph_input([&](Node_pin &dpin) {
+    auto it = inp_vars.find(dpin.get_name());
+    if (it == inp_vars.end())
+      return;  // unconnected inputs are zero
+
+    if (dpin.get_bits() == 0 || dpin.get_bits() == prog.get_bits(it->second)) {
+      sub_map[dpin.get_compact_class_driver()] = it->second;
+      return;
+    }
+    auto var = get_var(sub_map, dpin);
+    prog.add_inst(Emu_program::Op::Copy, var, {{it->second, 0}});
+  });
+
+  compile(sub_lg, sub_map);
+
+  for (auto &dpin : node.out_connected_pins()) {
+    auto out_name = dpin.get_pin_name();
+    if (!sub_lg->has_graph_output(out_name))
+      continue;
+
+    auto spin = sub_lg->get_graph_output(out_name).change_to_sink_from_graph_out_driver();
+    if (!spin.is_connected())
+      continue;
+
+    bind(map, dpin, get_var(sub_map, spin.get_driver_pin()));
+  }
+}
+
+void Pass_emu::compile(Lgraph *lg, Var_map &map) {
+  for (auto node : lg->fast()) {
+    auto op = node.get_type_op();
+
+    Emu_program::Op emu_op;
+    switch (op) {
+      case Ntype_op::Const: continue;
+      case Ntype_op::Flop: compile_flop(node, map); continue;
+      case Ntype_op::Memory: compile_memory(node, map); continue;
+      case Ntype_op::Sub: compile_sub(node, map); continue;
+      case Ntype_op::Sum: emu_op = Emu_program::Op::Sum; break;
+      case Ntype_op::Mult: emu_op = Emu_program::Op::Mult; break;
+      case Ntype_op::Div: emu_op = Emu_program::Op::Div; break;
+      case Ntype_op::And: emu_op = Emu_program::Op::And; break;
+      case Ntype_op::Or: emu_op = Emu_program::Op::Or; break;
+      case Ntype_op::Xor: emu_op = Emu_program::Op::Xor; break;
+      case Ntype_op::Ror: emu_op = Emu_program::Op::Ror; break;
+      case Ntype_op::Not: emu_op = Emu_program::Op::Not; break;
+      case Ntype_op::Get_mask: emu_op = Emu_program::Op::Get_mask; break;
+      case Ntype_op::Set_mask: emu_op = Emu_program::Op::Set_mask; break;
+      case Ntype_op::Sext: emu_op = Emu_program::Op::Sext; break;
+      case Ntype_op::LT: emu_op = Emu_program::Op::LT; break;
+      case Ntype_op::GT: emu_op = Emu_program::Op::GT; break;
+      case Ntype_op::EQ: emu_op = Emu_program::Op::EQ; break;
+      case Ntype_op::SHL: emu_op = Emu_program::Op::SHL; break;
+      case Ntype_op::SRA: emu_op = Emu_program::Op::SRA; break;
+      case Ntype_op::Mux: emu_op = Emu_program::Op::Mux; break;
+      default:
+        error("pass.emu does not support {} nodes ({}), run the lgraph passes to lower it first",
+              node.get_type_name(),
+              node.debug_name());
+        return;
+    }
+
+    if (!node.has_outputs())
+      continue;
+
+    Bits_t default_bits = 64;
+    if (op == Ntype_op::Ror || op == Ntype_op::LT || op == Ntype_op::GT || op == Ntype_op::EQ)
+      default_bits = 1;
+    auto dst = get_var(map, node.get_driver_pin(), default_bits);
+
+    if (op == Ntype_op::Get_mask || op == Ntype_op::Set_mask) {
+      uint32_t a     = Emu_program::invalid_var;
+      uint32_t value = Emu_program::invalid_var;
+      Lconst   mask;
+      bool     mask_found = false;
+      for (const auto &e : node.inp_edges()) {
+        auto pin_name = e.sink.get_pin_name();
+        if (pin_name == "a") {
+          a = get_var(map, e.driver);
+        } else if (pin_name == "value") {
+          value = get_var(map, e.driver);
+        } else if (pin_name == "mask") {
+          if (!e.driver.is_type_const()) {
+            error("pass.emu {} should have a constant mask not {}", node.debug_name(), e.driver.get_node().debug_name());
+            return;
+          }
+          mask       = e.driver.get_type_const();
+          mask_found = true;
+        }
+      }
+      if (a == Emu_program::invalid_var)
+        a = prog.add_const(Lconst(0));
+      if (!mask_found)
+        mask = Lconst(-1);
+      if (op == Ntype_op::Get_mask) {
+        prog.add_get_mask(dst, a, mask);
+      } else {
+        if (value == Emu_program::invalid_var)
+          value = prog.add_const(Lconst(0));
+        prog.add_set_mask(dst, a, mask, value);
+      }
+      continue;
+    }
+
+    std::vector<Emu_program::Arg> args;
+    for (const auto &e : node.inp_edges()) {
+      args.push_back({get_var(map, e.driver), e.sink.get_pid()});
+    }
+    if (args.empty()) {
+      error("pass.emu node {} has no inputs", node.debug_name());
+      return;
+    }
+    prog.add_inst(emu_op, dst, args);
+  }
+}
+
+void Pass_emu::compile_top(Lgraph *lg) {
+  prog = Emu_program();
+  inputs.clear();
+  outputs.clear();
+
+  Var_map map;
+  lg->each_graph_input([&](Node_pin &dpin) { inputs.emplace_back(dpin.get_name(), get_var(map, dpin)); });
+
+  compile(lg, map);
+
+  lg->each_graph_output([&](Node_pin &dpin) {
+    auto spin = dpin.change_to_sink_from_graph_out_driver();
+    if (!spin.is_connected())
+      return;
+    outputs.emplace_back(dpin.get_name(), get_var(map, spin.get_driver_pin()));
+  });
+
+  try {
+    prog.levelize();
+  } catch (const std::runtime_error &ex) {
+    error("pass.emu lgraph {} {}", lg->get_name(), ex.what());
+  }
+}
+
+void Pass_emu::do_work(Lgraph *lg) {
+  Lbench b("pass.emu");
+
+  compile_top(lg);
+
+  fmt::print("emu {}: {} insts {} vars {} words {} flops\n",
+             lg->get_name(),
+             prog.get_num_insts(),
+             prog.get_num_vars(),
+             prog.get_num_words(),
+             prog.get_num_flops());
+
+  prog.reset_state();
+
+  Lrand<uint64_t> rng(seed);
+  uint64_t        signature = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto cycle = 0u; cycle < n_cycles; ++cycle) {
+    for (const auto &[name, var] : inputs) {
+      if (name == "reset")
+        prog.set(var, cycle == 0 ? -1 : 0);  // reset only in the first cycle
+      else
+        prog.set(var, static_cast<int64_t>(rng.any()));
+    }
+
+    prog.cycle();
+
+    for (const auto &[name, var] : outputs) {
+      signature = (signature ^ static_cast<uint64_t>(prog.get(var))) * 0x100000001b3ULL;
+    }
+  }
+  auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  fmt::print("emu {}: {} cycles {:.1f} Kcycles/s signature {:016x}\n",
+             lg->get_name(),
+             n_cycles,
+             secs > 0 ? n_cycles / secs / 1000 : 0.0,
+             signature);
+}
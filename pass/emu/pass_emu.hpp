@@ -0,0 +1,42 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "emu_program.hpp"
+#include "node_pin.hpp"
+#include "pass.hpp"
+
+class Pass_emu : public Pass {
+protected:
+  using Var_map = absl::flat_hash_map<Node_pin::Compact_class_driver, uint32_t>;
+
+  uint64_t n_cycles;
+  uint64_t seed;
+
+  Emu_program prog;
+
+  std::vector<std::pair<mmap_lib::str, uint32_t>> inputs;
+  std::vector<std::pair<mmap_lib::str, uint32_t>> outputs;
+
+  uint32_t get_var(Var_map &map, const Node_pin &dpin, Bits_t default_bits = 64);
+  void     bind(Var_map &map, const Node_pin &dpin, uint32_t var);
+
+  void compile(Lgraph *lg, Var_map &map);
+  void compile_memory(Node &node, Var_map &map);
+  void compile_flop(Node &node, Var_map &map);
+  void compile_sub(Node &node, Var_map &map);
+
+  // prog, inputs and outputs for lg (subs flattened), levelized
+  void compile_top(Lgraph *lg);
+
+  void do_work(Lgraph *lg);
+
+public:
+  static void work(Eprp_var &var);
+
+  Pass_emu(const Eprp_var &var);
+
+  static void setup();
+};
@@ -0,0 +1,147 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "gtest/gtest.h"
+#include "lgraph.hpp"
+#include "pass_emu.hpp"
+
+// Compiles a small lgraph (flop, sub instance and a forwarding memory) through
+// Pass_emu and checks the emulated outputs cycle by cycle.
+
+class Pass_emu_harness : public Pass_emu {
+public:
+  Pass_emu_harness(const Eprp_var &var) : Pass_emu(var) {}
+
+  using Pass_emu::compile_top;
+
+  Emu_program &get_prog() { return prog; }
+
+  uint32_t get_io(const std::vector<std::pair<mmap_lib::str, uint32_t>> &ios, const mmap_lib::str &name) const {
+    for (const auto &[io_name, var] : ios) {
+      if (io_name == name)
+        return var;
+    }
+    return Emu_program::invalid_var;
+  }
+  uint32_t get_input(const mmap_lib::str &name) const { return get_io(inputs, name); }
+  uint32_t get_output(const mmap_lib::str &name) const { return get_io(outputs, name); }
+};
+
+class Pass_emu_test : public ::testing::Test {
+protected:
+  Lgraph *top = nullptr;
+  Lgraph *sub = nullptr;
+
+  void SetUp() override {
+    // sub: z = a + 1
+    sub = Lgraph::create("lgdb_pass_emu", "pass_emu_sub", "-");
+    {
+      auto a_dpin = sub->add_graph_input("a", 0, 8);
+      auto z_spin = sub->add_graph_output("z", 1, 8);
+
+      auto sum = sub->create_node(Ntype_op::Sum, 8);
+      sum.setup_sink_pin("A").connect_driver(a_dpin);
+      sum.setup_sink_pin("A").connect_driver(sub->create_node_const(1).setup_driver_pin());
+      sum.setup_driver_pin().connect_sink(z_spin);
+    }
+
+    // top: q = #(a + b); o = sub(q); m = mem[b] (async, fwd, written with a at b)
+    top = Lgraph::create("lgdb_pass_emu", "pass_emu_top", "-");
+    {
+      auto clk_dpin = top->add_graph_input("clock", 0, 1);
+      auto a_dpin   = top->add_graph_input("a", 1, 8);
+      auto b_dpin   = top->add_graph_input("b", 2, 8);
+      top->add_graph_output("o", 3, 8);
+      top->add_graph_output("m", 4, 8);
+
+      auto sum = top->create_node(Ntype_op::Sum, 8);
+      sum.setup_sink_pin("A").connect_driver(a_dpin);
+      sum.setup_sink_pin("A").connect_driver(b_dpin);
+
+      auto flop = top->create_node(Ntype_op::Flop, 8);
+      flop.setup_sink_pin("clock").connect_driver(clk_dpin);
+      flop.setup_sink_pin("din").connect_driver(sum.setup_driver_pin());
+
+      auto inst = top->create_node_sub("pass_emu_sub");
+      inst.setup_sink_pin("a").connect_driver(flop.setup_driver_pin());
+      auto z_dpin = inst.setup_driver_pin("z");
+      z_dpin.set_bits(8);
+      z_dpin.connect_sink(top->get_graph_output("o"));
+
+      auto mem = top->create_node(Ntype_op::Memory);
+      auto set       = [&](Port_ID pid, const Node_pin &dpin) { mem.setup_sink_pin_raw(pid).connect_driver(dpin); };
+      auto set_const = [&](Port_ID pid, int64_t v) { set(pid, top->create_node_const(v).setup_driver_pin()); };
+
+      set_const(1, 8);   // bits
+      set(2, clk_dpin);  // clock
+      set_const(5, 1);   // fwd
+      set_const(7, 0);   // type async
+      set_const(9, 4);   // size
+
+      set(0, b_dpin);  // port 0 write
+      set(3, a_dpin);
+      set_const(4, 1);
+      set_const(10, 0);
+
+      set(11, b_dpin);  // port 1 read
+      set_const(21, 1);
+
+      auto dout = mem.setup_driver_pin_raw(1);
+      dout.set_bits(8);
+      dout.connect_sink(top->get_graph_output("m"));
+    }
+  }
+
+  void TearDown() override {
+    top->sync();
+    sub->sync();
+  }
+};
+
+TEST_F(Pass_emu_test, compile_and_emulate) {
+  Eprp_var var;
+  var.add("cycles", "10");
+  var.add("seed", "0");
+
+  Pass_emu_harness p(var);
+  p.compile_top(top);
+
+  auto &prog = p.get_prog();
+  prog.reset_state();
+
+  auto a = p.get_input("a");
+  auto b = p.get_input("b");
+  auto o = p.get_output("o");
+  auto m = p.get_output("m");
+  ASSERT_NE(a, Emu_program::invalid_var);
+  ASSERT_NE(b, Emu_program::invalid_var);
+  ASSERT_NE(o, Emu_program::invalid_var);
+  ASSERT_NE(m, Emu_program::invalid_var);
+
+  EXPECT_EQ(prog.get_num_flops(), 1u);
+
+  prog.set(a, 3);
+  prog.set(b, 2);
+  prog.cycle();
+  EXPECT_EQ(prog.get(o), 1);  // q was 0 before the edge
+  EXPECT_EQ(prog.get(m), 3);  // same cycle write forwarded
+
+  prog.set(a, 10);
+  prog.set(b, 1);
+  prog.cycle();
+  EXPECT_EQ(prog.get(o), 6);  // q = 3 + 2
+  EXPECT_EQ(prog.get(m), 10);
+
+  prog.set(a, 100);
+  prog.set(b, 2);
+  prog.cycle();
+  EXPECT_EQ(prog.get(o), 12);   // q = 10 + 1
+  EXPECT_EQ(prog.get(m), 100);  // forwarded over the old mem[2] (3)
+
+  prog.set(a, 125);
+  prog.set(b, 3);
+  prog.cycle();
+  EXPECT_EQ(prog.get(o), 103);  // q = 100 + 2
+
+  prog.cycle();
+  EXPECT_EQ(prog.get(o), -127);  // q = 125 + 3 wraps to -128 in the 8 bit flop
+}
@@ -35,6 +35,7 @@ void Firmap::do_firbits_analysis(Lgraph *lg) {  // multi-threaded
 
   I(fbmaps.find(lg) != fbmaps.end());  // call add_map_entry
   auto &fbmap = fbmaps.find(lg)->second;
+  fbmap.setup(lg);
 
 #if 0
   // Iterate over inputs to look for tup_add to fill firbits for inputs
@@ -6,9 +6,10 @@
 #include "node.hpp"
 #include "node_pin.hpp"
 #include "pass.hpp"
+#include "side_array.hpp"
 #include "struct_firbits.hpp"
 
-using FBMap   = absl::flat_hash_map<Node_pin::Compact_class_driver, Firrtl_bits>;  // pin->firrtl bits
+using FBMap   = Pin_driver_side_array<Firrtl_bits>;                               // pin->firrtl bits
 using PinMap  = absl::flat_hash_map<Node_pin, Node_pin>;                           // old_pin to new_pin for both dpin and spin
 using XorrMap = absl::flat_hash_map<Node_pin, std::vector<Node_pin>>;  // special case for xorr one old spin -> multi newspin
 
@@ -5,9 +5,20 @@
 #include "cell.hpp"
 #include "pass.hpp"
 
-Label_acyclic::Label_acyclic(bool _verbose, bool _hier) : verbose(_verbose), hier(_hier) { (void)verbose; }
+Label_acyclic::Label_acyclic(bool _verbose, bool _hier) : verbose(_verbose), hier(_hier), versions("label_acyclic", _hier ? 1 : 0) {}
 
 void Label_acyclic::label(Lgraph *g) {
+  bool changed = !versions.is_labeled(g);
+  if (hier) {
+    g->each_hier_unique_sub_bottom_up([this, &changed](Lgraph *lg) { changed = !versions.is_labeled(lg) || changed; });
+  }
+  if (!changed) {
+    if (verbose) {
+      fmt::print("pass.label.acyclic {}: unchanged, 0 nodes relabeled\n", g->get_name());
+    }
+    return;
+  }
+
   g->each_graph_input([&](const Node_pin &pin) {
     (void)pin;  // to avoid warning
   });
@@ -20,4 +31,9 @@ void Label_acyclic::label(Lgraph *g) {
     (void)node;  // to avoid warning
     // FIXME: do pass here
   }
+
+  versions.set_labeled(g);
+  if (hier) {
+    g->each_hier_unique_sub_bottom_up([this](Lgraph *lg) { versions.set_labeled(lg); });
+  }
 }
@@ -4,6 +4,7 @@
 
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
+#include "label_version.hpp"
 #include "lgraphbase.hpp"
 #include "lnast.hpp"
 
@@ -12,6 +13,8 @@ private:
   const bool verbose;
   const bool hier;
 
+  Label_version versions;
+
 public:
   void label(Lgraph *g);
 
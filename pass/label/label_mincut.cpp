@@ -2,22 +2,101 @@
 
 #include "label_mincut.hpp"
 
+#include <chrono>
+
+#include "absl/container/flat_hash_map.h"
+#include "annotate.hpp"
 #include "cell.hpp"
+#include "mincut_partition.hpp"
 #include "pass.hpp"
+#include "thread_pool.hpp"
 
-Label_mincut::Label_mincut(bool _verbose, bool _hier) : verbose(_verbose), hier(_hier) { (void)verbose; }
+Label_mincut::Label_mincut(bool _verbose, bool _hier, int _k, double _imbalance)
+    : verbose(_verbose), hier(_hier), k(_k), imbalance(_imbalance) {}
 
 void Label_mincut::label(Lgraph *g) {
-  g->each_graph_input([&](const Node_pin &pin) {
-    (void)pin;  // to avoid warning
-  });
+  auto start = std::chrono::steady_clock::now();
+
+  // one vertex per node (consts are not worth a vertex), in fast order so
+  // that the CSR ids keep the lgraph locality. The color is stored per sub
+  // lgraph (not per instance), so with hier all the instances of a node share
+  // one vertex weighted by the number of instances, and get the same color.
+  absl::flat_hash_map<Node::Compact_flat, Mincut_hgraph::Vid> node2vid;
+  std::vector<Node::Compact_flat>                             vid2node;
+  Mincut_hgraph                                               hg;
 
-  g->each_graph_output([&](const Node_pin &pin) {
-    (void)pin;  // to avoid warning
+  for (auto node : g->fast(hier)) {
+    if (node.is_type_const())
+      continue;
+    auto [it, inserted] = node2vid.insert({node.get_compact_flat(), 0});
+    if (inserted) {
+      it->second = hg.add_vertex();
+      vid2node.emplace_back(node.get_compact_flat());
+    } else {
+      hg.set_vertex_weight(it->second, hg.get_vertex_weight(it->second) + 1);
+    }
+  }
+
+  // one net per driver pin (and per graph input) with all its sinks
+  std::vector<Mincut_hgraph::Vid> pins;
+
+  auto add_sinks = [&node2vid, &pins](const Node_pin &dpin) {
+    for (const auto &e : dpin.out_edges()) {
+      auto it = node2vid.find(e.sink.get_node().get_compact_flat());
+      if (it != node2vid.end())
+        pins.emplace_back(it->second);
+    }
+  };
+
+  g->each_graph_input([&](const Node_pin &dpin) {
+    pins.clear();
+    add_sinks(dpin);
+    hg.add_net(pins);
   });
 
   for (auto node : g->fast(hier)) {
-    (void)node;  // to avoid warning
-    // FIXME: do pass here
+    if (node.is_type_const())
+      continue;
+    auto vid = node2vid[node.get_compact_flat()];
+    for (const auto &dpin : node.out_connected_pins()) {
+      pins.clear();
+      pins.emplace_back(vid);
+      add_sinks(dpin);
+      hg.add_net(pins);
+    }
+  }
+  hg.finalize();
+
+  Mincut_partition p(k, imbalance, thread_pool.size() + 1);
+  auto             part = p.partition(hg);
+
+  if (hier) {
+    g->each_hier_unique_sub_bottom_up([](Lgraph *lg) { Ann_node_color::clear(lg); });
+  }
+  Ann_node_color::clear(g);
+
+  for (auto vid = 0u; vid < part.size(); ++vid) {
+    Node node(g, vid2node[vid]);
+    node.set_color(part[vid] + 1);
+  }
+
+  if (!verbose)
+    return;
+
+  auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fmt::print("pass.label.mincut {}: {} nodes {} nets {} pins, k:{} cut:{} km1:{} imbalance:{:.3f} in {:.3f}s\n",
+             g->get_name(),
+             hg.get_n_vertices(),
+             hg.get_n_nets(),
+             hg.get_n_pins(),
+             k,
+             Mincut_partition::get_cut(hg, part),
+             Mincut_partition::get_km1(hg, part),
+             Mincut_partition::get_imbalance(hg, part, k),
+             secs);
+
+  for (auto vid = 0u; vid < part.size(); ++vid) {
+    Node node(g, vid2node[vid]);
+    fmt::print(":{} node:{}\n", part[vid] + 1, node.debug_name());
   }
 }
@@ -9,11 +9,13 @@
 
 class Label_mincut {
 private:
-  const bool verbose;
-  const bool hier;
+  const bool   verbose;
+  const bool   hier;
+  const int    k;
+  const double imbalance;
 
 public:
   void label(Lgraph *g);
 
-  Label_mincut(bool _verbose, bool _hier);
+  Label_mincut(bool _verbose, bool _hier, int _k, double _imbalance);
 };
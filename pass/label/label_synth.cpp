@@ -2,11 +2,15 @@
 
 #include "label_synth.hpp"
 
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
 #include "annotate.hpp"
 #include "cell.hpp"
 #include "pass.hpp"
 
-Label_synth::Label_synth(bool _verbose, bool _hier, const mmap_lib::str &alg) : verbose(_verbose), hier(_hier) {
+Label_synth::Label_synth(bool _verbose, bool _hier, const mmap_lib::str &alg)
+    : verbose(_verbose), hier(_hier), n_relabeled(0), versions("label_synth", (alg == "synth" ? 1 : 0) | (_hier ? 2 : 0)) {
   if (alg == "pipe") {
     synth = false;
   } else if (alg == "synth") {
@@ -16,162 +20,521 @@ Label_synth::Label_synth(bool _verbose, bool _hier, const mmap_lib::str &alg) :
   }
 }
 
-int Label_synth::get_free_id() { return last_free_id++; }
+uint64_t Label_synth::get_port(Lg_type_id lgid, Port_ID pid, bool out) {
+  I(lgid.value < (1ULL << 31));
 
-void Label_synth::set_id(const Node &node, int id) {
-  auto [it, inserted] = flat_node2id.insert({node.get_compact_flat(), id});
-  if (inserted || id == it->second)
-    return;
+  return (1ULL << 63) | (static_cast<uint64_t>(lgid.value) << 32) | (static_cast<uint64_t>(pid) << 1) | (out ? 1 : 0);
+}
+
+mmap_lib::vector<uint64_t> *Label_synth::ref_store(const Lgraph *lg) {
+  auto it = lg2store.find(lg);
+  if (it != lg2store.end())
+    return it->second.get();
 
-  auto it2 = flat_merges.find(it->second);
-  if (it2 == flat_merges.end())
-    flat_merges[id] = it->second;
-  else
-    flat_merges[id] = it2->second;
+  auto *store = new mmap_lib::vector<uint64_t>(lg->get_path().to_s(), absl::StrCat("lg_", std::to_string(lg->get_lgid()), "_label_synth"));
+  lg2store[lg] = std::unique_ptr<mmap_lib::vector<uint64_t>>(store);
+  return store;
 }
 
-void Label_synth::mark_ids(Lgraph *g) {
-#if 1
-  // Do we cluster inputs? (FIXME: option)
-  g->each_graph_input([&](const Node_pin &pin) {
-    auto id = get_free_id();
-    for (const auto &e : pin.out_edges()) {
-      auto node = e.sink.get_node();
-      if (!node.is_type_loop_last())
-        set_id(node, id);
+// The nodes that do not start a partition (flops and consts, and the large
+// arithmetic for synth). They are still in the partition of their drivers.
+bool Label_synth::is_driver(const Node &node) const {
+  if (node.is_type_loop_last())
+    return false;
+  if (node.is_type_const())
+    return false;  // consts do not need to create new IDs
+
+  if (synth) {
+    auto op = node.get_type_op();
+    if (op == Ntype_op::Mult || op == Ntype_op::Div)
+      return false;
+    auto b = node.get_driver_pin().get_bits();
+    if (op == Ntype_op::Sum && b > 8)
+      return false;
+  }
+
+  return true;
+}
+
+void Label_synth::summarize(Lgraph *lg, Part &part) const {
+  absl::flat_hash_map<uint32_t, uint32_t> nid2idx;
+  std::vector<uint32_t>                   idx2nid;
+  std::vector<uint32_t>                   uf;  // union find over the node indexes
+  std::vector<uint8_t>                    present;
+
+  auto get_idx = [&](const Node &node) -> uint32_t {
+    auto [it, inserted] = nid2idx.insert({node.get_nid().value, idx2nid.size()});
+    if (inserted) {
+      idx2nid.emplace_back(it->first);
+      uf.emplace_back(it->second);
+      present.emplace_back(0);
     }
-  });
-#endif
+    return it->second;
+  };
+  auto find = [&uf](uint32_t i) {
+    while (uf[i] != i) {
+      uf[i] = uf[uf[i]];
+      i     = uf[i];
+    }
+    return i;
+  };
+
+  // a sink is a graph output or a sub pin (port), or a local node
+  auto get_term = [&](const Node_pin &spin) -> uint64_t {
+    auto node = spin.get_node();
+    if (node.is_graph_output())
+      return get_port(lg->get_lgid(), spin.get_pid(), true);
+    if (hier && node.is_type_sub_present())
+      return get_port(node.get_type_sub(), spin.get_pid(), false);
+    return (static_cast<uint64_t>(get_idx(node)) << 1) | (node.is_type_loop_last() ? 1 : 0);
+  };
+
+  const auto out_idx = get_idx(lg->get_graph_output_node());
 
-  for (auto node : g->forward(hier)) {
-    if (node.is_type_loop_last())
+  std::vector<std::pair<uint32_t, uint64_t>> links;  // driver index, port
+  std::vector<uint64_t>                      net_driver;
+  std::vector<std::vector<uint64_t>>         net_terms;
+
+  for (auto node : lg->fast()) {
+    if (node.is_graph_io())
       continue;
-    if (node.is_type_const())
-      continue;  // consts do not need to create new IDs
 
-    if (synth) {
-      auto op = node.get_type_op();
-      if (op == Ntype_op::Mult || op == Ntype_op::Div)
-        continue;
-      auto b = node.get_driver_pin().get_bits();
-      if (op == Ntype_op::Sum && b > 8)
+    if (hier && node.is_type_sub_present()) {
+      auto sub_lgid = node.get_type_sub();
+      for (const auto &dpin : node.out_connected_pins()) {
+        net_driver.emplace_back(get_port(sub_lgid, dpin.get_pid(), true));
+        auto &terms = net_terms.emplace_back();
+        for (const auto &e : dpin.out_edges()) {
+          terms.emplace_back(get_term(e.sink));
+        }
+      }
+      continue;
+    }
+
+    if (!is_driver(node))
+      continue;
+
+    auto d = get_idx(node);
+    for (const auto &e : node.out_edges()) {
+      auto term = get_term(e.sink);
+      if (is_port(term)) {
+        links.emplace_back(d, term);
         continue;
+      }
+      auto idx      = term >> 1;
+      present[idx]  = 1;
+      uf[find(idx)] = find(d);
     }
+  }
 
-    int  id = 0;
-    auto it = flat_node2id.find(node.get_compact_flat());
-    if (it == flat_node2id.end()) {
-      id = get_free_id();
-    } else {
-      id = it->second;
+  lg->each_graph_input([&](const Node_pin &pin) {
+    net_driver.emplace_back(get_port(lg->get_lgid(), pin.get_pid(), false));
+    auto &terms = net_terms.emplace_back();
+    for (const auto &e : pin.out_edges()) {
+      terms.emplace_back(get_term(e.sink));
     }
+  });
 
-    for (const auto &e : node.out_edges()) {
-      set_id(e.sink.get_node(), id);
+  // number the comps, and sort the nodes by comp
+  const uint32_t        n_nodes = idx2nid.size();
+  std::vector<uint32_t> idx2comp(n_nodes);
+  std::vector<uint32_t> root2comp(n_nodes, UINT32_MAX);
+  uint32_t              n_comps = 0;
+  for (uint32_t i = 0; i < n_nodes; ++i) {
+    auto r = find(i);
+    if (root2comp[r] == UINT32_MAX)
+      root2comp[r] = n_comps++;
+    idx2comp[i] = root2comp[r];
+  }
+
+  part.comp_begin.assign(n_comps + 1, 0);
+  for (auto c : idx2comp) {
+    ++part.comp_begin[c + 1];
+  }
+  for (uint32_t c = 0; c < n_comps; ++c) {
+    part.comp_begin[c + 1] += part.comp_begin[c];
+  }
+
+  std::vector<uint32_t> idx2pos(n_nodes);
+  {
+    auto next = part.comp_begin;
+    part.nodes.resize(n_nodes);
+    for (uint32_t i = 0; i < n_nodes; ++i) {
+      auto pos        = next[idx2comp[i]]++;
+      idx2pos[i]      = pos;
+      part.nodes[pos] = (static_cast<uint64_t>(idx2nid[i]) << 32) | (static_cast<uint64_t>(present[i]) << 31) | idx2comp[i];
     }
   }
+
+  part.out_node = idx2pos[out_idx];
+  part.root     = false;
+  part.n_colors = 0;
+  part.comp_color.assign(n_comps, 0);
+
+  part.links.clear();
+  for (const auto &[d, port] : links) {
+    part.links.emplace_back(idx2comp[d], port);
+  }
+  std::sort(part.links.begin(), part.links.end());
+  part.links.erase(std::unique(part.links.begin(), part.links.end()), part.links.end());
+
+  part.net_driver = std::move(net_driver);
+  part.net_begin.assign(1, 0);
+  part.terms.clear();
+  for (const auto &terms : net_terms) {
+    for (auto term : terms) {
+      if (!is_port(term))
+        term = (static_cast<uint64_t>(idx2pos[term >> 1]) << 1) | (term & 1);
+      part.terms.emplace_back(term);
+    }
+    part.net_begin.emplace_back(part.terms.size());
+  }
+  part.net_active.assign(part.n_nets(), 0);
 }
 
-static int recursion = 0;
+// persisted as [format, #nodes, #comps, #links, #nets, #terms, out_node, root, n_colors] and the arrays
+static constexpr uint64_t part_format = 0x4c53000000000001ULL;
+static constexpr size_t   part_header = 9;
+
+bool Label_synth::load(Lgraph *lg, Part &part) {
+  const auto *store = ref_store(lg);
+  if (store->size() < part_header)
+    return false;
 
-void Label_synth::collapse_merge(int dst) {
-  if (recursion > 100) {
-    // dump();
-    fmt::print("d:{}\n", dst);
+  store->ref_lock();
+  const auto *w = store->ref(0);
+  if (w[0] != part_format) {
+    store->ref_unlock();
+    return false;
   }
 
-  if (collapse_set_min > dst)
-    collapse_set_min = dst;
+  const uint64_t n_nodes = w[1], n_comps = w[2], n_links = w[3], n_nets = w[4], n_terms = w[5];
+  I(store->size() == part_header + n_nodes + 2 * n_comps + 1 + 2 * n_links + 3 * n_nets + 1 + n_terms);
 
-  auto it = flat_merges.find(dst);
-  if (it == flat_merges.end())
-    return;
+  part.out_node = w[6];
+  part.root     = w[7];
+  part.n_colors = w[8];
+  w += part_header;
 
-  collapse_set.insert(dst);
-  if (collapse_set.contains(it->second))
-    return;
+  part.nodes.assign(w, w + n_nodes);
+  w += n_nodes;
+  part.comp_begin.assign(w, w + n_comps + 1);
+  w += n_comps + 1;
+  part.comp_color.assign(w, w + n_comps);
+  w += n_comps;
+  part.links.resize(n_links);
+  for (auto &link : part.links) {
+    link = {static_cast<uint32_t>(w[0]), w[1]};
+    w += 2;
+  }
+  part.net_driver.assign(w, w + n_nets);
+  w += n_nets;
+  part.net_begin.assign(w, w + n_nets + 1);
+  w += n_nets + 1;
+  part.net_active.assign(w, w + n_nets);
+  w += n_nets;
+  part.terms.assign(w, w + n_terms);
 
-  recursion++;
-  collapse_merge(it->second);
-  recursion--;
+  store->ref_unlock();
+  return true;
+}
+
+void Label_synth::save(Lgraph *lg, const Part &part) {
+  auto *store = ref_store(lg);
+  store->clear();
 
-  flat_merges[dst] = collapse_set_min;
+  for (auto v : {part_format,
+                 static_cast<uint64_t>(part.nodes.size()),
+                 static_cast<uint64_t>(part.n_comps()),
+                 static_cast<uint64_t>(part.links.size()),
+                 static_cast<uint64_t>(part.n_nets()),
+                 static_cast<uint64_t>(part.terms.size()),
+                 static_cast<uint64_t>(part.out_node),
+                 static_cast<uint64_t>(part.root),
+                 part.n_colors}) {
+    store->emplace_back(v);
+  }
+  for (auto v : part.nodes) {
+    store->emplace_back(v);
+  }
+  for (auto v : part.comp_begin) {
+    store->emplace_back(v);
+  }
+  for (auto v : part.comp_color) {
+    store->emplace_back(static_cast<uint64_t>(v));
+  }
+  for (const auto &[comp, port] : part.links) {
+    store->emplace_back(comp);
+    store->emplace_back(port);
+  }
+  for (auto v : part.net_driver) {
+    store->emplace_back(v);
+  }
+  for (auto v : part.net_begin) {
+    store->emplace_back(v);
+  }
+  for (auto v : part.net_active) {
+    store->emplace_back(v);
+  }
+  for (auto v : part.terms) {
+    store->emplace_back(v);
+  }
 }
 
-void Label_synth::merge_ids() {
-  // 1st collapse flat_merges
-  {
-    bool updated;
-    do {
-      updated = false;
-      for (auto &it : flat_merges) {
-        collapse_set.clear();
-        collapse_set.insert(it.second);
-        collapse_set_min = it.second;
-        collapse_merge(it.second);
-        if (collapse_set_min == it.second)
-          continue;
-        it.second = collapse_set_min;
-        updated   = true;
-      }
-    } while (updated);
+void Label_synth::label(Lgraph *g) {
+  std::vector<Lgraph *> lgs;
+  if (hier) {
+    g->each_hier_unique_sub_bottom_up([&lgs](Lgraph *lg) { lgs.emplace_back(lg); });
   }
+  lgs.emplace_back(g);
+  const size_t top = lgs.size() - 1;
 
-  // 2nd relabel
-  for (auto &it : flat_node2id) {
-    auto it2 = flat_merges.find(it.second);
-    if (it2 == flat_merges.end())
+  // Only the changed lgraphs are walked. The colors are checked too, so an
+  // lgraph cleared in place (same nodes, no colors) is labeled again.
+  std::vector<Part>    parts(lgs.size());
+  std::vector<uint8_t> changed(lgs.size(), 0);
+  size_t               n_changed = 0;
+  bool                 same_top  = true;
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    auto *lg = lgs[i];
+    if (versions.is_labeled(lg) && load(lg, parts[i]) && parts[i].n_colors == Ann_node_color::ref(lg)->key2val.size()) {
+      same_top = same_top && parts[i].root == (i == top);
       continue;
+    }
+    summarize(lg, parts[i]);
+    changed[i] = 1;
+    ++n_changed;
+  }
 
-    it.second = it2->second;
+  n_relabeled = 0;
+  if (n_changed == 0 && same_top) {
+    if (verbose) {
+      fmt::print("pass.label.synth {}: {} lgraphs unchanged, 0 nodes relabeled\n", g->get_name(), lgs.size());
+    }
+    return;
   }
 
-#ifndef NDEBUG
-  for (auto &it : flat_node2id) {
-    auto it2 = flat_merges.find(it.second);
-    if (it2 == flat_merges.end())
-      continue;
-    if (it2->second == it.second)
-      continue;
-    collapse_set.clear();
-    collapse_set_min = it.second;
-    collapse_merge(it.second);
-    collapse_merge(it2->second);
-    if (it2->second == it.second && it.second == collapse_set_min)
+  // elements: the comps of each lgraph, then the ports. The graph outputs of
+  // the top are its graph output node (there is no instance to go up).
+  std::vector<uint32_t> base(lgs.size());
+  std::vector<uint32_t> uf;
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    base[i] = uf.size();
+    for (uint32_t c = 0; c < parts[i].n_comps(); ++c) {
+      uf.emplace_back(uf.size());
+    }
+  }
+  auto get_comp = [&](size_t i, uint32_t idx) -> uint32_t { return base[i] + (parts[i].nodes[idx] & 0x7FFFFFFF); };
+
+  const auto                              top_lgid = g->get_lgid().value;
+  const auto                              top_out  = get_comp(top, parts[top].out_node);
+  absl::flat_hash_map<uint64_t, uint32_t> port2elem;
+  auto get_elem = [&](uint64_t port) -> uint32_t {
+    if ((port & 1) && ((port >> 32) & 0x7FFFFFFF) == top_lgid)
+      return top_out;
+    auto [it, inserted] = port2elem.insert({port, uf.size()});
+    if (inserted)
+      uf.emplace_back(it->second);
+    return it->second;
+  };
+  auto find = [&uf](uint32_t i) {
+    while (uf[i] != i) {
+      uf[i] = uf[uf[i]];
+      i     = uf[i];
+    }
+    return i;
+  };
+
+  // A net crossing a port is active when its driver starts a partition (a
+  // local driver, or an active port up the chain). The graph inputs of the
+  // top are active, like the old input clustering.
+  auto is_top_input = [&](size_t i, uint64_t port) { return i == top && !(port & 1) && ((port >> 32) & 0x7FFFFFFF) == top_lgid; };
+
+  absl::flat_hash_map<uint32_t, std::vector<std::pair<uint32_t, uint32_t>>> driver2nets;
+  absl::flat_hash_set<uint32_t>                                             active_ports;
+  std::vector<uint32_t>                                                     pending;
+  auto activate = [&](uint32_t elem) {
+    if (active_ports.insert(elem).second)
+      pending.emplace_back(elem);
+  };
+
+  std::vector<std::vector<uint8_t>> active(lgs.size());
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    const auto &part = parts[i];
+    active[i].assign(part.n_nets(), 0);
+    for (uint32_t n = 0; n < part.n_nets(); ++n) {
+      auto d = get_elem(part.net_driver[n]);
+      driver2nets[d].emplace_back(i, n);
+      if (is_top_input(i, part.net_driver[n]))
+        activate(d);
+    }
+    for (const auto &link : part.links) {
+      activate(get_elem(link.second));
+    }
+  }
+  while (!pending.empty()) {
+    auto elem = pending.back();
+    pending.pop_back();
+    auto it = driver2nets.find(elem);
+    if (it == driver2nets.end())
       continue;
-    I(false);  // The collapse_merge avoid to trigger this many times
+    for (const auto &[i, n] : it->second) {
+      active[i][n] = 1;
+      const auto &part = parts[i];
+      for (auto t = part.net_begin[n]; t < part.net_begin[n + 1]; ++t) {
+        if (is_port(part.terms[t]))
+          activate(get_elem(part.terms[t]));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    const auto &part = parts[i];
+    for (const auto &link : part.links) {
+      uf[find(base[i] + link.first)] = find(get_elem(link.second));
+    }
+    for (uint32_t n = 0; n < part.n_nets(); ++n) {
+      if (!active[i][n])
+        continue;
+      auto d         = get_elem(part.net_driver[n]);
+      auto top_input = is_top_input(i, part.net_driver[n]);
+      for (auto t = part.net_begin[n]; t < part.net_begin[n + 1]; ++t) {
+        auto term = part.terms[t];
+        if (is_port(term)) {
+          uf[find(get_elem(term))] = find(d);
+        } else if (!top_input || !(term & 1)) {  // the top inputs do not cluster flops
+          uf[find(get_comp(i, term >> 1))] = find(d);
+        }
+      }
+    }
   }
-#endif
-}
 
-void Label_synth::dump() const {
-  for (auto &it : flat_merges) {
-    fmt::print("{} -> {}\n", it.first, it.second);
+  // A node is colored when it is the sink of an active net. If the nets and
+  // the top did not change, an unchanged lgraph has the colors of the last
+  // labeling (a comp without color has no colored node).
+  std::vector<uint8_t> valid(lgs.size());
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    valid[i] = !changed[i] && parts[i].root == (i == top) && parts[i].net_active == active[i];
   }
-}
 
-void Label_synth::label(Lgraph *g) {
-  last_free_id = 1;
+  auto get_sinks = [&](size_t i) {
+    absl::flat_hash_set<uint32_t> sinks;
+    const auto                   &part = parts[i];
+    for (uint32_t n = 0; n < part.n_nets(); ++n) {
+      if (!active[i][n])
+        continue;
+      auto top_input = is_top_input(i, part.net_driver[n]);
+      for (auto t = part.net_begin[n]; t < part.net_begin[n + 1]; ++t) {
+        auto term = part.terms[t];
+        if (!is_port(term) && (!top_input || !(term & 1)))
+          sinks.insert(term >> 1);
+      }
+    }
+    if (i == top && active_ports.contains(top_out))
+      sinks.insert(part.out_node);
+    return sinks;
+  };
+  auto is_present = [&](size_t i, const absl::flat_hash_set<uint32_t> &sinks, uint32_t idx) {
+    return ((parts[i].nodes[idx] >> 31) & 1) || sinks.contains(idx);
+  };
 
-  mark_ids(g);
-  merge_ids();
+  // The partitions with a changed comp get new colors. The other partitions
+  // keep the color of the last labeling, so only the changed colors are written.
+  absl::flat_hash_set<uint32_t>      touched;
+  absl::flat_hash_map<uint32_t, int> root2color;
+  int                                max_color = 0;
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    const auto &part = parts[i];
+    if (valid[i]) {
+      for (uint32_t c = 0; c < part.n_comps(); ++c) {
+        auto color = part.comp_color[c];
+        if (color == 0)
+          continue;
+        max_color = std::max(max_color, color);
 
-  if (hier) {
-    g->each_hier_unique_sub_bottom_up([](Lgraph *lg) { Ann_node_color::clear(lg); });
+        auto r              = find(base[i] + c);
+        auto [it, inserted] = root2color.insert({r, color});
+        if (!inserted && it->second != color)
+          touched.insert(r);  // merged with another old partition
+      }
+      continue;
+    }
+
+    auto sinks = get_sinks(i);
+    for (uint32_t idx = 0; idx < part.nodes.size(); ++idx) {
+      if (is_present(i, sinks, idx))
+        touched.insert(find(get_comp(i, idx)));
+    }
   }
-  Ann_node_color::clear(g);
 
-  for (auto &it : flat_node2id) {
-    Node node(g, it.first);
-    node.set_color(it.second);
+  absl::flat_hash_map<int, uint32_t> color2root;
+  for (const auto &[r, color] : root2color) {
+    if (touched.contains(r))
+      continue;
+    auto [it, inserted] = color2root.insert({color, r});
+    if (!inserted) {  // the old partition was split
+      touched.insert(r);
+      touched.insert(it->second);
+    }
   }
 
-  if (verbose) {
-    // dump();
+  absl::flat_hash_map<uint32_t, int> new_color;
+  for (size_t i = 0; i < lgs.size(); ++i) {
+    auto *lg   = lgs[i];
+    auto &part = parts[i];
+
+    bool written = !valid[i];
+    if (!valid[i])
+      Ann_node_color::clear(lg);
 
-    for (auto &it : flat_node2id) {
-      Node node(g, it.first);
-      fmt::print(":{} node:{}\n", it.second, node.debug_name());
+    absl::flat_hash_set<uint32_t> sinks;
+    bool                          sinks_done = false;
+    for (uint32_t c = 0; c < part.n_comps(); ++c) {
+      auto r = find(base[i] + c);
+      if (!touched.contains(r))
+        continue;
+
+      if (!sinks_done) {
+        sinks      = get_sinks(i);
+        sinks_done = true;
+      }
+
+      auto [it, inserted] = new_color.insert({r, max_color + 1 + new_color.size()});
+      auto color          = it->second;
+
+      part.comp_color[c] = 0;
+      for (auto idx = part.comp_begin[c]; idx < part.comp_begin[c + 1]; ++idx) {
+        if (!is_present(i, sinks, idx))
+          continue;
+        part.comp_color[c] = color;
+
+        Node node(lg, Node::Compact_class(Index_id(part.nodes[idx] >> 32)));
+        node.set_color(color);
+        ++n_relabeled;
+
+        if (verbose) {
+          fmt::print(":{} node:{}\n", color, node.debug_name());
+        }
+      }
+      written = true;
     }
+
+    if (!written)
+      continue;
+
+    part.root       = i == top;
+    part.net_active = active[i];
+    part.n_colors   = Ann_node_color::ref(lg)->key2val.size();
+    save(lg, part);
+    versions.set_labeled(lg);
+  }
+
+  if (verbose) {
+    fmt::print("pass.label.synth {}: {} of {} lgraphs changed, {} partitions relabeled, {} nodes relabeled\n",
+               g->get_name(),
+               n_changed,
+               lgs.size(),
+               new_color.size(),
+               n_relabeled);
   }
 }
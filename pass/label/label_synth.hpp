@@ -2,37 +2,68 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "label_version.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "lgraphbase.hpp"
 #include "lnast.hpp"
+#include "mmap_vector.hpp"
 
 class Label_synth {
 private:
+  // Partition summary of one lgraph, persisted next to it. The local
+  // partitions (comps) are the nets driven by the lgraph nodes. The nets that
+  // cross an instance boundary are kept as ports (graph IO or sub pin), so the
+  // hierarchical partitions are a union over the comps and ports of each
+  // lgraph. An unchanged lgraph reuses its summary without a graph walk.
+  struct Part {
+    uint32_t out_node = 0;      // index of the graph output node
+    bool     root     = false;  // top lgraph in the last labeling
+    uint64_t n_colors = 0;      // colored nodes after the last labeling
+
+    std::vector<uint64_t>                      nodes;       // nid << 32 | present << 31 | comp (sorted by comp)
+    std::vector<uint32_t>                      comp_begin;  // comp -> first index in nodes
+    std::vector<int32_t>                       comp_color;  // comp color in the last labeling (0 if none)
+    std::vector<std::pair<uint32_t, uint64_t>> links;       // comp connected to a port by a local driver
+    std::vector<uint64_t>                      net_driver;  // port driving a net (graph input or sub output)
+    std::vector<uint32_t>                      net_begin;   // net -> first index in terms
+    std::vector<uint64_t>                      terms;       // port or (node index << 1 | loop_last)
+    std::vector<uint8_t>                       net_active;  // net active in the last labeling
+
+    uint32_t n_comps() const { return comp_begin.size() - 1; }
+    uint32_t n_nets() const { return net_driver.size(); }
+  };
+
   const bool verbose;
   const bool hier;
   bool       synth;
 
-  int last_free_id;
-  int collapse_set_min;
+  int n_relabeled;
 
-  absl::flat_hash_set<int>                     collapse_set;
-  absl::flat_hash_map<Node::Compact_flat, int> flat_node2id;
-  absl::flat_hash_map<int, int>                flat_merges;
+  Label_version versions;
 
-  int  get_free_id();
-  void set_id(const Node &node, int id);
-  void collapse_merge(int dst);
+  absl::flat_hash_map<const Lgraph *, std::unique_ptr<mmap_lib::vector<uint64_t>>> lg2store;
 
-  void mark_ids(Lgraph *g);
-  void merge_ids();
+  static uint64_t get_port(Lg_type_id lgid, Port_ID pid, bool out);
+  static bool     is_port(uint64_t term) { return term >> 63; }
+
+  mmap_lib::vector<uint64_t> *ref_store(const Lgraph *lg);
+
+  bool is_driver(const Node &node) const;
+  void summarize(Lgraph *lg, Part &part) const;
+  bool load(Lgraph *lg, Part &part);
+  void save(Lgraph *lg, const Part &part);
 
 public:
   void label(Lgraph *g);
 
-  Label_synth(bool _verbose, bool _hier, const mmap_lib::str &alg);
+  // nodes with a new color in the last label call (0 when nothing changed)
+  int get_n_relabeled() const { return n_relabeled; }
 
-  void dump() const;
+  Label_synth(bool _verbose, bool _hier, const mmap_lib::str &alg);
 };
@@ -0,0 +1,72 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "label_version.hpp"
+
+#include "absl/strings/str_cat.h"
+
+static uint64_t digest_mix(uint64_t h, uint64_t d) {  // splitmix64 finalizer
+  h ^= d + 0x9e3779b97f4a7c15ULL;
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+Label_version::Label_version(std::string_view _pass_name, uint64_t _config) : pass_name(_pass_name), config(_config) {}
+
+Label_version::Version_map *Label_version::ref_map(const Lgraph *lg) {
+  auto path = lg->get_path().to_s();
+
+  auto it = path2map.find(path);
+  if (it != path2map.end())
+    return it->second.get();
+
+  auto *map      = new Version_map(path, absl::StrCat(pass_name, "_version"));
+  path2map[path] = std::unique_ptr<Version_map>(map);
+  return map;
+}
+
+uint64_t Label_version::compute_digest(Lgraph *lg) {
+  // The node table has the types, bits and edges (and the graph IOs). It is
+  // hashed raw, so checking an unchanged lgraph does not walk the graph.
+  uint64_t h = lg->get_node_table_hash();
+
+  // the sub types are not in the node table (order independent, it is a hash map)
+  uint64_t subs = 0;
+  for (const auto &ent : lg->get_down_nodes_map()) {
+    subs += digest_mix(ent.first.get_nid(), ent.second.value);
+  }
+
+  return digest_mix(h, subs);
+}
+
+const Label_version::Entry &Label_version::get_entry(Lgraph *lg) {
+  auto it = lg2entry.find(lg);
+  if (it != lg2entry.end())
+    return it->second;
+
+  Entry entry;
+  entry.lib_version = lg->get_library().get_version(lg->get_lgid()).value;
+  entry.digest      = compute_digest(lg);
+  entry.config      = config;
+
+  return lg2entry[lg] = entry;
+}
+
+bool Label_version::is_labeled(Lgraph *lg) {
+  auto *map = ref_map(lg);
+
+  if (!map->has(lg->get_lgid().value))
+    return false;
+
+  const auto  old   = map->get(lg->get_lgid().value);
+  const auto &entry = get_entry(lg);
+
+  return old.lib_version == entry.lib_version && old.digest == entry.digest && old.config == entry.config;
+}
+
+void Label_version::set_labeled(Lgraph *lg) {
+  ref_map(lg)->set(lg->get_lgid().value, get_entry(lg));
+}
@@ -0,0 +1,43 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "lgraph.hpp"
+#include "mmap_map.hpp"
+
+// Per lgraph version for the incremental label passes. The version is the
+// library version (bumped when a frontend creates the lgraph again) and a
+// digest of the raw node table and sub types (passes that edit in place do
+// not bump the library version). The version of the last labeling is
+// persisted next to the lgraph, so a later run skips the unchanged lgraphs.
+class Label_version {
+private:
+  struct Entry {
+    uint64_t lib_version;
+    uint64_t digest;
+    uint64_t config;
+  };
+
+  using Version_map = mmap_lib::map<uint32_t, Entry>;
+
+  const std::string pass_name;
+  const uint64_t    config;
+
+  absl::flat_hash_map<std::string, std::unique_ptr<Version_map>> path2map;
+  absl::flat_hash_map<const Lgraph *, Entry>                     lg2entry;  // current version (digest computed once per run)
+
+  Version_map    *ref_map(const Lgraph *lg);
+  const Entry    &get_entry(Lgraph *lg);
+  static uint64_t compute_digest(Lgraph *lg);
+
+public:
+  // config has the pass options that change the labels (a different config relabels)
+  Label_version(std::string_view _pass_name, uint64_t _config);
+
+  bool is_labeled(Lgraph *lg);
+  void set_labeled(Lgraph *lg);
+};
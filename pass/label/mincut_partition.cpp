@@ -0,0 +1,653 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "mincut_partition.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <random>
+
+#include "absl/container/flat_hash_map.h"
+#include "thread_pool.hpp"
+
+namespace {
+
+constexpr size_t   coarse_limit        = 160;    // vertices in the coarsest level of a bisection
+constexpr uint32_t max_rating_net_size = 128;    // bigger nets do not guide the clustering
+constexpr size_t   parallel_threshold  = 20000;  // vertices to use the thread pool
+
+// Two-way FM state: pins of each net in each side, vertex gains, and the
+// move heaps (lazy, entries with an old gain are skipped).
+class Fm_state {
+public:
+  using Vid   = Mincut_hgraph::Vid;
+  using Entry = std::pair<int64_t, Vid>;
+
+  const Mincut_hgraph  &h;
+  std::vector<uint8_t> &side;
+
+  std::vector<uint32_t> pc[2];
+  std::vector<int64_t>  gain;
+  std::vector<uint8_t>  locked;
+  uint64_t              weight[2];
+  uint64_t              cut;
+
+  std::priority_queue<Entry> heap[2];
+
+  Fm_state(const Mincut_hgraph &_h, std::vector<uint8_t> &_side) : h(_h), side(_side) {
+    auto n_nets = h.get_n_nets();
+    pc[0].assign(n_nets, 0);
+    pc[1].assign(n_nets, 0);
+    cut = 0;
+    for (Mincut_hgraph::Nid e = 0; e < n_nets; ++e) {
+      for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+        ++pc[side[*p]][e];
+      }
+      if (pc[0][e] && pc[1][e])
+        cut += h.get_net_weight(e);
+    }
+
+    auto n = h.get_n_vertices();
+    weight[0] = 0;
+    weight[1] = 0;
+    gain.resize(n);
+    locked.assign(n, 0);
+    for (Vid v = 0; v < n; ++v) {
+      weight[side[v]] += h.get_vertex_weight(v);
+      gain[v] = compute_gain(v);
+    }
+  }
+
+  int64_t compute_gain(Vid v) const {
+    auto    s = side[v];
+    int64_t g = 0;
+    for (auto *e = h.vertex_begin(v); e != h.vertex_end(v); ++e) {
+      if (pc[s][*e] == 1)
+        g += h.get_net_weight(*e);
+      if (pc[s ^ 1][*e] == 0)
+        g -= h.get_net_weight(*e);
+    }
+    return g;
+  }
+
+  bool is_boundary(Vid v) const {
+    for (auto *e = h.vertex_begin(v); e != h.vertex_end(v); ++e) {
+      if (pc[0][*e] && pc[1][*e])
+        return true;
+    }
+    return false;
+  }
+
+  uint64_t get_overweight(const uint64_t max_weight[2]) const {
+    uint64_t over = 0;
+    for (auto s = 0; s < 2; ++s) {
+      if (weight[s] > max_weight[s])
+        over += weight[s] - max_weight[s];
+    }
+    return over;
+  }
+
+  void update_gain(Vid u, int64_t delta) {
+    gain[u] += delta;
+    if (!locked[u])
+      heap[side[u]].push({gain[u], u});
+  }
+
+  void move(Vid v) {
+    auto f = side[v];
+    auto t = f ^ 1;
+
+    for (auto *ep = h.vertex_begin(v); ep != h.vertex_end(v); ++ep) {
+      auto    e = *ep;
+      int64_t w = h.get_net_weight(e);
+
+      if (pc[t][e] == 0) {
+        for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+          if (*p != v)
+            update_gain(*p, w);
+        }
+        cut += w;
+      } else if (pc[t][e] == 1) {
+        for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+          if (side[*p] == t) {
+            update_gain(*p, -w);
+            break;
+          }
+        }
+      }
+
+      --pc[f][e];
+      ++pc[t][e];
+
+      if (pc[f][e] == 0) {
+        for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+          if (*p != v)
+            update_gain(*p, -w);
+        }
+        cut -= w;
+      } else if (pc[f][e] == 1) {
+        for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+          if (*p != v && side[*p] == f) {
+            update_gain(*p, w);
+            break;
+          }
+        }
+      }
+    }
+
+    side[v] = t;
+    gain[v] = -gain[v];
+    weight[f] -= h.get_vertex_weight(v);
+    weight[t] += h.get_vertex_weight(v);
+  }
+
+  // best unlocked vertex in side s (or invalid)
+  bool top(int s, Vid &v) {
+    while (!heap[s].empty()) {
+      auto [g, u] = heap[s].top();
+      if (!locked[u] && side[u] == s && gain[u] == g) {
+        v = u;
+        return true;
+      }
+      heap[s].pop();
+    }
+    return false;
+  }
+};
+
+}  // namespace
+
+bool Mincut_hgraph::add_net(const Vid *pins, size_t n_pins, uint32_t weight) {
+  auto start = net_pins.size();
+  net_pins.insert(net_pins.end(), pins, pins + n_pins);
+  std::sort(net_pins.begin() + start, net_pins.end());
+  net_pins.erase(std::unique(net_pins.begin() + start, net_pins.end()), net_pins.end());
+
+  if (net_pins.size() - start < 2) {
+    net_pins.resize(start);
+    return false;
+  }
+
+  net_offset.emplace_back(net_pins.size());
+  nwgt.emplace_back(weight);
+  return true;
+}
+
+void Mincut_hgraph::finalize() {
+  vtx_offset.assign(vwgt.size() + 1, 0);
+  for (auto v : net_pins) {
+    ++vtx_offset[v + 1];
+  }
+  for (auto i = 1u; i < vtx_offset.size(); ++i) {
+    vtx_offset[i] += vtx_offset[i - 1];
+  }
+
+  auto pos = vtx_offset;
+  vtx_nets.resize(net_pins.size());
+  for (Nid e = 0; e < nwgt.size(); ++e) {
+    for (auto *p = net_begin(e); p != net_end(e); ++p) {
+      vtx_nets[pos[*p]++] = e;
+    }
+  }
+}
+
+Mincut_partition::Mincut_partition(int _k, double _imbalance, int _n_threads, uint64_t _seed)
+    : k(std::max(_k, 1)), imbalance(std::max(_imbalance, 0.0)), n_threads(std::max(_n_threads, 1)), seed(_seed) {}
+
+std::vector<uint32_t> Mincut_partition::partition(const Mincut_hgraph &h) {
+  std::vector<uint32_t> part(h.get_n_vertices(), 0);
+  if (k <= 1 || h.get_n_vertices() == 0)
+    return part;
+
+  // the imbalance compounds at each bisection level
+  auto depth = std::ceil(std::log2(k));
+  auto eps   = std::pow(1.0 + imbalance, 1.0 / depth) - 1.0;
+
+  std::vector<Vid> orig(h.get_n_vertices());
+  std::iota(orig.begin(), orig.end(), 0);
+
+  bisect_rec(h, orig, k, 0, eps, seed, part);
+
+  return part;
+}
+
+void Mincut_partition::bisect_rec(const Mincut_hgraph &h, const std::vector<Vid> &orig, int kk, uint32_t first_part, double eps,
+                                  uint64_t rseed, std::vector<uint32_t> &part) const {
+  auto n = h.get_n_vertices();
+  if (kk == 1 || n == 0) {
+    for (Vid v = 0; v < n; ++v) {
+      part[orig[v]] = first_part;
+    }
+    return;
+  }
+
+  int k0 = kk / 2;
+  int k1 = kk - k0;
+
+  double   total = h.get_total_weight();
+  uint64_t max_weight[2];
+  max_weight[0] = std::ceil((1.0 + eps) * total * k0 / kk);
+  max_weight[1] = std::ceil((1.0 + eps) * total * k1 / kk);
+
+  auto side = bisect(h, max_weight, rseed);
+
+  // the cut nets are split between the two sub-hypergraphs
+  Mincut_hgraph    sub[2];
+  std::vector<Vid> sub_orig[2];
+  std::vector<Vid> sub_id(n);
+  for (Vid v = 0; v < n; ++v) {
+    auto s    = side[v];
+    sub_id[v] = sub[s].add_vertex(h.get_vertex_weight(v));
+    sub_orig[s].emplace_back(orig[v]);
+  }
+
+  std::vector<Vid> pins[2];
+  for (Mincut_hgraph::Nid e = 0; e < h.get_n_nets(); ++e) {
+    pins[0].clear();
+    pins[1].clear();
+    for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+      pins[side[*p]].emplace_back(sub_id[*p]);
+    }
+    for (auto s = 0; s < 2; ++s) {
+      if (pins[s].size() >= 2)
+        sub[s].add_net(pins[s], h.get_net_weight(e));
+    }
+  }
+  sub[0].finalize();
+  sub[1].finalize();
+
+  side.clear();
+  side.shrink_to_fit();
+  sub_id.clear();
+  sub_id.shrink_to_fit();
+
+  if (n_threads > 1 && sub[1].get_n_vertices() > parallel_threshold) {
+    std::atomic<int> pending(1);
+    thread_pool.add([this, &sub, &sub_orig, k1, first_part, k0, eps, rseed, &part, &pending]() -> void {
+      bisect_rec(sub[1], sub_orig[1], k1, first_part + k0, eps, rseed * 2 + 2, part);
+      pending--;
+    });
+    bisect_rec(sub[0], sub_orig[0], k0, first_part, eps, rseed * 2 + 1, part);
+    thread_pool.wait_until_done(pending);
+  } else {
+    bisect_rec(sub[0], sub_orig[0], k0, first_part, eps, rseed * 2 + 1, part);
+    bisect_rec(sub[1], sub_orig[1], k1, first_part + k0, eps, rseed * 2 + 2, part);
+  }
+}
+
+std::vector<uint8_t> Mincut_partition::bisect(const Mincut_hgraph &h, const uint64_t max_weight[2], uint64_t rseed) const {
+  auto max_cluster_weight = std::max<uint64_t>(1, h.get_total_weight() / (coarse_limit / 2));
+
+  std::vector<std::unique_ptr<Level>> levels;
+
+  const Mincut_hgraph *cur = &h;
+  while (cur->get_n_vertices() > coarse_limit) {
+    auto level = std::make_unique<Level>();
+    if (!coarsen(*cur, max_cluster_weight, rseed + levels.size(), *level))
+      break;
+    cur = &level->hg;
+    levels.emplace_back(std::move(level));
+  }
+
+  auto side = initial_bisection(*cur, max_weight, rseed);
+
+  for (auto i = levels.size(); i-- > 0;) {
+    const auto &fine = i == 0 ? h : levels[i - 1]->hg;
+
+    std::vector<uint8_t> fine_side(fine.get_n_vertices());
+    for (Vid v = 0; v < fine_side.size(); ++v) {
+      fine_side[v] = side[levels[i]->fine2coarse[v]];
+    }
+    side.swap(fine_side);
+    levels[i].reset();
+
+    refine_fm(fine, max_weight, side);
+  }
+
+  return side;
+}
+
+void Mincut_partition::rate(const Mincut_hgraph &h, uint64_t max_cluster_weight, Vid start, Vid end, std::vector<Vid> &best) const {
+  std::vector<double> score(h.get_n_vertices(), 0.0);
+  std::vector<Vid>    touched;
+
+  for (Vid u = start; u < end; ++u) {
+    touched.clear();
+    for (auto *e = h.vertex_begin(u); e != h.vertex_end(u); ++e) {
+      auto sz = h.get_net_size(*e);
+      if (sz > max_rating_net_size)
+        continue;
+      double r = static_cast<double>(h.get_net_weight(*e)) / (sz - 1);
+      for (auto *p = h.net_begin(*e); p != h.net_end(*e); ++p) {
+        if (*p == u)
+          continue;
+        if (score[*p] == 0)
+          touched.emplace_back(*p);
+        score[*p] += r;
+      }
+    }
+
+    // heavy connectivity, penalized by the cluster weight
+    Vid    best_v  = u;
+    double best_sc = 0;
+    double wu      = h.get_vertex_weight(u);
+    for (auto v : touched) {
+      double wv = h.get_vertex_weight(v);
+      if (wu + wv <= max_cluster_weight) {
+        auto sc = score[v] / (wu * wv);
+        if (sc > best_sc) {
+          best_sc = sc;
+          best_v  = v;
+        }
+      }
+      score[v] = 0;
+    }
+    best[u] = best_v;
+  }
+}
+
+bool Mincut_partition::coarsen(const Mincut_hgraph &h, uint64_t max_cluster_weight, uint64_t rseed, Level &level) const {
+  constexpr Vid invalid = UINT32_MAX;
+
+  auto n = h.get_n_vertices();
+
+  std::vector<Vid> best(n);
+  if (n_threads > 1 && n > parallel_threshold) {
+    std::atomic<int> pending(n_threads);
+    Vid              chunk = (n + n_threads - 1) / n_threads;
+    for (auto t = 0; t < n_threads; ++t) {
+      Vid start = std::min<size_t>(n, static_cast<size_t>(t) * chunk);
+      Vid end   = std::min<size_t>(n, static_cast<size_t>(start) + chunk);
+      thread_pool.add([this, &h, max_cluster_weight, start, end, &best, &pending]() -> void {
+        rate(h, max_cluster_weight, start, end, best);
+        pending--;
+      });
+    }
+    thread_pool.wait_until_done(pending);
+  } else {
+    rate(h, max_cluster_weight, 0, n, best);
+  }
+
+  // cluster in random order, a vertex joins the cluster of its best neighbor if it fits
+  std::vector<Vid> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::mt19937_64 rng(rseed);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  std::vector<Vid>      cluster(n, invalid);
+  std::vector<uint64_t> cweight;
+  for (auto u : order) {
+    if (cluster[u] != invalid)
+      continue;
+
+    auto v  = best[u];
+    auto wu = h.get_vertex_weight(u);
+    if (v != u) {
+      if (cluster[v] == invalid) {
+        cluster[u] = cweight.size();
+        cluster[v] = cweight.size();
+        cweight.emplace_back(wu + h.get_vertex_weight(v));
+        continue;
+      }
+      if (cweight[cluster[v]] + wu <= max_cluster_weight) {
+        cluster[u] = cluster[v];
+        cweight[cluster[v]] += wu;
+        continue;
+      }
+    }
+    cluster[u] = cweight.size();
+    cweight.emplace_back(wu);
+  }
+
+  auto n_clusters = cweight.size();
+  if (n_clusters > n * 0.95)
+    return false;
+
+  // renumber in fine vertex order (keeps the locality of the fine ids)
+  std::vector<Vid> renum(n_clusters, invalid);
+  Vid              next = 0;
+  level.fine2coarse.resize(n);
+  for (Vid v = 0; v < n; ++v) {
+    auto &c = renum[cluster[v]];
+    if (c == invalid)
+      c = next++;
+    level.fine2coarse[v] = c;
+  }
+
+  level.hg = Mincut_hgraph(n_clusters);
+  for (Vid c = 0; c < n_clusters; ++c) {
+    level.hg.set_vertex_weight(c, 0);
+  }
+  for (Vid v = 0; v < n; ++v) {
+    auto c = level.fine2coarse[v];
+    level.hg.set_vertex_weight(c, level.hg.get_vertex_weight(c) + h.get_vertex_weight(v));
+  }
+
+  // parallel nets (same pins after the contraction) become one heavier net
+  absl::flat_hash_map<uint64_t, Mincut_hgraph::Nid> hash2net;
+  std::vector<Vid>                                  pins;
+  for (Mincut_hgraph::Nid e = 0; e < h.get_n_nets(); ++e) {
+    pins.clear();
+    for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+      pins.emplace_back(level.fine2coarse[*p]);
+    }
+    std::sort(pins.begin(), pins.end());
+    pins.erase(std::unique(pins.begin(), pins.end()), pins.end());
+    if (pins.size() < 2)
+      continue;
+
+    uint64_t hash = pins.size();
+    for (auto p : pins) {
+      hash = (hash ^ p) * 0x100000001b3ULL;
+    }
+
+    auto it = hash2net.find(hash);
+    if (it != hash2net.end()) {
+      auto other = it->second;
+      if (level.hg.get_net_size(other) == pins.size() && std::equal(pins.begin(), pins.end(), level.hg.net_begin(other))) {
+        level.hg.add_net_weight(other, h.get_net_weight(e));
+        continue;
+      }
+    }
+
+    level.hg.add_net(pins, h.get_net_weight(e));
+    if (it == hash2net.end())
+      hash2net[hash] = level.hg.get_n_nets() - 1;
+  }
+  level.hg.finalize();
+
+  return true;
+}
+
+void Mincut_partition::grow(const Mincut_hgraph &h, Vid start, uint64_t target0, std::vector<uint8_t> &side) {
+  auto n = h.get_n_vertices();
+  side.assign(n, 1);
+
+  Fm_state st(h, side);
+
+  Vid next_seed = 0;
+  Vid v         = start;
+  while (true) {
+    st.locked[v] = 1;
+    st.move(v);
+    if (st.weight[0] >= target0)
+      break;
+
+    if (!st.top(1, v)) {  // disconnected, start from another vertex
+      while (next_seed < n && side[next_seed] == 0) ++next_seed;
+      if (next_seed >= n)
+        break;
+      v = next_seed;
+    }
+  }
+}
+
+std::vector<uint8_t> Mincut_partition::initial_bisection(const Mincut_hgraph &h, const uint64_t max_weight[2], uint64_t rseed) {
+  constexpr int n_tries = 16;
+
+  auto                 n = h.get_n_vertices();
+  std::vector<uint8_t> best;
+  uint64_t             best_over = UINT64_MAX;
+  uint64_t             best_cut  = UINT64_MAX;
+
+  if (n == 0)
+    return best;
+
+  uint64_t target0 = static_cast<double>(h.get_total_weight()) * max_weight[0] / (max_weight[0] + max_weight[1]);
+
+  std::mt19937_64      rng(rseed);
+  std::vector<uint8_t> side;
+  for (auto t = 0; t < n_tries; ++t) {
+    grow(h, rng() % n, target0, side);
+    refine_fm(h, max_weight, side);
+
+    Fm_state st(h, side);
+    auto     over = st.get_overweight(max_weight);
+    if (over < best_over || (over == best_over && st.cut < best_cut)) {
+      best_over = over;
+      best_cut  = st.cut;
+      best      = side;
+    }
+  }
+
+  return best;
+}
+
+void Mincut_partition::refine_fm(const Mincut_hgraph &h, const uint64_t max_weight[2], std::vector<uint8_t> &side) {
+  constexpr int max_passes = 8;
+
+  auto n = h.get_n_vertices();
+  if (n < 2)
+    return;
+
+  // stop a pass after this many moves without a better cut
+  const size_t max_useless_moves = std::clamp<size_t>(n / 100, 50, 1000);
+
+  Fm_state         st(h, side);
+  std::vector<Vid> moves;
+
+  for (auto pass = 0; pass < max_passes; ++pass) {
+    std::fill(st.locked.begin(), st.locked.end(), 0);
+    st.heap[0] = {};
+    st.heap[1] = {};
+
+    auto over = st.get_overweight(max_weight);
+    for (Vid v = 0; v < n; ++v) {
+      if (over || st.is_boundary(v))
+        st.heap[side[v]].push({st.gain[v], v});
+    }
+
+    moves.clear();
+    auto   best_over    = over;
+    auto   best_cut     = st.cut;
+    size_t best_n_moves = 0;
+
+    while (moves.size() - best_n_moves < max_useless_moves) {
+      // best legal move of each side, a move cannot make the balance worse
+      Vid     cand[2];
+      bool    valid[2];
+      int64_t cand_gain[2];
+      for (auto s = 0; s < 2; ++s) {
+        valid[s] = st.top(s, cand[s]);
+        if (!valid[s])
+          continue;
+
+        auto     w = h.get_vertex_weight(cand[s]);
+        uint64_t new_w[2];
+        new_w[s]     = st.weight[s] - w;
+        new_w[s ^ 1] = st.weight[s ^ 1] + w;
+        uint64_t new_over = 0;
+        for (auto i = 0; i < 2; ++i) {
+          if (new_w[i] > max_weight[i])
+            new_over += new_w[i] - max_weight[i];
+        }
+        valid[s]     = new_over <= over;
+        cand_gain[s] = st.gain[cand[s]];
+      }
+
+      int s;
+      if (valid[0] && valid[1]) {
+        if (cand_gain[0] != cand_gain[1])
+          s = cand_gain[0] > cand_gain[1] ? 0 : 1;
+        else
+          s = st.weight[0] >= st.weight[1] ? 0 : 1;
+      } else if (valid[0]) {
+        s = 0;
+      } else if (valid[1]) {
+        s = 1;
+      } else {
+        break;
+      }
+
+      auto v = cand[s];
+      st.heap[s].pop();
+      st.locked[v] = 1;
+      st.move(v);
+      moves.emplace_back(v);
+
+      over = st.get_overweight(max_weight);
+      if (over < best_over || (over == best_over && st.cut < best_cut)) {
+        best_over    = over;
+        best_cut     = st.cut;
+        best_n_moves = moves.size();
+      }
+    }
+
+    for (auto i = moves.size(); i-- > best_n_moves;) {
+      st.move(moves[i]);
+    }
+
+    if (best_n_moves == 0)
+      break;
+  }
+}
+
+uint64_t Mincut_partition::get_cut(const Mincut_hgraph &h, const std::vector<uint32_t> &part) {
+  uint64_t cut = 0;
+  for (Mincut_hgraph::Nid e = 0; e < h.get_n_nets(); ++e) {
+    auto first = part[*h.net_begin(e)];
+    for (auto *p = h.net_begin(e) + 1; p != h.net_end(e); ++p) {
+      if (part[*p] != first) {
+        cut += h.get_net_weight(e);
+        break;
+      }
+    }
+  }
+  return cut;
+}
+
+uint64_t Mincut_partition::get_km1(const Mincut_hgraph &h, const std::vector<uint32_t> &part) {
+  if (part.empty())
+    return 0;
+
+  std::vector<Mincut_hgraph::Nid> stamp(*std::max_element(part.begin(), part.end()) + 1, UINT32_MAX);
+
+  uint64_t km1 = 0;
+  for (Mincut_hgraph::Nid e = 0; e < h.get_n_nets(); ++e) {
+    uint64_t n_parts = 0;
+    for (auto *p = h.net_begin(e); p != h.net_end(e); ++p) {
+      if (stamp[part[*p]] != e) {
+        stamp[part[*p]] = e;
+        ++n_parts;
+      }
+    }
+    km1 += (n_parts - 1) * h.get_net_weight(e);
+  }
+  return km1;
+}
+
+double Mincut_partition::get_imbalance(const Mincut_hgraph &h, const std::vector<uint32_t> &part, int k) {
+  if (h.get_total_weight() == 0 || k <= 0)
+    return 0;
+
+  std::vector<uint64_t> weight(k, 0);
+  for (Vid v = 0; v < part.size(); ++v) {
+    weight[part[v]] += h.get_vertex_weight(v);
+  }
+
+  double ideal = static_cast<double>(h.get_total_weight()) / k;
+  return *std::max_element(weight.begin(), weight.end()) / ideal - 1.0;
+}
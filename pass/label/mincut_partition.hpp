@@ -0,0 +1,104 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hypergraph in CSR form (net to pins and vertex to nets). The nets are added
+// first, and finalize builds the vertex to net arrays with a counting pass,
+// so both directions are contiguous arrays.
+class Mincut_hgraph {
+public:
+  using Vid = uint32_t;
+  using Nid = uint32_t;
+
+  explicit Mincut_hgraph(size_t n_vertices = 0) : vwgt(n_vertices, 1), net_offset(1, 0), total_weight(n_vertices) {}
+
+  Vid add_vertex(uint32_t weight = 1) {
+    vwgt.emplace_back(weight);
+    total_weight += weight;
+    return vwgt.size() - 1;
+  }
+
+  void set_vertex_weight(Vid v, uint32_t weight) {
+    total_weight += weight;
+    total_weight -= vwgt[v];
+    vwgt[v] = weight;
+  }
+
+  // repeated pins are removed, and nets with less than 2 pins are dropped (false)
+  bool add_net(const Vid *pins, size_t n_pins, uint32_t weight = 1);
+  bool add_net(const std::vector<Vid> &pins, uint32_t weight = 1) { return add_net(pins.data(), pins.size(), weight); }
+
+  // must be called after the last add_net
+  void finalize();
+
+  size_t   get_n_vertices() const { return vwgt.size(); }
+  size_t   get_n_nets() const { return nwgt.size(); }
+  size_t   get_n_pins() const { return net_pins.size(); }
+  uint64_t get_total_weight() const { return total_weight; }
+
+  uint32_t get_vertex_weight(Vid v) const { return vwgt[v]; }
+  uint32_t get_net_weight(Nid n) const { return nwgt[n]; }
+  uint32_t get_net_size(Nid n) const { return net_offset[n + 1] - net_offset[n]; }
+
+  const Vid *net_begin(Nid n) const { return net_pins.data() + net_offset[n]; }
+  const Vid *net_end(Nid n) const { return net_pins.data() + net_offset[n + 1]; }
+  const Nid *vertex_begin(Vid v) const { return vtx_nets.data() + vtx_offset[v]; }
+  const Nid *vertex_end(Vid v) const { return vtx_nets.data() + vtx_offset[v + 1]; }
+
+  void add_net_weight(Nid n, uint32_t weight) { nwgt[n] += weight; }
+
+private:
+  std::vector<uint32_t> vwgt;
+  std::vector<uint32_t> nwgt;
+  std::vector<uint32_t> net_offset;
+  std::vector<Vid>      net_pins;
+  std::vector<uint32_t> vtx_offset;
+  std::vector<Nid>      vtx_nets;
+  uint64_t              total_weight;
+};
+
+// Balanced k-way min-cut by recursive multilevel bisection. Each bisection
+// coarsens the hypergraph (heavy connectivity clustering), bisects the
+// coarsest level (greedy growing plus FM, several tries), and refines with FM
+// at every level while projecting back. The clustering ratings and the two
+// halves of each bisection run in the thread pool.
+class Mincut_partition {
+public:
+  using Vid = Mincut_hgraph::Vid;
+
+  // every part weight is at most (1+imbalance) times total/k
+  Mincut_partition(int _k, double _imbalance = 0.03, int _n_threads = 1, uint64_t _seed = 0);
+
+  std::vector<uint32_t> partition(const Mincut_hgraph &h);
+
+  static uint64_t get_cut(const Mincut_hgraph &h, const std::vector<uint32_t> &part);  // weight of the nets in several parts
+  static uint64_t get_km1(const Mincut_hgraph &h, const std::vector<uint32_t> &part);  // sum of (parts-1)*weight
+  static double   get_imbalance(const Mincut_hgraph &h, const std::vector<uint32_t> &part, int k);
+
+private:
+  const int      k;
+  const double   imbalance;
+  const int      n_threads;
+  const uint64_t seed;
+
+  struct Level {
+    Mincut_hgraph    hg;
+    std::vector<Vid> fine2coarse;
+  };
+
+  void bisect_rec(const Mincut_hgraph &h, const std::vector<Vid> &orig, int kk, uint32_t first_part, double eps, uint64_t rseed,
+                  std::vector<uint32_t> &part) const;
+
+  std::vector<uint8_t> bisect(const Mincut_hgraph &h, const uint64_t max_weight[2], uint64_t rseed) const;
+
+  bool coarsen(const Mincut_hgraph &h, uint64_t max_cluster_weight, uint64_t rseed, Level &level) const;
+  void rate(const Mincut_hgraph &h, uint64_t max_cluster_weight, Vid start, Vid end, std::vector<Vid> &best) const;
+
+  static std::vector<uint8_t> initial_bisection(const Mincut_hgraph &h, const uint64_t max_weight[2], uint64_t rseed);
+  static void grow(const Mincut_hgraph &h, Vid start, uint64_t target0, std::vector<uint8_t> &side);
+  static void refine_fm(const Mincut_hgraph &h, const uint64_t max_weight[2], std::vector<uint8_t> &side);
+};
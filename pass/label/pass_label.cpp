@@ -27,7 +27,9 @@ Pass_label::Pass_label(const Eprp_var &var) : Pass("pass.label", var) {
 
 void Pass_label::setup() {
   Eprp_method m1(mmap_lib::str("pass.label.mincut"), mmap_lib::str("Label a graph with mincut"), &Pass_label::label_mincut);
-  m1.add_label_optional("hier", mmap_lib::str("hierarchical traversal/labeling"), "false");
+  m1.add_label_optional("hier", mmap_lib::str("hierarchical traversal/labeling (all the instances of a sub node get one color)"), "false");
+  m1.add_label_optional("k", mmap_lib::str("number of partitions"), "2");
+  m1.add_label_optional("imbalance", mmap_lib::str("max partition weight over the average, in percent"), "3");
   m1.add_label_optional("verbose", mmap_lib::str("verbose statistics and information"), "false");
   register_pass(m1);
 
@@ -46,7 +48,18 @@ void Pass_label::setup() {
 void Pass_label::label_mincut(Eprp_var &var) {
   Pass_label pp(var);
 
-  Label_mincut p(pp.verbose, pp.hier);
+  auto k_txt         = var.get("k");
+  auto imbalance_txt = var.get("imbalance");
+  if (!k_txt.is_i() || k_txt.to_i() <= 0) {
+    error("pass.label.mincut k:{} should be bigger than zero", k_txt);
+    return;
+  }
+  if (!imbalance_txt.is_i() || imbalance_txt.to_i() < 0) {
+    error("pass.label.mincut imbalance:{} should be zero or positive", imbalance_txt);
+    return;
+  }
+
+  Label_mincut p(pp.verbose, pp.hier, k_txt.to_i(), imbalance_txt.to_i() / 100.0);
 
   for (const auto &l : var.lgs) {
     p.label(l);
@@ -0,0 +1,103 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "absl/container/flat_hash_set.h"
+#include "gtest/gtest.h"
+#include "label_mincut.hpp"
+#include "lgraph.hpp"
+
+// A sub with a chain of nots, instantiated twice in series in a top with its
+// own chain of nots. With hier, the nodes of the sub are labeled once (the
+// color is per sub lgraph), and the sub nodes of the top are not labeled.
+
+class Label_mincut_test : public ::testing::Test {
+protected:
+  static constexpr size_t chain = 8;
+
+  Lgraph *top = nullptr;
+  Lgraph *sub = nullptr;
+
+  static Node_pin add_chain(Lgraph *lg, Node_pin dpin) {
+    for (size_t i = 0; i < chain; ++i) {
+      auto not_node = lg->create_node(Ntype_op::Not, 1);
+      not_node.setup_sink_pin("a").connect_driver(dpin);
+      dpin = not_node.setup_driver_pin();
+    }
+    return dpin;
+  }
+
+  // the colors of the non graph IO nodes (0 if not colored)
+  static std::vector<int> get_colors(Lgraph *lg, bool skip_subs) {
+    std::vector<int> colors;
+    for (auto node : lg->fast()) {
+      if (skip_subs && node.is_type_sub())
+        continue;
+      colors.emplace_back(node.has_color() ? node.get_color() : 0);
+    }
+    return colors;
+  }
+
+  void SetUp() override {
+    sub = Lgraph::create("lgdb_label_mincut", "label_mincut_sub", "-");
+    {
+      auto x_dpin = sub->add_graph_input("x", 0, 1);
+      auto z_spin = sub->add_graph_output("z", 1, 1);
+      add_chain(sub, x_dpin).connect_sink(z_spin);
+    }
+
+    // top: o = #sub(#sub(chain(a)))
+    top = Lgraph::create("lgdb_label_mincut", "label_mincut_top", "-");
+
+    auto dpin = add_chain(top, top->add_graph_input("a", 0, 1));
+    for (int i = 0; i < 2; ++i) {
+      auto inst = top->create_node_sub("label_mincut_sub");
+      inst.setup_sink_pin("x").connect_driver(dpin);
+      dpin = inst.setup_driver_pin("z");
+      dpin.set_bits(1);
+    }
+    top->add_graph_output("o", 1, 1).connect_driver(dpin);
+  }
+
+  void TearDown() override {
+    top->sync();
+    sub->sync();
+  }
+};
+
+TEST_F(Label_mincut_test, hier) {
+  Label_mincut p(false, true, 2, 0.5);
+  p.label(top);
+
+  absl::flat_hash_set<int> used;
+  for (auto *lg : {top, sub}) {
+    auto colors = get_colors(lg, true);
+    EXPECT_EQ(colors.size(), chain);
+    for (auto color : colors) {
+      EXPECT_GE(color, 1);
+      EXPECT_LE(color, 2);
+      used.insert(color);
+    }
+  }
+  EXPECT_EQ(used.size(), 2u);
+
+  for (auto node : top->fast()) {
+    if (node.is_type_sub()) {
+      EXPECT_FALSE(node.has_color());
+    }
+  }
+}
+
+TEST_F(Label_mincut_test, flat) {
+  Label_mincut p(false, false, 2, 0.5);
+  p.label(top);
+
+  auto colors = get_colors(top, false);
+  EXPECT_EQ(colors.size(), chain + 2);
+  for (auto color : colors) {
+    EXPECT_GE(color, 1);
+    EXPECT_LE(color, 2);
+  }
+
+  for (auto color : get_colors(sub, false)) {
+    EXPECT_EQ(color, 0);
+  }
+}
@@ -0,0 +1,166 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "annotate.hpp"
+#include "gtest/gtest.h"
+#include "label_synth.hpp"
+#include "lgraph.hpp"
+
+// Two different subs, each one registered in the top by a flop, so they end
+// in different partitions. A rerun without changes relabels no node, an edit
+// in one sub keeps the colors of the other one, and the incremental labeling
+// has the same partitions as labeling from scratch.
+
+class Label_synth_test : public ::testing::Test {
+protected:
+  Lgraph *top   = nullptr;
+  Lgraph *sub_a = nullptr;
+  Lgraph *sub_b = nullptr;
+
+  // z = ~(x & y)
+  static Lgraph *create_sub(const mmap_lib::str &name) {
+    auto *sub = Lgraph::create("lgdb_label_synth", name, "-");
+
+    auto x_dpin = sub->add_graph_input("x", 0, 1);
+    auto y_dpin = sub->add_graph_input("y", 1, 1);
+    auto z_spin = sub->add_graph_output("z", 2, 1);
+
+    auto and_node = sub->create_node(Ntype_op::And, 1);
+    and_node.setup_sink_pin("A").connect_driver(x_dpin);
+    and_node.setup_sink_pin("A").connect_driver(y_dpin);
+
+    auto not_node = sub->create_node(Ntype_op::Not, 1);
+    not_node.setup_sink_pin("a").connect_driver(and_node.setup_driver_pin());
+    not_node.setup_driver_pin().connect_sink(z_spin);
+
+    return sub;
+  }
+
+  static absl::flat_hash_map<Node::Compact_class, int> get_colors(Lgraph *lg) {
+    absl::flat_hash_map<Node::Compact_class, int> colors;
+    for (auto node : lg->fast()) {
+      if (node.has_color())
+        colors[node.get_compact_class()] = node.get_color();
+    }
+    return colors;
+  }
+
+  // the partitions as sets of nodes (the color values may differ)
+  static std::vector<std::vector<std::pair<const Lgraph *, uint32_t>>> get_partitions(const std::vector<Lgraph *> &lgs) {
+    absl::flat_hash_map<int, std::vector<std::pair<const Lgraph *, uint32_t>>> color2nodes;
+    for (auto *lg : lgs) {
+      for (const auto &[compact, color] : get_colors(lg)) {
+        color2nodes[color].emplace_back(lg, compact.get_nid().value);
+      }
+    }
+
+    std::vector<std::vector<std::pair<const Lgraph *, uint32_t>>> partitions;
+    for (auto &[color, nodes] : color2nodes) {
+      std::sort(nodes.begin(), nodes.end());
+      partitions.emplace_back(std::move(nodes));
+    }
+    std::sort(partitions.begin(), partitions.end());
+    return partitions;
+  }
+
+  void edit_sub_b() {
+    // in place edit of sub_b (the library version does not change)
+    auto xor_node = sub_b->create_node(Ntype_op::Xor, 1);
+    xor_node.setup_sink_pin("A").connect_driver(sub_b->get_graph_input("x"));
+    xor_node.setup_sink_pin("A").connect_driver(sub_b->get_graph_input("y"));
+
+    Node and_node;
+    for (auto node : sub_b->fast()) {
+      if (node.get_type_op() == Ntype_op::And)
+        and_node = node;
+    }
+    ASSERT_FALSE(and_node.is_invalid());
+    and_node.setup_sink_pin("A").connect_driver(xor_node.setup_driver_pin());
+  }
+
+  static int label(Lgraph *lg) {
+    Label_synth p(false, true, "synth");
+    p.label(lg);
+    return p.get_n_relabeled();
+  }
+
+  void SetUp() override {
+    sub_a = create_sub("label_synth_sub_a");
+    sub_b = create_sub("label_synth_sub_b");
+
+    // top: o1 = #sub_a(a, b); o2 = #sub_b(c, d)
+    top = Lgraph::create("lgdb_label_synth", "label_synth_top", "-");
+
+    auto clk_dpin = top->add_graph_input("clock", 0, 1);
+    auto a_dpin   = top->add_graph_input("a", 1, 1);
+    auto b_dpin   = top->add_graph_input("b", 2, 1);
+    auto c_dpin   = top->add_graph_input("c", 3, 1);
+    auto d_dpin   = top->add_graph_input("d", 4, 1);
+    top->add_graph_output("o1", 5, 1);
+    top->add_graph_output("o2", 6, 1);
+
+    auto add_inst = [&](const mmap_lib::str &sub_name, const Node_pin &x, const Node_pin &y, const mmap_lib::str &out) {
+      auto inst = top->create_node_sub(sub_name);
+      inst.setup_sink_pin("x").connect_driver(x);
+      inst.setup_sink_pin("y").connect_driver(y);
+      auto z_dpin = inst.setup_driver_pin("z");
+      z_dpin.set_bits(1);
+
+      auto flop = top->create_node(Ntype_op::Flop, 1);
+      flop.setup_sink_pin("clock").connect_driver(clk_dpin);
+      flop.setup_sink_pin("din").connect_driver(z_dpin);
+      flop.setup_driver_pin().connect_sink(top->get_graph_output(out));
+    };
+    add_inst("label_synth_sub_a", a_dpin, b_dpin, "o1");
+    add_inst("label_synth_sub_b", c_dpin, d_dpin, "o2");
+  }
+
+  void TearDown() override {
+    top->sync();
+    sub_a->sync();
+    sub_b->sync();
+  }
+};
+
+TEST_F(Label_synth_test, unchanged_rerun) {
+  EXPECT_GT(label(top), 0);
+  EXPECT_EQ(label(top), 0);
+}
+
+TEST_F(Label_synth_test, edit_keeps_untouched_colors) {
+  EXPECT_GT(label(top), 0);
+
+  auto a_colors = get_colors(sub_a);
+  auto b_colors = get_colors(sub_b);
+  EXPECT_FALSE(a_colors.empty());
+  EXPECT_FALSE(b_colors.empty());
+
+  edit_sub_b();
+
+  EXPECT_GT(label(top), 0);
+  EXPECT_EQ(get_colors(sub_a), a_colors);
+  EXPECT_NE(get_colors(sub_b), b_colors);
+
+  EXPECT_EQ(label(top), 0);
+}
+
+TEST_F(Label_synth_test, incremental_matches_full) {
+  EXPECT_GT(label(top), 0);
+
+  edit_sub_b();
+  EXPECT_GT(label(top), 0);
+
+  auto incremental = get_partitions({top, sub_a, sub_b});
+  EXPECT_EQ(incremental.size(), 2u);
+
+  // without colors, all the lgraphs are labeled again
+  for (auto *lg : {top, sub_a, sub_b}) {
+    Ann_node_color::clear(lg);
+  }
+  EXPECT_GT(label(top), 0);
+
+  EXPECT_EQ(get_partitions({top, sub_a, sub_b}), incremental);
+}
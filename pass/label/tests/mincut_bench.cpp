@@ -0,0 +1,130 @@
+// This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Quality/runtime benchmark for Mincut_partition. The netlist is synthetic:
+// the cells sit in a grid and drive nets with mostly local sinks (plus some
+// long and high fanout nets), and the cell ids are shuffled so the id order
+// has no locality. The grid stripes and random balanced parts are the
+// references.
+//
+// mincut_bench [n_cells] [k] [n_threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "lbench.hpp"
+#include "mincut_partition.hpp"
+#include "thread_pool.hpp"
+
+struct Netlist {
+  Mincut_hgraph         hg;
+  std::vector<uint32_t> stripes;  // geometric reference
+};
+
+static void create_netlist(Netlist &nl, uint32_t n, int k, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+
+  uint32_t side = std::ceil(std::sqrt(static_cast<double>(n)));
+
+  std::vector<uint32_t> id(n);  // grid position to cell id
+  std::iota(id.begin(), id.end(), 0);
+  std::shuffle(id.begin(), id.end(), rng);
+
+  nl.hg = Mincut_hgraph(n);
+  nl.stripes.resize(n);
+  for (uint32_t pos = 0; pos < n; ++pos) {
+    nl.stripes[id[pos]] = static_cast<uint64_t>(pos) * k / n;
+  }
+
+  std::uniform_int_distribution<int> fanout_dist(1, 4);
+  std::uniform_int_distribution<int> offset_dist(-3, 3);
+  std::uniform_real_distribution<>   prob(0.0, 1.0);
+
+  std::vector<uint32_t> pins;
+  for (uint32_t pos = 0; pos < n; ++pos) {
+    int x = pos % side;
+    int y = pos / side;
+
+    pins.clear();
+    pins.emplace_back(id[pos]);
+
+    int fanout = fanout_dist(rng);
+    if (prob(rng) < 0.0005)
+      fanout = 200;  // reset/enable like nets
+
+    for (auto i = 0; i < fanout; ++i) {
+      uint32_t sink;
+      if (prob(rng) < 0.02) {
+        sink = rng() % n;  // long wire
+      } else {
+        int sx = std::clamp<int>(x + offset_dist(rng), 0, side - 1);
+        int sy = std::clamp<int>(y + offset_dist(rng), 0, side - 1);
+        sink   = std::min<uint32_t>(sy * side + sx, n - 1);
+      }
+      pins.emplace_back(id[sink]);
+    }
+    nl.hg.add_net(pins);
+  }
+
+  nl.hg.finalize();
+}
+
+static bool report(const char *name, const Mincut_hgraph &hg, const std::vector<uint32_t> &part, int k, double secs) {
+  auto cut = Mincut_partition::get_cut(hg, part);
+  auto km1 = Mincut_partition::get_km1(hg, part);
+  auto imb = Mincut_partition::get_imbalance(hg, part, k);
+
+  fmt::print("{:<8} cut:{:>9} km1:{:>9} imbalance:{:6.3f} time:{:.3f}s\n", name, cut, km1, imb, secs);
+
+  return imb <= 0.03 + 1e-9;
+}
+
+int main(int argc, char **argv) {
+  uint32_t n         = argc > 1 ? std::stoul(argv[1]) : 200000;
+  int      k         = argc > 2 ? std::stoi(argv[2]) : 8;
+  int      n_threads = argc > 3 ? std::stoi(argv[3]) : thread_pool.size() + 1;
+
+  Netlist nl;
+  create_netlist(nl, n, k, 42);
+  fmt::print("netlist cells:{} nets:{} pins:{} k:{} threads:{}\n", n, nl.hg.get_n_nets(), nl.hg.get_n_pins(), k, n_threads);
+
+  std::vector<uint32_t> random_part(n);
+  for (uint32_t v = 0; v < n; ++v) {
+    random_part[v] = v % k;  // the ids are already shuffled
+  }
+
+  report("random", nl.hg, random_part, k, 0);
+  report("stripes", nl.hg, nl.stripes, k, 0);
+
+  std::vector<uint32_t> part;
+  double                secs;
+  {
+    Lbench           b("mincut_bench");
+    auto             start = std::chrono::steady_clock::now();
+    Mincut_partition p(k, 0.03, n_threads, 1);
+    part = p.partition(nl.hg);
+    secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  bool balanced = report("mincut", nl.hg, part, k, secs);
+
+  auto km1        = Mincut_partition::get_km1(nl.hg, part);
+  auto stripe_km1 = Mincut_partition::get_km1(nl.hg, nl.stripes);
+  fmt::print("mincut km1 is {:.2f}x the stripes\n", static_cast<double>(km1) / stripe_km1);
+
+  if (!balanced) {
+    fmt::print("ERROR: the partition is not balanced\n");
+    return 3;
+  }
+  if (km1 > 2 * stripe_km1) {
+    fmt::print("ERROR: the partition cut is much worse than the grid stripes\n");
+    return 3;
+  }
+
+  return 0;
+}
@@ -2,48 +2,46 @@
 
 #include "opt_lnast.hpp"
 
-#include "lnast.hpp"
-
-/* TODO:
+#include <atomic>
+#include <functional>
 
-   The current code is designed to work in parallel. The overall flow:
-
-   -There should be a "top_tree" pass that runs BEFORE all the Opt_lnast. This
-   pass does not traverse inside the subgraphs to be processed in Opt_lnast.
-   The Opt_lnast can be spawned as the top_tree iterates, no need to wait for
-   the end. Since it does not traverse inside, it can not know the value for
-   the live-ins at spawn time, but it can know the potential live-ins.
+#include "lbench.hpp"
+#include "lnast.hpp"
+#include "thread_pool.hpp"
 
-   A possible spawn decision is the "stmts" sequence. If there are many
-   statements spawn an Opt_lnast. if it is HUGE, it can be even splited in
-   multiple but the optimization may not be as good.
+/* Parallel flow:
 
-   (Any node in the tree is a valid spawn point to process the children in
-   Opt_lnast. Only large subtrees make sense due to overheads)
+   -top_tree runs BEFORE all the Opt_lnast workers. It does not traverse
+   inside the statements to be processed by the workers. It splits the top
+   stmts sequence in regions of region_size consecutive statements, and each
+   region is a spawn point for an Opt_lnast worker in the thread_pool. Small
+   LNASTs have a single region and run in the calling thread.
 
    (NOTE: immutable variables could be passed because the sub-tree/Opt_lnast is
    not allowed to touch. Immutable are ___XX or inputs $foo)
 
-   -Each thread has a Opt_lnast object starting with a node_id. When the
-   traversal reaches the node_id, the opt finished.
+   -Each region is first scanned (in parallel) for its live-ins: the variables
+   read before written in the region. The aggregated live-ins decide two
+   things:
 
-   -The Opt_lnat is a "local" optimization that can not perform the best result
-   because it does not know all the live-ins values. The result is to not
-   forward/optimize unless the variable was used in a higher or equal scope.
+     *A region whose live-ins are not written by an earlier region does not
+      depend on earlier values. Its Opt_lnast worker propagates values
+      locally (in parallel) and the result is merged in order.
 
-   The Opt_lnast updates the level_forward_* tables and creates a "live-ins"
-   for any variable that was read before.
+     *A region that reads earlier values can not know the live-in values at
+      spawn time. It is processed after the merge in the top Opt_lnast, so
+      the propagated values are the same as a serial traversal.
 
-   -After all the Opt_lnast passes are done, there should be a new "cleanup"
-   pass. This pass uses information left by the Opt_lnast (level_forward for
-   live-ins). This allows to detect variables that can be deleted from the
-   tree. If live-in was not read by any succeded Opt_lnast, the variable can be
-   deleted.
+   -After all the Opt_lnast workers are done, the "cleanup" runs bottom-up
+   over each region (in parallel). A variable is live if a later statement
+   of the region reads it, or a later region has it as live-in. Statements
+   that write a variable that is not live are deleted. The cleanup is
+   repeated while the deletes shrink the region live-ins. Inputs/outputs/regs
+   ($/%/#) and the variables read by statements that the cleanup does not
+   handle (if, func_def, ...) are never deleted.
 
-   -The Opt_lnast should return the "read live-ins". This allows a fast top-level
-   cleanup method. Starting from the end we can spawn cleanups (bottom-level). Each
-   bottom-level cleanup should create a new LNAST tree which will allow to run
-   future passes in parallel.
+   -The cleanup creates a new LNAST tree without the deleted statements. This
+   reduces the nodes for the passes after lnastopt.
 
 COMMENTS:
 
@@ -74,10 +72,16 @@ Opt_lnast::Opt_lnast(const Eprp_var &var) {
   if (var.has_label("top"))
     top = var.get("top");
 
+  auto verbose_txt = var.get("verbose");
+  verbose          = verbose_txt != "false" && verbose_txt != "0" && !verbose_txt.empty();
+
   needs_hierarchy = false;
   hier_mode       = false;
 }
 
+Opt_lnast::Opt_lnast(const mmap_lib::str &_top, bool _hier_mode)
+    : needs_hierarchy(false), hier_mode(_hier_mode), verbose(false), top(_top) {}
+
 void Opt_lnast::set_needs_hierarchy() { needs_hierarchy = true; }
 
 void Opt_lnast::hierarchy_info_int(const std::string &msg) {
@@ -449,7 +453,11 @@ void Opt_lnast::process_todo(const std::shared_ptr<Lnast> &ln, const Lnast_nid &
 void Opt_lnast::process_stmts(const std::shared_ptr<Lnast> &ln, const Lnast_nid &lnid) {
   I(ln->get_data(lnid).type.is_stmts());
 
-  auto idx = ln->get_first_child(lnid);
+  process_range(ln, ln->get_first_child(lnid), Lnast_nid());
+}
+
+void Opt_lnast::process_range(const std::shared_ptr<Lnast> &ln, const Lnast_nid &first, const Lnast_nid &last) {
+  auto idx = first;
 
   while (!idx.is_invalid()) {
     const auto &data = ln->get_data(idx);
@@ -466,11 +474,257 @@ void Opt_lnast::process_stmts(const std::shared_ptr<Lnast> &ln, const Lnast_nid
       default: process_todo(ln, idx);
     }
 
+    if (idx == last)
+      break;
     idx = ln->get_sibling_next(idx);
   }
 }
 
-void Opt_lnast::opt(const std::shared_ptr<Lnast> &ln) {
+bool Opt_lnast::is_killable(const Lnast_ntype &type) {
+  return type.is_assign() || type.is_plus() || type.is_minus() || type.is_bit_or() || type.is_tuple_add() || type.is_tuple_get()
+         || type.is_tuple_set();
+}
+
+bool Opt_lnast::is_full_def(const Lnast_ntype &type) {
+  // tuple_set only updates a field, the rest of the variable is still live
+  return is_killable(type) && !type.is_tuple_set();
+}
+
+bool Opt_lnast::is_persistent(const mmap_lib::str &var) {
+  if (var.empty())
+    return true;
+
+  auto ch = var.front();
+  return ch == '$' || ch == '%' || ch == '#';
+}
+
+void Opt_lnast::collect_refs(const std::shared_ptr<Lnast> &ln, const Lnast_nid &lnid, Var_set &refs) const {
+  const auto &data = ln->get_data(lnid);
+  if (data.type.is_ref()) {
+    refs.insert(data.token.get_text());
+    return;
+  }
+
+  for (const auto &child : ln->children(lnid)) {
+    collect_refs(ln, child, refs);
+  }
+}
+
+void Opt_lnast::collect_reads(const std::shared_ptr<Lnast> &ln, const Lnast_nid &stmt, Var_set &reads) const {
+  const auto type = ln->get_type(stmt);
+  if (!is_killable(type)) {
+    collect_refs(ln, stmt, reads);
+    return;
+  }
+
+  auto lhs_id = ln->get_first_child(stmt);
+  if (type.is_tuple_set())
+    reads.insert(ln->get_name(lhs_id));
+
+  for (auto idx = ln->get_sibling_next(lhs_id); !idx.is_invalid(); idx = ln->get_sibling_next(idx)) {
+    collect_refs(ln, idx, reads);
+  }
+}
+
+void Opt_lnast::scan_region(const std::shared_ptr<Lnast> &ln, Region &region) const {
+  Var_set reads;
+
+  for (auto idx = region.first;; idx = ln->get_sibling_next(idx)) {
+    const auto type = ln->get_type(idx);
+
+    if (!type.is_invalid()) {
+      reads.clear();
+      collect_reads(ln, idx, reads);
+      for (const auto &var : reads) {
+        if (!region.defs.contains(var))
+          region.live_ins.insert(var);
+      }
+
+      if (!is_killable(type)) {
+        // may write any of them (if, func_call...), and nested stmts update values
+        region.pinned.insert(reads.begin(), reads.end());
+        region.defs.insert(reads.begin(), reads.end());
+      } else {
+        region.defs.insert(ln->get_name(ln->get_first_child(idx)));
+      }
+    }
+
+    if (idx == region.last)
+      break;
+  }
+}
+
+void Opt_lnast::cleanup_region(const std::shared_ptr<Lnast> &ln, Region &region, size_t pos) const {
+  Var_set live;
+  Var_set reads;
+
+  auto is_live = [&](const mmap_lib::str &var) {
+    if (is_persistent(var) || live.contains(var) || pinned.contains(var))
+      return true;
+    const auto it = last_live_in.find(var);
+    return it != last_live_in.end() && it->second > pos + 1;
+  };
+
+  region.dead.clear();
+
+  for (auto idx = region.last;; idx = ln->get_sibling_prev(idx)) {
+    const auto type = ln->get_type(idx);
+
+    if (is_killable(type)) {
+      const auto &lhs = ln->get_name(ln->get_first_child(idx));
+      if (!is_live(lhs)) {
+        region.dead.emplace_back(idx);
+      } else {
+        if (is_full_def(type))
+          live.erase(lhs);
+        collect_reads(ln, idx, live);
+      }
+    } else if (!type.is_invalid()) {
+      collect_reads(ln, idx, live);
+    }
+
+    if (idx == region.first)
+      break;
+  }
+
+  // what is left read before written are the live-ins of the surviving stmts
+  region.live_ins_changed = live != region.live_ins;
+  region.live_ins         = std::move(live);
+}
+
+void Opt_lnast::merge_values(const Opt_lnast &worker) {
+  for (const auto &var : worker.st.stack.back().declared) {
+    st.set(var, worker.st.get_bundle(var));
+  }
+}
+
+void Opt_lnast::top_tree(const std::shared_ptr<Lnast> &ln, const Lnast_nid &stmts_nid) {
+  I(ln->get_data(stmts_nid).type.is_stmts());
+
+  regions.clear();
+  last_live_in.clear();
+  pinned.clear();
+
+  size_t n = 0;
+  for (const auto &idx : ln->children(stmts_nid)) {
+    if (n == 0) {
+      auto &region = regions.emplace_back();
+      region.first = idx;
+    }
+    regions.back().last = idx;
+    if (++n == region_size)
+      n = 0;
+  }
+  if (regions.empty())
+    return;
+
+  auto run = [this](const std::function<void(Region &region, size_t pos)> &fn) {
+    if (regions.size() == 1) {
+      fn(regions[0], 0);
+      return;
+    }
+
+    std::atomic<int> pending = 0;
+    for (auto i = 0u; i < regions.size(); ++i) {
+      ++pending;
+      thread_pool.add([this, &fn, &pending, i]() -> void {
+        try {
+          fn(regions[i], i);
+        } catch (...) {
+          regions[i].error = std::current_exception();
+        }
+        --pending;
+      });
+    }
+    thread_pool.wait_until_done(pending);
+
+    for (const auto &region : regions) {
+      if (region.error)
+        std::rethrow_exception(region.error);
+    }
+  };
+
+  run([this, &ln](Region &region, size_t pos) { (void)pos; scan_region(ln, region); });
+
+  // live-in aggregation
+  Var_set written;
+  for (auto i = 0u; i < regions.size(); ++i) {
+    auto &region = regions[i];
+    for (const auto &var : region.live_ins) {
+      if (written.contains(var))
+        region.independent = false;
+      last_live_in[var] = i + 1;
+    }
+    written.insert(region.defs.begin(), region.defs.end());
+    pinned.insert(region.pinned.begin(), region.pinned.end());
+  }
+
+  auto func_id = ln->get_top_module_name();
+  run([this, &ln, &func_id](Region &region, size_t pos) {
+    (void)pos;
+    if (!region.independent || regions.size() == 1)
+      return;
+
+    region.worker = std::unique_ptr<Opt_lnast>(new Opt_lnast(top, hier_mode));
+    region.worker->st.funcion_scope(func_id);
+    region.worker->process_range(ln, region.first, region.last);
+  });
+
+  for (auto &region : regions) {
+    if (region.worker) {
+      merge_values(*region.worker);
+      needs_hierarchy |= region.worker->needs_hierarchy;
+      region.worker.reset();
+    } else {
+      process_range(ln, region.first, region.last);
+    }
+  }
+
+  // A stmt deleted in a region can leave a live-in of that region unread, and
+  // then the stmts writing it in earlier regions are dead too. Repeat the
+  // cleanup with the surviving live-ins until they do not change, so the
+  // result is the same as a single region.
+  while (true) {
+    run([this, &ln](Region &region, size_t pos) { cleanup_region(ln, region, pos); });
+    if (regions.size() == 1)
+      break;
+
+    bool changed = false;
+    last_live_in.clear();
+    for (auto i = 0u; i < regions.size(); ++i) {
+      changed |= regions[i].live_ins_changed;
+      for (const auto &var : regions[i].live_ins) {
+        last_live_in[var] = i + 1;
+      }
+    }
+    if (!changed)
+      break;
+  }
+}
+
+std::shared_ptr<Lnast> Opt_lnast::compact(const std::shared_ptr<Lnast> &ln) const {
+  auto new_ln = std::make_shared<Lnast>(ln->get_top_module_name(), ln->get_source());
+  new_ln->set_root(ln->get_data(Lnast_nid::root()));
+
+  std::function<void(const Lnast_nid &, const Lnast_nid &)> copy_children = [&](const Lnast_nid &src, const Lnast_nid &dst) {
+    const auto in_stmts = ln->get_type(src).is_stmts();
+    for (const auto &child : ln->children(src)) {
+      const auto &data = ln->get_data(child);
+      if (in_stmts && data.type.is_invalid())
+        continue;
+
+      auto new_child = new_ln->add_child(dst, data);
+      copy_children(child, new_child);
+    }
+  };
+  copy_children(Lnast_nid::root(), Lnast_nid::root());
+
+  return new_ln;
+}
+
+std::shared_ptr<Lnast> Opt_lnast::opt(const std::shared_ptr<Lnast> &ln) {
+  Lbench b("pass.lnastopt");
+
   st.funcion_scope(ln->get_top_module_name());
 
   if (ln->get_top_module_name() == top || top.empty())
@@ -484,9 +738,39 @@ void Opt_lnast::opt(const std::shared_ptr<Lnast> &ln) {
   }
 
   auto idx = ln->get_first_child(Lnast_nid::root());
-  process_stmts(ln, idx);
+  top_tree(ln, idx);
 
   auto outputs = st.leave_scope();
-  if (outputs)
+  if (outputs && verbose)
     outputs->dump();
+
+  size_t n_dead = 0;
+  for (const auto &region : regions) {
+    for (const auto &dead_nid : region.dead) {
+      ln->ref_data(dead_nid)->type = Lnast_ntype::create_invalid();
+    }
+    n_dead += region.dead.size();
+  }
+  regions.clear();
+
+  if (n_dead == 0)
+    return ln;
+
+  auto new_ln = compact(ln);
+  if (!verbose)
+    return new_ln;
+
+  size_t n_before = 0;
+  for (const auto &nid : ln->depth_preorder()) {
+    (void)nid;
+    ++n_before;
+  }
+  size_t n_after = 0;
+  for (const auto &nid : new_ln->depth_preorder()) {
+    (void)nid;
+    ++n_after;
+  }
+  fmt::print("lnastopt {}: removed {} dead statements, {} -> {} nodes\n", ln->get_top_module_name(), n_dead, n_before, n_after);
+
+  return new_ln;
 }
@@ -1,22 +1,67 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "symbol_table.hpp"
 #include "lnast.hpp"
 #include "pass.hpp"
 
 class Opt_lnast {
 protected:
+  using Var_set = absl::flat_hash_set<mmap_lib::str>;
+
+  // top_tree spawn unit: a run of consecutive statements of the top stmts
+  struct Region {
+    Lnast_nid                  first;
+    Lnast_nid                  last;
+    Var_set                    live_ins;  // read before written in the region
+    Var_set                    defs;
+    Var_set                    pinned;    // read by statements that the cleanup does not handle
+    bool                       independent = true;  // no live-in is written by an earlier region
+    std::unique_ptr<Opt_lnast> worker;
+    std::vector<Lnast_nid>     dead;
+    bool                       live_ins_changed = false;  // by the last cleanup
+    std::exception_ptr         error;
+  };
+  size_t region_size = 256;  // statements per Opt_lnast worker (0: a single region)
+
   Symbol_table  st;
   bool          needs_hierarchy;
   bool          hier_mode;
+  bool          verbose;
   mmap_lib::str top;
 
+  std::vector<Region>                         regions;
+  absl::flat_hash_map<mmap_lib::str, size_t> last_live_in;  // last region (+1) reading the variable as live-in
+  Var_set                                     pinned;
+
+  Opt_lnast(const mmap_lib::str &_top, bool _hier_mode);
+
+  static bool is_killable(const Lnast_ntype &type);
+  static bool is_full_def(const Lnast_ntype &type);
+  static bool is_persistent(const mmap_lib::str &var);
+
+  void collect_refs(const std::shared_ptr<Lnast> &ln, const Lnast_nid &lnid, Var_set &refs) const;
+  void collect_reads(const std::shared_ptr<Lnast> &ln, const Lnast_nid &stmt, Var_set &reads) const;
+
+  void top_tree(const std::shared_ptr<Lnast> &ln, const Lnast_nid &stmts_nid);
+  void scan_region(const std::shared_ptr<Lnast> &ln, Region &region) const;
+  void cleanup_region(const std::shared_ptr<Lnast> &ln, Region &region, size_t pos) const;
+  void merge_values(const Opt_lnast &worker);
+
+  std::shared_ptr<Lnast> compact(const std::shared_ptr<Lnast> &ln) const;
+
   void process_assign   (const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
   void process_plus     (const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
   void process_minus     (const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
   void process_bit_or     (const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
   void process_stmts    (const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
+  void process_range    (const std::shared_ptr<Lnast>& ln, const Lnast_nid& first, const Lnast_nid& last);
   void process_tuple_set(const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
   void process_tuple_get(const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
   void process_tuple_add(const std::shared_ptr<Lnast>& ln, const Lnast_nid& lnid);
@@ -36,5 +81,8 @@ protected:
 public:
   Opt_lnast(const Eprp_var& var);
 
-  void opt(const std::shared_ptr<Lnast>& ln);
+  // returns ln, or a new compacted LNAST when dead statements were removed
+  std::shared_ptr<Lnast> opt(const std::shared_ptr<Lnast>& ln);
+
+  void set_region_size(size_t sz) { region_size = sz; }
 };
@@ -10,6 +10,7 @@ static Pass_plugin lnastopt("pass_lnastopt", Pass_lnastopt::setup);
 
 void Pass_lnastopt::setup() {
   Eprp_method m1("pass.lnastopt", mmap_lib::str("LNAST optimization"), &Pass_lnastopt::work);
+  m1.add_label_optional("verbose", mmap_lib::str("print the dead statements and nodes removed"), "false");
 
   register_pass(m1);
 }
@@ -19,7 +20,10 @@ Pass_lnastopt::Pass_lnastopt(const Eprp_var &var) : Pass("pass.lnastopt", var) {
 void Pass_lnastopt::work(Eprp_var &var) {
   Opt_lnast p(var);
 
-  for (const auto &ln : var.lnasts) {
-    p.opt(ln);
+  auto lnasts = var.lnasts;
+  for (const auto &ln : lnasts) {
+    auto new_ln = p.opt(ln);
+    if (new_ln != ln)
+      var.replace(ln, new_ln);
   }
 }
@@ -0,0 +1,85 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "lnast_create.hpp"
+#include "opt_lnast.hpp"
+
+class Opt_lnast_test : public ::testing::Test {
+protected:
+  void SetUp() override { mmap_lib::str::setup(); }
+
+  // acc chain: x_k = x_j + in; dead_j = x_j + 1 (never read); %out_k = x_j every 10
+  static std::shared_ptr<Lnast> create(int n_iter) {
+    Lnast_create ln;
+    ln.new_lnast("opt_lnast_test"_str);
+
+    for (int j = 0; j < n_iter; ++j) {
+      auto x   = mmap_lib::str::concat("x", j % 8);
+      auto tmp = ln.create_plus_stmts(x, "$in"_str);
+      ln.create_assign_stmts(mmap_lib::str::concat("x", (j + 1) % 8), tmp);
+
+      auto dead = ln.create_plus_stmts(x, mmap_lib::str(1));
+      ln.create_assign_stmts(mmap_lib::str::concat("dead", j), dead);
+
+      if (j % 10 == 9)
+        ln.create_assign_stmts(mmap_lib::str::concat("%out", j % 4), x);
+    }
+
+    return ln.lnast;
+  }
+
+  static std::vector<std::string> flatten(const std::shared_ptr<Lnast> &lnast) {
+    std::vector<std::string> flat;
+    for (const auto &nid : lnast->depth_preorder()) {
+      const auto &node = lnast->get_data(nid);
+      flat.emplace_back(fmt::format("{} {} {}", nid.level, node.type.to_str(), node.token.get_text()));
+    }
+    return flat;
+  }
+
+  static std::shared_ptr<Lnast> opt(const std::shared_ptr<Lnast> &ln, size_t region_size) {
+    Eprp_var  var;
+    Opt_lnast p(var);
+    p.set_region_size(region_size);
+    return p.opt(ln);
+  }
+
+  static size_t count_stmts(const std::shared_ptr<Lnast> &ln, std::string_view prefix) {
+    size_t n     = 0;
+    auto   stmts = ln->get_first_child(Lnast_nid::root());
+    for (const auto &stmt : ln->children(stmts)) {
+      if (ln->is_leaf(stmt))
+        continue;
+      if (ln->get_name(ln->get_first_child(stmt)).starts_with(prefix))
+        ++n;
+    }
+    return n;
+  }
+};
+
+TEST_F(Opt_lnast_test, dead_statements) {
+  auto ln     = create(300);
+  auto new_ln = opt(ln, 0);
+
+  ASSERT_NE(new_ln, ln);  // something was removed
+
+  EXPECT_EQ(count_stmts(ln, "dead"), 300u);
+  EXPECT_EQ(count_stmts(new_ln, "dead"), 0u);  // never read
+  EXPECT_EQ(count_stmts(new_ln, "%out"), count_stmts(ln, "%out"));  // outputs are kept
+
+  // the accumulator feeds the outputs, only the last x update is never read
+  EXPECT_EQ(count_stmts(new_ln, "x") + 1, count_stmts(ln, "x"));
+}
+
+TEST_F(Opt_lnast_test, regions_match_single_region) {
+  auto single = flatten(opt(create(2000), 0));
+
+  for (auto sz : {1, 16, 256}) {
+    auto regions = flatten(opt(create(2000), sz));
+    EXPECT_TRUE(single == regions) << "region size " << sz;  // not EXPECT_EQ, the diff of a large tree is useless
+  }
+}
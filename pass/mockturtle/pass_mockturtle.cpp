@@ -11,6 +11,10 @@
 
 #include "pass_mockturtle.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+
 #include <mockturtle/algorithms/node_resynthesis.hpp>
 #include <mockturtle/algorithms/node_resynthesis/akers.hpp>
 #include <mockturtle/algorithms/node_resynthesis/direct.hpp>
@@ -19,10 +23,13 @@
 // FIXME: exact needs percy package in WORKSPACE
 //#include <mockturtle/algorithms/node_resynthesis/exact.hpp>
 
+#include "thread_pool.hpp"
+
 static Pass_plugin sample("pass_mockturtle", Pass_mockturtle::setup);
 
 void Pass_mockturtle::setup() {
   Eprp_method m1("pass.mockturtle", "pass a lgraph using mockturtle", &Pass_mockturtle::work);
+  m1.add_label_optional("jobs", "groups synthesized in parallel (0 uses the thread pool, 1 is the serial flow)", "0");
 
   register_pass(m1);
 }
@@ -30,6 +37,15 @@ void Pass_mockturtle::setup() {
 void Pass_mockturtle::work(Eprp_var &var) {
   Pass_mockturtle pass(var);
 
+  auto jobs_txt = var.get("jobs");
+  if (!jobs_txt.is_i() || jobs_txt.to_i() < 0) {
+    error("pass.mockturtle jobs:{} should be zero or positive", jobs_txt);
+    return;
+  }
+  pass.jobs = jobs_txt.to_i();
+  if (pass.jobs == 0)
+    pass.jobs = thread_pool.size() + 1;  // the calling thread also runs jobs while waiting
+
   for (const auto &g : var.lgs) {
     pass.do_work(g);
   }
@@ -777,132 +793,175 @@ void Pass_mockturtle::create_mockturtle_network(Lgraph *g) {
   }
 }
 
-void Pass_mockturtle::convert_mockturtle_to_KLUT() {
-  for (const auto &gid2mt_iter : gid2mt) {
-    const unsigned int             group_id = gid2mt_iter.first;
-    const mockturtle::mig_network &mt_ntk   = gid2mt_iter.second;
-
-    // mapping the po driving signal between original mig and the synthsized one
-    std::vector<mockturtle::mig_network::signal>                                          mig_pos_drivers_original;
-    std::vector<mockturtle::mig_network::signal>                                          mig_pos_drivers_synth;
-    absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::mig_network::signal> mig_synth_po_sigs_map;
-
-    mt_ntk.foreach_po([&](const auto &n) { mig_pos_drivers_original.emplace_back(n); });
+// Rewriting, resynthesis and k-LUT mapping of one group. It works on a deep
+// copy of the group MIG (a mig_network copy shares the storage), so mt_ntk and
+// its PO signals stay untouched and the groups can be synthesized in parallel.
+void Pass_mockturtle::synth_group(const mockturtle::mig_network &mt_ntk, Klut_result &res) {
+  // original IOs, the synthesis keeps the PI/PO order
+  std::vector<mockturtle::mig_network::node>   mig_inps;
+  std::vector<mockturtle::mig_network::signal> mig_outs;
+  mt_ntk.foreach_pi([&](const auto &n) { mig_inps.emplace_back(n); });
+  mt_ntk.foreach_po([&](const auto &n) { mig_outs.emplace_back(n); });
 
 #if 1
-    auto net0 = mt_ntk;
+  auto net0 = mt_ntk.clone();
 
-    // net0 = mockturtle::cleanup_dangling(net0);
+  // net0 = mockturtle::cleanup_dangling(net0);
 
-    mockturtle::refactoring_params rf_ps;
-    rf_ps.max_pis = 4;
-    mockturtle::mig_npn_resynthesis resyn1;
-    mockturtle::refactoring(net0, resyn1, rf_ps);
-    net0 = mockturtle::cleanup_dangling(net0);
+  mockturtle::refactoring_params rf_ps;
+  rf_ps.max_pis = 4;
+  mockturtle::mig_npn_resynthesis resyn1;
+  mockturtle::refactoring(net0, resyn1, rf_ps);
+  net0 = mockturtle::cleanup_dangling(net0);
 
-    mockturtle::akers_resynthesis<mockturtle::mig_network> resyn2;
-    const auto mig = mockturtle::node_resynthesis<mockturtle::mig_network>(net0, resyn2);
-    net0           = mockturtle::cleanup_dangling(net0);
+  mockturtle::akers_resynthesis<mockturtle::mig_network> resyn2;
+  const auto mig = mockturtle::node_resynthesis<mockturtle::mig_network>(net0, resyn2);
+  net0           = mockturtle::cleanup_dangling(net0);
 
-    mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{net0};
+  mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{net0};
 
 #else
-    mockturtle::mig_network cleaned_mt_ntk = cleanup_dangling(mt_ntk);
+  mockturtle::mig_network cleaned_mt_ntk = cleanup_dangling(mt_ntk);
 
-    mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{cleaned_mt_ntk};  // todo:might not suit for xag
+  mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{cleaned_mt_ntk};  // todo:might not suit for xag
 #endif
-    mockturtle::lut_mapping_params ps;
-    ps.cut_enumeration_ps.cut_size = LUT_input_bits;
-    mockturtle::lut_mapping<mockturtle::mapping_view<mockturtle::mig_network, true>, true>(mapped_mig, ps);
-    mockturtle::klut_network klut_ntk = *mockturtle::collapse_mapped_network<mockturtle::klut_network>(mapped_mig);
-    write_bench(mapped_mig, std::cout);
-    fmt::print("----------------------\n");
-    write_bench(klut_ntk, std::cout);
+  mockturtle::lut_mapping_params ps;
+  ps.cut_enumeration_ps.cut_size = LUT_input_bits;
+  mockturtle::lut_mapping<mockturtle::mapping_view<mockturtle::mig_network, true>, true>(mapped_mig, ps);
+  res.klut = *mockturtle::collapse_mapped_network<mockturtle::klut_network>(mapped_mig);
 
 #ifndef NDEBUG
-    // equivalence checking using miter
-    const auto miter  = *mockturtle::miter<mockturtle::klut_network>(mapped_mig, klut_ntk);
-    const auto result = *mockturtle::equivalence_checking(miter);
-    if (result)
-      fmt::print("mig->klut is equivalent!!\n");
-    I(result);
+  // equivalence checking using miter
+  const auto miter  = *mockturtle::miter<mockturtle::klut_network>(mapped_mig, res.klut);
+  const auto result = *mockturtle::equivalence_checking(miter);
+  I(result);
 #endif
 
-    // mapping the po driving signal and pi node between original mig and the synthsized one
-    mt_ntk.foreach_po([&](const auto &n) { mig_pos_drivers_synth.emplace_back(n); });
+  // mapping mig IO signal to klut IO signal
+  I(mt_ntk.num_pis() == res.klut.num_pis() && mt_ntk.num_pos() == res.klut.num_pos());
 
-    for (unsigned long int i = 0; i < mig_pos_drivers_original.size(); i++)
-      mig_synth_po_sigs_map[mig_pos_drivers_original[i]] = mig_pos_drivers_synth[i];
+  std::vector<mockturtle::klut_network::node>   klut_inps;
+  std::vector<mockturtle::klut_network::signal> klut_outs;
+  res.klut.foreach_pi([&](const auto &n) { klut_inps.emplace_back(n); });
+  res.klut.foreach_po([&](const auto &n) { klut_outs.emplace_back(n); });
 
-    // after po driver mapping, change the lgraph edge2mt_sigs mapping accordingly
-    // note: no need to handle bdinp_edges mapping as the pis has node representation, won't be changed by synth.
-    for (const auto &out_edge : bdout_edges) {
-      for (auto &itr : edge2mt_sigs[out_edge].signals) itr = mig_synth_po_sigs_map[itr];
+  for (auto i = 0u; i < mig_inps.size(); ++i) {
+    res.mig_pi2klut_pi[mig_inps[i]] = klut_inps[i];
+  }
+  for (auto i = 0u; i < mig_outs.size(); ++i) {
+    res.mig_po2klut_po[mig_outs[i]] = klut_outs[i];
+  }
+}
+
+// maps the boundary edges of the group to the klut IOs (serial, updates the pass tables)
+void Pass_mockturtle::stitch_group(unsigned int group_id, const mockturtle::mig_network &mt_ntk, Klut_result &res) {
+  for (const auto &inp_edge : bdinp_edges) {
+    if (edge2mt_sigs[inp_edge].gid != group_id)
+      continue;
+    I(res.klut.size() > 0);
+    edge2klut_inp_sigs[inp_edge].gid = group_id;
+    for (const auto &itr_mig_sig : edge2mt_sigs[inp_edge].signals) {
+      I(res.mig_pi2klut_pi.contains(mt_ntk.get_node(itr_mig_sig)));
+      edge2klut_inp_sigs[inp_edge].signals.emplace_back(res.mig_pi2klut_pi[mt_ntk.get_node(itr_mig_sig)]);
     }
+  }
 
-    gid2klut[group_id] = klut_ntk;
-    // mapping mig IO signal to klut IO signal
-    I(mt_ntk.num_pis() == klut_ntk.num_pis() && mt_ntk.num_pos() == klut_ntk.num_pos());
-
-    std::vector<mockturtle::mig_network::node>    mig_inps;
-    std::vector<mockturtle::mig_network::signal>  mig_outs;
-    std::vector<mockturtle::klut_network::node>   klut_inps;
-    std::vector<mockturtle::klut_network::signal> klut_outs;
-    mt_ntk.foreach_pi([&](const auto &n) { mig_inps.emplace_back(n); });
-    mt_ntk.foreach_po([&](const auto &n) { mig_outs.emplace_back(n); });
-
-    klut_ntk.foreach_pi([&](const auto &n) { klut_inps.emplace_back(n); });
-    klut_ntk.foreach_po([&](const auto &n) { klut_outs.emplace_back(n); });
-
-    absl::flat_hash_map<mockturtle::mig_network::node, mockturtle::klut_network::node>     mig_pi2klut_pi;
-    absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::klut_network::signal> mig_po2klut_po;
-    auto                                                                                   mig_inp_iter  = mig_inps.begin();
-    auto                                                                                   klut_inp_iter = klut_inps.begin();
-    while (mig_inp_iter != mig_inps.end()) {
-      mig_pi2klut_pi[*mig_inp_iter] = *klut_inp_iter;
-      fmt::print("Mockturtle Input({}) -> KLUT Input({})\n",
-                 mt_ntk.node_to_index(*mig_inp_iter),
-                 klut_ntk.node_to_index(*klut_inp_iter));
-      mig_inp_iter++;
-      klut_inp_iter++;
+  for (const auto &out_edge : bdout_edges) {
+    if (edge2mt_sigs[out_edge].gid != group_id)
+      continue;
+    I(res.klut.size() > 0);
+    edge2klut_out_sigs[out_edge].gid = group_id;
+    for (const auto &itr_mig_sig : edge2mt_sigs[out_edge].signals) {
+      I(res.mig_po2klut_po.contains(itr_mig_sig));
+      edge2klut_out_sigs[out_edge].signals.emplace_back(res.mig_po2klut_po[itr_mig_sig]);
     }
+  }
+
+  gid2klut[group_id] = std::move(res.klut);
+}
+
+void Pass_mockturtle::convert_mockturtle_to_KLUT() {
+  auto start = std::chrono::steady_clock::now();
+
+  // Biggest groups first, and the small groups are packed in one task (about
+  // 4 tasks per job) so the thread pool overhead does not dominate.
+  std::vector<std::pair<size_t, unsigned int>> order;  // (gates, gid)
+  size_t                                       total_gates = 0;
+  for (const auto &gid2mt_iter : gid2mt) {
+    order.emplace_back(gid2mt_iter.second.num_gates(), gid2mt_iter.first);
+    total_gates += gid2mt_iter.second.num_gates();
+  }
+  std::sort(order.begin(), order.end(), std::greater<>());
+
+  const size_t task_gates = std::max<size_t>(total_gates / (4 * jobs), 1);
 
-    auto mig_out_iter  = mig_outs.begin();
-    auto klut_out_iter = klut_outs.begin();
-    while (mig_out_iter != mig_outs.end()) {
-      mig_po2klut_po[*mig_out_iter] = *klut_out_iter;
-      fmt::print("Mockturtle Output({}) -> KLUT Output({})\n",
-                 mt_ntk.node_to_index(mt_ntk.get_node(*mig_out_iter)),
-                 klut_ntk.node_to_index(klut_ntk.get_node(*klut_out_iter)));
-      mig_out_iter++;
-      klut_out_iter++;
+  std::vector<std::vector<unsigned int>> tasks;
+  size_t                                 gates = task_gates;
+  for (const auto &[n, gid] : order) {
+    if (gates >= task_gates) {
+      tasks.emplace_back();
+      gates = 0;
     }
+    tasks.back().emplace_back(gid);
+    gates += n;
+  }
 
-    for (const auto &inp_edge : bdinp_edges) {
-      I(klut_ntk.size() > 0);
-      edge2klut_inp_sigs[inp_edge].gid = group_id;
-      for (const auto &itr_mig_sig : edge2mt_sigs[inp_edge].signals) {
-        I(std::find(mig_inps.begin(), mig_inps.end(), mt_ntk.get_node(itr_mig_sig)) != mig_inps.end());
-        edge2klut_inp_sigs[inp_edge].signals.emplace_back(mig_pi2klut_pi[mt_ntk.get_node(itr_mig_sig)]);
+  // At most 2*jobs tasks are synthesized before their kluts are stitched and
+  // their MIGs released, which bounds the memory with many groups.
+  const size_t window     = jobs <= 1 ? 1 : 2 * jobs;
+  size_t       group_luts = 0;
+  for (size_t first = 0; first < tasks.size(); first += window) {
+    const auto last = std::min(first + window, tasks.size());
+
+    absl::flat_hash_map<unsigned int, Klut_result> results;
+    for (auto t = first; t < last; ++t) {
+      for (auto gid : tasks[t]) {
+        results[gid];  // allocated before the workers start
       }
     }
 
-    for (const auto &out_edge : bdout_edges) {
-      I(klut_ntk.size() > 0);
-      edge2klut_out_sigs[out_edge].gid = group_id;
-      for (const auto &itr_mig_sig : edge2mt_sigs[out_edge].signals) {
-        I(std::find(mig_outs.begin(), mig_outs.end(), itr_mig_sig) != mig_outs.end());
-        edge2klut_out_sigs[out_edge].signals.emplace_back(mig_po2klut_po[(itr_mig_sig)]);
-        // edge2klut_out_sigs[out_edge].signals.emplace_back(mig_po2klut_po[*mig_outs.begin()]);
+    if (jobs <= 1) {
+      for (auto gid : tasks[first]) {
+        synth_group(gid2mt[gid], results[gid]);
+      }
+    } else {
+      std::atomic<int> pending = 0;
+      for (auto t = first; t < last; ++t) {
+        ++pending;
+        thread_pool.add([this, &results, &pending, &task = tasks[t]]() -> void {
+          for (auto gid : task) {
+            synth_group(gid2mt.at(gid), results.at(gid));
+          }
+          --pending;
+        });
       }
+      thread_pool.wait_until_done(pending);
     }
 
-    fmt::print("finished.\n\n");
+    for (auto t = first; t < last; ++t) {
+      for (auto gid : tasks[t]) {
+        auto &res = results[gid];
+        group_luts += res.klut.num_gates();
+        stitch_group(gid, gid2mt[gid], res);
+        gid2mt.erase(gid);
+      }
+    }
   }
+
+  n_luts += group_luts;
+
+  std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+  fmt::print("pass.mockturtle: {} groups in {} tasks, {} MIG gates -> {} LUTs, synthesis {:.3f}s with jobs:{}\n",
+             order.size(),
+             tasks.size(),
+             total_gates,
+             group_luts,
+             secs.count(),
+             jobs);
 }
 
 void Pass_mockturtle::create_lutified_lgraph(Lgraph *old_lg) {
-  auto    new_lg_name = absl::StrCat(old_lg->get_name(), LUTIFIED_NETWORK_NAME_SIGNATURE);
+  auto    new_lg_name = mmap_lib::str::concat(old_lg->get_name(), LUTIFIED_NETWORK_NAME_SIGNATURE);
   Lgraph *new_lg      = old_lg->clone_skeleton(new_lg_name);
 
   auto old_ginp_node                                = old_lg->get_graph_input_node();
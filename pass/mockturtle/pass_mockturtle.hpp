@@ -79,9 +79,20 @@ protected:
   absl::flat_hash_map<std::pair<unsigned int, mockturtle::klut_network::signal>,
                       std::vector<std::pair<mockturtle::klut_network::node, Port_ID>>>
        gid_pi2sink_node_lg_pid;
-  bool lg_partition(Lgraph *);
-  void create_mockturtle_network(Lgraph *);
-  void convert_mockturtle_to_KLUT();
+  size_t jobs   = 1;
+  size_t n_luts = 0;  // LUTs mapped in all the groups (serial and parallel must match)
+
+  struct Klut_result {
+    mockturtle::klut_network                                                               klut;
+    absl::flat_hash_map<mockturtle::mig_network::node, mockturtle::klut_network::node>     mig_pi2klut_pi;
+    absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::klut_network::signal> mig_po2klut_po;
+  };
+
+  bool        lg_partition(Lgraph *);
+  void        create_mockturtle_network(Lgraph *);
+  static void synth_group(const mockturtle::mig_network &mt_ntk, Klut_result &res);
+  void        stitch_group(unsigned int group_id, const mockturtle::mig_network &mt_ntk, Klut_result &res);
+  void        convert_mockturtle_to_KLUT();
   void create_lutified_lgraph(Lgraph *);
 
   void connect_complemented_signal(Lgraph *, Node_pin &, Node_pin &, const mockturtle::klut_network &,
@@ -230,5 +241,7 @@ protected:
 public:
   Pass_mockturtle(const Eprp_var &var) : Pass("pass.mockturtle", var){};
 
+  size_t get_n_luts() const { return n_luts; }
+
   static void setup();
 };
@@ -0,0 +1,95 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "gtest/gtest.h"
+#include "lgraph.hpp"
+#include "pass_mockturtle.hpp"
+
+// Several groups of logic, each one between its own flops (a flop is not
+// lutified, so it starts a new group), and of different sizes. The groups
+// synthesized in parallel (jobs>1) must map to the same LUTs as the serial
+// flow (jobs:1).
+
+class Pass_mockturtle_harness : public Pass_mockturtle {
+public:
+  Pass_mockturtle_harness(const Eprp_var &var, size_t _jobs) : Pass_mockturtle(var) { jobs = _jobs; }
+
+  using Pass_mockturtle::do_work;
+};
+
+class Pass_mockturtle_test : public ::testing::Test {
+protected:
+  static constexpr int n_groups = 6;
+  static constexpr int bits     = 4;
+
+  // group k: o_k = ~((fa ^ fb ^ ... ^ fb) & fa) with k+1 xors
+  static Lgraph *create_top(const mmap_lib::str &name) {
+    auto *lg = Lgraph::create("lgdb_pass_mockturtle", name, "-");
+
+    auto clk_dpin = lg->add_graph_input("clock", 0, 1);
+
+    Port_ID pos = 1;
+    for (int k = 0; k < n_groups; ++k) {
+      auto add_flop = [&](const mmap_lib::str &inp) {
+        auto flop = lg->create_node(Ntype_op::Flop, bits);
+        flop.setup_sink_pin("clock").connect_driver(clk_dpin);
+        flop.setup_sink_pin("din").connect_driver(lg->add_graph_input(inp, pos++, bits));
+        return flop.setup_driver_pin();
+      };
+      auto fa = add_flop(mmap_lib::str::concat("a", k));
+      auto fb = add_flop(mmap_lib::str::concat("b", k));
+
+      auto dpin = fa;
+      for (int i = 0; i <= k; ++i) {
+        auto xor_node = lg->create_node(Ntype_op::Xor, bits);
+        xor_node.setup_sink_pin("A").connect_driver(dpin);
+        xor_node.setup_sink_pin("A").connect_driver(fb);
+        dpin = xor_node.setup_driver_pin();
+      }
+
+      auto and_node = lg->create_node(Ntype_op::And, bits);
+      and_node.setup_sink_pin("A").connect_driver(dpin);
+      and_node.setup_sink_pin("A").connect_driver(fa);
+
+      auto not_node = lg->create_node(Ntype_op::Not, bits);
+      not_node.setup_sink_pin("a").connect_driver(and_node.setup_driver_pin());
+
+      lg->add_graph_output(mmap_lib::str::concat("o", k), pos++, bits).connect_driver(not_node.setup_driver_pin());
+    }
+
+    return lg;
+  }
+
+  static int count_luts(const mmap_lib::str &name) {
+    auto *lg = Lgraph::open("lgdb_pass_mockturtle", mmap_lib::str::concat(name, LUTIFIED_NETWORK_NAME_SIGNATURE));
+    if (lg == nullptr)
+      return -1;
+
+    int n = 0;
+    for (auto node : lg->fast()) {
+      if (node.get_type_op() == Ntype_op::LUT)
+        ++n;
+    }
+    return n;
+  }
+
+  static size_t lutify(const mmap_lib::str &name, size_t jobs) {
+    auto *lg = create_top(name);
+
+    Eprp_var                var;
+    Pass_mockturtle_harness p(var, jobs);
+    p.do_work(lg);
+
+    return p.get_n_luts();
+  }
+};
+
+TEST_F(Pass_mockturtle_test, same_luts) {
+  auto serial = lutify("pass_mockturtle_jobs_1", 1);
+  EXPECT_GE(serial, static_cast<size_t>(n_groups * bits));
+
+  // jobs>1 runs the parallel path even if the thread_pool has a single thread
+  auto parallel = lutify("pass_mockturtle_jobs_n", 4);
+  EXPECT_EQ(serial, parallel);
+
+  EXPECT_EQ(count_luts("pass_mockturtle_jobs_1"), count_luts("pass_mockturtle_jobs_n"));
+}
@@ -12,6 +12,8 @@ int main(int argc, char **argv) {
   } else {
     top.enable_trace(".");
   }
+  top.set_checkpoint_fork(true);  // a child process writes each checkpoint
+  top.set_checkpoint_delta(16);   // changed pages only, full checkpoint every 16
   //  top.advance_clock(100000000);
   top.advance_clock(1000000);
   // Replay last cycles:
@@ -0,0 +1,104 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Multi-lane throughput: the same design (written with the simlib helpers as
+// inou.cgen.simlib does) runs with scalar SInt once per seed, and with SIntN
+// for all the seeds at once (8, 16, 32 and 64 lanes). The final states must
+// match lane by lane.
+
+#include <chrono>
+#include <cstdio>
+
+#include "sint_lanes.hpp"
+
+constexpr int n_cycles = 2000000;
+
+template <int w>
+using Scalar = SInt<w>;
+
+template <int n_lanes>
+struct Lanes {
+  template <int w>
+  using type = SIntN<w, n_lanes>;
+};
+
+template <template <int> class T>
+struct Design {
+  T<32> lfsr;
+  T<32> acc;
+  T<16> cnt;
+
+  explicit Design(T<32> seed) : lfsr(seed), acc(0), cnt(0) {}
+
+  void cycle() {
+    const T<32> low  = (lfsr & T<32>(1)).asSInt();
+    const T<32> tap  = (lfsr ^ simlib::shl(lfsr, T<6>(3))).asSInt();
+    const T<32> next = simlib::select(simlib::resize<1>(low), (tap ^ T<32>(0x04c11db7ll)).asSInt(), simlib::sra(tap, T<6>(1)));
+    const T<1>  big  = simlib::gt<1>(simlib::resize<33>(next), simlib::resize<33>(acc));
+    const T<32> sum  = simlib::resize<32>(acc.addw(next));
+    const T<32> prod = simlib::mulw(acc, T<32>(3));
+
+    lfsr = next;
+    acc  = simlib::select(big, sum, prod);
+    cnt  = simlib::resize<16>(cnt.addw(simlib::resize<16>(big)));
+  }
+};
+
+static double secs_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// returns the number of lanes that do not match the scalar runs
+template <int n_lanes>
+static int run_lanes() {
+  SInt<32> acc[n_lanes];
+  SInt<16> cnt[n_lanes];
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto l = 0; l < n_lanes; ++l) {
+    Design<Scalar> d(SInt<32>(0x1234567ll + 7919ll * l));
+    for (auto c = 0; c < n_cycles; ++c) {
+      d.cycle();
+    }
+    acc[l] = d.acc;
+    cnt[l] = d.cnt;
+  }
+  auto scalar_secs = secs_since(start);
+
+  SIntN<32, n_lanes> seed(0);
+  for (auto l = 0; l < n_lanes; ++l) {
+    seed.set_lane(l, SInt<32>(0x1234567ll + 7919ll * l));
+  }
+
+  start = std::chrono::steady_clock::now();
+  Design<Lanes<n_lanes>::template type> d(seed);
+  for (auto c = 0; c < n_cycles; ++c) {
+    d.cycle();
+  }
+  auto lanes_secs = secs_since(start);
+
+  int n_bad = 0;
+  for (auto l = 0; l < n_lanes; ++l) {
+    if (d.acc.get_lane(l) != acc[l] || d.cnt.get_lane(l) != cnt[l])
+      ++n_bad;
+  }
+
+  auto lane_cycles = static_cast<double>(n_lanes) * n_cycles;
+  fprintf(stderr,
+          "lanes:%-2d scalar: %.3fs %.2f Mlane-cycles/s lanes: %.3fs %.2f Mlane-cycles/s (%.1fx)\n",
+          n_lanes,
+          scalar_secs,
+          lane_cycles / scalar_secs / 1e6,
+          lanes_secs,
+          lane_cycles / lanes_secs / 1e6,
+          scalar_secs / lanes_secs);
+  if (n_bad)
+    fprintf(stderr, "ERROR: %d of %d lanes do not match the scalar runs\n", n_bad, n_lanes);
+
+  return n_bad;
+}
+
+int main() {
+  int n_bad = run_lanes<8>() + run_lanes<16>() + run_lanes<32>() + run_lanes<64>();
+
+  return n_bad ? 3 : 0;
+}
@@ -0,0 +1,99 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Tracing slowdown: the same design without tracing, with the text VCD
+// writer, and with the binary Simlib_wave (convert with wave2vcd)
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "simlib_wave.hpp"
+#include "vcd_writer.hpp"
+
+constexpr int n_regs   = 64;
+constexpr int n_cycles = 200000;
+
+struct Design {
+  std::vector<UInt<32>> regs;
+  UInt<128>             acc;
+
+  Design() : regs(n_regs) {}
+
+  void cycle() {
+    for (auto i = 0; i < n_regs; ++i) {
+      if (i == 0 || regs[i - 1].bits<0, 0>())
+        regs[i] = regs[i].addw(UInt<32>(i + 1));
+    }
+    acc = acc.addw(UInt<128>(regs[0]));
+  }
+};
+
+static double secs_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+  double base_secs;
+  {
+    Design d;
+    auto   start = std::chrono::steady_clock::now();
+    for (auto c = 0; c < n_cycles; ++c) {
+      d.cycle();
+    }
+    base_secs = secs_since(start);
+    fprintf(stderr, "no trace: %.3fs (acc bit %d)\n", base_secs, (int)d.acc.bits<0, 0>().as_single_word());
+  }
+
+  {
+    Design                   d;
+    vcd::VCDWriter           writer("main_wave.vcd", vcd::makeVCDHeader());
+    std::vector<vcd::VarPtr> vars;
+    for (auto i = 0; i < n_regs; ++i) {
+      vars.emplace_back(writer.register_var("top", "reg" + std::to_string(i), vcd::VariableType::wire, 32));
+    }
+    auto acc_var = writer.register_var("top", "acc", vcd::VariableType::wire, 128);
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto c = 0; c < n_cycles; ++c) {
+      vcd::advance_to_posedge();
+      d.cycle();
+      for (auto i = 0; i < n_regs; ++i) {
+        writer.change(vars[i], d.regs[i].to_string_binary());
+      }
+      writer.change(acc_var, d.acc.to_string_binary());
+    }
+    writer.flush();
+    auto secs = secs_since(start);
+    fprintf(stderr, "vcd trace: %.3fs (%.1fx slowdown)\n", secs, secs / base_secs);
+  }
+
+  {
+    Design                           d;
+    Simlib_wave                      wave("main_wave.wave");
+    std::vector<Simlib_wave::Var_id> vars;
+    for (auto i = 0; i < n_regs; ++i) {
+      vars.emplace_back(wave.register_var("top", "reg" + std::to_string(i), 32));
+    }
+    auto acc_var = wave.register_var("top", "acc", 128);
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto c = 0; c < n_cycles; ++c) {
+      wave.advance(5 * (c + 1));
+      d.cycle();
+      for (auto i = 0; i < n_regs; ++i) {
+        wave.change(vars[i], d.regs[i]);
+      }
+      wave.change(acc_var, d.acc);
+    }
+    wave.close();
+    auto secs = secs_since(start);
+    fprintf(stderr,
+            "wave trace: %.3fs (%.1fx slowdown, %llu changes)\n",
+            secs,
+            secs / base_secs,
+            (unsigned long long)wave.get_n_changes());
+  }
+
+  return 0;
+}
@@ -0,0 +1,250 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+
+#include "sint.hpp"
+
+// Helpers for the stages generated by inou.cgen.simlib. Lgraph values are
+// signed, so each wire is a SInt<bits>. Operands are resized (sign extended or
+// truncated) to the width of the operation, and results wrap to the wire bits.
+// sint_lanes.hpp has the same helpers for the multi-lane SIntN.
+
+namespace simlib {
+
+template <int to, int from>
+inline SInt<to> resize(const SInt<from> &v) {
+  if constexpr (to >= from)
+    return SInt<to>(v);
+  else
+    return v.template bits<to - 1, 0>().asSInt();
+}
+
+// Unsigned value of the bits (shift amounts, mux selects, memory addresses).
+// Saturates when it does not fit in 64 bits
+template <int w>
+inline uint64_t to_index(const SInt<w> &v) {
+  if constexpr (w <= 64) {
+    return v.asUInt().as_single_word();
+  } else {
+    if (v.template bits<w - 1, 64>().orr())
+      return std::numeric_limits<uint64_t>::max();
+    return v.template bits<63, 0>().as_single_word();
+  }
+}
+
+template <int w>
+inline int64_t to_i(const SInt<w> &v) {
+  static_assert(w <= 64, "to_i only for 64 bits or less");
+  return resize<64>(v).as_single_word();
+}
+
+template <int w>
+inline bool is_true(const SInt<w> &v) {
+  return v.orr();
+}
+
+// true is 1 (-1 when the wire has 1 bit)
+template <int w>
+inline SInt<w> from_bool(bool b) {
+  return SInt<w>(b ? 1 : 0);
+}
+
+template <int w>
+inline SInt<w> shl(const SInt<w> &v, uint64_t amt) {
+  if (amt >= w)
+    return SInt<w>(0);
+  return v.dshlw(UInt<64>(amt));
+}
+
+template <int w>
+inline SInt<w> sra(const SInt<w> &v, uint64_t amt) {
+  if (amt >= w)
+    amt = w - 1;
+  return v >> UInt<64>(amt);
+}
+
+// sign extend from bit pos
+template <int w>
+inline SInt<w> sext(const SInt<w> &v, uint64_t pos) {
+  if (pos >= w - 1)
+    return v;
+  auto sa = w - 1 - pos;
+  return sra(shl(v, sa), sa);
+}
+
+// rounds toward zero, division by zero is zero
+template <int w>
+inline SInt<w> div(const SInt<w> &a, const SInt<w> &b) {
+  auto d = to_i(b);
+  if (d == 0)
+    return SInt<w>(0);
+  auto n = to_i(a);
+  if (d == -1)
+    return SInt<w>(static_cast<int64_t>(0 - static_cast<uint64_t>(n)));
+  return SInt<w>(n / d);
+}
+
+template <int w>
+inline bool get_bit(const SInt<w> &v, uint64_t pos) {
+  return sra(v, pos).template bits<0, 0>();
+}
+
+// bits [lo,hi) of a as a positive value
+template <int w, int a_w>
+inline SInt<w> get_range(const SInt<a_w> &a, uint64_t lo, uint64_t hi) {
+  constexpr int m = a_w > w ? a_w : w;
+
+  auto v = sra(resize<m>(a), lo);
+  auto n = hi - lo;
+  if (n < m)
+    v = (v & shl(SInt<m>(1), n).subw(SInt<m>(1))).asSInt();
+
+  return resize<w>(v);
+}
+
+template <int w, int a_w>
+inline SInt<w> get_mask(const SInt<a_w> &a, std::initializer_list<uint32_t> positions) {
+  SInt<w>  res(0);
+  uint64_t k = 0;
+  for (auto p : positions) {
+    if (k >= w)
+      break;
+    if (get_bit(a, p))
+      res = (res | shl(SInt<w>(1), k)).asSInt();
+    ++k;
+  }
+  return res;
+}
+
+// a with the bits [lo,hi) replaced by the low bits of value
+template <int w, int a_w, int v_w>
+inline SInt<w> set_range(const SInt<a_w> &a, const SInt<v_w> &value, uint64_t lo, uint64_t hi) {
+  auto res = resize<w>(a);
+  if (lo >= w)
+    return res;
+  if (hi > w)
+    hi = w;
+
+  auto    n    = hi - lo;
+  SInt<w> ones = n >= w ? SInt<w>(-1) : shl(SInt<w>(1), n).subw(SInt<w>(1));
+  auto    mask = shl(ones, lo);
+  auto    val  = shl(resize<w>(value), lo);
+
+  return ((res & (~mask).asSInt()) | (val & mask)).asSInt();
+}
+
+template <int w, int a_w, int v_w>
+inline SInt<w> set_mask(const SInt<a_w> &a, const SInt<v_w> &value, std::initializer_list<uint32_t> positions) {
+  auto     res = resize<w>(a);
+  uint64_t k   = 0;
+  for (auto p : positions) {
+    if (p >= w)
+      break;
+    auto bit = shl(SInt<w>(1), p);
+    if (get_bit(value, k))
+      res = (res | bit).asSInt();
+    else
+      res = (res & (~bit).asSInt()).asSInt();
+    ++k;
+  }
+  return res;
+}
+
+template <int w, int c_w>
+inline SInt<w> select(const SInt<c_w> &cond, const SInt<w> &a, const SInt<w> &b) {
+  return is_true(cond) ? a : b;
+}
+
+template <int w>
+inline SInt<w> mulw(const SInt<w> &a, const SInt<w> &b) {
+  return resize<w>(a * b);
+}
+
+template <int w, int a_w>
+inline SInt<w> lt(const SInt<a_w> &a, const SInt<a_w> &b) {
+  return from_bool<w>(a < b);
+}
+
+template <int w, int a_w>
+inline SInt<w> gt(const SInt<a_w> &a, const SInt<a_w> &b) {
+  return from_bool<w>(a > b);
+}
+
+template <int w, int a_w>
+inline SInt<w> eq(const SInt<a_w> &a, const SInt<a_w> &b) {
+  return from_bool<w>(a == b);
+}
+
+template <int w, int a_w>
+inline SInt<w> ror(const SInt<a_w> &a) {
+  return from_bool<w>(is_true(a));
+}
+
+template <int w>
+inline SInt<w> land(const SInt<w> &a, const SInt<w> &b) {
+  return from_bool<w>(is_true(a) && is_true(b));
+}
+
+template <int w>
+inline SInt<w> lor(const SInt<w> &a, const SInt<w> &b) {
+  return from_bool<w>(is_true(a) || is_true(b));
+}
+
+template <int w>
+inline SInt<1> eq_index(const SInt<w> &sel, uint64_t i) {
+  return from_bool<1>(to_index(sel) == i);
+}
+
+// shift amounts are the unsigned value of the wire
+template <int w, int b_w>
+inline SInt<w> shl(const SInt<w> &v, const SInt<b_w> &amt) {
+  return shl(v, to_index(amt));
+}
+
+template <int w, int b_w>
+inline SInt<w> sra(const SInt<w> &v, const SInt<b_w> &amt) {
+  return sra(v, to_index(amt));
+}
+
+template <int w, int b_w>
+inline SInt<w> sext(const SInt<w> &v, const SInt<b_w> &pos) {
+  return sext(v, to_index(pos));
+}
+
+// memories: out of range reads are zero, and out of range writes are dropped
+template <int w, size_t size, int a_w>
+inline SInt<w> mem_read(const std::array<SInt<w>, size> &m, const SInt<a_w> &addr) {
+  auto idx = to_index(addr);
+  return idx < size ? m[idx] : SInt<w>(0);
+}
+
+template <int w, size_t size, int a_w>
+inline void mem_write(std::array<SInt<w>, size> &m, const SInt<a_w> &addr, const SInt<w> &din) {
+  auto idx = to_index(addr);
+  if (idx < size)
+    m[idx] = din;
+}
+
+template <int w, size_t size, int a_w, int e_w>
+inline void mem_write(std::array<SInt<w>, size> &m, const SInt<a_w> &addr, const SInt<w> &din, const SInt<e_w> &enable) {
+  if (is_true(enable))
+    mem_write(m, addr, din);
+}
+
+// array memory read (combinational): din when the write port has the same address
+template <int w, int a_w, int b_w>
+inline SInt<w> fwd_write(const SInt<w> &cur, const SInt<a_w> &raddr, const SInt<b_w> &waddr, const SInt<w> &din) {
+  return to_index(raddr) == to_index(waddr) ? din : cur;
+}
+
+template <int w, int a_w, int b_w, int e_w>
+inline SInt<w> fwd_write(const SInt<w> &cur, const SInt<a_w> &raddr, const SInt<b_w> &waddr, const SInt<w> &din,
+                         const SInt<e_w> &enable) {
+  return is_true(enable) ? fwd_write(cur, raddr, waddr, din) : cur;
+}
+
+}  // namespace simlib
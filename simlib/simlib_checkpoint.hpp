@@ -1,13 +1,17 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include <dirent.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
+#include <cstring>
 #include <iterator>
 #include <vector>
 
@@ -28,6 +32,55 @@ class Simlib_checkpoint {
   Top_struct        top;
   Simlib_signature  signature;
 
+  // Checkpoint image is the signature followed by top. A delta checkpoint
+  // (name_<signature>_<ncycles>.delta) only has the pages that changed since
+  // the previous checkpoint (its base), and there is a full checkpoint every
+  // delta_full_every checkpoints to keep the chains short. The changed pages
+  // are found with a 64 bit hash per page (no copy of the image is kept).
+  static constexpr size_t   page_bytes        = 4096;
+  static constexpr uint64_t delta_magic       = 0x61746c6564696d73ULL;  // "simdelta"
+  static constexpr size_t   max_pending_forks = 2;
+
+  struct Delta_header {
+    uint64_t magic;
+    uint64_t base_ncycles;
+    uint64_t image_bytes;
+    uint64_t n_pages;
+  };
+
+  // Catalog of the checkpoints in path (name.index), sorted by signature and
+  // cycle, so the nearest compatible checkpoint is a binary search. The file
+  // is the magic followed by the entries in save order (append only), a later
+  // entry for the same signature and cycle replaces the earlier one.
+  static constexpr uint64_t index_magic = 0x32786e646e696d73ULL;  // "simindx2"
+
+  struct Index_entry {
+    uint64_t sign[2];
+    uint64_t ncycles;
+    uint64_t base_ncycles;  // ncycles for full checkpoints
+
+    bool operator<(const Index_entry& o) const {
+      if (sign[0] != o.sign[0])
+        return sign[0] < o.sign[0];
+      if (sign[1] != o.sign[1])
+        return sign[1] < o.sign[1];
+      return ncycles < o.ncycles;
+    }
+  };
+  std::vector<Index_entry> catalog;
+
+  bool                  fork_checkpoint;   // a forked child writes the (copy-on-write) snapshot
+  int                   delta_full_every;  // 0 disables the delta checkpoints
+  int                   delta_chain;
+  uint64_t              last_checkpoint_ncycles;
+  std::vector<uint64_t> last_page_hash;  // page hashes at the last checkpoint (delta base)
+  std::vector<pid_t>    pending_forks;
+
+  uint64_t n_checkpoints;
+  uint64_t n_delta_checkpoints;
+  uint64_t checkpoint_bytes;
+  double   checkpoint_secs;  // time the simulation is stopped by checkpoints
+
   Lbench perf;
 #ifdef SIMLIB_VCD
   void advance_reset(uint64_t n = 1) {
@@ -40,41 +93,360 @@ class Simlib_checkpoint {
   };
 #else
   void advance_reset(uint64_t n = 1) {
-    for (auto i = 0; i < n; ++i) {
+    for (uint64_t i = 0; i < n; ++i) {
       top.reset_cycle();
     }
     ncycles += n;
   };
 #endif
+
+  // f(ptr, off, n) for each contiguous piece of the image bytes [pos, pos+len)
+  template <typename F>
+  void each_image_segment(size_t pos, size_t len, F f) {
+    auto*        sig_ptr   = reinterpret_cast<uint8_t*>(signature.get_map_address());
+    const size_t sig_bytes = signature.get_map_bytes();
+    auto*        top_ptr   = reinterpret_cast<uint8_t*>(&top);
+
+    size_t done = 0;
+    while (done < len) {
+      auto     p = pos + done;
+      uint8_t* ptr;
+      size_t   avail;
+      if (p < sig_bytes) {
+        ptr   = sig_ptr + p;
+        avail = sig_bytes - p;
+      } else {
+        ptr   = top_ptr + (p - sig_bytes);
+        avail = sizeof(top) - (p - sig_bytes);
+      }
+      auto n = std::min(avail, len - done);
+      f(ptr, done, n);
+      done += n;
+    }
+  }
+
+  uint64_t hash_page(size_t pos, size_t len) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ pos;
+    each_image_segment(pos, len, [&h](uint8_t* ptr, size_t, size_t n) {
+      size_t i = 0;
+      for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        ::memcpy(&w, ptr + i, 8);
+        h = (h ^ w) * 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 31;
+      }
+      for (; i < n; ++i) {
+        h = (h ^ ptr[i]) * 0x94d049bb133111ebULL;
+        h ^= h >> 29;
+      }
+    });
+    return h;
+  }
+
+  // pages changed since the last checkpoint, false when a full checkpoint is needed
+  bool find_delta_pages(std::vector<uint32_t>& pages) {
+    if (delta_full_every <= 0)
+      return false;
+
+    const auto bytes   = calc_bytes();
+    const auto n_pages = (bytes + page_bytes - 1) / page_bytes;
+    const bool full    = delta_chain >= delta_full_every || last_page_hash.size() != n_pages || last_checkpoint_ncycles == ncycles;
+    last_page_hash.resize(n_pages);
+
+    for (size_t page = 0; page < n_pages; ++page) {
+      const auto pos = page * page_bytes;
+      const auto h   = hash_page(pos, std::min(page_bytes, bytes - pos));
+      if (!full && h != last_page_hash[page])
+        pages.emplace_back(page);
+      last_page_hash[page] = h;
+    }
+
+    if (full) {
+      delta_chain = 0;
+      return false;
+    }
+    ++delta_chain;
+
+    return true;
+  }
+
+  static bool write_all(int fd, const void* data, size_t n) {
+    auto* ptr = static_cast<const uint8_t*>(data);
+    while (n) {
+      auto sz = ::write(fd, ptr, n);
+      if (sz <= 0)
+        return false;
+      ptr += sz;
+      n -= sz;
+    }
+    return true;
+  }
+
+  static bool read_all(int fd, void* data, size_t n) {
+    auto* ptr = static_cast<uint8_t*>(data);
+    while (n) {
+      auto sz = ::read(fd, ptr, n);
+      if (sz <= 0)
+        return false;
+      ptr += sz;
+      n -= sz;
+    }
+    return true;
+  }
+
+  // Called from the forked child too, so errors are returned (no exit) and
+  // nothing is allocated (the parent may have other threads holding the
+  // malloc lock). The checkpoint is written to a .tmp file and renamed when
+  // complete.
+  bool write_checkpoint(const char* filename, const char* tmp_filename, bool delta, const std::vector<uint32_t>& pages,
+                        uint64_t base) {
+    int fd = ::open(tmp_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+      return false;
+
+    const auto bytes       = calc_bytes();
+    bool       ok          = true;
+    auto       write_image = [this, fd, &ok](size_t pos, size_t len) {
+      each_image_segment(pos, len, [fd, &ok](uint8_t* ptr, size_t, size_t n) { ok = ok && write_all(fd, ptr, n); });
+    };
+
+    if (delta) {
+      Delta_header header{delta_magic, base, bytes, pages.size()};
+      ok = write_all(fd, &header, sizeof(header)) && write_all(fd, pages.data(), pages.size() * sizeof(uint32_t));
+      for (auto page : pages) {
+        size_t pos = static_cast<size_t>(page) * page_bytes;
+        write_image(pos, std::min(page_bytes, bytes - pos));
+      }
+    } else {
+      write_image(0, bytes);
+    }
+
+    ok = ::close(fd) == 0 && ok;
+    if (!ok) {
+      ::unlink(tmp_filename);
+      return false;
+    }
+
+    return ::rename(tmp_filename, filename) == 0;
+  }
+
+  // checkpoints of different builds (signatures) never overwrite each other
+  std::string get_checkpoint_filename(uint64_t cycles) const {
+    char sign[33];
+    snprintf(sign,
+             sizeof(sign),
+             "%016llx%016llx",
+             (unsigned long long)signature.get_word(0),
+             (unsigned long long)signature.get_word(1));
+    return path + "/" + name + "_" + sign + "_" + std::to_string(cycles);
+  }
+
+  // Full checkpoint, or the delta applied over its base (recursively). A
+  // missing, truncated or different size checkpoint returns false, so the
+  // caller falls back to an older one.
+  bool load_image(uint64_t cycles, std::vector<uint8_t>& image) {
+    std::string filename = get_checkpoint_filename(cycles);
+
+    int fd = ::open(filename.c_str(), O_RDONLY, 0644);
+    if (fd >= 0) {
+      struct stat st;
+      bool        ok = ::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == image.size()
+                && read_all(fd, image.data(), image.size());
+      close(fd);
+      if (!ok)
+        fprintf(stderr, "simlib: WARNING corrupted or incompatible checkpoint:%s\n", filename.c_str());
+      return ok;
+    }
+
+    filename += ".delta";
+    fd = ::open(filename.c_str(), O_RDONLY, 0644);
+    if (fd < 0)
+      return false;
+
+    Delta_header header;
+    bool         ok = read_all(fd, &header, sizeof(header)) && header.magic == delta_magic && header.image_bytes == image.size()
+              && header.base_ncycles < cycles && header.n_pages <= (image.size() + page_bytes - 1) / page_bytes;
+    if (!ok) {
+      fprintf(stderr, "simlib: WARNING corrupted or incompatible checkpoint:%s\n", filename.c_str());
+      close(fd);
+      return false;
+    }
+
+    if (!load_image(header.base_ncycles, image)) {
+      close(fd);
+      return false;
+    }
+
+    std::vector<uint32_t> pages(header.n_pages);
+    ok = read_all(fd, pages.data(), pages.size() * sizeof(uint32_t));
+    for (auto page : pages) {
+      size_t pos = static_cast<size_t>(page) * page_bytes;
+      ok         = ok && pos < image.size() && read_all(fd, &image[pos], std::min(page_bytes, image.size() - pos));
+    }
+    close(fd);
+    if (!ok)
+      fprintf(stderr, "simlib: WARNING corrupted checkpoint:%s\n", filename.c_str());
+
+    return ok;
+  }
+
+  std::string get_index_filename() const { return path + "/" + name + ".index"; }
+
+  Index_entry get_index_key(uint64_t cycles) const {
+    Index_entry key;
+    key.sign[0]      = signature.get_word(0);
+    key.sign[1]      = signature.get_word(1);
+    key.ncycles      = cycles;
+    key.base_ncycles = cycles;
+    return key;
+  }
+
+  // sorted insert, the entry replaces an older one for the same signature and cycle
+  void insert_catalog(const Index_entry& entry) {
+    auto it = std::lower_bound(catalog.begin(), catalog.end(), entry);
+    if (it != catalog.end() && !(entry < *it))
+      *it = entry;
+    else
+      catalog.insert(it, entry);
+  }
+
+  void load_catalog() {
+    catalog.clear();
+
+    auto filename = get_index_filename();
+    int  fd       = ::open(filename.c_str(), O_RDONLY, 0644);
+    if (fd < 0)
+      return;  // no checkpoints yet
+
+    uint64_t magic = 0;
+    if (!read_all(fd, &magic, sizeof(magic)) || magic != index_magic) {
+      close(fd);
+      fprintf(stderr, "simlib: WARNING ignoring old or corrupted checkpoint index:%s\n", filename.c_str());
+      ::unlink(filename.c_str());
+      return;
+    }
+
+    // a partial last entry (interrupted append) is ignored
+    Index_entry entry;
+    while (read_all(fd, &entry, sizeof(entry))) {
+      insert_catalog(entry);
+    }
+    close(fd);
+  }
+
+  void add_to_catalog(uint64_t cycles, uint64_t base) {
+    auto entry         = get_index_key(cycles);
+    entry.base_ncycles = base;
+
+    insert_catalog(entry);
+
+    auto filename = get_index_filename();
+    int  fd       = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+      fprintf(stderr, "simlib: ERROR unable to update checkpoint index:%s\n", filename.c_str());
+      exit(3);
+    }
+
+    struct stat st;
+    bool        ok = ::fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0)
+      ok = write_all(fd, &index_magic, sizeof(index_magic));
+    ok = ok && write_all(fd, &entry, sizeof(entry));
+    ok = ::close(fd) == 0 && ok;
+    if (!ok) {
+      fprintf(stderr, "simlib: ERROR unable to update checkpoint index:%s\n", filename.c_str());
+      exit(3);
+    }
+  }
+
+  // nearest checkpoint at or before cycles with the same signature (nullptr if none)
+  const Index_entry* find_checkpoint(uint64_t cycles) const {
+    auto key = get_index_key(cycles);
+    auto it  = std::upper_bound(catalog.begin(), catalog.end(), key);
+    if (it == catalog.begin())
+      return nullptr;
+    --it;
+    if (it->sign[0] != key.sign[0] || it->sign[1] != key.sign[1])
+      return nullptr;
+    return &*it;
+  }
+
+  // reaps the finished checkpoint writers, and waits until there are no more than max_pending
+  void reap_checkpoints(size_t max_pending) {
+    auto check = [](pid_t ret, int status) {
+      if (ret < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "simlib: ERROR checkpoint process failed (unable to create checkpoint)\n");
+        exit(3);
+      }
+    };
+
+    auto it = pending_forks.begin();
+    while (it != pending_forks.end()) {
+      int  status = 0;
+      auto ret    = ::waitpid(*it, &status, WNOHANG);
+      if (ret == 0) {
+        ++it;
+        continue;
+      }
+      check(ret, status);
+      it = pending_forks.erase(it);
+    }
+
+    while (pending_forks.size() > max_pending) {
+      int  status = 0;
+      auto ret    = ::waitpid(pending_forks.front(), &status, 0);
+      check(ret, status);
+      pending_forks.erase(pending_forks.begin());
+    }
+  }
+
 public:
 #ifdef SIMLIB_VCD
   Simlib_checkpoint(std::string_view _name, std::string parent_name = "TOP",
                     vcd::VCDWriter* initializer_obj = vcd::initialize_vcd_writer(), uint64_t _reset_ncycles = 10000)
-      : name(_name), top(0, parent_name, initializer_obj), perf(name), reset_ncycles(_reset_ncycles) {
+      : reset_ncycles(_reset_ncycles), name(_name), top(0, parent_name, initializer_obj), perf(name) {
     ncycles                 = 0;
     checkpoint_ncycles      = -1;  // Disable checkpoint by default
     next_checkpoint_ncycles = 1000000000;
     last_checkpoint_sec     = 0.0;
+    fork_checkpoint         = false;
+    delta_full_every        = 0;
+    delta_chain             = 0;
+    last_checkpoint_ncycles = 0;
+    n_checkpoints           = 0;
+    n_delta_checkpoints     = 0;
+    checkpoint_bytes        = 0;
+    checkpoint_secs         = 0.0;
     advance_reset(reset_ncycles);
-    //#ifdef SIMLIB_TRACE
-    //    top.add_signature(signature);
-    //#endif
+#ifdef SIMLIB_TRACE
+    top.add_signature(signature);
+#endif
   };
 #else
   Simlib_checkpoint(std::string_view _name, uint64_t _reset_ncycles = 10000)
-      : name(_name), top(0), perf(name), reset_ncycles(_reset_ncycles) {
+      : reset_ncycles(_reset_ncycles), name(_name), top(0), perf(name) {
     ncycles                 = 0;
     checkpoint_ncycles      = -1;  // Disable checkpoint by default
     next_checkpoint_ncycles = 1000000000;
     last_checkpoint_sec     = 0.0;
+    fork_checkpoint         = false;
+    delta_full_every        = 0;
+    delta_chain             = 0;
+    last_checkpoint_ncycles = 0;
+    n_checkpoints           = 0;
+    n_delta_checkpoints     = 0;
+    checkpoint_bytes        = 0;
+    checkpoint_secs         = 0.0;
     advance_reset(reset_ncycles);
-    //#ifdef SIMLIB_TRACE
-    //    top.add_signature(signature);
-    //#endif
+#ifdef SIMLIB_TRACE
+    top.add_signature(signature);
+#endif
   };
 #endif
 
   ~Simlib_checkpoint() {
+    wait_checkpoints();
+
     std::string ext;
     double      speed = static_cast<double>(ncycles) / perf.get_secs();
     if (speed > 1e6) {
@@ -86,7 +458,31 @@ public:
     } else {
       ext = "Hz";
     }
-    fprintf(stderr, "simlib: simulation finished with %lld cycles (%.2f%s)\n", (long)ncycles, (float)speed, ext.c_str());
+    if (n_checkpoints == 0) {
+      fprintf(stderr, "simlib: simulation finished with %" PRIu64 " cycles (%.2f%s)\n", ncycles, (float)speed, ext.c_str());
+      return;
+    }
+    fprintf(stderr,
+            "simlib: simulation finished with %" PRIu64 " cycles (%.2f%s) and %" PRIu64 " checkpoints (%" PRIu64
+            " delta, %.2fMB, every %" PRIu64 " cycles, %.1f%% time)\n",
+            ncycles,
+            (float)speed,
+            ext.c_str(),
+            n_checkpoints,
+            n_delta_checkpoints,
+            checkpoint_bytes / (1024.0 * 1024.0),
+            ncycles / n_checkpoints,
+            100.0 * checkpoint_secs / perf.get_secs());
+  }
+
+  // fork: the simulation continues while a child process writes the checkpoint
+  void set_checkpoint_fork(bool enable) { fork_checkpoint = enable; }
+
+  // delta: only changed pages are saved, with a full checkpoint every full_every (0 disables)
+  void set_checkpoint_delta(int full_every) {
+    delta_full_every = full_every;
+    delta_chain      = full_every;  // next checkpoint is full
+    last_page_hash.clear();
   }
 
   void set_checkpoint_cycles(int n) {  // main.cpp:9
@@ -104,12 +500,17 @@ public:
 
   size_t calc_bytes() const { return sizeof(top) + signature.get_map_bytes(); }
 
+  const Top_struct& get_top() const { return top; }
+  uint64_t          get_ncycles() const { return ncycles; }
+
   void enable_trace(std::string_view _path) {
     path = _path;
     if (access(path.c_str(), W_OK) == -1) {
       fprintf(stderr, "simlib: ERROR unable to access path:%s\n", path.c_str());
       exit(3);
     }
+    load_catalog();
+
     const int pages = (calc_bytes() >> 12) + 1;
 
     set_checkpoint_cycles(10000 / pages);
@@ -123,104 +524,59 @@ public:
     return str.size() >= prefix.size() && 0 == str.compare(0, prefix.size(), prefix);
   }
 
-  //   uint64_t find_previous_checkpoint(uint64_t cycles) {
-  //     DIR *dr = opendir(path.c_str());
-  //     assert(dr != nullptr);
-  //     struct dirent *de;  // Pointer for directory entry
-  //     uint64_t best_found = 0; // reset everything
-  //     while ((de = readdir(dr)) != NULL) {
-  //      const std::string d_name{de->d_name};
-  //       if (!str_starts_with(d_name, name))
-  //        continue;
-  //       if (!str_ends_with(d_name, ".ckpt"))
-  //        continue;
-  //       const std::string str_cycles = d_name.substr(name.size()+1, d_name.size()-5); // 5 for .ckpt
-  //       auto val = std::atoi(str_cycles.c_str());
-  //       if (val > best_found && val <= cycles)
-  //         best_found = val;
-  //     }
-  //     closedir(dr);
-  //     return best_found;
-  //   }
-
   bool load_checkpoint(uint64_t cycles) {
-    printf("load checkpoint @%lld\n", cycles);
-    // std::string filename = path + "/" + name + "_" + std::to_string(cycles) + ".ckpt";
-    std::string filename = path + "/" + name + "_" + std::to_string(cycles);
-    int         fd       = ::open(filename.c_str(), O_RDONLY, 0644);
-    // 0644 file system permission flags : it stands for -rw-r--r-- file permission.
-    if (fd < 0) {
-      // fd<0 means the file was not opened/not found for opening/error while opening.
+    printf("load checkpoint @%" PRIu64 "\n", cycles);
+    wait_checkpoints();
+
+    std::vector<uint8_t> image(calc_bytes());
+    if (!load_image(cycles, image))
       return false;
-    }
 
-    Simlib_signature s2(signature);
-    auto             sz = read(fd, s2.get_map_address(), s2.get_map_bytes());
-    if (sz != signature.get_map_bytes()) {
-      fprintf(stderr, "simlib: ERROR corrupted checkpoint:%s signature loading\n", filename.c_str());
-      exit(3);
-    }
-    if (s2 != signature) {
-      printf("missmatch signature load checkpoint @%lld\n", cycles);
+    if (::memcmp(image.data(), signature.get_map_address(), signature.get_map_bytes()) != 0) {
+      printf("missmatch signature load checkpoint @%" PRIu64 "\n", cycles);
       return false;
     }
 
-    auto sz2 = read(fd, &top, sizeof(top));
-    if (sz2 != sizeof(top)) {
-      fprintf(stderr, "simlib: ERROR corrupted checkpoint:%s data loading\n", filename.c_str());
-      exit(3);
-    }
+    each_image_segment(0, image.size(), [&image](uint8_t* ptr, size_t off, size_t n) { ::memcpy(ptr, &image[off], n); });
 
-    close(fd);
+    delta_chain = delta_full_every;  // next checkpoint is full
 
     return true;
   }
 
   bool load_intermediate_checkpoint(uint64_t cycles) {
-    printf("load intermediate checkpoint @%lld\n", cycles);
-    std::vector<int> myvector;
-    DIR*             dr = opendir(path.c_str());
-    if (dr == NULL) {
-      fprintf(stderr, "simlib: ERROR unable to access path:%s\n", path.c_str());
-      exit(-1);
-    }
-    struct dirent* de;
-    while ((de = readdir(dr)) != NULL) {
-      std::string chop_name(de->d_name);
-      if (chop_name.substr(0, name.size() + 1) == (name + "_")) {  // name is provided in main.cpp
-        int mydata = atoi(chop_name.substr(name.size() + 1, chop_name.size() - name.size() + 1)
-                              .c_str());  // name.size() is due to ckpt and +1 is for "_"
-        myvector.push_back(mydata);
-      }
-    }
-    closedir(dr);
-    for (const auto e : myvector) {
-      if (e == cycles) {
-        load_checkpoint(cycles);  // checkpoint already available, so load it and return
-        return true;
+    printf("load intermediate checkpoint @%" PRIu64 "\n", cycles);
+    wait_checkpoints();
+
+    // nearest compatible checkpoint (a missing or mismatched one falls back to the previous)
+    uint64_t lower_cycles = 0;
+    auto     search       = cycles;
+    while (const auto* e = find_checkpoint(search)) {
+      if (load_checkpoint(e->ncycles)) {
+        lower_cycles = e->ncycles;
+        break;
       }
+      if (e->ncycles == 0)
+        break;
+      search = e->ncycles - 1;
     }
-    // if checkpoint is not already saved:
-    int lower_cycles = 0;
-    if (!myvector.empty()) {
-      std::sort(myvector.begin(), myvector.end());
-      std::vector<int>::iterator low = std::lower_bound(myvector.begin(), myvector.end(), cycles);
-      lower_cycles                   = myvector[low - myvector.begin() - 1];  // find the nearest checkpoint of lesser vailue
-    }
+
     ncycles = lower_cycles;
-    if (lower_cycles == 0) {  // if the nearest smaller checkpoint is 0
+    if (lower_cycles == cycles)
+      return true;  // checkpoint already available
+
+    if (lower_cycles == 0) {  // no checkpoint before, start from reset
       advance_reset(reset_ncycles);
       checkpoint_ncycles      = cycles - ncycles;
       next_checkpoint_ncycles = ncycles + checkpoint_ncycles;
       save_intermediate_checkpoint(cycles - reset_ncycles);
       return true;
-    }  // else:
-    load_checkpoint(lower_cycles);
+    }
+
+    // need to modify next checkpoint n cycles and ncycles since they control the flow of handling and saving checkpoint
     checkpoint_ncycles      = cycles - ncycles;
     next_checkpoint_ncycles = ncycles + checkpoint_ncycles;
     save_intermediate_checkpoint(cycles - lower_cycles);
-    // need to modify next checkpoint n cycles and ncycles since they control the flow of handling and saving checkpoint;//maybe for
-    // next checkpoint_ncycles we can use set checkpoint cycles fu cntion
     return true;
   }
   void save_intermediate_checkpoint(uint64_t n = 1) {
@@ -267,46 +623,55 @@ public:
     } while (unlikely(n > 0));
   }
   void save_checkpoint() {
-    printf("Save checkpoint @%lld\n", ncycles);
-    std::string filename = path + "/" + name + "_" + std::to_string(ncycles);
+    printf("Save checkpoint @%" PRIu64 "\n", ncycles);
+    const auto start = perf.get_secs();
 
-    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
-    if (fd < 0) {
-      fprintf(stderr, "simlib: ERROR unable to create checkpoint:%s\n", filename.c_str());
-      exit(3);
-    }
-    int ret = ::ftruncate(
-        fd,
-        calc_bytes());  // fd is made of size of top size + signature size//Upon successful completion, ftruncate() and
-                        // truncate() return 0. Otherwise a -1 is returned, and errno is set to indicate the error.
-    if (ret < 0) {
-      fprintf(stderr, "simlib: ERROR unable to grown checkpoint:%s\n", filename.c_str());
-      exit(3);
+    std::vector<uint32_t> pages;
+    const bool            delta = find_delta_pages(pages);
+    const uint64_t        base  = last_checkpoint_ncycles;
+    last_checkpoint_ncycles     = ncycles;
+
+    std::string filename = get_checkpoint_filename(ncycles);
+    if (delta)
+      filename += ".delta";
+    const std::string tmp_filename = filename + ".tmp";
+
+    bool forked = false;
+    if (fork_checkpoint) {
+      reap_checkpoints(max_pending_forks - 1);
+
+      fflush(stdout);
+      fflush(stderr);
+      auto pid = ::fork();
+      if (pid == 0) {
+        // child: the memory is a copy-on-write snapshot, the parent keeps
+        // simulating and reports a failure in reap_checkpoints
+        _exit(write_checkpoint(filename.c_str(), tmp_filename.c_str(), delta, pages, base) ? 0 : 3);
+      }
+      forked = pid > 0;  // if fork fails, write it from the parent
+      if (forked)
+        pending_forks.emplace_back(pid);
     }
-    uint8_t* base = (uint8_t*)::mmap(nullptr,
-                                     calc_bytes(),
-                                     PROT_READ | PROT_WRITE,
-                                     MAP_SHARED,
-                                     fd,
-                                     0);  // fd and base are mapped as shared mem locations ; mem mapped size is otained by
-                                          // calc_bytes which is top size+signature size
-
-    if (base == MAP_FAILED) {
-      fprintf(stderr, "simlib: ERROR unable to mmap checkpoint:%s\n", filename.c_str());
+
+    if (!forked && !write_checkpoint(filename.c_str(), tmp_filename.c_str(), delta, pages, base)) {
+      fprintf(stderr, "simlib: ERROR unable to create checkpoint:%s\n", filename.c_str());
       exit(3);
     }
 
-    ::memcpy(base,
-             signature.get_map_address(),
-             signature.get_map_bytes());  // mem form signature is copied to base for the size of signature
-    ::memcpy(
-        &base[signature.get_map_bytes()],
-        &top,
-        sizeof(top));  // data from top is copied to base with starting adress as that after signature area copied in last command
-    ::munmap(base, calc_bytes());  // memm unmap of base for the calc_bytes i.e size of top + size of signature
-    close(fd);
+    add_to_catalog(ncycles, delta ? base : ncycles);
+
+    ++n_checkpoints;
+    if (delta) {
+      ++n_delta_checkpoints;
+      checkpoint_bytes += sizeof(Delta_header) + pages.size() * (sizeof(uint32_t) + page_bytes);
+    } else {
+      checkpoint_bytes += calc_bytes();
+    }
+    checkpoint_secs += perf.get_secs() - start;
   }
 
+  void wait_checkpoints() { reap_checkpoints(0); }
+
   void handle_checkpoint() {
 #ifdef SIMLIB_TRACE
     auto delta_secs = perf.get_secs() - last_checkpoint_sec;  // delta_secs is of type double
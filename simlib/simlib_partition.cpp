@@ -0,0 +1,252 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "simlib_partition.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+Simlib_partition::Simlib_partition(int _n_threads, uint64_t _calibrate_ncycles)
+    : n_threads(std::max(_n_threads, 1)), calibrate_ncycles(_calibrate_ncycles), perf("simlib.partition") {
+  rebalance_ncycles      = 0;
+  last_rebalance_ncycles = 0;
+  ncycles                = 0;
+  run_end                = 0;
+  started                = false;
+  quit                   = false;
+  main_sense             = false;
+  wait_cost              = 0;
+  window_cost            = 0;
+}
+
+Simlib_partition::~Simlib_partition() {
+  if (!started)
+    return;
+
+  if (!workers.empty()) {
+    quit = true;
+    barrier_wait(main_sense);
+    for (auto &t : workers) {
+      t.join();
+    }
+  }
+
+  if (window_cost > 0) {
+    fprintf(stderr,
+            "simlib: partition %zu stages in %d threads, %lld cycles, thread 0 waits %.1f%% in the barrier (calibration windows)\n",
+            stages.size(),
+            n_threads,
+            (long long)ncycles,
+            100.0 * wait_cost / window_cost);
+  }
+}
+
+Simlib_partition::Stage_id Simlib_partition::add_stage(const std::string &name, Cycle_fn fn) {
+  if (started) {
+    fprintf(stderr, "simlib: ERROR partition stage:%s added after the first run\n", name.c_str());
+    exit(3);
+  }
+
+  Stage s;
+  s.name    = name;
+  s.fn      = std::move(fn);
+  s.n_calls = 0;
+  s.cost    = 0;
+  s.weight  = 1;
+  stages.emplace_back(std::move(s));
+
+  return stages.size() - 1;
+}
+
+void Simlib_partition::start() {
+  if (stages.empty()) {
+    fprintf(stderr, "simlib: ERROR partition without stages\n");
+    exit(3);
+  }
+  started = true;
+
+  // no more threads than stages or cores (spinning threads would share a core)
+  n_threads = std::min<int>(n_threads, stages.size());
+  int n_cores = std::thread::hardware_concurrency();
+  if (n_cores > 0)
+    n_threads = std::min(n_threads, n_cores);
+
+  barrier.pending.store(n_threads);
+  barrier.sense.store(false);
+
+  rebalance();  // round robin until there are measured costs
+
+  for (auto tid = 1; tid < n_threads; ++tid) {
+    workers.emplace_back(&Simlib_partition::worker_loop, this, tid);
+  }
+}
+
+void Simlib_partition::barrier_wait(bool &local_sense) {
+  local_sense = !local_sense;
+  if (barrier.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    barrier.pending.store(n_threads, std::memory_order_relaxed);
+    barrier.sense.store(local_sense, std::memory_order_release);
+    return;
+  }
+
+  int n_spins = 0;
+  while (barrier.sense.load(std::memory_order_acquire) != local_sense) {
+    if (++n_spins < 4096) {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#endif
+    } else {
+      std::this_thread::yield();  // more threads than cores
+    }
+  }
+}
+
+uint64_t Simlib_partition::get_timed_end(uint64_t first, uint64_t end) const {
+  return std::min(end, std::max(first, last_rebalance_ncycles + calibrate_ncycles));
+}
+
+void Simlib_partition::run_cycles(int tid, bool &local_sense) {
+  const auto &part = parts[tid];
+
+  // read before the first barrier: a worker can leave the last barrier after
+  // the main thread already set up the next run (run_end, rebalance)
+  const auto end       = run_end;
+  auto       c         = ncycles;
+  const auto timed_end = get_timed_end(ncycles, end);
+  if (c < timed_end) {
+    auto window_start = perf.get_secs();
+    for (; c < timed_end; ++c) {
+      for (auto id : part) {
+        auto &s     = stages[id];
+        auto  start = perf.get_secs();
+        s.fn(c);
+        s.cost += perf.get_secs() - start;
+        ++s.n_calls;
+      }
+
+      if (tid == 0) {
+        auto start = perf.get_secs();
+        barrier_wait(local_sense);
+        wait_cost += perf.get_secs() - start;
+      } else {
+        barrier_wait(local_sense);
+      }
+    }
+    if (tid == 0)
+      window_cost += perf.get_secs() - window_start;
+  }
+
+  for (; c < end; ++c) {
+    for (auto id : part) {
+      stages[id].fn(c);
+    }
+    barrier_wait(local_sense);
+  }
+}
+
+void Simlib_partition::worker_loop(int tid) {
+  bool local_sense = false;
+  while (true) {
+    barrier_wait(local_sense);  // start of a run (or quit)
+    if (quit)
+      return;
+    run_cycles(tid, local_sense);
+  }
+}
+
+void Simlib_partition::run_sequential(uint64_t n) {
+  auto c         = ncycles;
+  auto timed_end = get_timed_end(ncycles, ncycles + n);
+  for (; c < timed_end; ++c) {
+    for (auto &s : stages) {
+      auto start = perf.get_secs();
+      s.fn(c);
+      s.cost += perf.get_secs() - start;
+      ++s.n_calls;
+    }
+  }
+  for (; c < ncycles + n; ++c) {
+    for (auto &s : stages) {
+      s.fn(c);
+    }
+  }
+  ncycles += n;
+}
+
+void Simlib_partition::run(uint64_t n) {
+  if (unlikely(!started))
+    start();
+
+  if (ncycles < calibrate_ncycles) {
+    auto m = std::min(n, calibrate_ncycles - ncycles);
+    run_sequential(m);
+    n -= m;
+    if (ncycles >= calibrate_ncycles)
+      rebalance();
+  } else if (rebalance_ncycles && ncycles - last_rebalance_ncycles >= rebalance_ncycles) {
+    rebalance();
+  }
+
+  if (n == 0)
+    return;
+
+  if (workers.empty()) {
+    run_sequential(n);
+    return;
+  }
+
+  run_end = ncycles + n;
+  barrier_wait(main_sense);  // release the workers
+  run_cycles(0, main_sense);
+  ncycles = run_end;
+}
+
+void Simlib_partition::rebalance() {
+  // called between runs, the workers are waiting in the barrier
+  for (auto &s : stages) {
+    if (s.n_calls) {
+      s.weight = std::max(s.cost / s.n_calls, 1e-3);
+    }
+    s.cost    = 0;
+    s.n_calls = 0;
+  }
+  last_rebalance_ncycles = ncycles;
+
+  // longest (most expensive) stage first to the least loaded thread
+  std::vector<Stage_id> order(stages.size());
+  for (auto i = 0u; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](Stage_id a, Stage_id b) { return stages[a].weight > stages[b].weight; });
+
+  std::vector<double> load(n_threads, 0);
+  parts.clear();
+  parts.resize(n_threads);
+  for (auto id : order) {
+    auto tid = std::min_element(load.begin(), load.end()) - load.begin();
+    parts[tid].emplace_back(id);
+    load[tid] += stages[id].weight;
+  }
+  for (auto &p : parts) {
+    std::sort(p.begin(), p.end());
+  }
+}
+
+void Simlib_partition::dump() const {
+  double total = 0;
+  double max   = 0;
+  for (auto tid = 0u; tid < parts.size(); ++tid) {
+    double load = 0;
+    for (auto id : parts[tid]) load += stages[id].weight;
+    total += load;
+    max = std::max(max, load);
+
+    fprintf(stderr, "simlib: partition thread %u load %.2f:", tid, load);
+    for (auto id : parts[tid]) fprintf(stderr, " %s(%.2f)", stages[id].name.c_str(), stages[id].weight);
+    fprintf(stderr, "\n");
+  }
+  if (max > 0)
+    fprintf(stderr, "simlib: partition balance %.1f%% (ideal speedup %.2fx)\n", 100.0 * total / (max * parts.size()), total / max);
+}
@@ -0,0 +1,103 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lbench.hpp"
+
+// Flop between two partitioned stages. The driver stage sets the value every
+// cycle and the other stages get the value set in the previous cycle, so the
+// stages of a cycle can run in any order (or in parallel) with one barrier
+// per cycle.
+template <typename T>
+class alignas(64) Simlib_channel {
+public:
+  const T &get(uint64_t ncycle) const { return slot[(ncycle + 1) & 1]; }
+  void     set(uint64_t ncycle, const T &v) { slot[ncycle & 1] = v; }
+
+  void reset(const T &v) {
+    slot[0] = v;
+    slot[1] = v;
+  }
+
+private:
+  T slot[2];
+};
+
+// Runs sibling stages that only communicate through Simlib_channel (flops) in
+// worker threads. The first calibrate_ncycles cycles run sequentially to
+// measure the cost of each stage (Lbench cycles per call). Then the stages are
+// assigned to the threads with a greedy longest first balance, and each
+// thread runs its stages for a cycle and waits in a spin barrier. Only the
+// calibrate_ncycles cycles after each rebalance are timed, the other cycles
+// run without timer calls.
+class Simlib_partition {
+public:
+  using Stage_id = uint32_t;
+  using Cycle_fn = std::function<void(uint64_t ncycle)>;
+
+  explicit Simlib_partition(int n_threads, uint64_t calibrate_ncycles = 1000);
+  ~Simlib_partition();
+
+  Simlib_partition(const Simlib_partition &)            = delete;
+  Simlib_partition &operator=(const Simlib_partition &) = delete;
+
+  // all the stages must be added before the first run
+  Stage_id add_stage(const std::string &name, Cycle_fn fn);
+
+  // measured costs are kept, and the partitions are recomputed every n cycles (0 disables)
+  void set_rebalance(uint64_t n) { rebalance_ncycles = n; }
+
+  // advance n cycles (better with large n, each call releases the workers)
+  void run(uint64_t n);
+
+  uint64_t get_ncycles() const { return ncycles; }
+
+  void rebalance();
+  void dump() const;
+
+private:
+  struct alignas(64) Stage {
+    std::string name;
+    Cycle_fn    fn;
+    uint64_t    n_calls;
+    double      cost;    // Lbench time in the calibration window (written only by the owner thread)
+    double      weight;  // cost per call used by the last rebalance
+  };
+
+  struct alignas(64) Barrier {
+    std::atomic<int>  pending;
+    std::atomic<bool> sense;
+  };
+
+  int            n_threads;
+  const uint64_t calibrate_ncycles;
+  uint64_t       rebalance_ncycles;
+  uint64_t       last_rebalance_ncycles;
+  uint64_t       ncycles;
+  uint64_t       run_end;
+  bool           started;
+  bool           quit;
+  bool           main_sense;
+
+  std::vector<Stage>                 stages;
+  std::vector<std::vector<Stage_id>> parts;  // stages run by each thread
+  std::vector<std::thread>           workers;
+  Barrier                            barrier;
+  double                             wait_cost;    // thread 0 time in the barrier (calibration windows)
+  double                             window_cost;  // thread 0 time in the calibration windows
+
+  Lbench perf;
+
+  void start();
+  uint64_t get_timed_end(uint64_t first, uint64_t end) const;
+  void     run_sequential(uint64_t n);
+  void run_cycles(int tid, bool &local_sense);
+  void worker_loop(int tid);
+  void barrier_wait(bool &local_sense);
+};
@@ -1,19 +1,64 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
 
+// Structural signature of the simulated design. The stages append their name
+// and the name, offset and size of each state field (generated by
+// inou.cgen.simlib), so two builds with the same signature have the same
+// checkpoint layout. Two 64 bit lanes are mixed in order (not a XOR of
+// hashes) so reordered or swapped fields change the signature.
 class Simlib_signature {
 private:
-  uint64_t h;
+  uint64_t h[2];
+
+  static uint64_t mix(uint64_t x) {  // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+  }
 
 public:
-  Simlib_signature() { h = 0; }
+  Simlib_signature() {
+    h[0] = 0x736c62696c6d6973ULL;  // "simlibls"
+    h[1] = 0x6e676973ULL;
+  }
+
+  void append(uint64_t d) {
+    h[0] = mix(h[0] ^ d);
+    h[1] = mix(h[1] + (d ^ 0x9e3779b97f4a7c15ULL)) ^ h[0];
+  }
+
+  void append(std::string_view str) {
+    append(static_cast<uint64_t>(str.size()));
+    for (size_t i = 0; i < str.size(); i += 8) {
+      uint64_t d = 0;
+      ::memcpy(&d, str.data() + i, std::min<size_t>(8, str.size() - i));
+      append(d);
+    }
+  }
+
+  void append(const char *str) { append(std::string_view(str)); }
+
+  // field of stage: name, offset in the stage, and size
+  template <typename Stage, typename Field>
+  void append_field(const Stage *stage, const Field &field, std::string_view name) {
+    append(name);
+    append(static_cast<uint64_t>(reinterpret_cast<const char *>(&field) - reinterpret_cast<const char *>(stage)));
+    append(static_cast<uint64_t>(sizeof(Field)));
+  }
 
-  void      append(uint64_t d) { h ^= std::hash<uint64_t>{}(d); }
-  uint64_t *get_map_address() { return &h; }
+  uint64_t  get_word(int i) const { return h[i]; }
+  uint64_t *get_map_address() { return h; }
 
-  size_t get_map_bytes() const { return sizeof(uint64_t); }
+  size_t get_map_bytes() const { return sizeof(h); }
 
-  bool operator!=(const Simlib_signature &s2) const { return h != s2.h; }
+  bool operator==(const Simlib_signature &s2) const { return h[0] == s2.h[0] && h[1] == s2.h[1]; }
+  bool operator!=(const Simlib_signature &s2) const { return !(*this == s2); }
 };
@@ -0,0 +1,141 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "simlib_wave.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static size_t wave_round_pow2(size_t n) {
+  size_t v = 2;
+  while (v < n) v <<= 1;
+  return v;
+}
+
+Simlib_wave::Simlib_wave(const std::string &_filename, size_t buffer_words)
+    : filename(_filename)
+    , max_chunks(wave_round_pow2(buffer_words / chunk_words))
+    , full_chunks(2 * max_chunks)
+    , free_chunks(2 * max_chunks) {
+  now       = 0;
+  last_time = 0;
+  n_changes = 0;
+  started   = false;
+  closed    = false;
+  current   = nullptr;
+  done      = false;
+
+  ofile = fopen(filename.c_str(), "wb");
+  if (ofile == nullptr) {
+    fprintf(stderr, "simlib: ERROR unable to create waveform:%s\n", filename.c_str());
+    exit(3);
+  }
+
+  header.append(magic, sizeof(magic));
+}
+
+Simlib_wave::~Simlib_wave() { close(); }
+
+Simlib_wave::Var_id Simlib_wave::register_var(const std::string &scope, const std::string &name, uint32_t bits) {
+  if (started) {
+    fprintf(stderr, "simlib: ERROR waveform var:%s.%s registered after the first change\n", scope.c_str(), name.c_str());
+    exit(3);
+  }
+  if (bits == 0)
+    bits = 1;
+
+  Var v;
+  v.bits     = bits;
+  v.n_words  = (bits + 63) / 64;
+  v.offset   = last.size();
+  v.top_mask = (bits % 64) ? ((1ULL << (bits % 64)) - 1) : ~0ULL;
+  vars.emplace_back(v);
+  last.resize(last.size() + v.n_words, 0);
+
+  uint32_t sizes[3] = {bits, static_cast<uint32_t>(scope.size()), static_cast<uint32_t>(name.size())};
+  header.append(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+  header.append(scope);
+  header.append(name);
+
+  return vars.size() - 1;
+}
+
+void Simlib_wave::start() {
+  started = true;
+
+  // n_vars goes after the magic
+  uint64_t n_vars = vars.size();
+  header.insert(sizeof(magic), reinterpret_cast<const char *>(&n_vars), sizeof(n_vars));
+  if (fwrite(header.data(), 1, header.size(), ofile) != header.size()) {
+    fprintf(stderr, "simlib: ERROR unable to write waveform:%s\n", filename.c_str());
+    exit(3);
+  }
+
+  chunks.emplace_back(std::make_unique<Chunk>());
+  current    = chunks.back().get();
+  current->n = 0;
+
+  writer = std::thread(&Simlib_wave::writer_loop, this);
+}
+
+void Simlib_wave::next_chunk() {
+  while (!full_chunks.enqueue(current)) {
+    std::this_thread::yield();
+  }
+
+  current = nullptr;
+  if (!free_chunks.dequeue(current)) {
+    if (chunks.size() < max_chunks) {
+      chunks.emplace_back(std::make_unique<Chunk>());
+      current = chunks.back().get();
+    } else {
+      while (!free_chunks.dequeue(current)) {  // writer is behind, wait for it
+        std::this_thread::yield();
+      }
+    }
+  }
+  current->n = 0;
+}
+
+void Simlib_wave::writer_loop() {
+  Chunk *c = nullptr;
+  while (true) {
+    bool finished = done.load(std::memory_order_acquire);
+    if (!full_chunks.dequeue(c)) {
+      if (finished)
+        break;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    if (fwrite(c->data, sizeof(uint64_t), c->n, ofile) != c->n) {
+      fprintf(stderr, "simlib: ERROR unable to write waveform:%s\n", filename.c_str());
+      exit(3);
+    }
+    while (!free_chunks.enqueue(c)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void Simlib_wave::close() {
+  if (closed)
+    return;
+  closed = true;
+
+  if (started) {
+    if (current->n) {
+      while (!full_chunks.enqueue(current)) {
+        std::this_thread::yield();
+      }
+    }
+    done.store(true, std::memory_order_release);
+    writer.join();
+  } else {
+    uint64_t n_vars = vars.size();
+    header.insert(sizeof(magic), reinterpret_cast<const char *>(&n_vars), sizeof(n_vars));
+    fwrite(header.data(), 1, header.size(), ofile);
+  }
+
+  fclose(ofile);
+}
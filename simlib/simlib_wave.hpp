@@ -0,0 +1,160 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "likely.hpp"
+#include "sint.hpp"
+#include "spsc.hpp"
+#include "uint.hpp"
+
+// Binary waveform (value change log) writer. Variables are registered once
+// and then changed by id with raw words (LSB first). The simulation thread
+// only compares against the last value and appends the change to a chunk. Full
+// chunks go through a lock free queue (spsc) to a background thread that
+// writes them and recycles them. wave2vcd converts the log to a VCD file.
+//
+// File format (native endian):
+//   "SIMWAVE1", n_vars (u64)
+//   per var: bits (u32), scope size (u32), name size (u32), scope, name
+//   stream of u64: time records (bit 63 set) or a var id followed by its words
+class Simlib_wave {
+public:
+  using Var_id = uint32_t;
+
+  static constexpr char     magic[8]  = {'S', 'I', 'M', 'W', 'A', 'V', 'E', '1'};
+  static constexpr uint64_t time_mark = 1ULL << 63;
+
+  Simlib_wave(const std::string &filename, size_t buffer_words = 1 << 21);
+  ~Simlib_wave();
+
+  Simlib_wave(const Simlib_wave &)            = delete;
+  Simlib_wave &operator=(const Simlib_wave &) = delete;
+
+  // all the variables must be registered before the first change
+  Var_id register_var(const std::string &scope, const std::string &name, uint32_t bits);
+
+  // time of the following changes (never decreasing)
+  void advance(uint64_t t) { now = t; }
+
+  // returns false when the value did not change (the bits above the var size are ignored)
+  bool change(Var_id id, const uint64_t *words) {
+    const auto &v = vars[id];
+    return change_words(id, [&v, words](uint32_t i) { return i + 1 == v.n_words ? words[i] & v.top_mask : words[i]; });
+  }
+
+  // zero extended for vars wider than 64 bits
+  bool change(Var_id id, uint64_t value) {
+    const auto &v = vars[id];
+    return change_words(id, [&v, value](uint32_t i) -> uint64_t {
+      if (i)
+        return 0;
+      return v.n_words == 1 ? value & v.top_mask : value;
+    });
+  }
+
+  template <int w>
+  bool change(Var_id id, const UInt<w> &v) {
+    uint64_t words[(w + 63) / 64];
+    to_words(v, words, std::make_integer_sequence<int, (w + 63) / 64>{});
+    return change(id, words);
+  }
+
+  template <int w>
+  bool change(Var_id id, const SInt<w> &v) {
+    return change(id, v.asUInt());
+  }
+
+  // waits for the background writer and closes the file
+  void close();
+
+  uint64_t get_n_changes() const { return n_changes; }
+
+private:
+  struct Var {
+    uint32_t bits;
+    uint32_t n_words;
+    uint32_t offset;  // in last
+    uint64_t top_mask;
+  };
+
+  FILE       *ofile;
+  std::string filename;
+
+  std::vector<Var>      vars;
+  std::vector<uint64_t> last;  // last value of each var
+  std::string           header;
+
+  uint64_t now;
+  uint64_t last_time;
+  uint64_t n_changes;
+  bool     started;
+  bool     closed;
+
+  static constexpr size_t chunk_words = 8192;
+  struct Chunk {
+    size_t   n;
+    uint64_t data[chunk_words];
+  };
+
+  std::vector<std::unique_ptr<Chunk>> chunks;  // all the allocated chunks
+  const size_t                        max_chunks;
+  Chunk                              *current;
+  spsc<Chunk *>                       full_chunks;
+  spsc<Chunk *>                       free_chunks;
+  std::atomic<bool>                   done;
+  std::thread                         writer;
+
+  void start();
+  void next_chunk();
+  void writer_loop();
+
+  template <typename F>
+  bool change_words(Var_id id, F word) {
+    if (unlikely(!started))
+      start();
+
+    const auto &v    = vars[id];
+    auto       *prev = &last[v.offset];
+    bool        same = true;
+    for (auto i = 0u; i < v.n_words; ++i) {
+      same = same && prev[i] == word(i);
+    }
+    if (same)
+      return false;
+
+    for (auto i = 0u; i < v.n_words; ++i) {
+      prev[i] = word(i);
+    }
+
+    if (now != last_time) {
+      push_word(time_mark | now);
+      last_time = now;
+    }
+    push_word(id);
+    for (auto i = 0u; i < v.n_words; ++i) {
+      push_word(prev[i]);
+    }
+    ++n_changes;
+
+    return true;
+  }
+
+  void push_word(uint64_t d) {
+    if (unlikely(current->n == chunk_words))
+      next_chunk();
+    current->data[current->n++] = d;
+  }
+
+  template <int w, int... idx>
+  static void to_words(const UInt<w> &v, uint64_t *words, std::integer_sequence<int, idx...>) {
+    ((words[idx] = v.template bits<std::min(w - 1, 64 * idx + 63), 64 * idx>().as_single_word()), ...);
+  }
+};
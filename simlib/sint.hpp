@@ -70,7 +70,11 @@ public:
 
   SInt<w_ + 1> operator+(const UInt<w_> &other) const { return pad<w_ + 1>().addw(SInt<w_ + 1>(other.template pad<w_ + 1>())); }
 
-  SInt<w_> addw(const SInt<w_> &other) const { return ui.template core_add_sub<w_, false>(other.ui); }
+  SInt<w_> addw(const SInt<w_> &other) const {
+    SInt<w_> result(ui.template core_add_sub<w_, false>(other.ui));
+    result.sign_extend();
+    return result;
+  }
 
   SInt<w_> subw(const SInt<w_> &other) const {
     SInt<w_> result(ui.template core_add_sub<w_, true>(other.ui));
@@ -235,7 +239,7 @@ public:
     //   return as_single_word() <= other.as_single_word();
     if (negative()) {
       if (other.negative())
-        return ui >= other.ui;
+        return ui <= other.ui;  // same sign, two's complement order matches the unsigned
       else
         return UInt<1>(1);
     } else {
@@ -251,7 +255,7 @@ public:
     //   return as_single_word() >= other.as_single_word();
     if (negative()) {
       if (other.negative())
-        return ui <= other.ui;
+        return ui >= other.ui;
       else
         return UInt<1>(0);
     } else {
@@ -300,8 +304,8 @@ private:
   const static int kWordSize = UInt<w_>::kWordSize;
 
   bool negative() const {
-    return static_cast<int64_t>(ui.words_[ui.word_index(w_ - 1)]) < 0;
-    // return (ui.words_[ui.word_index(w_ - 1)] >> ((w_-1) % kWordSize)) & 1;
+    // the sign bit (words with fewer than 64 bits, or not sign extended after an op, have a positive word)
+    return (ui.words_[ui.word_index(w_ - 1)] >> ((w_ - 1) % kWordSize)) & 1;
   }
 
   void sign_extend(int sign_index = (w_ - 1)) {
@@ -0,0 +1,386 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "simlib_cgen.hpp"
+
+// SIntN<w, lanes> is a SInt<w> for lanes independent simulations (stimulus
+// lanes) of the same stage. The words are stored as struct of arrays
+// (words[word][lane]) so the per lane loops vectorize. Values up to 64 bits
+// are kept sign extended in one int64 per lane and most operations are one
+// loop; wider values fall back to the scalar SInt per lane.
+//
+// inou.cgen.simlib with lanes:N generates stages on SIntN with the helpers
+// below (same names as simlib_cgen.hpp), so one cycle() advances N lanes.
+template <int w_, int lanes_>
+class SIntN {
+public:
+  static_assert(lanes_ > 0, "at least one lane");
+
+  static constexpr int  n_words = (w_ + 63) / 64;
+  static constexpr int  lanes   = lanes_;
+  static constexpr bool narrow  = w_ <= 64;
+
+  alignas(64) uint64_t words[n_words][lanes_];
+
+  SIntN() {
+    for (auto k = 0; k < n_words; ++k) {
+      for (auto l = 0; l < lanes_; ++l) words[k][l] = 0;
+    }
+  }
+
+  SIntN(int64_t v) { broadcast(SInt<w_>(v)); }
+  SIntN(std::string v) { broadcast(SInt<w_>(v)); }
+  explicit SIntN(const SInt<w_> &v) { broadcast(v); }
+
+  static int64_t sext(uint64_t x) {
+    if constexpr (w_ >= 64)
+      return static_cast<int64_t>(x);
+    else
+      return static_cast<int64_t>(x << (64 - w_)) >> (64 - w_);
+  }
+
+  SInt<w_> get_lane(int l) const {
+    if constexpr (narrow) {
+      return SInt<w_>(static_cast<int64_t>(words[0][l]));
+    } else {
+      std::array<uint64_t, n_words> raw;  // most significant first
+      for (auto k = 0; k < n_words; ++k) raw[n_words - 1 - k] = words[k][l];
+      return SInt<w_>(raw);
+    }
+  }
+
+  void set_lane(int l, const SInt<w_> &v) {
+    if constexpr (narrow)
+      words[0][l] = simlib::to_i(v);
+    else
+      set_wide_lane(l, v, std::make_integer_sequence<int, n_words>{});
+  }
+
+  SIntN addw(const SIntN &o) const {
+    if constexpr (narrow) {
+      SIntN r;
+      for (auto l = 0; l < lanes_; ++l) r.words[0][l] = sext(words[0][l] + o.words[0][l]);
+      return r;
+    } else {
+      return map2(o, [](const SInt<w_> &a, const SInt<w_> &b) { return a.addw(b); });
+    }
+  }
+
+  SIntN subw(const SIntN &o) const {
+    if constexpr (narrow) {
+      SIntN r;
+      for (auto l = 0; l < lanes_; ++l) r.words[0][l] = sext(words[0][l] - o.words[0][l]);
+      return r;
+    } else {
+      return map2(o, [](const SInt<w_> &a, const SInt<w_> &b) { return a.subw(b); });
+    }
+  }
+
+  // bitwise operations keep the sign extension, so they work on all the words
+  SIntN operator&(const SIntN &o) const {
+    SIntN r;
+    for (auto k = 0; k < n_words; ++k) {
+      for (auto l = 0; l < lanes_; ++l) r.words[k][l] = words[k][l] & o.words[k][l];
+    }
+    return r;
+  }
+
+  SIntN operator|(const SIntN &o) const {
+    SIntN r;
+    for (auto k = 0; k < n_words; ++k) {
+      for (auto l = 0; l < lanes_; ++l) r.words[k][l] = words[k][l] | o.words[k][l];
+    }
+    return r;
+  }
+
+  SIntN operator^(const SIntN &o) const {
+    SIntN r;
+    for (auto k = 0; k < n_words; ++k) {
+      for (auto l = 0; l < lanes_; ++l) r.words[k][l] = words[k][l] ^ o.words[k][l];
+    }
+    return r;
+  }
+
+  SIntN operator~() const {
+    if constexpr (narrow) {
+      SIntN r;
+      for (auto l = 0; l < lanes_; ++l) r.words[0][l] = ~words[0][l];
+      return r;
+    } else {
+      return map1([](const SInt<w_> &a) { return (~a).asSInt(); });
+    }
+  }
+
+  // bitwise results are already SIntN (SInt returns UInt)
+  const SIntN &asSInt() const { return *this; }
+
+  template <typename F>
+  SIntN map1(F f) const {
+    SIntN r;
+    for (auto l = 0; l < lanes_; ++l) r.set_lane(l, f(get_lane(l)));
+    return r;
+  }
+
+  template <typename F>
+  SIntN map2(const SIntN &o, F f) const {
+    SIntN r;
+    for (auto l = 0; l < lanes_; ++l) r.set_lane(l, f(get_lane(l), o.get_lane(l)));
+    return r;
+  }
+
+private:
+  void broadcast(const SInt<w_> &v) {
+    set_lane(0, v);
+    for (auto k = 0; k < n_words; ++k) {
+      for (auto l = 1; l < lanes_; ++l) words[k][l] = words[k][0];
+    }
+  }
+
+  template <int... idx>
+  void set_wide_lane(int l, const SInt<w_> &v, std::integer_sequence<int, idx...>) {
+    ((words[idx][l] = v.template bits<std::min(w_ - 1, 64 * idx + 63), 64 * idx>().as_single_word()), ...);
+  }
+};
+
+namespace simlib {
+
+// per lane scalar fallback
+template <int w, int lanes, typename F>
+inline SIntN<w, lanes> lane_map(F f) {
+  SIntN<w, lanes> r;
+  for (auto l = 0; l < lanes; ++l) r.set_lane(l, f(l));
+  return r;
+}
+
+template <int w, int lanes>
+inline uint64_t lane_index(const SIntN<w, lanes> &v, int l) {
+  if constexpr (w < 64)
+    return v.words[0][l] & ((uint64_t(1) << w) - 1);
+  else if constexpr (w == 64)
+    return v.words[0][l];
+  else
+    return to_index(v.get_lane(l));
+}
+
+template <int w, int lanes>
+inline bool lane_true(const SIntN<w, lanes> &v, int l) {
+  if constexpr (w <= 64)
+    return v.words[0][l] != 0;
+  else
+    return is_true(v.get_lane(l));
+}
+
+template <int to, int from, int lanes>
+inline SIntN<to, lanes> resize(const SIntN<from, lanes> &v) {
+  if constexpr (to <= 64 && from <= 64) {
+    SIntN<to, lanes> r;
+    for (auto l = 0; l < lanes; ++l) r.words[0][l] = SIntN<to, lanes>::sext(v.words[0][l]);
+    return r;
+  } else {
+    return lane_map<to, lanes>([&v](int l) { return resize<to>(v.get_lane(l)); });
+  }
+}
+
+template <int w, int lanes>
+inline SIntN<w, lanes> from_bool_lanes(const bool *b) {
+  SIntN<w, lanes> r;
+  for (auto l = 0; l < lanes; ++l) r.words[0][l] = b[l] ? SIntN<w, lanes>::sext(1) : 0;
+  return r;
+}
+
+template <int w, int c_w, int lanes>
+inline SIntN<w, lanes> select(const SIntN<c_w, lanes> &cond, const SIntN<w, lanes> &a, const SIntN<w, lanes> &b) {
+  SIntN<w, lanes> r;
+  for (auto k = 0; k < SIntN<w, lanes>::n_words; ++k) {
+    for (auto l = 0; l < lanes; ++l) r.words[k][l] = lane_true(cond, l) ? a.words[k][l] : b.words[k][l];
+  }
+  return r;
+}
+
+template <int w, int lanes>
+inline SIntN<w, lanes> mulw(const SIntN<w, lanes> &a, const SIntN<w, lanes> &b) {
+  if constexpr (w <= 64) {
+    SIntN<w, lanes> r;
+    for (auto l = 0; l < lanes; ++l) r.words[0][l] = SIntN<w, lanes>::sext(a.words[0][l] * b.words[0][l]);
+    return r;
+  } else {
+    return a.map2(b, [](const SInt<w> &x, const SInt<w> &y) { return mulw(x, y); });
+  }
+}
+
+template <int w, int a_w, int lanes, typename Cmp>
+inline SIntN<w, lanes> compare_lanes(const SIntN<a_w, lanes> &a, const SIntN<a_w, lanes> &b, Cmp cmp) {
+  bool res[lanes];
+  if constexpr (a_w <= 64) {
+    for (auto l = 0; l < lanes; ++l)
+      res[l] = cmp(static_cast<int64_t>(a.words[0][l]), static_cast<int64_t>(b.words[0][l]));
+  } else {
+    for (auto l = 0; l < lanes; ++l) res[l] = cmp(a.get_lane(l), b.get_lane(l));
+  }
+  return from_bool_lanes<w, lanes>(res);
+}
+
+template <int w, int a_w, int lanes>
+inline SIntN<w, lanes> lt(const SIntN<a_w, lanes> &a, const SIntN<a_w, lanes> &b) {
+  return compare_lanes<w>(a, b, [](const auto &x, const auto &y) -> bool { return x < y; });
+}
+
+template <int w, int a_w, int lanes>
+inline SIntN<w, lanes> gt(const SIntN<a_w, lanes> &a, const SIntN<a_w, lanes> &b) {
+  return compare_lanes<w>(a, b, [](const auto &x, const auto &y) -> bool { return x > y; });
+}
+
+template <int w, int a_w, int lanes>
+inline SIntN<w, lanes> eq(const SIntN<a_w, lanes> &a, const SIntN<a_w, lanes> &b) {
+  return compare_lanes<w>(a, b, [](const auto &x, const auto &y) -> bool { return x == y; });
+}
+
+template <int w, int a_w, int lanes>
+inline SIntN<w, lanes> ror(const SIntN<a_w, lanes> &a) {
+  bool res[lanes];
+  for (auto l = 0; l < lanes; ++l) res[l] = lane_true(a, l);
+  return from_bool_lanes<w, lanes>(res);
+}
+
+template <int w, int lanes>
+inline SIntN<w, lanes> land(const SIntN<w, lanes> &a, const SIntN<w, lanes> &b) {
+  bool res[lanes];
+  for (auto l = 0; l < lanes; ++l) res[l] = lane_true(a, l) && lane_true(b, l);
+  return from_bool_lanes<w, lanes>(res);
+}
+
+template <int w, int lanes>
+inline SIntN<w, lanes> lor(const SIntN<w, lanes> &a, const SIntN<w, lanes> &b) {
+  bool res[lanes];
+  for (auto l = 0; l < lanes; ++l) res[l] = lane_true(a, l) || lane_true(b, l);
+  return from_bool_lanes<w, lanes>(res);
+}
+
+template <int w, int lanes>
+inline SIntN<1, lanes> eq_index(const SIntN<w, lanes> &sel, uint64_t i) {
+  bool res[lanes];
+  for (auto l = 0; l < lanes; ++l) res[l] = lane_index(sel, l) == i;
+  return from_bool_lanes<1, lanes>(res);
+}
+
+template <int w, int b_w, int lanes>
+inline SIntN<w, lanes> shl(const SIntN<w, lanes> &v, const SIntN<b_w, lanes> &amt) {
+  if constexpr (w <= 64) {
+    SIntN<w, lanes> r;
+    for (auto l = 0; l < lanes; ++l) {
+      auto a        = lane_index(amt, l);
+      r.words[0][l] = a >= w ? 0 : SIntN<w, lanes>::sext(v.words[0][l] << a);
+    }
+    return r;
+  } else {
+    return lane_map<w, lanes>([&](int l) { return shl(v.get_lane(l), lane_index(amt, l)); });
+  }
+}
+
+template <int w, int b_w, int lanes>
+inline SIntN<w, lanes> sra(const SIntN<w, lanes> &v, const SIntN<b_w, lanes> &amt) {
+  if constexpr (w <= 64) {
+    SIntN<w, lanes> r;
+    for (auto l = 0; l < lanes; ++l) {
+      auto a        = lane_index(amt, l);
+      r.words[0][l] = static_cast<int64_t>(v.words[0][l]) >> (a >= w ? w - 1 : a);
+    }
+    return r;
+  } else {
+    return lane_map<w, lanes>([&](int l) { return sra(v.get_lane(l), lane_index(amt, l)); });
+  }
+}
+
+template <int w, int b_w, int lanes>
+inline SIntN<w, lanes> sext(const SIntN<w, lanes> &v, const SIntN<b_w, lanes> &pos) {
+  return lane_map<w, lanes>([&](int l) { return sext(v.get_lane(l), lane_index(pos, l)); });
+}
+
+template <int w, int lanes>
+inline SIntN<w, lanes> div(const SIntN<w, lanes> &a, const SIntN<w, lanes> &b) {
+  return a.map2(b, [](const SInt<w> &x, const SInt<w> &y) { return div(x, y); });
+}
+
+template <int w, int a_w, int lanes>
+inline SIntN<w, lanes> get_range(const SIntN<a_w, lanes> &a, uint64_t lo, uint64_t hi) {
+  return lane_map<w, lanes>([&](int l) { return get_range<w>(a.get_lane(l), lo, hi); });
+}
+
+template <int w, int a_w, int lanes>
+inline SIntN<w, lanes> get_mask(const SIntN<a_w, lanes> &a, std::initializer_list<uint32_t> positions) {
+  return lane_map<w, lanes>([&](int l) { return get_mask<w>(a.get_lane(l), positions); });
+}
+
+template <int w, int a_w, int v_w, int lanes>
+inline SIntN<w, lanes> set_range(const SIntN<a_w, lanes> &a, const SIntN<v_w, lanes> &value, uint64_t lo, uint64_t hi) {
+  return lane_map<w, lanes>([&](int l) { return set_range<w>(a.get_lane(l), value.get_lane(l), lo, hi); });
+}
+
+template <int w, int a_w, int v_w, int lanes>
+inline SIntN<w, lanes> set_mask(const SIntN<a_w, lanes> &a, const SIntN<v_w, lanes> &value,
+                                std::initializer_list<uint32_t> positions) {
+  return lane_map<w, lanes>([&](int l) { return set_mask<w>(a.get_lane(l), value.get_lane(l), positions); });
+}
+
+// each lane reads its own address
+template <int w, size_t size, int a_w, int lanes>
+inline SIntN<w, lanes> mem_read(const std::array<SIntN<w, lanes>, size> &m, const SIntN<a_w, lanes> &addr) {
+  SIntN<w, lanes> r;
+  for (auto l = 0; l < lanes; ++l) {
+    auto idx = lane_index(addr, l);
+    if (idx >= size)
+      continue;
+    for (auto k = 0; k < SIntN<w, lanes>::n_words; ++k) r.words[k][l] = m[idx].words[k][l];
+  }
+  return r;
+}
+
+template <int w, size_t size, int a_w, int lanes>
+inline void mem_write(std::array<SIntN<w, lanes>, size> &m, const SIntN<a_w, lanes> &addr, const SIntN<w, lanes> &din) {
+  for (auto l = 0; l < lanes; ++l) {
+    auto idx = lane_index(addr, l);
+    if (idx >= size)
+      continue;
+    for (auto k = 0; k < SIntN<w, lanes>::n_words; ++k) m[idx].words[k][l] = din.words[k][l];
+  }
+}
+
+template <int w, size_t size, int a_w, int e_w, int lanes>
+inline void mem_write(std::array<SIntN<w, lanes>, size> &m, const SIntN<a_w, lanes> &addr, const SIntN<w, lanes> &din,
+                      const SIntN<e_w, lanes> &enable) {
+  for (auto l = 0; l < lanes; ++l) {
+    auto idx = lane_index(addr, l);
+    if (idx >= size || !lane_true(enable, l))
+      continue;
+    for (auto k = 0; k < SIntN<w, lanes>::n_words; ++k) m[idx].words[k][l] = din.words[k][l];
+  }
+}
+
+template <int w, int a_w, int b_w, int lanes>
+inline SIntN<w, lanes> fwd_write(const SIntN<w, lanes> &cur, const SIntN<a_w, lanes> &raddr, const SIntN<b_w, lanes> &waddr,
+                                 const SIntN<w, lanes> &din) {
+  SIntN<w, lanes> r;
+  for (auto l = 0; l < lanes; ++l) {
+    bool hit = lane_index(raddr, l) == lane_index(waddr, l);
+    for (auto k = 0; k < SIntN<w, lanes>::n_words; ++k) r.words[k][l] = hit ? din.words[k][l] : cur.words[k][l];
+  }
+  return r;
+}
+
+template <int w, int a_w, int b_w, int e_w, int lanes>
+inline SIntN<w, lanes> fwd_write(const SIntN<w, lanes> &cur, const SIntN<a_w, lanes> &raddr, const SIntN<b_w, lanes> &waddr,
+                                 const SIntN<w, lanes> &din, const SIntN<e_w, lanes> &enable) {
+  SIntN<w, lanes> r;
+  for (auto l = 0; l < lanes; ++l) {
+    bool hit = lane_true(enable, l) && lane_index(raddr, l) == lane_index(waddr, l);
+    for (auto k = 0; k < SIntN<w, lanes>::n_words; ++k) r.words[k][l] = hit ? din.words[k][l] : cur.words[k][l];
+  }
+  return r;
+}
+
+}  // namespace simlib
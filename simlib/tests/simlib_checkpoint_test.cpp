@@ -0,0 +1,124 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <sys/stat.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "simlib_checkpoint.hpp"
+
+// The checkpoints (full and delta, written by the parent or by a forked
+// child) must load back the same top state that was saved.
+
+struct Ckpt_test_stage {
+  uint64_t                   hidx;
+  uint64_t                   n;
+  std::array<uint64_t, 4096> data;  // 8 pages, the first 2KB change
+
+  Ckpt_test_stage(uint64_t _hidx) : hidx(_hidx) { reset_cycle(); }
+
+  void reset_cycle() {
+    n = 0;
+    data.fill(0);
+  }
+  void cycle() {
+    ++n;
+    data[n % 256] = n;
+  }
+  void cycle(int, int) { cycle(); }
+
+#ifdef SIMLIB_TRACE
+  void add_signature(Simlib_signature &sign) {
+    sign.append("Ckpt_test_stage");
+    sign.append(sizeof(*this));
+  }
+#endif
+};
+
+class Simlib_checkpoint_test : public ::testing::TestWithParam<bool> {
+protected:
+  // ckpt_<signature>_<cycles> (the default signature without SIMLIB_TRACE)
+  static std::string get_filename(const std::string &dir, uint64_t cycles) {
+    Simlib_signature sign;
+#ifdef SIMLIB_TRACE
+    sign.append("Ckpt_test_stage");
+    sign.append(sizeof(Ckpt_test_stage));
+#endif
+    char txt[33];
+    snprintf(txt, sizeof(txt), "%016llx%016llx", (unsigned long long)sign.get_word(0), (unsigned long long)sign.get_word(1));
+    return dir + "/ckpt_" + txt + "_" + std::to_string(cycles);
+  }
+};
+
+TEST_P(Simlib_checkpoint_test, delta_roundtrip) {
+  const bool  fork_checkpoint = GetParam();
+  std::string dir             = fork_checkpoint ? "simlib_ckpt_fork" : "simlib_ckpt_serial";
+  mkdir(dir.c_str(), 0755);
+
+  Simlib_checkpoint<Ckpt_test_stage> sim("ckpt", 1);
+  sim.enable_trace(dir);
+  sim.set_checkpoint_fork(fork_checkpoint);
+  sim.set_checkpoint_delta(4);
+
+  std::vector<uint64_t>        cycles;
+  std::vector<Ckpt_test_stage> saved;
+  for (auto i = 0; i < 6; ++i) {
+    sim.advance_clock(100 + i);
+    sim.save_checkpoint();
+    cycles.emplace_back(sim.get_ncycles());
+    saved.emplace_back(sim.get_top());
+  }
+  sim.wait_checkpoints();
+
+  struct stat st;
+  EXPECT_EQ(stat(get_filename(dir, cycles[0]).c_str(), &st), 0);
+  EXPECT_EQ(stat((get_filename(dir, cycles[1]) + ".delta").c_str(), &st), 0);
+  EXPECT_LT(static_cast<size_t>(st.st_size), sim.calc_bytes() / 2);  // only the changed pages
+
+  EXPECT_EQ(stat((dir + "/ckpt.index").c_str(), &st), 0);  // appended, magic and one entry per checkpoint
+  EXPECT_EQ(static_cast<size_t>(st.st_size), sizeof(uint64_t) + cycles.size() * 4 * sizeof(uint64_t));
+
+  for (auto i = cycles.size(); i-- > 0;) {
+    ASSERT_TRUE(sim.load_checkpoint(cycles[i]));
+    EXPECT_EQ(sim.get_top().n, saved[i].n);
+    EXPECT_TRUE(sim.get_top().data == saved[i].data);
+  }
+}
+
+// a truncated delta (or any checkpoint after it in the chain) falls back to
+// the previous checkpoint instead of exiting
+TEST_P(Simlib_checkpoint_test, corrupted_fallback) {
+  const bool  fork_checkpoint = GetParam();
+  std::string dir             = fork_checkpoint ? "simlib_ckpt_bad_fork" : "simlib_ckpt_bad_serial";
+  mkdir(dir.c_str(), 0755);
+
+  std::vector<uint64_t> cycles;
+  {
+    Simlib_checkpoint<Ckpt_test_stage> sim("ckpt", 1);
+    sim.enable_trace(dir);
+    sim.set_checkpoint_fork(fork_checkpoint);
+    sim.set_checkpoint_delta(4);
+    for (auto i = 0; i < 3; ++i) {
+      sim.advance_clock(100);
+      sim.save_checkpoint();
+      cycles.emplace_back(sim.get_ncycles());
+    }
+  }
+
+  ASSERT_EQ(truncate((get_filename(dir, cycles[1]) + ".delta").c_str(), 100), 0);
+
+  Simlib_checkpoint<Ckpt_test_stage> sim("ckpt", 1);
+  sim.enable_trace(dir);  // reloads the catalog
+
+  EXPECT_TRUE(sim.load_checkpoint(cycles[0]));
+  EXPECT_FALSE(sim.load_checkpoint(cycles[1]));
+  EXPECT_FALSE(sim.load_checkpoint(cycles[2]));  // its base is corrupted
+
+  EXPECT_TRUE(sim.load_intermediate_checkpoint(cycles[2]));
+  EXPECT_EQ(sim.get_ncycles(), cycles[2]);
+  EXPECT_EQ(sim.get_top().n + 1, cycles[2]);  // ncycles counts the reset cycle
+}
+
+INSTANTIATE_TEST_SUITE_P(Simlib_checkpoint, Simlib_checkpoint_test, ::testing::Values(false, true));
@@ -0,0 +1,88 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "simlib_partition.hpp"
+
+// Hand written ring of stages that only talk through Simlib_channel. Any
+// number of threads (with or without rebalance, runs across the calibration
+// windows) must end with the single thread state, and each stage must be
+// called once per cycle in order.
+
+class Simlib_partition_test : public ::testing::TestWithParam<int> {
+protected:
+  struct Ring_stage {
+    std::vector<uint64_t>     regs;
+    Simlib_channel<uint64_t> *inp;
+    Simlib_channel<uint64_t>  out;
+    uint64_t                  next_ncycle;
+    bool                      in_order;
+
+    Ring_stage(int n_regs, uint64_t seed) : regs(n_regs), inp(nullptr), next_ncycle(0), in_order(true) {
+      for (auto i = 0; i < n_regs; ++i) {
+        regs[i] = seed * 7919 + i;
+      }
+      out.reset(0);
+    }
+
+    void cycle(uint64_t ncycle) {
+      in_order = in_order && ncycle == next_ncycle;
+      next_ncycle = ncycle + 1;
+
+      auto v = inp->get(ncycle);
+      for (auto &r : regs) {
+        r = (r + v) ^ 0x9e3779b97f4a7c15ULL;
+        v = r;
+      }
+      out.set(ncycle, v);
+    }
+  };
+
+  static constexpr int n_stages = 9;
+
+  static std::vector<std::unique_ptr<Ring_stage>> create_ring() {
+    std::vector<std::unique_ptr<Ring_stage>> ring;
+    for (auto i = 0; i < n_stages; ++i) {
+      ring.emplace_back(std::make_unique<Ring_stage>(8 * (1 + i % 3), i));
+    }
+    for (auto i = 0; i < n_stages; ++i) {
+      ring[i]->inp = &ring[(i + n_stages - 1) % n_stages]->out;
+    }
+    return ring;
+  }
+
+  static void run(std::vector<std::unique_ptr<Ring_stage>> &ring, int n_threads, uint64_t rebalance) {
+    Simlib_partition part(n_threads, 50);
+    part.set_rebalance(rebalance);
+    for (auto i = 0; i < n_stages; ++i) {
+      auto *s = ring[i].get();
+      part.add_stage("ring" + std::to_string(i), [s](uint64_t ncycle) { s->cycle(ncycle); });
+    }
+
+    for (auto n : {7, 100, 1, 333, 2000}) {  // runs that start and end inside the windows
+      part.run(n);
+    }
+    EXPECT_EQ(part.get_ncycles(), 2441u);
+  }
+};
+
+TEST_P(Simlib_partition_test, same_as_one_thread) {
+  auto seq = create_ring();
+  run(seq, 1, 0);
+
+  for (auto rebalance : {0, 300}) {
+    auto par = create_ring();
+    run(par, GetParam(), rebalance);
+
+    for (auto i = 0; i < n_stages; ++i) {
+      EXPECT_TRUE(par[i]->in_order);
+      EXPECT_EQ(par[i]->next_ncycle, 2441u);
+      EXPECT_EQ(par[i]->regs, seq[i]->regs) << "stage " << i << " rebalance " << rebalance;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Simlib_partition, Simlib_partition_test, ::testing::Values(1, 2, 4));
@@ -0,0 +1,51 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <cstdio>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "simlib_wave.hpp"
+
+// The bits above the var size are ignored, and a scalar change of a var
+// wider than 64 bits is zero extended (no read past the value).
+
+static std::vector<uint64_t> read_tail(const char *filename, size_t n) {
+  std::vector<uint64_t> words(n);
+
+  auto *f = fopen(filename, "rb");
+  EXPECT_NE(f, nullptr);
+  fseek(f, -static_cast<long>(n * sizeof(uint64_t)), SEEK_END);
+  EXPECT_EQ(fread(words.data(), sizeof(uint64_t), n, f), n);
+  fclose(f);
+
+  return words;
+}
+
+TEST(Simlib_wave_test, masked_and_zero_extended) {
+  Simlib_wave::Var_id narrow;
+  Simlib_wave::Var_id wide;
+  {
+    Simlib_wave wave("simlib_wave_test.wave", 1 << 14);
+    narrow = wave.register_var("top", "narrow", 8);
+    wide   = wave.register_var("top", "wide", 100);
+
+    EXPECT_TRUE(wave.change(narrow, 0x1ff));
+    EXPECT_FALSE(wave.change(narrow, 0xff));  // same 8 bits
+
+    uint64_t words[2] = {0, 0xf000000000000000ULL};  // the set bits are above 100
+    EXPECT_FALSE(wave.change(wide, words));
+
+    wave.advance(1);
+    EXPECT_TRUE(wave.change(wide, 7));
+    words[0] = 7;
+    EXPECT_FALSE(wave.change(wide, words));
+
+    EXPECT_EQ(wave.get_n_changes(), 2u);
+  }
+
+  auto tail = read_tail("simlib_wave_test.wave", 4);
+  EXPECT_EQ(tail[0], Simlib_wave::time_mark | 1);
+  EXPECT_EQ(tail[1], wide);
+  EXPECT_EQ(tail[2], 7u);
+  EXPECT_EQ(tail[3], 0u);
+}
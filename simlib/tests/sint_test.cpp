@@ -0,0 +1,49 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "gtest/gtest.h"
+#include "sint.hpp"
+
+// addw wraps and sign extends, the sign is the top bit for any width, and
+// <=/>= order two negative values like the integers.
+
+TEST(Sint_test, addw_sign_extends) {
+  auto a = SInt<8>(127).addw(SInt<8>(1));
+  EXPECT_TRUE(a < SInt<8>(0));
+  EXPECT_TRUE(a == SInt<8>(-128));
+
+  auto b = SInt<8>(-128).addw(SInt<8>(-1));
+  EXPECT_TRUE(b == SInt<8>(127));
+  EXPECT_TRUE(b > SInt<8>(0));
+
+  auto d = SInt<40>(-3).addw(SInt<40>(1));
+  EXPECT_TRUE(d == SInt<40>(-2));
+  EXPECT_TRUE(d < SInt<40>(0));
+
+  auto c = SInt<64>(INT64_MAX).addw(SInt<64>(1));
+  EXPECT_EQ(c.as_single_word(), INT64_MIN);
+  EXPECT_TRUE(c < SInt<64>(0));
+}
+
+TEST(Sint_test, negative_any_width) {
+  EXPECT_TRUE(SInt<1>(-1) < SInt<1>(0));
+  EXPECT_TRUE(SInt<7>(-1) < SInt<7>(0));
+  EXPECT_TRUE(SInt<33>(-5) < SInt<33>(3));
+  EXPECT_TRUE(SInt<64>(-5) < SInt<64>(3));
+  EXPECT_TRUE(SInt<100>(-5) < SInt<100>(3));
+
+  EXPECT_FALSE(SInt<7>(63) < SInt<7>(0));
+  EXPECT_FALSE(SInt<100>(3) < SInt<100>(-5));
+}
+
+TEST(Sint_test, compare_negatives) {
+  for (int64_t x = -20; x <= 20; ++x) {
+    for (int64_t y = -20; y <= 20; ++y) {
+      EXPECT_EQ(static_cast<bool>(SInt<8>(x) <= SInt<8>(y)), x <= y) << x << " <= " << y;
+      EXPECT_EQ(static_cast<bool>(SInt<8>(x) >= SInt<8>(y)), x >= y) << x << " >= " << y;
+      EXPECT_EQ(static_cast<bool>(SInt<8>(x) < SInt<8>(y)), x < y) << x << " < " << y;
+      EXPECT_EQ(static_cast<bool>(SInt<8>(x) > SInt<8>(y)), x > y) << x << " > " << y;
+      EXPECT_EQ(static_cast<bool>(SInt<70>(x) <= SInt<70>(y)), x <= y) << x << " <= " << y;
+      EXPECT_EQ(static_cast<bool>(SInt<70>(x) >= SInt<70>(y)), x >= y) << x << " >= " << y;
+    }
+  }
+}
@@ -0,0 +1,189 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Offline converter from the Simlib_wave binary log to VCD
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "simlib_wave.hpp"
+
+struct Wave_var {
+  uint32_t    bits;
+  uint32_t    n_words;
+  std::string scope;
+  std::string name;
+  std::string ident;
+};
+
+static bool read_all(FILE *fp, void *data, size_t n) { return fread(data, 1, n, fp) == n; }
+
+static std::string get_ident(size_t id) {
+  std::string str;
+  do {
+    str.push_back('!' + (id % 94));
+    id /= 94;
+  } while (id);
+  return str;
+}
+
+static std::vector<std::string> split_scope(const std::string &scope) {
+  std::vector<std::string> path;
+  size_t                   start = 0;
+  while (start <= scope.size()) {
+    auto pos = scope.find('.', start);
+    if (pos == std::string::npos)
+      pos = scope.size();
+    if (pos > start)
+      path.emplace_back(scope.substr(start, pos - start));
+    start = pos + 1;
+  }
+  return path;
+}
+
+static void write_value(FILE *out, const Wave_var &v, const uint64_t *words) {
+  if (v.bits == 1) {
+    fprintf(out, "%c%s\n", (words[0] & 1) ? '1' : '0', v.ident.c_str());
+    return;
+  }
+
+  std::string str;
+  bool        leading = true;
+  for (int i = v.bits - 1; i >= 0; --i) {
+    bool b = (words[i / 64] >> (i % 64)) & 1;
+    if (leading && !b && i)
+      continue;
+    leading = false;
+    str.push_back(b ? '1' : '0');
+  }
+  fprintf(out, "b%s %s\n", str.c_str(), v.ident.c_str());
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <input.wave> <output.vcd>\n", argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "wave2vcd: ERROR unable to open %s\n", argv[1]);
+    return 3;
+  }
+
+  char     magic[8];
+  uint64_t n_vars = 0;
+  if (!read_all(in, magic, sizeof(magic)) || memcmp(magic, Simlib_wave::magic, sizeof(magic)) != 0
+      || !read_all(in, &n_vars, sizeof(n_vars))) {
+    fprintf(stderr, "wave2vcd: ERROR %s is not a simlib waveform\n", argv[1]);
+    return 3;
+  }
+
+  std::vector<Wave_var> vars(n_vars);
+  for (auto i = 0u; i < n_vars; ++i) {
+    uint32_t sizes[3];
+    if (!read_all(in, sizes, sizeof(sizes))) {
+      fprintf(stderr, "wave2vcd: ERROR corrupted header in %s\n", argv[1]);
+      return 3;
+    }
+    auto &v   = vars[i];
+    v.bits    = sizes[0];
+    v.n_words = (v.bits + 63) / 64;
+    v.scope.resize(sizes[1]);
+    v.name.resize(sizes[2]);
+    v.ident = get_ident(i);
+    if (!read_all(in, v.scope.data(), v.scope.size()) || !read_all(in, v.name.data(), v.name.size())) {
+      fprintf(stderr, "wave2vcd: ERROR corrupted header in %s\n", argv[1]);
+      return 3;
+    }
+  }
+
+  FILE *out = fopen(argv[2], "w");
+  if (out == nullptr) {
+    fprintf(stderr, "wave2vcd: ERROR unable to create %s\n", argv[2]);
+    return 3;
+  }
+
+  fprintf(out, "$timescale 1 ns $end\n");
+  fprintf(out, "$comment converted by wave2vcd from %s $end\n", argv[1]);
+
+  // declarations grouped by scope (vars keep the registration order inside a scope)
+  std::vector<size_t> order(vars.size());
+  for (auto i = 0u; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&vars](size_t a, size_t b) { return vars[a].scope < vars[b].scope; });
+
+  std::vector<std::string> open_path;
+  for (auto id : order) {
+    const auto &v    = vars[id];
+    auto        path = split_scope(v.scope);
+
+    size_t common = 0;
+    while (common < open_path.size() && common < path.size() && open_path[common] == path[common]) ++common;
+    for (auto i = open_path.size(); i > common; --i) fprintf(out, "$upscope $end\n");
+    for (auto i = common; i < path.size(); ++i) fprintf(out, "$scope module %s $end\n", path[i].c_str());
+    open_path = path;
+
+    fprintf(out, "$var wire %u %s %s $end\n", v.bits, v.ident.c_str(), v.name.c_str());
+  }
+  for (auto i = open_path.size(); i > 0; --i) fprintf(out, "$upscope $end\n");
+  fprintf(out, "$enddefinitions $end\n");
+
+  // initial values (the writer starts all the vars at zero)
+  std::vector<uint64_t> zero(1, 0);
+  fprintf(out, "#0\n$dumpvars\n");
+  for (const auto &v : vars) {
+    if (zero.size() < v.n_words)
+      zero.resize(v.n_words, 0);
+    write_value(out, v, zero.data());
+  }
+  fprintf(out, "$end\n");
+
+  std::vector<uint64_t> buffer(1 << 16);
+  size_t                pos = 0;
+  size_t                end = 0;
+  auto                  next_word = [&](uint64_t &d) -> bool {
+    if (pos == end) {
+      end = fread(buffer.data(), sizeof(uint64_t), buffer.size(), in);
+      pos = 0;
+      if (end == 0)
+        return false;
+    }
+    d = buffer[pos++];
+    return true;
+  };
+
+  uint64_t              d;
+  uint64_t              n_changes = 0;
+  std::vector<uint64_t> words;
+  while (next_word(d)) {
+    if (d & Simlib_wave::time_mark) {
+      fprintf(out, "#%llu\n", (unsigned long long)(d & ~Simlib_wave::time_mark));
+      continue;
+    }
+    if (d >= vars.size()) {
+      fprintf(stderr, "wave2vcd: ERROR corrupted change for var %llu in %s\n", (unsigned long long)d, argv[1]);
+      return 3;
+    }
+    const auto &v = vars[d];
+    words.resize(v.n_words);
+    for (auto i = 0u; i < v.n_words; ++i) {
+      if (!next_word(words[i])) {
+        fprintf(stderr, "wave2vcd: ERROR truncated change in %s\n", argv[1]);
+        return 3;
+      }
+    }
+    write_value(out, v, words.data());
+    ++n_changes;
+  }
+
+  fclose(in);
+  fclose(out);
+
+  fprintf(stderr, "wave2vcd: %llu vars, %llu changes\n", (unsigned long long)vars.size(), (unsigned long long)n_changes);
+
+  return 0;
+}
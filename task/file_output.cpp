@@ -1,58 +1,111 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cerrno>
+#include <cstring>
 
 #include "file_output.hpp"
+#include "fmt/format.h"
 #include "iassert.hpp"
+#include "mmap_gc.hpp"
 
-File_output::File_output(mmap_lib::str fname) :filename(fname), sz(0), aborted(false) {
+File_output::File_output() : sz(0), file_pos(0), aborted(false), memory_buffer(true), fd(-1) {}
 
+File_output::File_output(mmap_lib::str fname) : filename(fname), sz(0), file_pos(0), aborted(false), memory_buffer(false), fd(-1) {
+  active.reserve(chunk_size + 4096);
 }
 
-File_output::~File_output() {
-  if (aborted)
-    return;
+static mode_t get_umask() {
+  static const mode_t mask = []() {  // read once, umask can only be read by setting it
+    auto m = ::umask(0);
+    ::umask(m);
+    return m;
+  }();
+  return mask;
+}
 
-  //---------------------------------- OPEN
-  auto fname_str = filename.to_s();
+void File_output::open_file() {
+  tmp_filename = filename.to_s() + ".tmp_XXXXXX";
 
-  int fd = ::open(fname_str.c_str(), O_RDWR | O_CREAT, 0644);
+  fd = ::mkstemp(tmp_filename.data());
   if (fd < 0) {
     mmap_lib::mmap_gc::try_collect_fd();  // maybe they are all used by LG?
-    fd = open(fname_str.c_str(), O_RDWR | O_CREAT, 0644);
+    tmp_filename = filename.to_s() + ".tmp_XXXXXX";
+    fd = ::mkstemp(tmp_filename.data());
   }
   assert(fd >= 0); // throw std::runtime_error(fmt::format("could not create destination {} file (permissions?)", filename));
 
-  size_t map_size = sz;
-  map_size>>=12;
-  ++map_size;
-  map_size<<=12;
-  auto ok = ftruncate(fd, map_size);
-  I(ok==0);
+  ::fchmod(fd, 0644 & ~get_umask());  // mkstemp creates 0600, use the permissions of a regular open
+}
 
-  void *base = ::mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);  // no superpages
-  if (base==MAP_FAILED) {
-    fmt::print("mmap errno:{} for filename{}\n", strerror(errno), fname_str);
+void File_output::wait_flush() {
+  if (!pending_flush.valid())
+    return;
 
-    mmap_lib::mmap_gc::try_collect_mmap();
-    base = ::mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);  // no superpages
-    assert(base != MAP_FAILED); // throw std::runtime_error(fmt::format("could not create mmap for {} file", filename));
-  }
+  auto err = pending_flush.get();
+  if (err)
+    fmt::print("File_output write errno:{} for filename {}\n", strerror(err), filename.to_s());
+  assert(err == 0);
+}
 
-  //---------------------------------- SAVE
+void File_output::flush_chunk() {
+  I(!memory_buffer);
 
-  char *ptr = static_cast<char *>(base);
-  for(const auto &e:sequence) {
-    auto delta = e.fill_txt_direct(ptr);
-    ptr+=delta;
-    assert(static_cast<size_t>(ptr-static_cast<char *>(base))<=sz);
-  }
+  if (fd < 0)
+    open_file();
+
+  wait_flush();  // at most one chunk in flight
+
+  std::swap(active, flushing);
+  active.clear();
+  if (active.capacity() < chunk_size)
+    active.reserve(chunk_size + 4096);
 
-  //---------------------------------- CLOSE
-  ::munmap(base, map_size);
-  if (map_size != sz) {
-    auto ok2 = ftruncate(fd, sz);
-    (void)ok2;
+  auto offset = file_pos;
+  file_pos += flushing.size();
+
+  pending_flush = std::async(std::launch::async, [this, offset]() -> int {
+    size_t done = 0;
+    while (done < flushing.size()) {
+      auto n = ::pwrite(fd, flushing.data() + done, flushing.size() - done, offset + done);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return errno;
+      }
+      done += n;
+    }
+    return 0;
+  });
+}
+
+void File_output::abort() {
+  aborted = true;
+  wait_flush();
+  active.clear();
+
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+    ::unlink(tmp_filename.c_str());
   }
+}
+
+File_output::~File_output() {
+  if (aborted || memory_buffer)
+    return;
+
+  flush_chunk();  // last (maybe empty) chunk, also creates empty files
+  wait_flush();
+
   ::close(fd);
+
+  auto ok = ::rename(tmp_filename.c_str(), filename.to_s().c_str());
+  if (ok != 0)
+    fmt::print("File_output rename errno:{} for filename {}\n", strerror(errno), filename.to_s());
+  assert(ok == 0);
 }
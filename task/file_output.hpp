@@ -1,60 +1,105 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <charconv>
+#include <future>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "iassert.hpp"
 #include "mmap_str.hpp"
 
+// Streaming writer. The text is accumulated in a fixed size chunk, and full
+// chunks are written (pwrite) asynchronously while the next chunk is filled
+// (double buffering). The chunks go to a temporary file next to the
+// destination that is renamed when the File_output is destroyed, so an
+// abort (or a crash) does not leave a partial file or remove an old one.
+// A File_output without file name is a memory buffer that can be moved to
+// a file with append_buffer (parallel code generation).
 class File_output {
+  static constexpr size_t chunk_size = 1 << 20;
+
   mmap_lib::str filename;
+  std::string   tmp_filename;  // chunks are written here until the rename
 
-  size_t sz;
+  size_t sz;       // total bytes appended
+  size_t file_pos; // bytes sent to the file
   bool   aborted;
+  bool   memory_buffer;
+  int    fd;
 
-  std::vector<mmap_lib::str> sequence;
+  std::string       active;    // chunk being filled
+  std::string       flushing;  // chunk being written
+  std::future<int>  pending_flush;  // errno of the write (0 is OK)
 
-public:
-  File_output(mmap_lib::str fname);
-  ~File_output();
+  void open_file();
+  void wait_flush();
+  void flush_chunk();
 
-  void append(mmap_lib::str s1) {
-    sequence.emplace_back(s1);
-    sz += s1.size();
+  char *reserve(size_t n) {
+    auto pos = active.size();
+    active.resize(pos + n);
+    sz += n;
+    return active.data() + pos;
   }
-  void append(mmap_lib::str s1, mmap_lib::str s2) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sz += s1.size() + s2.size();
+
+  void append_one(const mmap_lib::str &s) {
+    auto n = s.size();
+    if (n == 0)
+      return;
+    auto delta = s.fill_txt_direct(reserve(n));
+    I(delta == n);
+    (void)delta;
   }
-  void append(mmap_lib::str s1, mmap_lib::str s2, mmap_lib::str s3) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sz += s1.size() + s2.size() + s3.size();
+
+  void append_one(std::string_view s) {
+    active.append(s.data(), s.size());
+    sz += s.size();
   }
-  void append(mmap_lib::str s1, mmap_lib::str s2, mmap_lib::str s3, mmap_lib::str s4) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sequence.emplace_back(s4);
-    sz += s1.size() + s2.size() + s3.size() + s4.size();
+
+  template <typename T>
+  void append_one(const T &v) {
+    if constexpr (std::is_same_v<T, bool>) {
+      append_one(static_cast<int>(v));
+    } else if constexpr (std::is_same_v<T, char>) {
+      active.push_back(v);
+      ++sz;
+    } else if constexpr (std::is_integral_v<T>) {
+      char buf[24];  // formatted in place, no string is created
+      auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), v, 10);
+      (void)ec;
+      append_one(std::string_view(buf, ptr - buf));
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+      append_one(std::string_view(v));
+    } else {
+      append_one(mmap_lib::str(v));
+    }
   }
-  void append(mmap_lib::str s1, mmap_lib::str s2, mmap_lib::str s3, mmap_lib::str s4, mmap_lib::str s5) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sequence.emplace_back(s4);
-    sequence.emplace_back(s5);
-    sz += s1.size() + s2.size() + s3.size() + s4.size() + s5.size();
+
+public:
+  File_output(); // memory buffer (nothing written), use append_buffer to move to a file
+  File_output(mmap_lib::str fname);
+  ~File_output();
+
+  File_output(const File_output &)            = delete;
+  File_output &operator=(const File_output &) = delete;
+
+  void append_buffer(const File_output &buf) {
+    I(buf.memory_buffer);
+    append_one(std::string_view(buf.active));
+    if (!memory_buffer && active.size() >= chunk_size)
+      flush_chunk();
   }
-  void append(mmap_lib::str s1, mmap_lib::str s2, mmap_lib::str s3, mmap_lib::str s4, mmap_lib::str s5, mmap_lib::str s6) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sequence.emplace_back(s4);
-    sequence.emplace_back(s5);
-    sequence.emplace_back(s6);
-    sz += s1.size() + s2.size() + s3.size() + s4.size() + s5.size() + s6.size();
+
+  template <typename... Args>
+  void append(const Args &...args) {
+    (append_one(args), ...);
+    if (!memory_buffer && active.size() >= chunk_size)
+      flush_chunk();
   }
 
-  void abort() { aborted = true; } // abort/cancel (the destructor will do nothing)
-};
+  size_t size() const { return sz; }
 
+  void abort(); // abort/cancel (nothing else is written, and any previous file is kept)
+};
@@ -48,12 +48,16 @@ public:
   spsc(size_t size)
       : _size(size)
       , _mask(size - 1)
-      , _buffer(reinterpret_cast<T *>(aligned_alloc(128, sizeof(T) * (size + 1))))
+      , _buffer(reinterpret_cast<T *>(aligned_alloc(alignment, alloc_bytes(size))))
       ,  // need one extra element for a guard
       _head(0)
       , _tail(0) {
     // make sure it's a power of 2
     assert((_size != 0) && ((_size & (~_size + 1)) == _size));
+    if (_buffer == nullptr) {
+      fprintf(stderr, "spsc: could not allocate %zu entries\n", size);
+      abort();
+    }
   }
 
   ~spsc() { free(_buffer); }
@@ -85,6 +89,11 @@ public:
 private:
   typedef char cache_line_pad_t[64];
 
+  static constexpr size_t alignment = 128;
+
+  // aligned_alloc needs a size multiple of the alignment
+  static size_t alloc_bytes(size_t size) { return (sizeof(T) * (size + 1) + alignment - 1) / alignment * alignment; }
+
   cache_line_pad_t _pad0;
   const size_t     _size;
   const size_t     _mask;
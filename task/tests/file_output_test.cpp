@@ -0,0 +1,192 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "file_output.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "lbench.hpp"
+
+class File_output_test : public ::testing::Test {
+protected:
+  void SetUp() override { mmap_lib::str::setup(); }
+
+  static std::string read_file(const std::string &fname) {
+    std::ifstream     in(fname);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+  }
+
+  static double secs_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  static std::vector<std::string> list_files() {
+    std::vector<std::string> names;
+
+    auto *dir = opendir(".");
+    if (dir == nullptr)
+      return names;
+    while (auto *entry = readdir(dir)) {
+      names.emplace_back(entry->d_name);
+    }
+    closedir(dir);
+
+    return names;
+  }
+
+  static long get_peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+};
+
+TEST_F(File_output_test, append_types) {
+  {
+    File_output fout("file_output_test1.v");
+
+    mmap_lib::str name("a_long_name_that_is_not_sso_at_all");
+    fout.append("wire [", 31, ":0] ", name, ";\n");
+    fout.append(static_cast<int64_t>(-7), " ", static_cast<uint8_t>(3), " ", std::string("str"), '\n');
+    fout.append('[', 'x', ']', "\n");
+    fout.append(""_str);
+
+    auto buf = std::make_shared<File_output>();
+    buf->append("  x = ", 42u, ";\n");
+    fout.append_buffer(*buf);
+    EXPECT_EQ(buf->size(), 10);
+  }
+
+  EXPECT_EQ(read_file("file_output_test1.v"), "wire [31:0] a_long_name_that_is_not_sso_at_all;\n-7 3 str\n[x]\n  x = 42;\n");
+}
+
+TEST_F(File_output_test, abort_and_empty) {
+  unlink("file_output_test2.v");
+  {
+    File_output fout("file_output_test2.v");
+    fout.append("something");
+    fout.abort();
+  }
+  EXPECT_NE(access("file_output_test2.v", F_OK), 0);
+
+  std::ofstream("file_output_test2.v") << "old";
+  {
+    File_output fout("file_output_test2.v");
+    for (int i = 0; i < 300000; ++i) {  // several chunks already in the temporary file
+      fout.append("  tmp_", i, " = 0;\n");
+    }
+    fout.abort();
+  }
+  EXPECT_EQ(read_file("file_output_test2.v"), "old");  // the old file is kept
+
+  std::string tmp = "file_output_test2.v.tmp_";
+  for (const auto &name : list_files()) {
+    EXPECT_NE(name.compare(0, tmp.size(), tmp), 0) << name << " was not removed";
+  }
+
+  {
+    File_output fout("file_output_test3.v");
+  }
+  EXPECT_EQ(access("file_output_test3.v", F_OK), 0);
+  EXPECT_EQ(read_file("file_output_test3.v"), "");
+}
+
+TEST_F(File_output_test, large_chunks) {
+  std::string expected;
+  {
+    File_output fout("file_output_test4.v");
+    for (int i = 0; i < 300000; ++i) {
+      fout.append("  tmp_", i, " = tmp_", i - 1, " + 1;\n");
+      expected += fmt::format("  tmp_{} = tmp_{} + 1;\n", i, i - 1);
+    }
+    EXPECT_EQ(fout.size(), expected.size());
+  }
+  EXPECT_EQ(read_file("file_output_test4.v"), expected);
+}
+
+TEST_F(File_output_test, bench) {
+  // cgen-like pattern: short literals, names and integers
+  constexpr int n_lines = 4000000;
+
+  std::vector<mmap_lib::str> names;
+  for (int i = 0; i < 1024; ++i) {
+    names.emplace_back(mmap_lib::str::concat("___some_verilog_wire_", i));
+  }
+
+  size_t nbytes = 0;
+  auto   rss_start = get_peak_rss_kb();
+  {
+    Lbench      b("task.file_output.vector_str");
+    auto        start = std::chrono::steady_clock::now();
+    std::string fname("file_output_bench1.v");
+
+    // The previous File_output: keep all the fragments (and the size), and
+    // in the destructor fill an mmap of the file with fill_txt_direct
+    std::vector<mmap_lib::str> sequence;
+    for (int i = 0; i < n_lines; ++i) {
+      mmap_lib::str s1("  ");
+      mmap_lib::str s2(names[i & 1023]);
+      mmap_lib::str s3(" = ");
+      mmap_lib::str s4(static_cast<int64_t>(i));
+      mmap_lib::str s5(";\n");
+      nbytes += s1.size() + s2.size() + s3.size() + s4.size() + s5.size();
+      sequence.emplace_back(s1);
+      sequence.emplace_back(s2);
+      sequence.emplace_back(s3);
+      sequence.emplace_back(s4);
+      sequence.emplace_back(s5);
+    }
+
+    int fd = ::open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    size_t map_size = ((nbytes >> 12) + 1) << 12;
+    ASSERT_EQ(ftruncate(fd, map_size), 0);
+    auto *base = static_cast<char *>(::mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    ASSERT_NE(base, MAP_FAILED);
+
+    char *ptr = base;
+    for (const auto &e : sequence) {
+      ptr += e.fill_txt_direct(ptr);
+    }
+    EXPECT_EQ(static_cast<size_t>(ptr - base), nbytes);
+
+    ::munmap(base, map_size);
+    EXPECT_EQ(ftruncate(fd, nbytes), 0);
+    ::close(fd);
+
+    auto secs = secs_since(start);
+    fmt::print("vector_str secs:{} MB/s:{} peak_rss:{}KB\n", secs, nbytes / secs / 1e6, get_peak_rss_kb() - rss_start);
+  }
+
+  rss_start = get_peak_rss_kb();
+  {
+    Lbench b("task.file_output.streaming");
+    auto   start = std::chrono::steady_clock::now();
+    {
+      File_output fout("file_output_bench2.v");
+      for (int i = 0; i < n_lines; ++i) {
+        fout.append("  ", names[i & 1023], " = ", i, ";\n");
+      }
+      EXPECT_EQ(fout.size(), nbytes);
+    }
+
+    auto secs = secs_since(start);
+    fmt::print("streaming  secs:{} MB/s:{} peak_rss:{}KB\n", secs, nbytes / secs / 1e6, get_peak_rss_kb() - rss_start);
+  }
+
+  EXPECT_EQ(read_file("file_output_bench1.v"), read_file("file_output_bench2.v"));
+}
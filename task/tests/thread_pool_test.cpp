@@ -145,6 +145,33 @@ TEST_F(GTest1, interface) {
   }
 }
 
+TEST_F(GTest1, wait_until_done_nested) {
+  Thread_pool      pool(4);
+  std::atomic<int> sum = 0;
+
+  std::atomic<int> outer = 0;
+  for (int i = 0; i < 8; ++i) {
+    ++outer;
+    pool.add([&pool, &sum, &outer]() {
+      std::atomic<int> inner = 0;  // local group waited from inside a job
+      for (int j = 0; j < 100; ++j) {
+        ++inner;
+        pool.add([&sum, &inner]() {
+          ++sum;
+          --inner;
+        });
+      }
+      pool.wait_until_done(inner);
+      --outer;
+    });
+  }
+
+  pool.wait_until_done(outer);
+  EXPECT_EQ(sum, 800);
+
+  pool.wait_all();
+}
+
 TEST_F(GTest1, bench) {
   {
     Lbench bb("task.THREAD_POOL_mpmc");
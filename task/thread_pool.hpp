@@ -222,6 +222,19 @@ public:
   }
 #endif
 
+  // Wait for a group of jobs (pending reaches zero). It can be called from a
+  // thread_pool job because queued jobs are executed while waiting.
+  void wait_until_done(const std::atomic<int> &pending) {
+    while (pending > 0) {
+      std::function<void(void)> res;
+      bool                      has_work = queue.dequeue(res);
+      if (has_work) {
+        res();
+        jobs_left.fetch_sub(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
   void wait_all() {
     while (jobs_left > 0) {
       std::function<void(void)> res;